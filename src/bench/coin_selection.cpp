@@ -13,6 +13,7 @@
 
 using node::NodeContext;
 using wallet::AttemptSelection;
+using wallet::AutomaticCoinSelection;
 using wallet::CHANGE_LOWER;
 using wallet::COutput;
 using wallet::CWallet;
@@ -80,6 +81,43 @@ static void CoinSelection(benchmark::Bench& bench)
     });
 }
 
+// Selection from the coins of a very large wallet, where AutomaticCoinSelection()
+// narrows the 200k coins to a window around the target
+static void CoinSelectionLargeWallet(benchmark::Bench& bench)
+{
+    NodeContext node;
+    auto chain = interfaces::MakeChain(node);
+    CWallet wallet(chain.get(), "", CreateDummyWalletDatabase());
+    std::vector<std::unique_ptr<CWalletTx>> wtxs;
+    LOCK(wallet.cs_wallet);
+
+    // Coins from 0.01 to 10 PPC
+    for (int i = 0; i < 200000; ++i) {
+        addCoin((i * 7919 % 1000 + 1) * CENT, wallet, wtxs);
+    }
+
+    wallet::CoinsResult available_coins;
+    const int input_bytes{CalculateMaximumSignedInputSize(wtxs[0]->tx->vout.at(0), &wallet, /*coin_control=*/nullptr)};
+    for (const auto& wtx : wtxs) {
+        const auto txout = wtx->tx->vout.at(0);
+        available_coins.coins[OutputType::BECH32].emplace_back(COutPoint(wtx->GetHash(), 0), txout, /*depth=*/6 * 24, input_bytes, /*spendable=*/true, /*solvable=*/true, /*safe=*/true, wtx->GetTxTime(), /*from_me=*/true, /*fees=*/ 0);
+    }
+
+    FastRandomContext rand{};
+    const CoinSelectionParams coin_selection_params{
+        rand,
+        /*change_output_size=*/ 34,
+        /*change_spend_size=*/ 148,
+        /*tx_noinputs_size=*/ 0,
+        /*avoid_partial=*/ false,
+    };
+    bench.epochIterations(5).run([&] {
+        auto result = AutomaticCoinSelection(wallet, available_coins, 25 * COIN, coin_selection_params);
+        assert(result);
+        assert(result->GetSelectedValue() >= 25 * COIN);
+    });
+}
+
 // Copied from src/wallet/test/coinselector_tests.cpp
 static void add_coin(const CAmount& nValue, int nInput, std::vector<OutputGroup>& set)
 {
@@ -120,3 +158,4 @@ static void BnBExhaustion(benchmark::Bench& bench)
 
 BENCHMARK(CoinSelection, benchmark::PriorityLevel::HIGH);
 BENCHMARK(BnBExhaustion, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CoinSelectionLargeWallet, benchmark::PriorityLevel::LOW);
@@ -72,6 +72,17 @@ static void SHA256D64_1024(benchmark::Bench& bench)
     });
 }
 
+static void SHA256DMulti_250b_1024(benchmark::Bench& bench)
+{
+    // 1024 transaction sized messages
+    std::vector<uint8_t> in(250 * 1024, 0), out(32 * 1024);
+    std::vector<Span<const uint8_t>> msgs;
+    for (size_t i = 0; i < 1024; ++i) msgs.emplace_back(in.data() + 250 * i, 250);
+    bench.batch(in.size()).unit("byte").run([&] {
+        SHA256DMulti(out.data(), msgs.data(), msgs.size());
+    });
+}
+
 static void SHA512(benchmark::Bench& bench)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -159,6 +170,7 @@ BENCHMARK(SHA3_256_1M, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256_32b, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SipHash_32b, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256D64_1024, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SHA256DMulti_250b_1024, benchmark::PriorityLevel::HIGH);
 BENCHMARK(FastRandom_32bit, benchmark::PriorityLevel::HIGH);
 BENCHMARK(FastRandom_1bit, benchmark::PriorityLevel::HIGH);
 
@@ -0,0 +1,80 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <univalue.h>
+
+#include <string>
+
+namespace {
+
+/** A document shaped like a verbose block: many transactions with hex blobs. */
+UniValue MakeDocument()
+{
+    UniValue txs(UniValue::VARR);
+    for (int i = 0; i < 1000; ++i) {
+        UniValue tx(UniValue::VOBJ);
+        tx.pushKV("txid", std::string(64, 'a' + i % 6));
+        tx.pushKV("version", 3);
+        tx.pushKV("size", 225 + i);
+        tx.pushKV("locktime", 0);
+        UniValue vout(UniValue::VARR);
+        for (int n = 0; n < 2; ++n) {
+            UniValue out(UniValue::VOBJ);
+            out.pushKV("value", 12.345678 + n);
+            out.pushKV("n", n);
+            UniValue spk(UniValue::VOBJ);
+            spk.pushKV("asm", "0 751e76e8199196d454941c45d1b3a323f1433bd6");
+            spk.pushKV("desc", "addr(pc1qw508d6qejxtdg4y5r3zarvary0c5xw7kzp2xfx)#2v0rc7az");
+            spk.pushKV("hex", "0014751e76e8199196d454941c45d1b3a323f1433bd6");
+            spk.pushKV("type", "witness_v0_keyhash");
+            out.pushKV("scriptPubKey", spk);
+            vout.push_back(out);
+        }
+        tx.pushKV("vout", vout);
+        tx.pushKV("hex", std::string(450, '0' + i % 10));
+        txs.push_back(tx);
+    }
+    UniValue block(UniValue::VOBJ);
+    block.pushKV("hash", std::string(64, 'f'));
+    block.pushKV("tx", txs);
+    return block;
+}
+
+} // namespace
+
+static void UniValueParse(benchmark::Bench& bench)
+{
+    const std::string json{MakeDocument().write()};
+    bench.batch(json.size()).unit("byte").run([&] {
+        UniValue v;
+        const bool ok{v.read(json)};
+        assert(ok);
+    });
+}
+
+static void UniValueWrite(benchmark::Bench& bench)
+{
+    const UniValue doc{MakeDocument()};
+    bench.run([&] {
+        ankerl::nanobench::doNotOptimizeAway(doc.write());
+    });
+}
+
+static void UniValueFindKey(benchmark::Bench& bench)
+{
+    UniValue obj(UniValue::VOBJ);
+    for (int i = 0; i < 1000; ++i) {
+        obj.__pushKV("key" + std::to_string(i), i);
+    }
+    const std::string key{"key999"};
+    bench.run([&] {
+        ankerl::nanobench::doNotOptimizeAway(find_value(obj, key));
+    });
+}
+
+BENCHMARK(UniValueParse, benchmark::PriorityLevel::HIGH);
+BENCHMARK(UniValueWrite, benchmark::PriorityLevel::HIGH);
+BENCHMARK(UniValueFindKey, benchmark::PriorityLevel::HIGH);
@@ -36,7 +36,8 @@ TipBlock getTip(const CChainParams& params, const node::NodeContext& context)
 void generateFakeBlock(const CChainParams& params,
                        const node::NodeContext& context,
                        CWallet& wallet,
-                       const CScript& coinbase_out_script)
+                       const CScript& coinbase_out_script,
+                       const std::vector<CTxOut>& payments = {})
 {
     TipBlock tip{getTip(params, context)};
 
@@ -52,6 +53,13 @@ void generateFakeBlock(const CChainParams& params,
     coinbase_tx.vout[1].scriptPubKey = coinbase_out_script; // extra output
     coinbase_tx.vout[1].nValue = 1 * COIN;
     block.vtx = {MakeTransactionRef(std::move(coinbase_tx))};
+    if (!payments.empty()) {
+        // A payment from outside the wallet, which unlike the coinbase does not need to mature
+        CMutableTransaction payment_tx;
+        payment_tx.vin.emplace_back(COutPoint{block.vtx[0]->GetHash(), 0});
+        payment_tx.vout = payments;
+        block.vtx.push_back(MakeTransactionRef(std::move(payment_tx)));
+    }
 
     block.nVersion = VERSIONBITS_LAST_OLD_BLOCK_VERSION;
     block.hashPrevBlock = tip.prev_block_hash;
@@ -171,6 +179,55 @@ static void AvailableCoins(benchmark::Bench& bench, const std::vector<OutputType
     });
 }
 
+// An exchange hot wallet: 200k payments of 0.01 to 10 PPC to a few addresses
+static void LargeWallet(benchmark::Bench& bench, bool create_tx)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    CWallet wallet{test_setup->m_node.chain.get(), "", CreateMockWalletDatabase()};
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.SetWalletFlag(WALLET_FLAG_DESCRIPTORS);
+        wallet.SetupDescriptorScriptPubKeyMans();
+        if (wallet.LoadWallet() != DBErrors::LOAD_OK) assert(false);
+    }
+
+    std::vector<CScript> dest_wallet;
+    for (int i = 0; i < 10; ++i) {
+        dest_wallet.emplace_back(GetScriptForDestination(getNewDestination(wallet, OutputType::LEGACY)));
+    }
+
+    const auto& params = Params();
+    const unsigned int chain_size{200};
+    const unsigned int payments_per_block{1000};
+    CAmount total{0};
+    for (unsigned int i = 0; i < chain_size; ++i) {
+        std::vector<CTxOut> payments;
+        for (unsigned int j = 0; j < payments_per_block; ++j) {
+            const CAmount value{((i * payments_per_block + j) * 7919 % 1000 + 1) * CENT};
+            payments.emplace_back(value, dest_wallet[j % dest_wallet.size()]);
+            total += value;
+        }
+        generateFakeBlock(params, test_setup->m_node, wallet, CScript() << OP_TRUE, payments);
+    }
+
+    auto bal = WITH_LOCK(wallet.cs_wallet, return wallet::AvailableCoins(wallet).GetTotalAmount()); // Cache
+    assert(bal == total);
+
+    const CScript dest{GetScriptForDestination(getNewDestination(wallet, OutputType::LEGACY))};
+    std::vector<wallet::CRecipient> recipients = {{dest, 25 * COIN, false}};
+    wallet::CCoinControl coin_control;
+    bench.epochIterations(1).run([&] {
+        LOCK(wallet.cs_wallet);
+        if (create_tx) {
+            const auto& tx_res = CreateTransaction(wallet, recipients, -1, coin_control);
+            assert(tx_res);
+        } else {
+            const auto& res = wallet::AvailableCoins(wallet);
+            assert(res.Size() == chain_size * payments_per_block);
+        }
+    });
+}
+
 static void WalletCreateTxUseOnlyPresetInputs(benchmark::Bench& bench) { WalletCreateTx(bench, OutputType::BECH32, /*allow_other_inputs=*/false,
                                                                                         {{/*num_of_internal_inputs=*/4}}); }
 
@@ -179,6 +236,12 @@ static void WalletCreateTxUsePresetInputsAndCoinSelection(benchmark::Bench& benc
 
 static void WalletAvailableCoins(benchmark::Bench& bench) { AvailableCoins(bench, {OutputType::BECH32M}); }
 
+static void WalletCreateTxLargeWallet(benchmark::Bench& bench) { LargeWallet(bench, /*create_tx=*/true); }
+
+static void WalletAvailableCoinsLargeWallet(benchmark::Bench& bench) { LargeWallet(bench, /*create_tx=*/false); }
+
 BENCHMARK(WalletCreateTxUseOnlyPresetInputs, benchmark::PriorityLevel::LOW)
 BENCHMARK(WalletCreateTxUsePresetInputsAndCoinSelection, benchmark::PriorityLevel::LOW)
-BENCHMARK(WalletAvailableCoins, benchmark::PriorityLevel::LOW);
\ No newline at end of file
+BENCHMARK(WalletAvailableCoins, benchmark::PriorityLevel::LOW);
+BENCHMARK(WalletCreateTxLargeWallet, benchmark::PriorityLevel::LOW);
+BENCHMARK(WalletAvailableCoinsLargeWallet, benchmark::PriorityLevel::LOW);
\ No newline at end of file
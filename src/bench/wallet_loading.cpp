@@ -92,6 +92,29 @@ static void WalletLoading(benchmark::Bench& bench, bool legacy_wallet)
     });
 }
 
+#ifdef USE_SQLITE
+static void WalletCreateDescriptors(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<TestingSetup>();
+    test_setup->m_args.ForceSetArg("-unsafesqlitesync", "1");
+    test_setup->m_args.ForceSetArg("-keypool", "1000");
+
+    WalletContext context;
+    context.args = &test_setup->m_args;
+    context.chain = test_setup->m_node.chain.get();
+
+    // Creating the wallet tops up the keypool of every descriptor
+    DatabaseOptions options;
+    options.create_flags = WALLET_FLAG_DESCRIPTORS;
+    options.require_format = DatabaseFormat::SQLITE;
+    bench.epochs(5).run([&] {
+        auto wallet = BenchLoadWallet(CreateMockWalletDatabase(options), context, options);
+        BenchUnloadWallet(std::move(wallet));
+    });
+}
+BENCHMARK(WalletCreateDescriptors, benchmark::PriorityLevel::HIGH);
+#endif
+
 #ifdef USE_BDB
 static void WalletLoadingLegacy(benchmark::Bench& bench) { WalletLoading(bench, /*legacy_wallet=*/true); }
 BENCHMARK(WalletLoadingLegacy, benchmark::PriorityLevel::HIGH);
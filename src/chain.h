@@ -143,6 +143,11 @@ enum BlockStatus : uint32_t {
      * on a background chainstate. See `doc/design/assumeutxo.md`.
      */
     BLOCK_ASSUMED_VALID      =   256,
+
+    //! peercoin: the stake state of the block (stake modifier, entropy bit,
+    //! proof-of-stake hash, mint and money supply) was loaded from a UTXO
+    //! snapshot and has not been recomputed from the block data yet.
+    BLOCK_SNAPSHOT_STAKE     =   512,
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -17,6 +17,21 @@
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * Run a chunk of verifications, stopping at the first one that fails.
+ * A type whose verifications are faster together can overload this for
+ * std::vector of it; CCheckQueue finds the overload by argument-dependent
+ * lookup.
+ */
+template <typename T>
+bool RunChecks(std::vector<T>& checks)
+{
+    for (T& check : checks) {
+        if (!check()) return false;
+    }
+    return true;
+}
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -119,9 +134,7 @@ private:
                 fOk = fAllOk;
             }
             // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
+            if (fOk) fOk = RunChecks(vChecks);
             vChecks.clear();
         } while (true);
     }
@@ -32,11 +32,13 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 namespace sha256d64_sse41
 {
 void Transform_4way(unsigned char* out, const unsigned char* in);
+void TransformMulti_4way(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_x86_shani
@@ -436,6 +438,9 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+/** Transform one 64-byte chunk into each of N independent states, stored one
+ *  after the other (8 words per state). */
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -481,6 +486,8 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformMultiType TransformMulti_4way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -564,6 +571,22 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformMulti_4way and TransformMulti_8way, if available. Lane i
+    // continues from the state after i chunks with chunk i.
+    for (const auto& [tr, ways] : {std::pair{TransformMulti_4way, 4}, std::pair{TransformMulti_8way, 8}}) {
+        if (!tr) continue;
+        uint32_t states[64];
+        const unsigned char* chunks[8];
+        for (int i = 0; i < ways; ++i) {
+            std::copy(result[i], result[i] + 8, states + 8 * i);
+            chunks[i] = data + 1 + 64 * i;
+        }
+        tr(states, chunks);
+        for (int i = 0; i < ways; ++i) {
+            if (!std::equal(states + 8 * i, states + 8 * i + 8, result[i + 1])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -576,6 +599,103 @@ bool AVXEnabled()
     return (a & 6) == 6;
 }
 #endif
+
+/** A message being hashed in one lane of a multi-way transform. The full
+ *  chunks are read from the message itself, the rest of the message and the
+ *  padding from tail. */
+struct MultiLane
+{
+    const unsigned char* data;
+    unsigned char* out;
+    size_t full_chunks;
+    size_t chunks;
+    size_t pos;
+    //! Whether the hash is to be hashed again (double-SHA256)
+    bool rehash;
+    bool busy{false};
+    unsigned char tail[128];
+
+    void Start(const unsigned char* msg, size_t len, unsigned char* hash, bool dbl, uint32_t* s)
+    {
+        data = msg;
+        out = hash;
+        rehash = dbl;
+        busy = true;
+        full_chunks = len / 64;
+        const size_t rest = len % 64;
+        chunks = full_chunks + (rest < 56 ? 1 : 2);
+        pos = 0;
+        const size_t tail_size = (chunks - full_chunks) * 64;
+        if (rest) memcpy(tail, msg + full_chunks * 64, rest);
+        tail[rest] = 0x80;
+        memset(tail + rest + 1, 0, tail_size - rest - 1 - 8);
+        WriteBE64(tail + tail_size - 8, uint64_t(len) << 3);
+        sha256::Initialize(s);
+    }
+
+    const unsigned char* Chunk() const { return pos < full_chunks ? data + 64 * pos : tail + 64 * (pos - full_chunks); }
+
+    /** Move on after the current chunk was transformed. Returns true when the
+     *  hash is complete and written to out. */
+    bool Next(uint32_t* s)
+    {
+        if (++pos < chunks) return false;
+        unsigned char hash[32];
+        for (int i = 0; i < 8; ++i) WriteBE32(hash + 4 * i, s[i]);
+        if (rehash) {
+            Start(hash, sizeof(hash), out, false, s);
+            return false;
+        }
+        memcpy(out, hash, sizeof(hash));
+        busy = false;
+        return true;
+    }
+};
+
+/** Hash messages in the lanes of a multi-way transform. A lane that completes
+ *  its message takes the next one, until there are none left; the messages
+ *  still in progress then are completed one chunk at a time. */
+template <size_t WAYS>
+void HashMultiWay(TransformMultiType tr, unsigned char* out, const Span<const unsigned char>* in, size_t count, bool dbl)
+{
+    MultiLane lanes[WAYS];
+    uint32_t states[8 * WAYS];
+    const unsigned char* chunks[WAYS];
+    size_t next = 0;
+    for (size_t i = 0; i < WAYS; ++i, ++next) {
+        lanes[i].Start(in[next].data(), in[next].size(), out + 32 * next, dbl, states + 8 * i);
+    }
+    bool all_busy = true;
+    while (all_busy) {
+        for (size_t i = 0; i < WAYS; ++i) chunks[i] = lanes[i].Chunk();
+        tr(states, chunks);
+        for (size_t i = 0; i < WAYS; ++i) {
+            if (!lanes[i].Next(states + 8 * i)) continue;
+            if (next == count) {
+                all_busy = false;
+                continue;
+            }
+            lanes[i].Start(in[next].data(), in[next].size(), out + 32 * next, dbl, states + 8 * i);
+            ++next;
+        }
+    }
+    for (size_t i = 0; i < WAYS; ++i) {
+        while (lanes[i].busy) {
+            Transform(states + 8 * i, lanes[i].Chunk(), 1);
+            lanes[i].Next(states + 8 * i);
+        }
+    }
+}
+
+void HashMulti(unsigned char* out, const Span<const unsigned char>* in, size_t count, bool dbl)
+{
+    if (TransformMulti_8way && count >= 8) return HashMultiWay<8>(TransformMulti_8way, out, in, count, dbl);
+    if (TransformMulti_4way && count >= 4) return HashMultiWay<4>(TransformMulti_4way, out, in, count, dbl);
+    for (size_t i = 0; i < count; ++i) {
+        CSHA256().Write(in[i].data(), in[i].size()).Finalize(out + 32 * i);
+        if (dbl) CSHA256().Write(out + 32 * i, 32).Finalize(out + 32 * i);
+    }
+}
 } // namespace
 
 
@@ -623,6 +743,7 @@ std::string SHA256AutoDetect()
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        TransformMulti_4way = sha256d64_sse41::TransformMulti_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -630,6 +751,7 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256d64_avx2::TransformMulti_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -761,3 +883,13 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+void SHA256Multi(unsigned char* output, const Span<const unsigned char>* inputs, size_t count)
+{
+    HashMulti(output, inputs, count, false);
+}
+
+void SHA256DMulti(unsigned char* output, const Span<const unsigned char>* inputs, size_t count)
+{
+    HashMulti(output, inputs, count, true);
+}
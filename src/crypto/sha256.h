@@ -5,6 +5,8 @@
 #ifndef BITCOIN_CRYPTO_SHA256_H
 #define BITCOIN_CRYPTO_SHA256_H
 
+#include <span.h>
+
 #include <cstdlib>
 #include <stdint.h>
 #include <string>
@@ -38,4 +40,15 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute the SHA256's of multiple independent messages of any length, in
+ *  the lanes of the multi-way implementations where available.
+ *  output:  pointer to a count*32 byte output buffer
+ *  inputs:  pointer to the count messages
+ *  count:   the number of hashes to compute.
+ */
+void SHA256Multi(unsigned char* output, const Span<const unsigned char>* inputs, size_t count);
+
+/** Same as SHA256Multi, but computes double-SHA256's. */
+void SHA256DMulti(unsigned char* output, const Span<const unsigned char>* inputs, size_t count);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
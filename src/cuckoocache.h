@@ -375,6 +375,20 @@ public:
         return std::make_pair(num_elems, approx_size_bytes);
     }
 
+    /** elements returns a copy of every element that is not marked for
+     * erasure, e.g. to persist the cache. Threadsafe without any concurrent
+     * insert.
+     * @returns the elements held by the cache, in table order
+     */
+    std::vector<Element> elements() const
+    {
+        std::vector<Element> ret;
+        for (uint32_t i = 0; i < size; ++i) {
+            if (!collection_flags.bit_is_set(i)) ret.push_back(table[i]);
+        }
+        return ret;
+    }
+
     /** insert loops at most depth_limit times trying to insert a hash
      * at various locations in the table via a variant of the Cuckoo Algorithm
      * with eight hash locations.
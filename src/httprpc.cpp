@@ -6,19 +6,23 @@
 
 #include <crypto/hmac_sha256.h>
 #include <httpserver.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <util/strencodings.h>
 #include <util/string.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <walletinitinterface.h>
 
 #include <algorithm>
 #include <iterator>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 /** WWW-Authenticate to present with 401 Unauthorized response */
@@ -180,6 +184,7 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
         return false;
     }
 
+    std::optional<HTTPStreamedReply> streamed_reply;
     try {
         // Parse request
         UniValue valRequest;
@@ -204,7 +209,17 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
                 req->WriteReply(HTTP_FORBIDDEN);
                 return false;
             }
+
+            // Methods with large results may stream them into the reply
+            // instead of returning them.
+            streamed_reply.emplace(req, "application/json", "{\"result\":");
+            JSONStreamWriter writer{[&](std::string&& chunk) { streamed_reply->Write(std::move(chunk)); }};
+            jreq.result_writer = &writer;
             UniValue result = tableRPC.execute(jreq);
+            if (writer.HasOutput()) {
+                streamed_reply->Finish(writer.TakeBuffer() + ",\"error\":null,\"id\":" + jreq.id.write() + "}\n");
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
@@ -235,9 +250,20 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
+        if (streamed_reply && streamed_reply->Started()) {
+            // Too late for an error reply, leave the client with a truncated result
+            LogPrintf("Error while streaming reply to %s: %s\n", jreq.strMethod, find_value(objError, "message").getValStr());
+            req->EndChunkedReply();
+            return false;
+        }
         JSONErrorReply(req, objError, jreq.id);
         return false;
     } catch (const std::exception& e) {
+        if (streamed_reply && streamed_reply->Started()) {
+            LogPrintf("Error while streaming reply to %s: %s\n", jreq.strMethod, e.what());
+            req->EndChunkedReply();
+            return false;
+        }
         JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
         return false;
     }
@@ -297,6 +323,59 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+/** Number of bytes at the start of a request body that are inspected to classify it */
+static constexpr size_t CLASSIFY_PEEK_BYTES{4096};
+
+/**
+ * Pick the work queue for a JSON-RPC request from the methods it calls. This
+ * runs on the event loop thread, so only the start of the body is scanned,
+ * textually. A misclassified request is merely served by another queue.
+ */
+static HTTPWorkClass ClassifyJSONRPCRequest(HTTPRequest* req)
+{
+    HTTPWorkClass work_class{HTTPWorkClass::RPC_CHAIN};
+    if (req->GetURI().rfind("/wallet/", 0) == 0) work_class = HTTPWorkClass::RPC_WALLET;
+
+    const std::string body{req->PeekBody(CLASSIFY_PEEK_BYTES)};
+    static constexpr std::string_view METHOD_KEY{"\"method\""};
+    for (size_t pos = body.find(METHOD_KEY); pos != std::string::npos; pos = body.find(METHOD_KEY, pos)) {
+        pos = body.find_first_not_of(" \t\r\n", pos + METHOD_KEY.size());
+        if (pos == std::string::npos || body[pos] != ':') continue;
+        pos = body.find_first_not_of(" \t\r\n", pos + 1);
+        if (pos == std::string::npos || body[pos] != '"') continue;
+        const size_t end{body.find('"', pos + 1)};
+        if (end == std::string::npos) break;
+        const std::string method{body.substr(pos + 1, end - pos - 1)};
+        pos = end + 1;
+
+        if (IsLongRunningRPCMethod(method)) return HTTPWorkClass::LONG_RUNNING;
+        if (tableRPC.commandCategory(method) == "wallet") work_class = HTTPWorkClass::RPC_WALLET;
+    }
+    return work_class;
+}
+
+/** Describe the HTTP work queues for getrpcinfo */
+static UniValue WorkQueueInfo()
+{
+    UniValue work_queues(UniValue::VARR);
+    for (const HTTPWorkQueueStats& stats : GetHTTPWorkQueueStats()) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", HTTPWorkClassName(stats.work_class));
+        entry.pushKV("threads", stats.threads);
+        entry.pushKV("queued", uint64_t(stats.queued));
+        entry.pushKV("max_queued", uint64_t(stats.max_queued));
+        entry.pushKV("active", uint64_t(stats.active));
+        entry.pushKV("processed", stats.processed);
+        entry.pushKV("rejected", stats.rejected);
+        entry.pushKV("avg_wait_us", stats.processed ? count_microseconds(stats.total_wait) / int64_t(stats.processed) : 0);
+        entry.pushKV("max_wait_us", count_microseconds(stats.max_wait));
+        entry.pushKV("avg_exec_us", stats.processed ? count_microseconds(stats.total_exec) / int64_t(stats.processed) : 0);
+        entry.pushKV("max_exec_us", count_microseconds(stats.max_exec));
+        work_queues.push_back(entry);
+    }
+    return work_queues;
+}
+
 bool StartHTTPRPC(const std::any& context)
 {
     LogPrint(BCLog::RPC, "Starting HTTP RPC server\n");
@@ -304,14 +383,16 @@ bool StartHTTPRPC(const std::any& context)
         return false;
 
     auto handle_rpc = [context](HTTPRequest* req, const std::string&) { return HTTPReq_JSONRPC(context, req); };
-    RegisterHTTPHandler("/", true, handle_rpc);
+    auto classify_rpc = [](HTTPRequest* req, const std::string&) { return ClassifyJSONRPCRequest(req); };
+    RegisterHTTPHandler("/", true, handle_rpc, classify_rpc);
     if (g_wallet_init_interface.HasWalletSupport()) {
-        RegisterHTTPHandler("/wallet/", false, handle_rpc);
+        RegisterHTTPHandler("/wallet/", false, handle_rpc, classify_rpc);
     }
     struct event_base* eventBase = EventBase();
     assert(eventBase);
     httpRPCTimerInterface = std::make_unique<HTTPRPCTimerInterface>(eventBase);
     RPCSetTimerInterface(httpRPCTimerInterface.get());
+    RPCSetWorkQueueInfo(WorkQueueInfo);
     return true;
 }
 
@@ -327,6 +408,7 @@ void StopHTTPRPC()
     if (g_wallet_init_interface.HasWalletSupport()) {
         UnregisterHTTPHandler("/wallet/", false);
     }
+    RPCSetWorkQueueInfo({});
     if (httpRPCTimerInterface) {
         RPCUnsetTimerInterface(httpRPCTimerInterface.get());
         httpRPCTimerInterface.reset();
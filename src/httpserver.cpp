@@ -20,8 +20,11 @@
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
 #include <util/threadnames.h>
+#include <util/time.h>
 #include <util/translation.h>
 
+#include <algorithm>
+#include <array>
 #include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
@@ -74,12 +77,25 @@ template <typename WorkItem>
 class WorkQueue
 {
 private:
+    struct Entry {
+        std::unique_ptr<WorkItem> item;
+        SteadyClock::time_point enqueued;
+    };
     Mutex cs;
     std::condition_variable cond GUARDED_BY(cs);
-    std::deque<std::unique_ptr<WorkItem>> queue GUARDED_BY(cs);
+    std::deque<Entry> queue GUARDED_BY(cs);
     bool running GUARDED_BY(cs){true};
     const size_t maxDepth;
 
+    //! Statistics, see HTTPWorkQueueStats
+    size_t m_active GUARDED_BY(cs){0};
+    uint64_t m_processed GUARDED_BY(cs){0};
+    uint64_t m_rejected GUARDED_BY(cs){0};
+    std::chrono::microseconds m_total_wait GUARDED_BY(cs){0};
+    std::chrono::microseconds m_max_wait GUARDED_BY(cs){0};
+    std::chrono::microseconds m_total_exec GUARDED_BY(cs){0};
+    std::chrono::microseconds m_max_exec GUARDED_BY(cs){0};
+
 public:
     explicit WorkQueue(size_t _maxDepth) : maxDepth(_maxDepth)
     {
@@ -92,9 +108,10 @@ public:
     {
         LOCK(cs);
         if (!running || queue.size() >= maxDepth) {
+            ++m_rejected;
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        queue.push_back({std::unique_ptr<WorkItem>(item), SteadyClock::now()});
         cond.notify_one();
         return true;
     }
@@ -103,18 +120,44 @@ public:
     {
         while (true) {
             std::unique_ptr<WorkItem> i;
+            SteadyClock::time_point start;
             {
                 WAIT_LOCK(cs, lock);
                 while (running && queue.empty())
                     cond.wait(lock);
                 if (!running && queue.empty())
                     break;
-                i = std::move(queue.front());
+                i = std::move(queue.front().item);
+                start = SteadyClock::now();
+                const auto wait{std::chrono::duration_cast<std::chrono::microseconds>(start - queue.front().enqueued)};
                 queue.pop_front();
+                m_total_wait += wait;
+                m_max_wait = std::max(m_max_wait, wait);
+                ++m_active;
             }
             (*i)();
+            const auto exec{std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start)};
+            LOCK(cs);
+            --m_active;
+            ++m_processed;
+            m_total_exec += exec;
+            m_max_exec = std::max(m_max_exec, exec);
         }
     }
+    /** Fill in the queue related fields of stats */
+    void GetStats(HTTPWorkQueueStats& stats) EXCLUSIVE_LOCKS_REQUIRED(!cs)
+    {
+        LOCK(cs);
+        stats.queued = queue.size();
+        stats.max_queued = maxDepth;
+        stats.active = m_active;
+        stats.processed = m_processed;
+        stats.rejected = m_rejected;
+        stats.total_wait = m_total_wait;
+        stats.max_wait = m_max_wait;
+        stats.total_exec = m_total_exec;
+        stats.max_exec = m_max_exec;
+    }
     /** Interrupt and exit loops */
     void Interrupt() EXCLUSIVE_LOCKS_REQUIRED(!cs)
     {
@@ -126,13 +169,14 @@ public:
 
 struct HTTPPathHandler
 {
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPRequestClassifier _classifier):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), classifier(_classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPRequestClassifier classifier;
 };
 
 /** HTTP module state */
@@ -143,8 +187,10 @@ static struct event_base* eventBase = nullptr;
 static struct evhttp* eventHTTP = nullptr;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static std::unique_ptr<WorkQueue<HTTPClosure>> g_work_queue{nullptr};
+//! Work queues for handling longer requests off the event loop thread, one per HTTPWorkClass
+static std::array<std::unique_ptr<WorkQueue<HTTPClosure>>, HTTP_WORK_CLASS_COUNT> g_work_queues;
+//! Number of worker threads serving each work queue
+static std::array<int, HTTP_WORK_CLASS_COUNT> g_work_queue_threads{};
 //! Handlers for (sub)paths
 static GlobalMutex g_httppathhandlers_mutex;
 static std::vector<HTTPPathHandler> pathHandlers GUARDED_BY(g_httppathhandlers_mutex);
@@ -332,12 +378,14 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        const HTTPWorkClass work_class{i->classifier(hreq.get(), path)};
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
-        assert(g_work_queue);
-        if (g_work_queue->Enqueue(item.get())) {
+        const auto& queue{g_work_queues.at(static_cast<size_t>(work_class))};
+        assert(queue);
+        if (queue->Enqueue(item.get())) {
             item.release(); /* if true, queue took ownership */
         } else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: request rejected because %s work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n", HTTPWorkClassName(work_class));
             item->req->WriteReply(HTTP_SERVICE_UNAVAILABLE, "Work queue depth exceeded");
         }
     } else {
@@ -405,10 +453,33 @@ static bool HTTPBindAddresses(struct evhttp* http)
     return !boundSockets.empty();
 }
 
+std::string HTTPWorkClassName(HTTPWorkClass work_class)
+{
+    switch (work_class) {
+    case HTTPWorkClass::RPC_CHAIN: return "rpc_chain";
+    case HTTPWorkClass::RPC_WALLET: return "rpc_wallet";
+    case HTTPWorkClass::REST: return "rest";
+    case HTTPWorkClass::LONG_RUNNING: return "long_running";
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+/** Thread name prefix for the workers of a work class */
+static std::string HTTPWorkerThreadName(HTTPWorkClass work_class)
+{
+    switch (work_class) {
+    case HTTPWorkClass::RPC_CHAIN: return "httpworker";
+    case HTTPWorkClass::RPC_WALLET: return "httpwallet";
+    case HTTPWorkClass::REST: return "httprest";
+    case HTTPWorkClass::LONG_RUNNING: return "httplong";
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
 /** Simple wrapper to set thread name and run work queue */
-static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, int worker_num)
+static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, HTTPWorkClass work_class, int worker_num)
 {
-    util::ThreadRename(strprintf("httpworker.%i", worker_num));
+    util::ThreadRename(strprintf("%s.%i", HTTPWorkerThreadName(work_class), worker_num));
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::NET_HTTP_SERVER_WORKER);
     queue->Run();
 }
@@ -475,9 +546,11 @@ bool InitHTTPServer()
 
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)gArgs.GetIntArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintfCategory(BCLog::HTTP, "creating work queue of depth %d\n", workQueueDepth);
+    LogPrintfCategory(BCLog::HTTP, "creating work queues of depth %d\n", workQueueDepth);
 
-    g_work_queue = std::make_unique<WorkQueue<HTTPClosure>>(workQueueDepth);
+    for (auto& queue : g_work_queues) {
+        queue = std::make_unique<WorkQueue<HTTPClosure>>(workQueueDepth);
+    }
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -498,12 +571,20 @@ static std::vector<std::thread> g_thread_http_workers;
 void StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
-    int rpcThreads = std::max((long)gArgs.GetIntArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintfCategory(BCLog::HTTP, "starting %d worker threads\n", rpcThreads);
+    g_work_queue_threads = {
+        int(std::max((long)gArgs.GetIntArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L)),
+        int(std::max((long)gArgs.GetIntArg("-rpcwalletthreads", DEFAULT_HTTP_WALLET_THREADS), 1L)),
+        int(std::max((long)gArgs.GetIntArg("-restthreads", DEFAULT_HTTP_REST_THREADS), 1L)),
+        int(std::max((long)gArgs.GetIntArg("-rpclongthreads", DEFAULT_HTTP_LONG_THREADS), 1L)),
+    };
     g_thread_http = std::thread(ThreadHTTP, eventBase);
 
-    for (int i = 0; i < rpcThreads; i++) {
-        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, g_work_queue.get(), i);
+    for (size_t c = 0; c < HTTP_WORK_CLASS_COUNT; ++c) {
+        const auto work_class{static_cast<HTTPWorkClass>(c)};
+        LogPrintfCategory(BCLog::HTTP, "starting %d %s worker threads\n", g_work_queue_threads[c], HTTPWorkClassName(work_class));
+        for (int i = 0; i < g_work_queue_threads[c]; i++) {
+            g_thread_http_workers.emplace_back(HTTPWorkQueueRun, g_work_queues[c].get(), work_class, i);
+        }
     }
 }
 
@@ -514,15 +595,15 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
     }
-    if (g_work_queue) {
-        g_work_queue->Interrupt();
+    for (const auto& queue : g_work_queues) {
+        if (queue) queue->Interrupt();
     }
 }
 
 void StopHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Stopping HTTP server\n");
-    if (g_work_queue) {
+    if (!g_thread_http_workers.empty()) {
         LogPrint(BCLog::HTTP, "Waiting for HTTP worker threads to exit\n");
         for (auto& thread : g_thread_http_workers) {
             thread.join();
@@ -556,7 +637,9 @@ void StopHTTPServer()
         event_base_free(eventBase);
         eventBase = nullptr;
     }
-    g_work_queue.reset();
+    for (auto& queue : g_work_queues) {
+        queue.reset();
+    }
     LogPrint(BCLog::HTTP, "Stopped HTTP server\n");
 }
 
@@ -597,7 +680,11 @@ HTTPRequest::HTTPRequest(struct evhttp_request* _req, bool _replySent) : req(_re
 
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (chunkedReplyStarted && !replySent) {
+        // The status has been sent already, all that is left is to end the reply
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        EndChunkedReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Unhandled request");
@@ -616,6 +703,17 @@ std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr) cons
         return std::make_pair(false, "");
 }
 
+std::string HTTPRequest::PeekBody(size_t max_bytes) const
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    std::string rv(std::min(max_bytes, evbuffer_get_length(buf)), '\0');
+    const ev_ssize_t copied{evbuffer_copyout(buf, rv.data(), rv.size())};
+    rv.resize(copied > 0 ? copied : 0);
+    return rv;
+}
+
 std::string HTTPRequest::ReadBody()
 {
     struct evbuffer* buf = evhttp_request_get_input_buffer(req);
@@ -648,9 +746,8 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  * Replies must be sent in the main loop in the main http thread,
  * this cannot be done from worker threads.
  */
-void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
+void HTTPRequest::AddReplyHeaders()
 {
-    assert(!replySent && req);
     // Add cors header if it's specified
     if (gArgs.GetArg("-corsdomain","") != "") {
         WriteHeader("Access-Control-Allow-Origin", gArgs.GetArg("-corsdomain",""));
@@ -658,6 +755,29 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     if (ShutdownRequested()) {
         WriteHeader("Connection", "close");
     }
+}
+
+/** Re-enable reading from the socket. This is the second part of the libevent
+ * workaround in http_request_cb. Must be called in the main http thread when
+ * the reply is completed.
+ */
+static void ReenableHTTPRead(struct evhttp_request* req)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
+void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
+{
+    assert(!replySent && !chunkedReplyStarted && req);
+    AddReplyHeaders();
     // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
@@ -665,23 +785,204 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
+        ReenableHTTPRead(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+/* The chunked reply functions below each send one event to the main http
+ * thread. Events triggered from the same thread are handled in order, so the
+ * parts of a reply go out in the order they were written. If the client goes
+ * away in between, libevent detaches the request from its connection, which
+ * turns the remaining chunks into no-ops until the reply is ended.
+ */
+/** How far a chunked reply got. Written by the main http thread, waited on by the worker producing it. */
+struct HTTPReplyFlow {
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    //! Bytes queued by the worker
+    uint64_t m_queued GUARDED_BY(m_mutex){0};
+    //! Bytes handed to the connection by the main http thread
+    uint64_t m_handed GUARDED_BY(m_mutex){0};
+    //! Bytes written to the socket
+    uint64_t m_written GUARDED_BY(m_mutex){0};
+    //! The client went away, or does not read the reply body
+    bool m_done GUARDED_BY(m_mutex){false};
+
+    /** Called by libevent once the connection's output buffer has drained. */
+    static void Drained(struct evhttp_connection*, void* arg)
+    {
+        HTTPReplyFlow* flow = static_cast<HTTPReplyFlow*>(arg);
+        WITH_LOCK(flow->m_mutex, flow->m_written = flow->m_handed);
+        flow->m_cv.notify_all();
+    }
+
+    /** Hand a chunk to the connection. Must be called in the main http thread. */
+    void Send(struct evhttp_request* req, struct evbuffer* evb, size_t size)
+    {
+        {
+            LOCK(m_mutex);
+            m_handed += size;
+            // Without a connection the chunk is dropped, and a HEAD reply
+            // carries no body, so nothing would ever signal its progress.
+            if (!evhttp_request_get_connection(req) || evhttp_request_get_command(req) == EVHTTP_REQ_HEAD) {
+                m_done = true;
             }
         }
+        m_cv.notify_all();
+        evhttp_send_reply_chunk_with_cb(req, evb, &HTTPReplyFlow::Drained, this);
+    }
+};
+
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && !chunkedReplyStarted && req);
+    AddReplyHeaders();
+    chunkedReplyStarted = true;
+    m_reply_flow = std::make_shared<HTTPReplyFlow>();
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+}
+
+void HTTPRequest::WriteReplyChunk(std::string_view chunk)
+{
+    assert(chunkedReplyStarted && !replySent && req);
+    // An empty chunk would end the reply on the wire
+    if (chunk.empty()) return;
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+    WITH_LOCK(m_reply_flow->m_mutex, m_reply_flow->m_queued += chunk.size());
+    auto req_copy = req;
+    auto flow = m_reply_flow;
+    const size_t size = chunk.size();
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb, flow, size]{
+        flow->Send(req_copy, evb, size);
+        evbuffer_free(evb);
+    });
+    ev->trigger(nullptr);
+}
+
+void HTTPRequest::WaitForReplyDrain(size_t max_pending)
+{
+    assert(chunkedReplyStarted && !replySent && req);
+    // A client that reads nothing for this long is not worth holding the worker for
+    constexpr auto STALL_TIMEOUT{std::chrono::seconds{DEFAULT_HTTP_SERVER_TIMEOUT}};
+    HTTPReplyFlow& flow = *m_reply_flow;
+    WAIT_LOCK(flow.m_mutex, lock);
+    while (!flow.m_done && flow.m_queued - flow.m_written > max_pending) {
+        const uint64_t written = flow.m_written;
+        if (flow.m_cv.wait_for(lock, STALL_TIMEOUT) == std::cv_status::timeout && flow.m_written == written) {
+            LogPrint(BCLog::HTTP, "Client stopped reading a streamed reply, no longer waiting for it\n");
+            flow.m_done = true;
+        }
+    }
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(chunkedReplyStarted && !replySent && req);
+    auto req_copy = req;
+    // The flow stays alive until the reply has ended, which replaces its drain callback
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, flow = std::move(m_reply_flow)]{
+        // Ending the reply may free the request, so re-enable reading first.
+        // Nothing is read before control returns to the event loop anyway.
+        ReenableHTTPRead(req_copy);
+        evhttp_send_reply_end(req_copy);
     });
     ev->trigger(nullptr);
     replySent = true;
     req = nullptr; // transferred back to main thread
 }
 
+void HTTPRequest::WriteReplyChunk(const HTTPReplyFile& file, int64_t offset, int64_t length)
+{
+    assert(chunkedReplyStarted && !replySent && req && !file.IsNull());
+    if (length == 0) return;
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    // The buffer holds a reference to the file segment, which the connection's
+    // output buffer takes over when the chunk is sent. Marking it as draining
+    // to a socket keeps libevent from reading the file into memory.
+    evbuffer_set_flags(evb, EVBUFFER_FLAG_DRAINS_TO_FD);
+    if (evbuffer_add_file_segment(evb, file.m_segment, offset, length) != 0) {
+        LogPrintf("%s: adding file segment to reply failed\n", __func__);
+    }
+    auto req_copy = req;
+    auto flow = m_reply_flow;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb, flow]{
+        // File segments take no memory, but still move the drain callback along
+        flow->Send(req_copy, evb, 0);
+        evbuffer_free(evb);
+    });
+    ev->trigger(nullptr);
+}
+
+static void HTTPReplyFileCleanup(struct evbuffer_file_segment const*, int, void* arg)
+{
+    std::fclose(static_cast<FILE*>(arg));
+}
+
+HTTPReplyFile::HTTPReplyFile(FILE* file)
+{
+    if (!file) return;
+    // A length of -1 maps the whole file
+    m_segment = evbuffer_file_segment_new(fileno(file), 0, -1, 0);
+    if (!m_segment) {
+        std::fclose(file);
+        return;
+    }
+    evbuffer_file_segment_add_cleanup_cb(m_segment, HTTPReplyFileCleanup, file);
+}
+
+HTTPReplyFile::~HTTPReplyFile()
+{
+    if (m_segment) evbuffer_file_segment_free(m_segment);
+}
+
+HTTPStreamedReply::HTTPStreamedReply(HTTPRequest* req, std::string content_type, std::string prefix)
+    : m_req(req), m_content_type(std::move(content_type)), m_prefix(std::move(prefix))
+{
+}
+
+void HTTPStreamedReply::Start()
+{
+    if (m_started) return;
+    m_req->WriteHeader("Content-Type", m_content_type);
+    m_req->StartChunkedReply(HTTP_OK);
+    m_req->WriteReplyChunk(m_prefix);
+    m_started = true;
+}
+
+void HTTPStreamedReply::Write(std::string&& chunk)
+{
+    Start();
+    m_req->WriteReplyChunk(chunk);
+    m_req->WaitForReplyDrain(MAX_PENDING_BYTES);
+}
+
+void HTTPStreamedReply::Write(const HTTPReplyFile& file, int64_t offset, int64_t length)
+{
+    Start();
+    m_req->WriteReplyChunk(file, offset, length);
+}
+
+void HTTPStreamedReply::Finish(std::string&& tail)
+{
+    if (!m_started) {
+        m_req->WriteHeader("Content-Type", m_content_type);
+        m_req->WriteReply(HTTP_OK, m_prefix + tail);
+        return;
+    }
+    m_req->WriteReplyChunk(tail);
+    m_req->EndChunkedReply();
+}
+
 CService HTTPRequest::GetPeer() const
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -761,11 +1062,29 @@ std::optional<std::string> GetQueryParameterFromUri(const char* uri, const std::
     return result;
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, HTTPWorkClass work_class)
+{
+    RegisterHTTPHandler(prefix, exactMatch, handler, [work_class](HTTPRequest*, const std::string&) { return work_class; });
+}
+
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
     LOCK(g_httppathhandlers_mutex);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
+}
+
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    std::vector<HTTPWorkQueueStats> result;
+    for (size_t c = 0; c < HTTP_WORK_CLASS_COUNT; ++c) {
+        if (!g_work_queues[c]) continue;
+        HTTPWorkQueueStats& stats{result.emplace_back()};
+        stats.work_class = static_cast<HTTPWorkClass>(c);
+        stats.threads = g_work_queue_threads[c];
+        g_work_queues[c]->GetStats(stats);
+    }
+    return result;
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -5,11 +5,20 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_WALLET_THREADS=2;
+static const int DEFAULT_HTTP_REST_THREADS=2;
+static const int DEFAULT_HTTP_LONG_THREADS=2;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
@@ -17,6 +26,7 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPReplyFlow;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -35,21 +45,82 @@ void StopHTTPServer();
 /** Change logging level for libevent. */
 void UpdateHTTPServerLogging(bool enable);
 
+/**
+ * Class of work a request belongs to. Every class has its own work queue and
+ * worker threads, so that e.g. a flood of REST requests or a slow rescan
+ * cannot starve wallet RPCs.
+ */
+enum class HTTPWorkClass {
+    RPC_CHAIN,    //!< JSON-RPC calls not belonging to another class (-rpcthreads)
+    RPC_WALLET,   //!< JSON-RPC wallet calls (-rpcwalletthreads)
+    REST,         //!< REST interface (-restthreads)
+    LONG_RUNNING, //!< scans, imports and other calls that can take minutes (-rpclongthreads)
+};
+static constexpr size_t HTTP_WORK_CLASS_COUNT{4};
+std::string HTTPWorkClassName(HTTPWorkClass work_class);
+
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Picks the work class of a request. Runs on the event loop thread, so it must be cheap. */
+typedef std::function<HTTPWorkClass(HTTPRequest* req, const std::string &)> HTTPRequestClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
  * be invoked.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         HTTPWorkClass work_class = HTTPWorkClass::RPC_CHAIN);
+/** Register handler for prefix whose requests are sorted into work classes by classifier. */
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         const HTTPRequestClassifier &classifier);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Snapshot of the state and counters of one work queue. */
+struct HTTPWorkQueueStats {
+    HTTPWorkClass work_class;
+    int threads{0};
+    size_t queued{0};
+    size_t max_queued{0};
+    size_t active{0};
+    uint64_t processed{0};
+    uint64_t rejected{0};
+    std::chrono::microseconds total_wait{0};
+    std::chrono::microseconds max_wait{0};
+    std::chrono::microseconds total_exec{0};
+    std::chrono::microseconds max_exec{0};
+};
+/** Return statistics for all work queues (empty if the server is not initialized). */
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
 struct event_base* EventBase();
 
+/**
+ * Open file whose contents can be added to replies without copying them into
+ * memory first. Where the platform supports it the data goes from the page
+ * cache straight to the socket. Parts of the file that are still queued for
+ * sending keep it open, even after this object is destroyed.
+ */
+class HTTPReplyFile
+{
+private:
+    struct evbuffer_file_segment* m_segment{nullptr};
+
+public:
+    /** Take ownership of an open file, which is closed once no reply references it anymore. */
+    explicit HTTPReplyFile(FILE* file);
+    ~HTTPReplyFile();
+
+    HTTPReplyFile(const HTTPReplyFile&) = delete;
+    HTTPReplyFile& operator=(const HTTPReplyFile&) = delete;
+
+    bool IsNull() const { return m_segment == nullptr; }
+
+    friend class HTTPRequest;
+};
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -58,6 +129,12 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    bool chunkedReplyStarted{false};
+    //! Progress of a chunked reply on the wire, shared with the main http thread
+    std::shared_ptr<HTTPReplyFlow> m_reply_flow;
+
+    /** Add the headers every reply carries. */
+    void AddReplyHeaders();
 
 public:
     explicit HTTPRequest(struct evhttp_request* req, bool replySent = false);
@@ -101,6 +178,12 @@ public:
      */
     std::pair<bool, std::string> GetHeader(const std::string& hdr) const;
 
+    /**
+     * Return up to max_bytes from the start of the request body without
+     * consuming it.
+     */
+    std::string PeekBody(size_t max_bytes) const;
+
     /**
      * Read request body.
      *
@@ -125,6 +208,71 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a reply whose body is sent in chunks while it is being produced,
+     * using chunked transfer encoding where the client supports it.
+     *
+     * @note Instead of WriteReply. Add the body with WriteReplyChunk and
+     * complete the reply with EndChunkedReply.
+     */
+    void StartChunkedReply(int nStatus);
+
+    /** Queue the next part of a reply started with StartChunkedReply. */
+    void WriteReplyChunk(std::string_view chunk);
+
+    /** Queue length bytes of file starting at offset as the next part of a reply started with StartChunkedReply. */
+    void WriteReplyChunk(const HTTPReplyFile& file, int64_t offset, int64_t length);
+
+    /**
+     * Wait until no more than max_pending bytes of a chunked reply are queued
+     * but not yet written to the socket. Returns right away once the client
+     * is gone, and stops waiting for a client that makes no progress at all.
+     */
+    void WaitForReplyDrain(size_t max_pending);
+
+    /**
+     * Complete a reply started with StartChunkedReply.
+     *
+     * @note As with WriteReply, do not call any other HTTPRequest methods
+     * after calling this.
+     */
+    void EndChunkedReply();
+};
+
+/**
+ * Reply body that is sent while it is being produced. Nothing is sent until
+ * the producer hands over its first chunk, so small replies, and errors
+ * detected before any output was produced, still go out as a regular reply.
+ */
+class HTTPStreamedReply
+{
+private:
+    HTTPRequest* const m_req;
+    const std::string m_content_type;
+    //! Sent in front of the first part of the body
+    const std::string m_prefix;
+    bool m_started{false};
+
+    void Start();
+
+public:
+    //! Bytes that may be queued for the client before Write blocks the producer
+    static constexpr size_t MAX_PENDING_BYTES{4 << 20};
+
+    HTTPStreamedReply(HTTPRequest* req, std::string content_type, std::string prefix = {});
+
+    /** Whether part of the reply has been sent, so it can no longer be replaced by an error reply. */
+    bool Started() const { return m_started; }
+
+    /** Send the next part of the body. */
+    void Write(std::string&& chunk);
+
+    /** Send length bytes of file starting at offset as the next part of the body. */
+    void Write(const HTTPReplyFile& file, int64_t offset, int64_t length);
+
+    /** Send the remaining body and complete the reply. */
+    void Finish(std::string&& tail);
 };
 
 /** Get the query parameter value from request uri for a specified key, or std::nullopt if the key
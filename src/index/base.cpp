@@ -120,7 +120,8 @@ bool BaseIndex::Init()
             const CBlockIndex* block = active_chain.Tip();
             prune_violation = true;
             // check backwards from the tip if we have all block data until we reach the indexes bestblock
-            while (block_to_test && block && (block->nStatus & BLOCK_HAVE_DATA)) {
+            // peercoin: the blocks of a UTXO snapshot are indexed as the background validation connects them
+            while (block_to_test && block && ((block->nStatus & BLOCK_HAVE_DATA) || (AllowSnapshotGaps() && block->IsAssumedValid()))) {
                 if (block_to_test == block) {
                     prune_violation = false;
                     break;
@@ -189,6 +190,8 @@ void BaseIndex::ThreadSync()
                     return;
                 }
                 pindex = pindex_next;
+                // peercoin: skip the blocks of a UTXO snapshot that are not downloaded yet
+                if (AllowSnapshotGaps() && !(pindex->nStatus & BLOCK_HAVE_DATA) && pindex->IsAssumedValid()) continue;
             }
 
             auto current_time{std::chrono::steady_clock::now()};
@@ -285,6 +288,11 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
                        __func__, pindex->nHeight);
             return;
         }
+    } else if (AllowSnapshotGaps() && SkipsSnapshot(best_block_index, pindex)) {
+        // peercoin: the block is the first one after a UTXO snapshot, continue
+        // from it and leave the blocks of the snapshot to the background validation
+        LogPrintf("%s: %s continues after the UTXO snapshot at height %d\n",
+                  __func__, GetName(), pindex->pprev->nHeight);
     } else {
         // Ensure block connects to an ancestor of the current best block. This should be the case
         // most of the time, but may not be immediately after the sync thread catches up and sets
@@ -318,6 +326,35 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
     }
 }
 
+bool BaseIndex::SkipsSnapshot(const CBlockIndex* best_block_index, const CBlockIndex* pindex) const
+{
+    LOCK(cs_main);
+    const CBlockIndex* snapshot_base{m_chainstate->m_chainman.GetSnapshotBaseBlock()};
+    return snapshot_base && pindex->pprev && best_block_index->nHeight < snapshot_base->nHeight &&
+           pindex->pprev->GetAncestor(snapshot_base->nHeight) == snapshot_base &&
+           snapshot_base->GetAncestor(best_block_index->nHeight) == best_block_index;
+}
+
+void BaseIndex::BackgroundBlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex)
+{
+    if (!m_synced || !AllowSnapshotGaps()) {
+        return;
+    }
+
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    if (!best_block_index || best_block_index->GetAncestor(pindex->nHeight) != pindex) {
+        // The index has not passed the snapshot yet, the block extends it
+        BlockConnected(block, pindex);
+        return;
+    }
+
+    // Fill in a block of the snapshot below the best block of the index
+    if (!CustomAppend(kernel::MakeBlockInfo(pindex, block.get()))) {
+        FatalError("%s: Failed to write block %s to index",
+                   __func__, pindex->GetBlockHash().ToString());
+    }
+}
+
 void BaseIndex::ChainStateFlushed(const CBlockLocator& locator)
 {
     if (!m_synced) {
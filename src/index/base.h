@@ -94,6 +94,15 @@ private:
 
     virtual bool AllowPrune() const = 0;
 
+    /// peercoin: whether the index may skip the blocks below a UTXO snapshot
+    /// base that are not downloaded yet, and fill them in as the background
+    /// validation connects them.
+    virtual bool AllowSnapshotGaps() const { return false; }
+
+    /// peercoin: whether pindex is after the base of the UTXO snapshot in use
+    /// and the best block of the index before it.
+    bool SkipsSnapshot(const CBlockIndex* best_block_index, const CBlockIndex* pindex) const;
+
 protected:
     std::unique_ptr<interfaces::Chain> m_chain;
     Chainstate* m_chainstate{nullptr};
@@ -101,8 +110,12 @@ protected:
 
     void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
 
+    void BackgroundBlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+
     void ChainStateFlushed(const CBlockLocator& locator) override;
 
+    std::string GetSubscriberName() const override { return m_name; }
+
     /// Initialize internal state from the database and block index.
     [[nodiscard]] virtual bool CustomInit(const std::optional<interfaces::BlockKey>& block) { return true; }
 
@@ -13,6 +13,7 @@
 using node::OpenBlockFile;
 
 constexpr uint8_t DB_TXINDEX{'t'};
+constexpr uint8_t DB_SNAPSHOT_TX{'k'};
 
 std::unique_ptr<TxIndex> g_txindex;
 
@@ -29,6 +30,10 @@ public:
 
     /// Write a batch of transaction positions to the DB.
     bool WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos);
+
+    /// peercoin: read and write the kernel data of snapshot transactions.
+    bool ReadSnapshotTx(const uint256& txid, SnapshotTxPos& pos) const;
+    bool WriteSnapshotTxs(const std::vector<std::pair<uint256, SnapshotTxPos>>& v_pos);
 };
 
 TxIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
@@ -49,6 +54,20 @@ bool TxIndex::DB::WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_
     return WriteBatch(batch);
 }
 
+bool TxIndex::DB::ReadSnapshotTx(const uint256& txid, SnapshotTxPos& pos) const
+{
+    return Read(std::make_pair(DB_SNAPSHOT_TX, txid), pos);
+}
+
+bool TxIndex::DB::WriteSnapshotTxs(const std::vector<std::pair<uint256, SnapshotTxPos>>& v_pos)
+{
+    CDBBatch batch(*this);
+    for (const auto& [txid, pos] : v_pos) {
+        batch.Write(std::make_pair(DB_SNAPSHOT_TX, txid), pos);
+    }
+    return WriteBatch(batch);
+}
+
 TxIndex::TxIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
     : BaseIndex(std::move(chain), "txindex"), m_db(std::make_unique<TxIndex::DB>(n_cache_size, f_memory, f_wipe))
 {}
@@ -105,3 +124,13 @@ bool TxIndex::FindTxPosition(const uint256& txid, CDiskTxPos& pos) const
 {
     return m_db->ReadTxPos(txid, pos);
 }
+
+bool TxIndex::FindSnapshotTx(const uint256& txid, SnapshotTxPos& pos) const
+{
+    return m_db->ReadSnapshotTx(txid, pos);
+}
+
+bool TxIndex::WriteSnapshotTxs(const std::vector<std::pair<uint256, SnapshotTxPos>>& v_pos)
+{
+    return m_db->WriteSnapshotTxs(v_pos);
+}
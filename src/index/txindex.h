@@ -11,6 +11,17 @@
 
 static constexpr bool DEFAULT_TXINDEX{false};
 
+/** peercoin: block and offset of a transaction with coins in a UTXO snapshot,
+ * for the stake kernels spending them before the block is downloaded. */
+struct SnapshotTxPos
+{
+    uint256 block_hash;
+    uint32_t block_time{0};
+    unsigned int tx_offset{0}; // after header, as CDiskTxPos::nTxOffset
+
+    SERIALIZE_METHODS(SnapshotTxPos, obj) { READWRITE(obj.block_hash, obj.block_time, VARINT(obj.tx_offset)); }
+};
+
 /**
  * TxIndex is used to look up transactions included in the blockchain by hash.
  * The index is written to a LevelDB database and records the filesystem
@@ -25,6 +36,7 @@ private:
     const std::unique_ptr<DB> m_db;
 
     bool AllowPrune() const override { return false; }
+    bool AllowSnapshotGaps() const override { return true; }
 
 protected:
     bool CustomAppend(const interfaces::BlockInfo& block) override;
@@ -47,6 +59,15 @@ public:
     bool FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const;
 
     bool FindTxPosition(const uint256& txid, CDiskTxPos& pos) const;
+
+    /// peercoin: look up the kernel data of a transaction loaded from a UTXO
+    /// snapshot, see WriteSnapshotTxs().
+    bool FindSnapshotTx(const uint256& txid, SnapshotTxPos& pos) const;
+
+    /// peercoin: record the kernel data of the transactions with coins in a
+    /// UTXO snapshot, whose blocks are only indexed once the background
+    /// validation connects them.
+    bool WriteSnapshotTxs(const std::vector<std::pair<uint256, SnapshotTxPos>>& v_pos);
     std::map<uint256,std::pair<CBlockHeader,CTransactionRef>> cachedTxs;
 };
 
@@ -252,6 +252,8 @@ public:
         virtual void blockDisconnected(const BlockInfo& block) {}
         virtual void updatedBlockTip() {}
         virtual void chainStateFlushed(const CBlockLocator& locator) {}
+        //! Name of the client, reported in validation queue statistics.
+        virtual std::string getNotificationsName() const { return "chain client"; }
     };
 
     //! Register handler for notifications.
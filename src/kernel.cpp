@@ -8,14 +8,19 @@
 #include <streams.h>
 #include <timedata.h>
 #include <bignum.h>
+#include <coins.h>
 #include <txdb.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <util/perfstats.h>
 #include <util/system.h>
 #include <validation.h>
 #include <random.h>
 #include <script/interpreter.h>
 
 #include <index/txindex.h>
+#include <logging.h>
 
 #include <boost/assign/list_of.hpp>
 
@@ -53,6 +58,11 @@ const unsigned int nProtocolV12TestSwitchTime = 1671060214; // Wed 14 Dec 11:23:
 const unsigned int nProtocolV14SwitchTime     = 1717416000; // Mon  3 Jun 12:00:00 UTC 2024
 const unsigned int nProtocolV14TestSwitchTime = 1710720000; // Mon 18 Mar 00:00:00 UTC 2024
 
+static perf::Timer g_perf_compute_stake_modifier{"compute_next_stake_modifier", "ComputeNextStakeModifier"};
+static perf::Timer g_perf_check_proof_of_stake{"check_proof_of_stake", "CheckProofOfStake, including the kernel read and signature check", "txindex_cache_hits"};
+static perf::Timer g_perf_check_proof_of_stake_assumed_valid{"check_proof_of_stake_assumed_valid", "CheckProofOfStake below the assumevalid block, without the signature check", "txindex_cache_hits"};
+static perf::Timer g_perf_kernel_disk_read{"kernel_disk_read", "Reading a kernel transaction and its block header from disk"};
+
 // Hard checkpoints of stake modifiers to ensure they are deterministic
 static std::map<int, unsigned int> mapStakeModifierCheckpoints =
     boost::assign::map_list_of
@@ -261,7 +271,7 @@ static bool SelectBlockFromCandidates(
             *pindexSelected = (const CBlockIndex*) pindex;
         }
     }
-    if (gArgs.GetBoolArg("-debug", false) && gArgs.GetBoolArg("-printstakemodifier", false))
+    if (g_log_debug && g_print_stake_modifier)
         LogPrintf("SelectBlockFromCandidates: selection hash=%s\n", hashBest.ToString());
     return fSelected;
 }
@@ -281,6 +291,7 @@ static bool SelectBlockFromCandidates(
 // blocks.
 bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStakeModifier, bool& fGeneratedStakeModifier, Chainstate& chainstate)
 {
+    perf::ScopedTimer timer{g_perf_compute_stake_modifier};
     const Consensus::Params& params = Params().GetConsensus();
     const CBlockIndex* pindexPrev = pindexCurrent->pprev;
     nStakeModifier = 0;
@@ -295,11 +306,11 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStake
     int64_t nModifierTime = 0;
     if (!GetLastStakeModifier(pindexPrev, nStakeModifier, nModifierTime))
         return error("ComputeNextStakeModifier: unable to get last modifier");
-    if (gArgs.GetBoolArg("-debug", false))
+    if (g_log_debug)
         LogPrintf("ComputeNextStakeModifier: prev modifier=0x%016x time=%s epoch=%u\n", nStakeModifier, FormatISO8601DateTime(nModifierTime), (unsigned int)nModifierTime);
     if (nModifierTime / params.nModifierInterval >= pindexPrev->GetBlockTime() / params.nModifierInterval)
     {
-        if (gArgs.GetBoolArg("-debug", false))
+        if (g_log_debug)
             LogPrintf("ComputeNextStakeModifier: no new interval keep current modifier: pindexPrev nHeight=%d nTime=%u\n", pindexPrev->nHeight, (unsigned int)pindexPrev->GetBlockTime());
         return true;
     }
@@ -308,13 +319,13 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStake
         // v0.4+ requires current block timestamp also be in a different modifier interval
         if (IsProtocolV04(pindexCurrent->nTime))
         {
-            if (gArgs.GetBoolArg("-debug", false))
+            if (g_log_debug)
                 LogPrintf("ComputeNextStakeModifier: (v0.4+) no new interval keep current modifier: pindexCurrent nHeight=%d nTime=%u\n", pindexCurrent->nHeight, (unsigned int)pindexCurrent->GetBlockTime());
             return true;
         }
         else
         {
-            if (gArgs.GetBoolArg("-debug", false))
+            if (g_log_debug)
                 LogPrintf("ComputeNextStakeModifier: v0.3 modifier at block %s not meeting v0.4+ protocol: pindexCurrent nHeight=%d nTime=%u\n", pindexCurrent->GetBlockHash().ToString(), pindexCurrent->nHeight, (unsigned int)pindexCurrent->GetBlockTime());
         }
     }
@@ -370,13 +381,13 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStake
         nStakeModifierNew |= (((uint64_t)pindex->GetStakeEntropyBit()) << nRound);
         // add the selected block from candidates to selected list
         mapSelectedBlocks.insert(make_pair(pindex->GetBlockHash(), pindex));
-        if (gArgs.GetBoolArg("-debug", false) && gArgs.GetBoolArg("-printstakemodifier", false))
+        if (g_log_debug && g_print_stake_modifier)
             LogPrintf("ComputeNextStakeModifier: selected round %d stop=%s height=%d bit=%d\n",
                 nRound, FormatISO8601DateTime(nSelectionIntervalStop), pindex->nHeight, pindex->GetStakeEntropyBit());
     }
 
     // Print selection map for visualization of the selected blocks
-    if (gArgs.GetBoolArg("-debug", false) && gArgs.GetBoolArg("-printstakemodifier", false))
+    if (g_log_debug && g_print_stake_modifier)
     {
         string strSelectionMap = "";
         // '-' indicates proof-of-work blocks not selected
@@ -397,7 +408,7 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t &nStake
         }
         LogPrintf("ComputeNextStakeModifier: selection height [%d, %d] map %s\n", nHeightFirstCandidate, pindexPrev->nHeight, strSelectionMap);
     }
-    if (gArgs.GetBoolArg("-debug", false))
+    if (g_log_debug)
         LogPrintf("ComputeNextStakeModifier: new modifier=0x%016x time=%s\n", nStakeModifierNew, FormatISO8601DateTime(pindexPrev->GetBlockTime()));
 
     nStakeModifier = nStakeModifierNew;
@@ -507,6 +518,14 @@ static bool GetKernelStakeModifierV03(CBlockIndex* pindexPrev, uint256 hashBlock
     return true;
 }
 
+std::optional<KernelStakeModifier> GetKernelStakeModifierV05(CBlockIndex* pindexPrev, unsigned int nTimeTx)
+{
+    KernelStakeModifier modifier;
+    if (!GetKernelStakeModifierV05(pindexPrev, nTimeTx, modifier.nStakeModifier, modifier.nStakeModifierHeight, modifier.nStakeModifierTime, false))
+        return std::nullopt;
+    return modifier;
+}
+
 // Get the stake modifier specified by the protocol to hash for a stake kernel
 static bool GetKernelStakeModifier(CBlockIndex* pindexPrev, uint256 hashBlockFrom, unsigned int nTimeTx, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake, Chainstate& chainstate)
 {
@@ -542,7 +561,7 @@ static bool GetKernelStakeModifier(CBlockIndex* pindexPrev, uint256 hashBlockFro
 //   quantities so as to generate blocks faster, degrading the system back into
 //   a proof-of-work situation.
 //
-bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader& blockFrom, unsigned int nTxPrevOffset, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake, Chainstate& chainstate)
+bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader& blockFrom, unsigned int nTxPrevOffset, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake, Chainstate& chainstate, const KernelStakeModifier* pStakeModifier, bool fCheckTarget)
 {
     const Consensus::Params& params = Params().GetConsensus();
     unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
@@ -568,7 +587,13 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
     int64_t nStakeModifierTime = 0;
     if (IsProtocolV03(nTimeTx))  // v0.3 protocol
     {
-        if (!GetKernelStakeModifier(pindexPrev, blockFrom.GetHash(), nTimeTx, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake, chainstate))
+        if (pStakeModifier && IsProtocolV05(nTimeTx))
+        {
+            nStakeModifier = pStakeModifier->nStakeModifier;
+            nStakeModifierHeight = pStakeModifier->nStakeModifierHeight;
+            nStakeModifierTime = pStakeModifier->nStakeModifierTime;
+        }
+        else if (!GetKernelStakeModifier(pindexPrev, blockFrom.GetHash(), nTimeTx, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake, chainstate))
             return false;
         ss << nStakeModifier;
     }
@@ -587,7 +612,7 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
             LogPrintf("CheckStakeKernelHash() : using modifier 0x%016x at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
                 nStakeModifier, nStakeModifierHeight,
                 FormatISO8601DateTime(nStakeModifierTime),
-                pindexTmp->nHeight,
+                pindexTmp ? pindexTmp->nHeight : -1,
                 FormatISO8601DateTime(blockFrom.GetBlockTime()));
         }
         LogPrintf("CheckStakeKernelHash() : check protocol=%s modifier=0x%016x nTimeBlockFrom=%u nTxPrevOffset=%u nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
@@ -598,9 +623,9 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
     }
 
     // Now check if proof-of-stake hash meets target protocol
-    if (CBigNum(hashProofOfStake) > bnCoinDayWeight * bnTargetPerCoinDay)
+    if (fCheckTarget && CBigNum(hashProofOfStake) > bnCoinDayWeight * bnTargetPerCoinDay)
         return false;
-    if (gArgs.GetBoolArg("-debug", false) && !fPrintProofOfStake)
+    if (g_log_debug && !fPrintProofOfStake)
     {
         if (IsProtocolV03(nTimeTx)) {
             LOCK(cs_main);
@@ -608,7 +633,7 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
             LogPrintf("CheckStakeKernelHash() : using modifier 0x%016x at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
                 nStakeModifier, nStakeModifierHeight, 
                 FormatISO8601DateTime(nStakeModifierTime),
-                pindexTmp->nHeight,
+                pindexTmp ? pindexTmp->nHeight : -1,
                 FormatISO8601DateTime(blockFrom.GetBlockTime()));
         }
         LogPrintf("CheckStakeKernelHash() : pass protocol=%s modifier=0x%016x nTimeBlockFrom=%u nTxPrevOffset=%u nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
@@ -620,9 +645,51 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBl
     return true;
 }
 
+std::optional<size_t> FindStakeKernelV05(unsigned int nBits, const KernelStakeModifier& modifier, const std::vector<StakeKernelCandidate>& candidates, unsigned int nTimeTx)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    CBigNum bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits);
+
+    // Serialized kernel hash input: nStakeModifier, nTimeBlockFrom,
+    // nTxPrevOffset, nTimeTxPrev, prevout.n, nTimeTx
+    static constexpr size_t KERNEL_SIZE{28};
+    static constexpr size_t BATCH_SIZE{256};
+    unsigned char kernels[BATCH_SIZE][KERNEL_SIZE];
+    Span<const unsigned char> messages[BATCH_SIZE];
+    unsigned char hashes[BATCH_SIZE * CSHA256::OUTPUT_SIZE];
+    for (size_t begin = 0; begin < candidates.size(); begin += BATCH_SIZE) {
+        const size_t count{std::min(BATCH_SIZE, candidates.size() - begin)};
+        for (size_t i = 0; i < count; ++i) {
+            const StakeKernelCandidate& candidate{candidates[begin + i]};
+            WriteLE64(kernels[i], modifier.nStakeModifier);
+            WriteLE32(kernels[i] + 8, candidate.nTimeBlockFrom);
+            WriteLE32(kernels[i] + 12, candidate.nTxPrevOffset);
+            WriteLE32(kernels[i] + 16, candidate.nTimeTxPrev);
+            WriteLE32(kernels[i] + 20, candidate.nPrevout);
+            WriteLE32(kernels[i] + 24, nTimeTx);
+            messages[i] = kernels[i];
+        }
+        SHA256DMulti(hashes, messages, count);
+
+        for (size_t i = 0; i < count; ++i) {
+            const StakeKernelCandidate& candidate{candidates[begin + i]};
+            if (nTimeTx < candidate.nTimeTxPrev || candidate.nTimeBlockFrom + params.nStakeMinAge > nTimeTx)
+                continue;
+            const int64_t nTimeWeight = min((int64_t)nTimeTx - candidate.nTimeTxPrev, params.nStakeMaxAge) - params.nStakeMinAge;
+            const CBigNum bnCoinDayWeight = CBigNum(candidate.nValueIn) * nTimeWeight / COIN / (24 * 60 * 60);
+            const uint256 hashProofOfStake{Span{hashes + i * CSHA256::OUTPUT_SIZE, CSHA256::OUTPUT_SIZE}};
+            if (CBigNum(hashProofOfStake) <= bnCoinDayWeight * bnTargetPerCoinDay)
+                return begin + i;
+        }
+    }
+    return std::nullopt;
+}
+
 // Check kernel hash target and coinstake signature
-bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, const CTransactionRef& tx, unsigned int nBits, uint256& hashProofOfStake, unsigned int nTimeTx, Chainstate& chainstate)
+bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, const CTransactionRef& tx, unsigned int nBits, uint256& hashProofOfStake, unsigned int nTimeTx, Chainstate& chainstate, bool fAssumeValid)
 {
+    perf::ScopedTimer timer{fAssumeValid ? g_perf_check_proof_of_stake_assumed_valid : g_perf_check_proof_of_stake};
     if (!tx->IsCoinStake())
         return error("CheckProofOfStake() : called on non-coinstake %s", tx->GetHash().ToString());
 
@@ -635,33 +702,50 @@ bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, con
 
     // Get transaction index for the previous transaction
     CDiskTxPos postx;
-    if (!g_txindex->FindTxPosition(txin.prevout.hash, postx))
-        return error("CheckProofOfStake() : tx index not found");  // tx index not found
-
-    // Read txPrev and header of its block
+    SnapshotTxPos snapshot_pos;
     CBlockHeader header;
     CTransactionRef txPrev;
-    auto it = g_txindex->cachedTxs.find(txin.prevout.hash);
-    if (it != g_txindex->cachedTxs.end()) {
-        header = it->second.first;
-        txPrev = it->second.second;
-    } else {
-        CAutoFile file(node::OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-        try {
-            file >> header;
-            fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-            file >> txPrev;
-        } catch (std::exception &e) {
-            return error("%s() : deserialize or I/O error in CheckProofOfStake()", __PRETTY_FUNCTION__);
+    unsigned int nTxPrevOffset;
+    if (g_txindex->FindTxPosition(txin.prevout.hash, postx)) {
+        // Read txPrev and header of its block
+        auto it = g_txindex->cachedTxs.find(txin.prevout.hash);
+        if (it != g_txindex->cachedTxs.end()) {
+            header = it->second.first;
+            txPrev = it->second.second;
+            timer.AddItems();
+        } else {
+            perf::ScopedTimer read_timer{g_perf_kernel_disk_read};
+            CAutoFile file(node::OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+            try {
+                file >> header;
+                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
+                file >> txPrev;
+            } catch (std::exception &e) {
+                return error("%s() : deserialize or I/O error in CheckProofOfStake()", __PRETTY_FUNCTION__);
+            }
+            //g_txindex->cachedTxs[txin.prevout.hash] = std::pair(header,txPrev);
         }
-        //g_txindex->cachedTxs[txin.prevout.hash] = std::pair(header,txPrev);
-    }
 
-    if (txPrev->GetHash() != txin.prevout.hash)
-        return error("%s() : txid mismatch in CheckProofOfStake()", __PRETTY_FUNCTION__);
+        if (txPrev->GetHash() != txin.prevout.hash)
+            return error("%s() : txid mismatch in CheckProofOfStake()", __PRETTY_FUNCTION__);
+        nTxPrevOffset = postx.nTxOffset + CBlockHeader::NORMAL_SERIALIZE_SIZE;
+    } else if (g_txindex->FindSnapshotTx(txin.prevout.hash, snapshot_pos)) {
+        // peercoin: the kernel is a coin loaded from a UTXO snapshot whose
+        // block the background validation has not downloaded yet
+        LOCK(cs_main);
+        const CBlockIndex* pindexFrom = chainstate.m_blockman.LookupBlockIndex(snapshot_pos.block_hash);
+        Coin coin;
+        if (!pindexFrom || !chainstate.CoinsTip().GetCoin(txin.prevout, coin))
+            return error("CheckProofOfStake() : snapshot coin %s not found", txin.prevout.ToString());
+        header = pindexFrom->GetBlockHeader();
+        txPrev = MakeSnapshotKernelTx(coin, txin.prevout.n);
+        nTxPrevOffset = snapshot_pos.tx_offset + CBlockHeader::NORMAL_SERIALIZE_SIZE;
+    } else {
+        return error("CheckProofOfStake() : tx index not found");  // tx index not found
+    }
 
     // Verify signature
-    {
+    if (!fAssumeValid) {
         int nIn = 0;
         const CTxOut& prevOut = txPrev->vout[tx->vin[nIn].prevout.n];
         TransactionSignatureChecker checker(&(*tx), nIn, prevOut.nValue, PrecomputedTransactionData(*tx), MissingDataBehavior(1));
@@ -670,12 +754,33 @@ bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, con
             return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "invalid-pos-script", strprintf("%s: VerifyScript failed on coinstake %s", __func__, tx->GetHash().ToString()));
     }
 
-    if (!CheckStakeKernelHash(nBits, pindexPrev, header, postx.nTxOffset + CBlockHeader::NORMAL_SERIALIZE_SIZE, txPrev, txin.prevout, nTimeTx, hashProofOfStake, gArgs.GetBoolArg("-debug", false), chainstate))
+    if (!CheckStakeKernelHash(nBits, pindexPrev, header, nTxPrevOffset, txPrev, txin.prevout, nTimeTx, hashProofOfStake, g_log_debug, chainstate, nullptr, !fAssumeValid))
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "check-kernel-failed", strprintf("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s", tx->GetHash().ToString(), hashProofOfStake.ToString())); // may occur during initial download or if behind on block chain sync
 
     return true;
 }
 
+CTransactionRef MakeSnapshotKernelTx(const Coin& coin, uint32_t n)
+{
+    CMutableTransaction tx;
+    tx.nTime = coin.nTime;
+    tx.vout.resize(n + 1);
+    tx.vout[n] = coin.out;
+    return MakeTransactionRef(std::move(tx));
+}
+
+const CBlockIndex* GetStakeStateWindowStart(const CBlockIndex* pindex)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    // Kernels hash the modifier generated up to nStakeMinAge minus a selection
+    // interval before them. A modifier interval more covers the timestamps of
+    // the next blocks that are below the base block time.
+    const int64_t nWindowStart = pindex->GetBlockTime() - params.nStakeMinAge - GetStakeModifierSelectionInterval() - params.nModifierInterval;
+    while (pindex->pprev && (pindex->GetBlockTime() >= nWindowStart || !pindex->GeneratedStakeModifier()))
+        pindex = pindex->pprev;
+    return pindex;
+}
+
 // Check whether the coinstake timestamp meets protocol
 bool CheckCoinStakeTimestamp(int64_t nTimeBlock, int64_t nTimeTx)
 {
@@ -740,17 +845,17 @@ unsigned int GetStakeEntropyBit(const CBlock& block)
     if (IsProtocolV04(block.nTime))
     {
         nEntropyBit = UintToArith256(block.GetHash()).GetLow64() & 1llu;// last bit of block hash
-        if (gArgs.GetBoolArg("-printstakemodifier", false))
+        if (g_print_stake_modifier)
             LogPrintf("GetStakeEntropyBit(v0.4+): nTime=%u hashBlock=%s entropybit=%d\n", block.nTime, block.GetHash().ToString(), nEntropyBit);
     }
     else
     {
         // old protocol for entropy bit pre v0.4
         uint160 hashSig = Hash160(block.vchBlockSig);
-        if (gArgs.GetBoolArg("-printstakemodifier", false))
+        if (g_print_stake_modifier)
             LogPrintf("GetStakeEntropyBit(v0.3): nTime=%u hashSig=%s", block.nTime, hashSig.ToString());
         nEntropyBit = hashSig.data()[19] >> 7;  // take the first bit of the hash
-        if (gArgs.GetBoolArg("-printstakemodifier", false))
+        if (g_print_stake_modifier)
             LogPrintf(" entropybit=%d\n", nEntropyBit);
     }
     return nEntropyBit;
@@ -6,8 +6,12 @@
 
 #include <primitives/transaction.h> // CTransaction(Ref)
 
+#include <optional>
+#include <vector>
+
 class CBlockIndex;
 class BlockValidationState;
+class Coin;
 class CBlockHeader;
 class CBlock;
 class Chainstate;
@@ -46,13 +50,58 @@ bool IsProtocolV14(const CBlockIndex* pindexPrev);
 // Compute the hash modifier for proof-of-stake
 bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier, Chainstate& chainstate);
 
+// Stake modifier hashed by a v0.5 kernel, with the height and time of the
+// block that generated it
+struct KernelStakeModifier
+{
+    uint64_t nStakeModifier{0};
+    int nStakeModifierHeight{0};
+    int64_t nStakeModifierTime{0};
+};
+
+// Get the v0.5 stake modifier for a kernel at nTimeTx on top of pindexPrev.
+// It does not depend on the staked coin, so a kernel search over many coins
+// gets it once per timestamp.
+std::optional<KernelStakeModifier> GetKernelStakeModifierV05(CBlockIndex* pindexPrev, unsigned int nTimeTx);
+
 // Check whether stake kernel meets hash target
 // Sets hashProofOfStake on success return
-bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader& blockFrom, unsigned int nTxPrevOffset, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake, Chainstate& chainstate);
+// pStakeModifier is the result of GetKernelStakeModifierV05(), if known
+// Without fCheckTarget only the hash is computed, not compared to the target
+bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev, const CBlockHeader& blockFrom, unsigned int nTxPrevOffset, const CTransactionRef& txPrev, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, bool fPrintProofOfStake, Chainstate& chainstate, const KernelStakeModifier* pStakeModifier = nullptr, bool fCheckTarget = true);
+
+// A coin to search a v0.5 kernel for, with the kernel hash inputs of
+// CheckStakeKernelHash()
+struct StakeKernelCandidate
+{
+    unsigned int nTimeBlockFrom{0};
+    unsigned int nTxPrevOffset{0};
+    unsigned int nTimeTxPrev{0};
+    uint32_t nPrevout{0};
+    CAmount nValueIn{0};
+};
+
+// Find the first candidate whose v0.5 kernel hash at nTimeTx meets the target,
+// as CheckStakeKernelHash() would. The kernel hashes are computed in batches
+// with SHA256DMulti().
+std::optional<size_t> FindStakeKernelV05(unsigned int nBits, const KernelStakeModifier& modifier, const std::vector<StakeKernelCandidate>& candidates, unsigned int nTimeTx);
 
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
-bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, const CTransactionRef &tx, unsigned int nBits, uint256& hashProofOfStake, unsigned int nTimeTx, Chainstate& chainstate);
+// fAssumeValid skips the signature and the hash target for blocks covered by
+// -assumevalid, the hash is still computed as the stake modifiers depend on it
+bool CheckProofOfStake(BlockValidationState &state, CBlockIndex* pindexPrev, const CTransactionRef &tx, unsigned int nBits, uint256& hashProofOfStake, unsigned int nTimeTx, Chainstate& chainstate, bool fAssumeValid = false);
+
+// peercoin: stand-in for the transaction of a coin loaded from a UTXO snapshot
+// before its block is downloaded, with the transaction time and the output
+// that kernels and coin age read. It does not hash to the txid.
+CTransactionRef MakeSnapshotKernelTx(const Coin& coin, uint32_t n);
+
+// peercoin: first block of the window ending at pindex whose stake state the
+// proof-of-stake checks of the blocks after pindex read: the modifiers hashed
+// by kernels up to nStakeMinAge earlier and the blocks the next modifiers
+// select from
+const CBlockIndex* GetStakeStateWindowStart(const CBlockIndex* pindex);
 
 // Check whether the coinstake timestamp meets protocol
 bool CheckCoinStakeTimestamp(int64_t nTimeBlock, int64_t nTimeTx);
@@ -529,14 +529,16 @@ public:
             }
         };
 
+        // peercoin: height 110 is the chain of the validation_chainstatemanager
+        // unit tests, height 200 the one of feature_assumeutxo.py
         m_assumeutxo_data = MapAssumeutxo{
             {
                 110,
-                {AssumeutxoHash{uint256S("0x1ebbf5850204c0bdb15bf030f47c7fe91d45c44c712697e4509ba67adb01c618")}, 110},
+                {AssumeutxoHash{uint256S("0x47c39285659fe1de23b61ed3c33e18d73ecf2ef471eb7adc7e6de0aa2f9fff8d")}, 111, uint256S("0x99a70aed9e46daf514d6b80c761d8ebe051a03644408fe23b89583387d76d162")},
             },
             {
                 200,
-                {AssumeutxoHash{uint256S("0x51c8d11d8b5c1de51543c579736e786aa2736206d1e11e627568029ce092cf62")}, 200},
+                {AssumeutxoHash{uint256S("0x788261ee37034eede75254fc022fbdfb54e7e96260fc384dadac8846eb45f2b2")}, 201, uint256S("0x4dddf34fcf13dd045d11d9a3a6866bf34eca03ef836e74e6d83bb727fdb8bc7a")},
             },
         };
 
@@ -52,6 +52,10 @@ struct AssumeutxoData {
     //! We need to hardcode the value here because this is computed cumulatively using block data,
     //! which we do not necessarily have at the time of snapshot load.
     const unsigned int nChainTx;
+
+    //! peercoin: the expected hash of the stake state carried by the snapshot
+    //! (see node::ComputeSnapshotStakeHash), which is not part of the UTXO set.
+    const uint256 hash_stake;
 };
 
 using MapAssumeutxo = std::map<int, const AssumeutxoData>;
@@ -0,0 +1,128 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kernel/validation_cache_persist.h>
+
+#include <clientversion.h>
+#include <kernel/cs_main.h>
+#include <logging.h>
+#include <script/sigcache.h>
+#include <serialize.h>
+#include <streams.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/fs.h>
+#include <util/fs_helpers.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+using fsbridge::FopenFn;
+
+namespace kernel {
+
+static const uint64_t VALIDATION_CACHE_DUMP_VERSION = 2;
+
+bool DumpValidationCaches(const fs::path& dump_path, FopenFn mockable_fopen_function, bool skip_file_commit)
+{
+    auto start = SteadyClock::now();
+
+    uint256 sig_nonce;
+    const std::vector<uint256> sig_entries{DumpSignatureCache(sig_nonce)};
+    uint256 script_nonce;
+    const std::vector<uint256> script_entries{WITH_LOCK(::cs_main, return DumpScriptExecutionCache(script_nonce))};
+
+    auto mid = SteadyClock::now();
+
+    try {
+        FILE* filestr{mockable_fopen_function(dump_path + ".new", "wb")};
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+
+        // Another version may verify differently, so its entries are not reused
+        file << VALIDATION_CACHE_DUMP_VERSION << int32_t{CLIENT_VERSION};
+        file << sig_nonce << sig_entries;
+        file << script_nonce << script_entries;
+
+        if (!skip_file_commit && !FileCommit(file.Get()))
+            throw std::runtime_error("FileCommit failed");
+        file.fclose();
+        if (!RenameOver(dump_path + ".new", dump_path)) {
+            throw std::runtime_error("Rename failed");
+        }
+        auto last = SteadyClock::now();
+
+        LogPrintf("Dumped %u signature and %u script execution cache entries: %gs to copy, %gs to dump\n",
+                  sig_entries.size(), script_entries.size(),
+                  Ticks<SecondsDouble>(mid - start),
+                  Ticks<SecondsDouble>(last - mid));
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump validation caches: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+bool LoadValidationCaches(const fs::path& load_path, FopenFn mockable_fopen_function)
+{
+    if (load_path.empty()) return false;
+
+    uint256 sig_nonce;
+    std::vector<uint256> sig_entries;
+    uint256 script_nonce;
+    std::vector<uint256> script_entries;
+    bool other_version{false};
+    {
+        FILE* filestr{mockable_fopen_function(load_path, "rb")};
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        if (file.IsNull()) {
+            LogPrintf("Failed to open validation cache file from disk. Continuing anyway.\n");
+            return false;
+        }
+
+        // Read the whole dump before touching the caches, so that they keep
+        // their fresh random nonces unless it is complete.
+        try {
+            uint64_t version;
+            int32_t client_version;
+            file >> version >> client_version;
+            if (version != VALIDATION_CACHE_DUMP_VERSION || client_version != CLIENT_VERSION) {
+                LogPrintf("Validation cache file was written by another client version (%d). Discarding it.\n", client_version);
+                other_version = true;
+            } else {
+                file >> sig_nonce >> sig_entries;
+                file >> script_nonce >> script_entries;
+            }
+        } catch (const std::exception& e) {
+            LogPrintf("Failed to deserialize validation cache data on disk: %s. Continuing anyway.\n", e.what());
+            return false;
+        }
+    }
+
+    // Never pick up the same nonces and entries again, e.g. after an unclean
+    // shutdown that did not write a new dump.
+    std::error_code ec;
+    fs::remove(load_path, ec);
+    if (ec) {
+        LogPrintf("Failed to remove validation cache file from disk: %s. Not loading it.\n", ec.message());
+        return false;
+    }
+    if (other_version) return false;
+
+    LoadSignatureCache(sig_nonce, sig_entries);
+    WITH_LOCK(::cs_main, LoadScriptExecutionCache(script_nonce, script_entries));
+
+    LogPrintf("Imported validation caches from disk: %u signature and %u script execution cache entries\n", sig_entries.size(), script_entries.size());
+    return true;
+}
+
+} // namespace kernel
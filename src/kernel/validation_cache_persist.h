@@ -0,0 +1,27 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_KERNEL_VALIDATION_CACHE_PERSIST_H
+#define BITCOIN_KERNEL_VALIDATION_CACHE_PERSIST_H
+
+#include <util/fs.h>
+
+namespace kernel {
+
+/** Dump the signature and script execution caches, with the nonces their
+ *  entries are salted with and the client version, to disk. */
+bool DumpValidationCaches(const fs::path& dump_path,
+                          fsbridge::FopenFn mockable_fopen_function = fsbridge::fopen,
+                          bool skip_file_commit = false);
+
+/** Load the caches dumped by DumpValidationCaches, right after they are set
+ *  up and before anything uses them. The file is removed once read, so a
+ *  dump and its nonces are used for one restart only. A dump of another
+ *  client version is removed without being loaded. */
+bool LoadValidationCaches(const fs::path& load_path,
+                          fsbridge::FopenFn mockable_fopen_function = fsbridge::fopen);
+
+} // namespace kernel
+
+#endif // BITCOIN_KERNEL_VALIDATION_CACHE_PERSIST_H
@@ -16,6 +16,8 @@
 
 const char * const DEFAULT_DEBUGLOGFILE = "debug.log";
 constexpr auto MAX_USER_SETABLE_SEVERITY_LEVEL{BCLog::Level::Info};
+/** Once this much is waiting for the background writer, debug messages are dropped */
+static constexpr size_t MAX_LOG_QUEUE_BYTES{32 << 20};
 
 BCLog::Logger& LogInstance()
 {
@@ -39,6 +41,11 @@ BCLog::Logger& LogInstance()
 }
 
 bool fLogIPs = DEFAULT_LOGIPS;
+std::atomic<bool> g_log_debug{false};
+std::atomic<bool> g_print_stake_modifier{false};
+std::atomic<bool> g_print_coinstake{false};
+std::atomic<bool> g_print_creation{false};
+std::atomic<bool> g_print_coinage{false};
 
 static int FileWriteStr(const std::string &str, FILE *fp)
 {
@@ -48,6 +55,7 @@ static int FileWriteStr(const std::string &str, FILE *fp)
 bool BCLog::Logger::StartLogging()
 {
     StdLockGuard scoped_lock(m_cs);
+    StdLockGuard file_lock(m_file_cs);
 
     assert(m_buffering);
     assert(m_fileout == nullptr);
@@ -80,22 +88,179 @@ bool BCLog::Logger::StartLogging()
         m_msgs_before_open.pop_front();
     }
     if (m_print_to_console) fflush(stdout);
+    m_has_sinks = !m_print_callbacks.empty();
+
+    if (m_log_async) {
+        {
+            std::lock_guard<std::mutex> queue_lock(m_queue_mutex);
+            m_writer_running = true;
+        }
+        m_writer = std::thread(&BCLog::Logger::ThreadWrite, this);
+        m_writer_active = true;
+    }
 
     return true;
 }
 
+void BCLog::Logger::ThreadWrite()
+{
+    util::ThreadRename("logger");
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    m_writer_id = std::this_thread::get_id();
+    while (true) {
+        const auto ready{[&] { return m_writer_stop || !m_queue.empty(); }};
+        if (m_suppressed_pending.load(std::memory_order_relaxed)) {
+            m_queue_cv.wait_for(lock, std::chrono::seconds{1}, ready);
+        } else {
+            m_queue_cv.wait(lock, ready);
+        }
+        if (m_suppressed_pending.load(std::memory_order_relaxed)) {
+            // Queues the report, so it must not hold the queue lock
+            const bool stopping{m_writer_stop};
+            lock.unlock();
+            ReportSuppressed(/*all=*/stopping);
+            lock.lock();
+        }
+        if (m_writing) {
+            // WriteQueued() writes from another thread, keep the order
+            m_written_cv.wait(lock, [&] { return !m_writing; });
+            continue;
+        }
+        if (m_queue.empty()) {
+            if (m_writer_stop) break;
+            continue;
+        }
+
+        std::vector<std::string> batch;
+        batch.swap(m_queue);
+        const size_t bytes{std::exchange(m_queue_bytes, 0)};
+        const uint64_t dropped{std::exchange(m_queue_dropped, 0)};
+        m_writing = true;
+        lock.unlock();
+
+        // The file is unbuffered, so write the batch in one go.
+        std::string out;
+        out.reserve(bytes);
+        for (const std::string& str : batch) out += str;
+        if (dropped > 0) {
+            out += LogTimestampStr(strprintf("%u debug log messages dropped, the log writer could not keep up\n", dropped), /*started_new_line=*/true);
+        }
+        WriteToOutputs(out);
+
+        lock.lock();
+        m_writing = false;
+        m_written_cv.notify_all();
+    }
+    m_writer_id = {};
+    m_writer_running = false;
+    m_written_cv.notify_all();
+}
+
+void BCLog::Logger::Enqueue(std::string&& str, bool droppable)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        if (droppable && m_queue_bytes > MAX_LOG_QUEUE_BYTES) {
+            ++m_queue_dropped;
+            return;
+        }
+        m_queue_bytes += str.size();
+        m_queue.push_back(std::move(str));
+    }
+    m_queue_cv.notify_one();
+}
+
+void BCLog::Logger::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    m_written_cv.wait(lock, [&] { return !m_writer_running || (m_queue.empty() && !m_writing); });
+}
+
+void BCLog::Logger::WriteQueued()
+{
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    if (std::this_thread::get_id() != m_writer_id) {
+        // The lines the background writer is writing were logged first. Do not
+        // wait forever, the process may be aborting because the writer is stuck.
+        m_written_cv.wait_for(lock, std::chrono::seconds{1}, [&] { return !m_writing; });
+    }
+    if (m_queue.empty() && m_queue_dropped == 0) return;
+    std::vector<std::string> batch;
+    batch.swap(m_queue);
+    m_queue_bytes = 0;
+    const uint64_t dropped{std::exchange(m_queue_dropped, 0)};
+    // Still set when called from the writer, or after the wait timed out
+    const bool writer_writing{std::exchange(m_writing, true)};
+    lock.unlock();
+
+    std::string out;
+    for (const std::string& str : batch) out += str;
+    if (dropped > 0) {
+        out += LogTimestampStr(strprintf("%u debug log messages dropped, the log writer could not keep up\n", dropped), /*started_new_line=*/true);
+    }
+    WriteToOutputs(out);
+
+    if (writer_writing) return;
+    lock.lock();
+    m_writing = false;
+    m_written_cv.notify_all();
+}
+
+void BCLog::Logger::StopWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        m_writer_stop = true;
+    }
+    m_queue_cv.notify_all();
+    if (m_writer.joinable()) m_writer.join();
+    std::lock_guard<std::mutex> lock(m_queue_mutex);
+    m_writer_stop = false;
+}
+
 void BCLog::Logger::DisconnectTestLogger()
 {
+    {
+        StdLockGuard scoped_lock(m_cs);
+        m_buffering = true;
+        m_has_sinks = true;
+        m_writer_active = false;
+    }
+    StopWriter();
     StdLockGuard scoped_lock(m_cs);
-    m_buffering = true;
+    StdLockGuard file_lock(m_file_cs);
     if (m_fileout != nullptr) fclose(m_fileout);
     m_fileout = nullptr;
     m_print_callbacks.clear();
 }
 
+void BCLog::Logger::UpdateAcceptMasks()
+{
+    const uint32_t categories{m_categories.load()};
+    for (size_t level = 0; level < m_accept_masks.size(); ++level) {
+        uint32_t mask{0};
+        for (int bit = 0; bit < 32; ++bit) {
+            const auto flag{static_cast<LogFlags>(uint32_t{1} << bit)};
+            if (!(categories & flag)) continue;
+            const auto it{m_category_log_levels.find(flag)};
+            if (static_cast<Level>(level) >= (it == m_category_log_levels.end() ? LogLevel() : it->second)) mask |= flag;
+        }
+        m_accept_masks[level] = mask;
+    }
+}
+
+void BCLog::Logger::SetLogLevel(BCLog::Level level)
+{
+    StdLockGuard scoped_lock(m_cs);
+    m_log_level = level;
+    UpdateAcceptMasks();
+}
+
 void BCLog::Logger::EnableCategory(BCLog::LogFlags flag)
 {
+    StdLockGuard scoped_lock(m_cs);
     m_categories |= flag;
+    UpdateAcceptMasks();
 }
 
 bool BCLog::Logger::EnableCategory(const std::string& str)
@@ -108,7 +273,9 @@ bool BCLog::Logger::EnableCategory(const std::string& str)
 
 void BCLog::Logger::DisableCategory(BCLog::LogFlags flag)
 {
+    StdLockGuard scoped_lock(m_cs);
     m_categories &= ~flag;
+    UpdateAcceptMasks();
 }
 
 bool BCLog::Logger::DisableCategory(const std::string& str)
@@ -130,11 +297,7 @@ bool BCLog::Logger::WillLogCategoryLevel(BCLog::LogFlags category, BCLog::Level
     // important troubleshooting information doesn't get lost.
     if (level >= BCLog::Level::Warning) return true;
 
-    if (!WillLogCategory(category)) return false;
-
-    StdLockGuard scoped_lock(m_cs);
-    const auto it{m_category_log_levels.find(category)};
-    return level >= (it == m_category_log_levels.end() ? LogLevel() : it->second);
+    return (m_accept_masks[static_cast<size_t>(level)].load(std::memory_order_relaxed) & category) != 0;
 }
 
 bool BCLog::Logger::DefaultShrinkDebugFile() const
@@ -341,14 +504,14 @@ std::string BCLog::Logger::LogLevelsString() const
     return Join(std::vector<BCLog::Level>{levels.begin(), levels.end()}, ", ", [this](BCLog::Level level) { return LogLevelToStr(level); });
 }
 
-std::string BCLog::Logger::LogTimestampStr(const std::string& str)
+std::string BCLog::Logger::LogTimestampStr(const std::string& str, bool started_new_line)
 {
     std::string strStamped;
 
     if (!m_log_timestamps)
         return str;
 
-    if (m_started_new_line) {
+    if (started_new_line) {
         const auto now{SystemClock::now()};
         const auto now_seconds{std::chrono::time_point_cast<std::chrono::seconds>(now)};
         strStamped = FormatISO8601DateTime(TicksSinceEpoch<std::chrono::seconds>(now_seconds));
@@ -389,12 +552,95 @@ namespace BCLog {
     }
 } // namespace BCLog
 
+bool BCLog::Logger::RateLimited(BCLog::LogFlags category)
+{
+    const uint32_t limit{m_rate_limit.load(std::memory_order_relaxed)};
+    if (limit == 0) return false;
+
+    int bit{0};
+    while (!((category >> bit) & 1)) ++bit;
+    RateLimitState& state{m_rate_limits[bit]};
+
+    const int64_t now{TicksSinceEpoch<std::chrono::seconds>(SteadyClock::now())};
+    int64_t window{state.window.load(std::memory_order_relaxed)};
+    if (window != now && state.window.compare_exchange_strong(window, now)) {
+        state.count = 0;
+    }
+    if (state.count.fetch_add(1, std::memory_order_relaxed) < limit) return false;
+    if (state.suppressed.fetch_add(1, std::memory_order_relaxed) == 0) {
+        state.suppressed_since = now;
+    }
+    if (!m_suppressed_pending.exchange(true)) {
+        // Wake the background writer, which reports once the second is over
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        m_queue_cv.notify_one();
+    }
+    return true;
+}
+
+void BCLog::Logger::ReportSuppressed(bool all)
+{
+    m_suppressed_pending = false;
+    const int64_t now{TicksSinceEpoch<std::chrono::seconds>(SteadyClock::now())};
+    for (int bit = 0; bit < 32; ++bit) {
+        RateLimitState& state{m_rate_limits[bit]};
+        if (state.suppressed.load(std::memory_order_relaxed) == 0) continue;
+        if (!all && state.window.load(std::memory_order_relaxed) == now) {
+            // Still within the limited second, more may follow
+            m_suppressed_pending = true;
+            continue;
+        }
+        const int64_t since{state.suppressed_since.load(std::memory_order_relaxed)};
+        const uint64_t suppressed{state.suppressed.exchange(0)};
+        if (suppressed == 0) continue;
+        LogPrintStr(strprintf("Suppressed %u %s messages in the last %ds (-logratelimit)\n",
+                              suppressed, LogCategoryToStr(static_cast<LogFlags>(uint32_t{1} << bit)), std::max<int64_t>(now - since, 1)),
+                    __func__, __FILE__, __LINE__, LogFlags::NONE, Level::None);
+    }
+}
+
+void BCLog::Logger::WriteToOutputs(const std::string& str)
+{
+    if (m_print_to_console) {
+        // print to console
+        fwrite(str.data(), 1, str.size(), stdout);
+        fflush(stdout);
+    }
+    if (m_print_to_file) {
+        StdLockGuard file_lock(m_file_cs);
+        assert(m_fileout != nullptr);
+
+        // reopen the log file, if requested
+        if (m_reopen_file) {
+            m_reopen_file = false;
+            FILE* new_fileout = fsbridge::fopen(m_file_path, "a");
+            if (new_fileout) {
+                setbuf(new_fileout, nullptr); // unbuffered
+                fclose(m_fileout);
+                m_fileout = new_fileout;
+            }
+        }
+        FileWriteStr(str, m_fileout);
+    }
+}
+
 void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& logging_function, const std::string& source_file, int source_line, BCLog::LogFlags category, BCLog::Level level)
 {
-    StdLockGuard scoped_lock(m_cs);
+    // Messages logged unconditionally or at warning level and above are never
+    // rate limited or dropped.
+    const bool is_debug{category != LogFlags::NONE && (level == Level::None || level < Level::Warning)};
+    if (is_debug) {
+        // Also report here, for when there is no background writer
+        if (m_suppressed_pending.load(std::memory_order_relaxed)) {
+            ReportSuppressed(/*all=*/false);
+        }
+        if (RateLimited(category)) return;
+    }
+
     std::string str_prefixed = LogEscapeMessage(str);
+    const bool started_new_line{m_started_new_line.exchange(!str.empty() && str[str.size()-1] == '\n')};
 
-    if ((category != LogFlags::NONE || level != Level::None) && m_started_new_line) {
+    if ((category != LogFlags::NONE || level != Level::None) && started_new_line) {
         std::string s{"["};
 
         if (category != LogFlags::NONE) {
@@ -414,48 +660,37 @@ void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& loggi
         str_prefixed.insert(0, s);
     }
 
-    if (m_log_sourcelocations && m_started_new_line) {
+    if (m_log_sourcelocations && started_new_line) {
         str_prefixed.insert(0, "[" + RemovePrefix(source_file, "./") + ":" + ToString(source_line) + "] [" + logging_function + "] ");
     }
 
-    if (m_log_threadnames && m_started_new_line) {
+    if (m_log_threadnames && started_new_line) {
         const auto& threadname = util::ThreadGetInternalName();
         str_prefixed.insert(0, "[" + (threadname.empty() ? "unknown" : threadname) + "] ");
     }
 
-    str_prefixed = LogTimestampStr(str_prefixed);
-
-    m_started_new_line = !str.empty() && str[str.size()-1] == '\n';
+    str_prefixed = LogTimestampStr(str_prefixed, started_new_line);
 
-    if (m_buffering) {
-        // buffer if we haven't started logging yet
-        m_msgs_before_open.push_back(str_prefixed);
-        return;
-    }
-
-    if (m_print_to_console) {
-        // print to console
-        fwrite(str_prefixed.data(), 1, str_prefixed.size(), stdout);
-        fflush(stdout);
-    }
-    for (const auto& cb : m_print_callbacks) {
-        cb(str_prefixed);
-    }
-    if (m_print_to_file) {
-        assert(m_fileout != nullptr);
+    {
+        StdLockGuard scoped_lock(m_cs);
+        if (m_buffering) {
+            // buffer if we haven't started logging yet
+            m_msgs_before_open.push_back(str_prefixed);
+            return;
+        }
 
-        // reopen the log file, if requested
-        if (m_reopen_file) {
-            m_reopen_file = false;
-            FILE* new_fileout = fsbridge::fopen(m_file_path, "a");
-            if (new_fileout) {
-                setbuf(new_fileout, nullptr); // unbuffered
-                fclose(m_fileout);
-                m_fileout = new_fileout;
-            }
+        for (const auto& cb : m_print_callbacks) {
+            cb(str_prefixed);
+        }
+        if (!m_writer_active) {
+            WriteToOutputs(str_prefixed);
+            return;
         }
-        FileWriteStr(str_prefixed, m_fileout);
     }
+    Enqueue(std::move(str_prefixed), is_debug);
+    // Errors often come right before the node stops or aborts, write them
+    // before returning
+    if (level == Level::Error) WriteQueued();
 }
 
 void BCLog::Logger::ShrinkDebugFile()
@@ -517,5 +752,6 @@ bool BCLog::Logger::SetCategoryLogLevel(const std::string& category_str, const s
 
     StdLockGuard scoped_lock(m_cs);
     m_category_log_levels[flag] = level.value();
+    UpdateAcceptMasks();
     return true;
 }
@@ -11,12 +11,15 @@
 #include <util/fs.h>
 #include <util/string.h>
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
 #include <list>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -25,10 +28,23 @@ static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
 static const bool DEFAULT_LOGSOURCELOCATIONS = false;
+static const bool DEFAULT_LOGASYNC = true;
+static const unsigned int DEFAULT_LOGRATELIMIT = 0;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
 
+/**
+ * Peercoin stake diagnostics, set from -debug and the -print* options at
+ * startup so that kernel and validation code does not look up arguments on
+ * every call.
+ */
+extern std::atomic<bool> g_log_debug;
+extern std::atomic<bool> g_print_stake_modifier;
+extern std::atomic<bool> g_print_coinstake;
+extern std::atomic<bool> g_print_creation;
+extern std::atomic<bool> g_print_coinage;
+
 struct LogCategory {
     std::string category;
     bool active;
@@ -84,10 +100,34 @@ namespace BCLog {
     {
     private:
         mutable StdMutex m_cs; // Can not use Mutex from sync.h because in debug mode it would cause a deadlock when a potential deadlock was detected
+        //! Taken after m_cs when both are needed. The background writer only takes this one.
+        mutable StdMutex m_file_cs;
 
-        FILE* m_fileout GUARDED_BY(m_cs) = nullptr;
+        FILE* m_fileout GUARDED_BY(m_file_cs) = nullptr;
         std::list<std::string> m_msgs_before_open GUARDED_BY(m_cs);
         bool m_buffering GUARDED_BY(m_cs) = true; //!< Buffer messages before logging can be started.
+        //! Whether m_buffering is set or print callbacks are connected, readable without m_cs.
+        std::atomic_bool m_has_sinks{true};
+        //! Whether messages are handed to the background writer.
+        bool m_writer_active GUARDED_BY(m_cs) = false;
+
+        /**
+         * Queue of formatted messages for the background writer, which swaps
+         * it out as a whole. Members below up to m_writer are protected by
+         * m_queue_mutex. One queue shared by all threads keeps lines in the
+         * order they were logged.
+         */
+        std::mutex m_queue_mutex;
+        std::condition_variable m_queue_cv;
+        std::condition_variable m_written_cv;
+        std::vector<std::string> m_queue;
+        size_t m_queue_bytes{0};
+        uint64_t m_queue_dropped{0};
+        bool m_writing{false};
+        bool m_writer_running{false};
+        bool m_writer_stop{false};
+        std::thread::id m_writer_id;
+        std::thread m_writer;
 
         /**
          * m_started_new_line is a state variable that will suppress printing of
@@ -106,7 +146,42 @@ namespace BCLog {
         /** Log categories bitfield. */
         std::atomic<uint32_t> m_categories{0};
 
-        std::string LogTimestampStr(const std::string& str);
+        /**
+         * For each level, the categories whose messages of that level are
+         * logged, kept up to date with m_categories and the log levels so
+         * that checking a category takes no lock.
+         */
+        std::array<std::atomic<uint32_t>, static_cast<size_t>(Level::None) + 1> m_accept_masks{};
+
+        struct RateLimitState {
+            std::atomic<int64_t> window{0};
+            std::atomic<uint32_t> count{0};
+            std::atomic<uint64_t> suppressed{0};
+            //! The second of the first message suppressed since the last report
+            std::atomic<int64_t> suppressed_since{0};
+        };
+        //! Per category bit, the number of messages in the current second
+        std::array<RateLimitState, 32> m_rate_limits;
+        std::atomic<uint32_t> m_rate_limit{DEFAULT_LOGRATELIMIT};
+        //! Whether suppressed messages are waiting to be reported
+        std::atomic_bool m_suppressed_pending{false};
+
+        std::string LogTimestampStr(const std::string& str, bool started_new_line);
+
+        void UpdateAcceptMasks() EXCLUSIVE_LOCKS_REQUIRED(m_cs);
+        /** Whether a message of this category exceeds -logratelimit. */
+        bool RateLimited(LogFlags category);
+        /**
+         * Log the number of suppressed messages of each category whose rate
+         * limited second is over, or of all categories. Called every second by
+         * the background writer while there is something to report, so the
+         * end of a burst is reported without waiting for the next message.
+         */
+        void ReportSuppressed(bool all);
+        void WriteToOutputs(const std::string& str) EXCLUSIVE_LOCKS_REQUIRED(!m_file_cs);
+        void Enqueue(std::string&& str, bool droppable);
+        void ThreadWrite();
+        void StopWriter();
 
         /** Slots that connect to the print signal */
         std::list<std::function<void(const std::string&)>> m_print_callbacks GUARDED_BY(m_cs) {};
@@ -119,6 +194,8 @@ namespace BCLog {
         bool m_log_time_micros = DEFAULT_LOGTIMEMICROS;
         bool m_log_threadnames = DEFAULT_LOGTHREADNAMES;
         bool m_log_sourcelocations = DEFAULT_LOGSOURCELOCATIONS;
+        //! Write to the outputs from a background thread once logging is started.
+        bool m_log_async = false;
 
         fs::path m_file_path;
         std::atomic<bool> m_reopen_file{false};
@@ -129,8 +206,7 @@ namespace BCLog {
         /** Returns whether logs will be written to any output */
         bool Enabled() const
         {
-            StdLockGuard scoped_lock(m_cs);
-            return m_buffering || m_print_to_console || m_print_to_file || !m_print_callbacks.empty();
+            return m_print_to_console || m_print_to_file || m_has_sinks.load(std::memory_order_relaxed);
         }
 
         /** Connect a slot to the print signal and return the connection */
@@ -138,6 +214,7 @@ namespace BCLog {
         {
             StdLockGuard scoped_lock(m_cs);
             m_print_callbacks.push_back(std::move(fun));
+            m_has_sinks = true;
             return --m_print_callbacks.end();
         }
 
@@ -146,13 +223,25 @@ namespace BCLog {
         {
             StdLockGuard scoped_lock(m_cs);
             m_print_callbacks.erase(it);
+            m_has_sinks = m_buffering || !m_print_callbacks.empty();
         }
 
         /** Start logging (and flush all buffered messages) */
         bool StartLogging();
+        /** Wait until the background writer has written all queued messages */
+        void Flush();
+        /**
+         * Write the queued messages from the calling thread. Unlike Flush(),
+         * this does not depend on the background writer, so it can be called
+         * right before the process aborts.
+         */
+        void WriteQueued();
         /** Only for testing */
         void DisconnectTestLogger();
 
+        /** Limit debug messages to <n> per second per category, 0 for no limit */
+        void SetRateLimit(uint32_t messages_per_second) { m_rate_limit = messages_per_second; }
+
         void ShrinkDebugFile();
 
         std::unordered_map<LogFlags, Level> CategoryLevels() const
@@ -164,11 +253,12 @@ namespace BCLog {
         {
             StdLockGuard scoped_lock(m_cs);
             m_category_log_levels = levels;
+            UpdateAcceptMasks();
         }
         bool SetCategoryLogLevel(const std::string& category_str, const std::string& level_str);
 
         Level LogLevel() const { return m_log_level.load(); }
-        void SetLogLevel(Level level) { m_log_level = level; }
+        void SetLogLevel(Level level);
         bool SetLogLevel(const std::string& level);
 
         uint32_t GetCategoryMask() const { return m_categories.load(); }
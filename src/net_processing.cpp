@@ -501,6 +501,7 @@ public:
         EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override
         EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex);
+    std::string GetSubscriberName() const override { return "net_processing"; }
 
     /** Implement NetEventsInterface */
     void InitializeNode(CNode& node, ServiceFlags our_services) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
@@ -897,6 +898,10 @@ private:
      */
     void FindNextBlocksToDownload(const Peer& peer, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, NodeId& nodeStaller) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /** peercoin: Request blocks for the background chainstate of an active
+     *  snapshot, from its tip up to the snapshot base, if the peer has them. */
+    void TryDownloadingHistoricalBlocks(const Peer& peer, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, const CBlockIndex* from_tip, const CBlockIndex* target_block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     /* Multimap used to preserve insertion order */
     typedef std::multimap<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator>> BlockDownloadMap;
     BlockDownloadMap mapBlocksInFlight GUARDED_BY(cs_main);
@@ -1413,6 +1418,32 @@ void PeerManagerImpl::FindNextBlocksToDownload(const Peer& peer, unsigned int co
     }
 }
 
+void PeerManagerImpl::TryDownloadingHistoricalBlocks(const Peer& peer, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, const CBlockIndex* from_tip, const CBlockIndex* target_block)
+{
+    if (vBlocks.size() >= count) return;
+
+    const CNodeState* state = State(peer.m_id);
+    assert(state != nullptr);
+    if (state->pindexBestKnownBlock == nullptr || state->pindexBestKnownBlock->GetAncestor(target_block->nHeight) != target_block) {
+        // This peer can't provide the blocks below the snapshot base.
+        return;
+    }
+
+    // Walk the download window above the background tip in forward direction.
+    const int max_height{std::min<int>(from_tip->nHeight + BLOCK_DOWNLOAD_WINDOW, target_block->nHeight)};
+    std::vector<const CBlockIndex*> window;
+    for (const CBlockIndex* walk = target_block->GetAncestor(max_height); walk && walk != from_tip; walk = walk->pprev) {
+        window.push_back(walk);
+    }
+    for (auto it = window.rbegin(); it != window.rend(); ++it) {
+        const CBlockIndex* pindex{*it};
+        if (!CanServeWitnesses(peer) && IsBTC16BIPsEnabled(pindex->nTime)) return;
+        if (pindex->nStatus & BLOCK_HAVE_DATA || IsBlockRequested(pindex->GetBlockHash())) continue;
+        vBlocks.push_back(pindex);
+        if (vBlocks.size() == count) return;
+    }
+}
+
 } // namespace
 
 void PeerManagerImpl::PushNodeVersion(CNode& pnode, const Peer& peer)
@@ -6042,6 +6073,12 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
             FindNextBlocksToDownload(*peer, MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.vBlocksInFlight.size(), vToDownload, staller);
+            // peercoin: with a snapshot active, also fetch the blocks the
+            // background chainstate is missing from peers that keep the full chain
+            if (m_chainman.BackgroundSyncInProgress() && !IsLimitedPeer(*peer)) {
+                TryDownloadingHistoricalBlocks(*peer, MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.vBlocksInFlight.size(), vToDownload,
+                                               m_chainman.GetBackgroundSyncTip(), Assert(m_chainman.GetSnapshotBaseBlock()));
+            }
             for (const CBlockIndex *pindex : vToDownload) {
                 uint32_t nFetchFlags = IsBTC16BIPsEnabled(pindex->nTime) ? GetFetchFlags(*peer) : false;
                 vGetData.push_back(CInv(MSG_BLOCK | nFetchFlags, pindex->GetBlockHash()));
@@ -7,6 +7,7 @@
 #include <chain.h>
 #include <clientversion.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
 #include <flatfile.h>
 #include <hash.h>
 #include <kernel.h>
@@ -144,6 +145,10 @@ bool BlockManager::LoadBlockIndex(const Consensus::Params& consensus_params)
     std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
               CBlockIndexHeightOnlyComparator());
 
+    // peercoin: stake modifier checksums from the first block with stake state
+    // loaded from a UTXO snapshot on are only known once it is validated
+    int first_snapshot_stake_height{std::numeric_limits<int>::max()};
+
     for (CBlockIndex* pindex : vSortedByHeight) {
         if (ShutdownRequested()) return false;
         pindex->nChainTrust = (pindex->pprev ? pindex->pprev->nChainTrust : 0) + GetBlockTrust(*pindex);
@@ -174,8 +179,11 @@ bool BlockManager::LoadBlockIndex(const Consensus::Params& consensus_params)
         }
         // peercoin: calculate stake modifier checksum
         pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
+        if (pindex->nStatus & BLOCK_SNAPSHOT_STAKE) {
+            first_snapshot_stake_height = std::min(first_snapshot_stake_height, pindex->nHeight);
+        }
         //if (chainman.ActiveChain().Contains(pindex))
-        if (pindex->nStatus & BLOCK_HAVE_DATA) {
+        if ((pindex->nStatus & BLOCK_HAVE_DATA) && pindex->nHeight < first_snapshot_stake_height) {
             if (!CheckStakeModifierCheckpoints(pindex->nHeight, pindex->nStakeModifierChecksum))
                 return error("LoadBlockIndex() : Failed stake modifier checkpoint height=%d, modifier=0x%016llx", pindex->nHeight, pindex->nStakeModifier);
         }
@@ -625,6 +633,26 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
     return true;
 }
 
+bool ReadRawBlockSize(FILE* file, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start, unsigned int& size)
+{
+    uint8_t meta[8]; // message start and block size
+    if (pos.nPos < sizeof(meta) || std::fseek(file, pos.nPos - sizeof(meta), SEEK_SET) != 0 ||
+        std::fread(meta, 1, sizeof(meta), file) != sizeof(meta)) {
+        return error("%s: Read from block file failed for %s", __func__, pos.ToString());
+    }
+    if (memcmp(meta, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+        return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                     HexStr(Span{meta, CMessageHeader::MESSAGE_START_SIZE}),
+                     HexStr(message_start));
+    }
+    size = ReadLE32(meta + CMessageHeader::MESSAGE_START_SIZE);
+    if (size > MAX_SIZE) {
+        return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                     size, MAX_SIZE);
+    }
+    return true;
+}
+
 FlatFilePos BlockManager::SaveBlockToDisk(const CBlock& block, int nHeight, CChain& active_chain, const CChainParams& chainparams, const FlatFilePos* dbp)
 {
     unsigned int nBlockSize = ::GetSerializeSize(block, CLIENT_VERSION);
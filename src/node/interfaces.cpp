@@ -433,6 +433,7 @@ public:
         m_notifications->updatedBlockTip();
     }
     void ChainStateFlushed(const CBlockLocator& locator) override { m_notifications->chainStateFlushed(locator); }
+    std::string GetSubscriberName() const override { return m_notifications->getNotificationsName(); }
     std::shared_ptr<Chain::Notifications> m_notifications;
 };
 
@@ -32,6 +32,7 @@
 #include <util/exception.h>
 #include <util/thread.h>
 #include <validation.h>
+#include <wallet/context.h>
 #include <wallet/wallet.h>
 #include <wallet/coincontrol.h>
 #include <warnings.h>
@@ -39,6 +40,7 @@
 #include <wallet/wallet.h>
 
 #include <algorithm>
+#include <set>
 #include <utility>
 
 #include <boost/thread.hpp>
@@ -126,7 +128,7 @@ void BlockAssembler::resetBlock()
 }
 
 // peercoin: if pwallet != NULL it will attempt to create coinstake
-std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet, bool* pfPoSCancel, NodeContext* m_node, CTxDestination destination)
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, const std::vector<wallet::StakingWallet>* stakers, bool* pfPoSCancel, NodeContext* m_node)
 {
     const auto time_start{SteadyClock::now()};
 
@@ -140,6 +142,43 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     CBlock* const pblock = &pblocktemplate->block; // pointer for convenience
     pblock->nTime = TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime());
 
+#ifdef ENABLE_WALLET
+    // peercoin: the coinstake is signed under the cs_wallet of the staking
+    // wallet, which is locked before cs_main, so it is created first
+    CTransactionRef coinstake;
+    const CBlockIndex* stake_prev{nullptr};
+    if (stakers)  // attemp to find a coinstake
+    {
+        *pfPoSCancel = true;
+        // peercoin: if coinstake available add coinstake tx
+        static int64_t nLastCoinStakeSearchTime = pblock->nTime;  // only initialized at startup
+        {
+            LOCK(::cs_main);
+            stake_prev = m_chainstate.m_chain.Tip();
+            pblock->nBits = GetNextTargetRequired(stake_prev, true, chainparams.GetConsensus());
+        }
+        CMutableTransaction txCoinStake;
+        int64_t nSearchTime = txCoinStake.nTime; // search to current time
+        if (nSearchTime > nLastCoinStakeSearchTime)
+        {
+            const std::optional<size_t> staker{wallet::CreateCoinStake(*m_node->chainman, *stakers, pblock->nBits, nSearchTime-nLastCoinStakeSearchTime, txCoinStake)};
+            if (staker)
+            {
+                if (txCoinStake.nTime >= std::max(stake_prev->GetMedianTimePast()+1, stake_prev->GetBlockTime() - (IsProtocolV09(stake_prev->GetBlockTime()) ? MAX_FUTURE_BLOCK_TIME : MAX_FUTURE_BLOCK_TIME_PREV9)))
+                {   // make sure coinstake would meet timestamp protocol
+                    // as it would be the same as the block timestamp
+                    coinstake = MakeTransactionRef(CTransaction(txCoinStake));
+                    pblocktemplate->staker = (*stakers)[*staker].wallet;
+                }
+            }
+            nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
+            nLastCoinStakeSearchTime = nSearchTime;
+        }
+        if (!coinstake)
+            return nullptr; // peercoin: there is no point to continue if we failed to create coinstake
+    }
+#endif
+
     LOCK(::cs_main);
 
     CBlockIndex* pindexPrev = m_chainstate.m_chain.Tip();
@@ -153,7 +192,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     coinbaseTx.vout.resize(1);
     coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
 
-    if (pwallet == nullptr) {
+    if (stakers == nullptr) {
         pblock->nBits = GetNextTargetRequired(pindexPrev, false, chainparams.GetConsensus());
         coinbaseTx.vout[0].nValue = GetProofOfWorkReward(pblock->nBits, pblock->nTime);
         }
@@ -163,34 +202,16 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblocktemplate->vTxFees.push_back(-1); // updated at end
     pblocktemplate->vTxSigOpsCost.push_back(-1); // updated at end
 
-    // peercoin: if coinstake available add coinstake tx
-    static int64_t nLastCoinStakeSearchTime = pblock->nTime;  // only initialized at startup
-
 #ifdef ENABLE_WALLET
-    if (pwallet)  // attemp to find a coinstake
+    if (stakers)
     {
-        *pfPoSCancel = true;
-        pblock->nBits = GetNextTargetRequired(pindexPrev, true, chainparams.GetConsensus());
-        CMutableTransaction txCoinStake;
-        int64_t nSearchTime = txCoinStake.nTime; // search to current time
-        if (nSearchTime > nLastCoinStakeSearchTime)
-        {
-            if (pwallet->CreateCoinStake(*m_node->chainman, pwallet, pblock->nBits, nSearchTime-nLastCoinStakeSearchTime, txCoinStake, destination))
-            {
-                if (txCoinStake.nTime >= std::max(pindexPrev->GetMedianTimePast()+1, pindexPrev->GetBlockTime() - (IsProtocolV09(pindexPrev->GetBlockTime()) ? MAX_FUTURE_BLOCK_TIME : MAX_FUTURE_BLOCK_TIME_PREV9)))
-                {   // make sure coinstake would meet timestamp protocol
-                    // as it would be the same as the block timestamp
-                    coinbaseTx.vout[0].SetEmpty();
-                    coinbaseTx.nTime = txCoinStake.nTime;
-                    pblock->vtx.push_back(MakeTransactionRef(CTransaction(txCoinStake)));
-                    *pfPoSCancel = false;
-                }
-            }
-            nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
-            nLastCoinStakeSearchTime = nSearchTime;
-        }
-        if (*pfPoSCancel)
-            return nullptr; // peercoin: there is no point to continue if we failed to create coinstake
+        // The coinstake spends coins of the tip it was created at
+        if (pindexPrev != stake_prev)
+            return nullptr;
+        coinbaseTx.vout[0].SetEmpty();
+        coinbaseTx.nTime = coinstake->nTime;
+        pblock->vtx.push_back(coinstake);
+        *pfPoSCancel = false;
         pblock->nFlags = CBlockIndex::BLOCK_PROOF_OF_STAKE;
     }
 #endif
@@ -530,6 +551,27 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
     return true;
 }
 
+/** The mintkey address of a wallet, created on first use */
+static std::optional<CTxDestination> GetMintKeyDestination(CWallet& wallet) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
+{
+    const std::string label = "mintkey";
+    CTxDestination dest;
+    wallet.ForEachAddrBookEntry([&](const CTxDestination& _dest, const std::string& _label, bool _is_change, const std::optional<wallet::AddressPurpose>& _purpose) {
+        if (_is_change) return;
+        if (_label == label)
+            dest = _dest;
+    });
+
+    if (std::get_if<CNoDestination>(&dest)) {
+        // create mintkey address
+        auto op_dest = wallet.GetNewDestination(OutputType::LEGACY, label);
+        if (!op_dest)
+            return std::nullopt;
+        dest = *op_dest;
+    }
+    return dest;
+}
+
 void PoSMiner(NodeContext& m_node)
 {
     std::string strMintMessage = _("Info: Minting suspended due to locked wallet.").translated;
@@ -545,56 +587,52 @@ void PoSMiner(NodeContext& m_node)
     }
 
     CConnman* connman = m_node.connman.get();
-    CWallet* pwallet;
-    // ppctodo: deal with multiple wallets better
-    if (m_node.wallet_loader->getWallets().size() && gArgs.GetBoolArg("-minting", true))
-        pwallet = m_node.wallet_loader->getWallets()[0]->wallet();
-    else
+    if (!m_node.wallet_loader || !m_node.wallet_loader->context())
         return;
+    wallet::WalletContext& wallet_context{*m_node.wallet_loader->context()};
 
     LogPrintf("CPUMiner started for proof-of-stake\n");
     util::ThreadRename("peercoin-stake-minter");
 
     unsigned int nExtraNonce = 0;
-
-    CTxDestination dest;
+    // Mintkey address of each loaded wallet by name
+    std::map<std::string, CTxDestination> destinations;
+    // Wallets whose keypool ran out, they are retried every round
+    std::set<std::string> keypool_exhausted;
     // Compute timeout for pos as sqrt(numUTXO)
-    unsigned int pos_timio;
-    {
-        LOCK2(pwallet->cs_wallet, cs_main);
-        const std::string label = "mintkey";
-        pwallet->ForEachAddrBookEntry([&](const CTxDestination& _dest, const std::string& _label, bool _is_change, const std::optional<wallet::AddressPurpose>& _purpose) {
-            if (_is_change) return;
-            if (_label == label)
-                dest = _dest;
-        });
-
-        if (std::get_if<CNoDestination>(&dest)) {
-            // create mintkey address
-            auto op_dest = pwallet->GetNewDestination(OutputType::LEGACY, label);
-            if (!op_dest)
-                throw std::runtime_error("Error: Keypool ran out, please call keypoolrefill first.");
-            dest = *op_dest;
-        }
-
-        wallet::CoinsResult availableCoins;
-        CCoinControl coincontrol;
-        availableCoins = AvailableCoins(*pwallet, &coincontrol);
-        pos_timio = 500 + 30 * sqrt(availableCoins.Size());
-        LogPrintf("Set proof-of-stake timeout: %ums for %u UTXOs\n", pos_timio, availableCoins.Size());
-    }
+    unsigned int pos_timio = 500;
 
     try {
         bool fNeedToClear = false;
         while (true) {
-            while (pwallet->IsLocked()) {
-                if (strMintWarning != strMintMessage) {
-                    strMintWarning = strMintMessage;
-                    uiInterface.NotifyAlertChanged();
+            // Every loaded wallet mints unless its disable_staking flag is set,
+            // wallets loaded while the minter runs join in the next round
+            std::vector<std::shared_ptr<CWallet>> wallets;
+            for (const std::shared_ptr<CWallet>& wallet : wallet::GetWallets(wallet_context)) {
+                if (!wallet->IsWalletFlagSet(wallet::WALLET_FLAG_DISABLE_STAKING))
+                    wallets.push_back(wallet);
+            }
+            // Forget the wallets that were unloaded or left out of minting
+            const auto is_minting = [&](const std::string& name) {
+                return std::any_of(wallets.begin(), wallets.end(), [&](const std::shared_ptr<CWallet>& wallet) { return wallet->GetName() == name; });
+            };
+            for (auto it = destinations.begin(); it != destinations.end();) {
+                it = is_minting(it->first) ? std::next(it) : destinations.erase(it);
+            }
+            for (auto it = keypool_exhausted.begin(); it != keypool_exhausted.end();) {
+                it = is_minting(*it) ? std::next(it) : keypool_exhausted.erase(it);
+            }
+            if (std::all_of(wallets.begin(), wallets.end(), [](const std::shared_ptr<CWallet>& wallet) { return wallet->IsLocked(); })) {
+                if (!wallets.empty()) {
+                    if (strMintWarning != strMintMessage) {
+                        strMintWarning = strMintMessage;
+                        uiInterface.NotifyAlertChanged();
+                    }
+                    fNeedToClear = true;
                 }
-                fNeedToClear = true;
                 if (!connman->interruptNet.sleep_for(std::chrono::seconds(3)))
                     return;
+                continue;
             }
 
             if (Params().MiningRequiresPeers()) {
@@ -629,6 +667,44 @@ void PoSMiner(NodeContext& m_node)
                 fNeedToClear = false;
             }
 
+            // The kernel search works from the stake snapshots, without cs_wallet
+            std::vector<wallet::StakingWallet> stakers;
+            size_t stake_coins = 0;
+            for (const std::shared_ptr<CWallet>& wallet : wallets) {
+                if (wallet->IsLocked())
+                    continue;
+                LOCK2(wallet->cs_wallet, cs_main);
+                auto it = destinations.find(wallet->GetName());
+                // A wallet reloaded under the same name may be another file
+                if (it != destinations.end() && !wallet->IsMine(it->second)) {
+                    destinations.erase(it);
+                    it = destinations.end();
+                }
+                if (it == destinations.end()) {
+                    std::optional<CTxDestination> dest = GetMintKeyDestination(*wallet);
+                    if (!dest) {
+                        if (keypool_exhausted.insert(wallet->GetName()).second)
+                            wallet->WalletLogPrintf("Error in PeercoinMiner: Keypool ran out, please call keypoolrefill to mint with it\n");
+                        continue;
+                    }
+                    keypool_exhausted.erase(wallet->GetName());
+                    it = destinations.emplace(wallet->GetName(), *dest).first;
+                }
+                wallet->UpdateStakeSnapshot(*m_node.chainman);
+                stake_coins += wallet->GetStakeSnapshot()->coins.size();
+                stakers.push_back({wallet, it->second});
+            }
+            const unsigned int timeout = 500 + 30 * sqrt(stake_coins);
+            if (timeout != pos_timio) {
+                pos_timio = timeout;
+                LogPrintf("Set proof-of-stake timeout: %ums for %u UTXOs in %u wallets\n", pos_timio, stake_coins, stakers.size());
+            }
+            if (stakers.empty()) {
+                if (!connman->interruptNet.sleep_for(std::chrono::milliseconds(pos_timio)))
+                    return;
+                continue;
+            }
+
             //
             // Create new block
             //
@@ -636,16 +712,13 @@ void PoSMiner(NodeContext& m_node)
             CBlock *pblock;
             std::unique_ptr<CBlockTemplate> pblocktemplate;
 
+            try {
+                pblocktemplate = BlockAssembler(m_node.chainman->ActiveChainstate(), m_node.mempool.get()).CreateNewBlock(GetScriptForDestination(stakers.front().destination), &stakers, &fPoSCancel, &m_node);
+            }
+            catch (const std::runtime_error &e)
             {
-                LOCK2(pwallet->cs_wallet, cs_main);
-                try {
-                    pblocktemplate = BlockAssembler(m_node.chainman->ActiveChainstate(), m_node.mempool.get()).CreateNewBlock(GetScriptForDestination(dest), pwallet, &fPoSCancel, &m_node, dest);
-                }
-                catch (const std::runtime_error &e)
-                {
-                    LogPrintf("PeercoinMiner runtime error: %s\n", e.what());
-                    continue;
-                }
+                LogPrintf("PeercoinMiner runtime error: %s\n", e.what());
+                continue;
             }
 
             if (!pblocktemplate.get())
@@ -658,7 +731,7 @@ void PoSMiner(NodeContext& m_node)
                 }
                 strMintWarning = strMintBlockMessage;
                 uiInterface.NotifyAlertChanged();
-                LogPrintf("Error in PeercoinMiner: Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
+                LogPrintf("Error in PeercoinMiner: block creation failed\n");
                 if (!connman->interruptNet.sleep_for(std::chrono::seconds(10)))
                    return;
 
@@ -670,17 +743,20 @@ void PoSMiner(NodeContext& m_node)
             // peercoin: if proof-of-stake block found then process block
             if (pblock->IsProofOfStake())
             {
+                // The wallet that owns the kernel signs the block
+                CWallet& staker = *pblocktemplate->staker;
                 {
-                    LOCK2(pwallet->cs_wallet, cs_main);
-                    if (!SignBlock(*pblock, *pwallet))
+                    LOCK2(staker.cs_wallet, cs_main);
+                    if (!SignBlock(*pblock, staker))
                     {
                         LogPrintf("PoSMiner(): failed to sign PoS block\n");
                         continue;
                     }
                 }
-                LogPrintf("CPUMiner : proof-of-stake block found %s\n", pblock->GetHash().ToString());
+                LogPrintf("CPUMiner : proof-of-stake block found %s by wallet \"%s\"\n", pblock->GetHash().ToString(), staker.GetName());
                 try {
-                    ProcessBlockFound(pblock, Params(), m_node);
+                    if (ProcessBlockFound(pblock, Params(), m_node))
+                        ++staker.m_staking_stats.blocks;
                     }
                 catch (const std::runtime_error &e)
                 {
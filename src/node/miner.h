@@ -10,6 +10,7 @@
 #include <primitives/block.h>
 #include <txmempool.h>
 #include <node/context.h>
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <stdint.h>
@@ -39,6 +40,8 @@ struct CBlockTemplate
     std::vector<CAmount> vTxFees;
     std::vector<int64_t> vTxSigOpsCost;
     std::vector<unsigned char> vchCoinbaseCommitment;
+    //! peercoin: wallet that found the kernel of a proof-of-stake block, to sign it
+    std::shared_ptr<wallet::CWallet> staker;
 };
 
 // Container for tracking updates to ancestor feerate as we include (parent)
@@ -165,11 +168,13 @@ public:
     explicit BlockAssembler(Chainstate& chainstate, const CTxMemPool* mempool, const Options& options);
 
     /** Construct a new block template with coinbase to scriptPubKeyIn */
-    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet=nullptr, bool* pfPoSCancel=nullptr, NodeContext* m_node=nullptr, CTxDestination destination=CNoDestination());
+    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, const std::vector<wallet::StakingWallet>* stakers=nullptr, bool* pfPoSCancel=nullptr, NodeContext* m_node=nullptr);
     //std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn);
 
-    inline static std::optional<int64_t> m_last_block_num_txs{};
-    inline static std::optional<int64_t> m_last_block_weight{};
+    //! Stats of the last assembled block, -1 if none was ever assembled.
+    //! Atomic so that getmininginfo can read them without cs_main.
+    inline static std::atomic<int64_t> m_last_block_num_txs{-1};
+    inline static std::atomic<int64_t> m_last_block_weight{-1};
 
 private:
     const Options m_options;
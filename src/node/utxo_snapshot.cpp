@@ -4,6 +4,7 @@
 
 #include <node/utxo_snapshot.h>
 
+#include <hash.h>
 #include <logging.h>
 #include <streams.h>
 #include <sync.h>
@@ -21,6 +22,13 @@
 
 namespace node {
 
+uint256 ComputeSnapshotStakeHash(const SnapshotMetadata& metadata, const std::vector<SnapshotKernelTx>& kernel_txs)
+{
+    HashWriter hasher{};
+    hasher << metadata.m_base_blockhash << metadata.m_stake_blocks << kernel_txs;
+    return hasher.GetHash();
+}
+
 bool WriteSnapshotBaseBlockhash(Chainstate& snapshot_chainstate)
 {
     AssertLockHeld(::cs_main);
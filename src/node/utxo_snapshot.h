@@ -7,6 +7,7 @@
 #define BITCOIN_NODE_UTXO_SNAPSHOT_H
 
 #include <kernel/cs_main.h>
+#include <primitives/transaction.h>
 #include <serialize.h>
 #include <sync.h>
 #include <uint256.h>
@@ -15,12 +16,49 @@
 #include <cstdint>
 #include <optional>
 #include <string_view>
+#include <vector>
 
 class Chainstate;
 
 namespace node {
+//! peercoin: stake state of a block before the snapshot base. Only connecting
+//! a block computes it, and the proof-of-stake checks of the blocks after the
+//! base depend on it for the blocks of the window returned by
+//! GetStakeStateWindowStart().
+struct SnapshotStakeBlock {
+    uint256 hash;
+    //! CBlockIndex::nFlags, with the entropy bit and the generated modifier flag
+    unsigned int flags{0};
+    uint64_t stake_modifier{0};
+    uint256 hash_proof_of_stake;
+    COutPoint prevout_stake;
+    unsigned int stake_time{0};
+    int64_t mint{0};
+    int64_t money_supply{0};
+
+    SERIALIZE_METHODS(SnapshotStakeBlock, obj)
+    {
+        READWRITE(obj.hash, obj.flags, obj.stake_modifier, obj.hash_proof_of_stake,
+                  obj.prevout_stake, obj.stake_time, obj.mint, obj.money_supply);
+    }
+};
+
+//! peercoin: position of a transaction with coins in the snapshot within its
+//! block, which the stake kernels of the coins hash. The block is the one at
+//! the height of the coins, the transaction time is the time of the coins.
+struct SnapshotKernelTx {
+    uint256 txid;
+    //! Offset of the transaction after the block header, as CDiskTxPos::nTxOffset
+    uint32_t tx_offset{0};
+
+    SERIALIZE_METHODS(SnapshotKernelTx, obj) { READWRITE(obj.txid, VARINT(obj.tx_offset)); }
+};
+
 //! Metadata describing a serialized version of a UTXO set from which an
 //! assumeutxo Chainstate can be constructed.
+//!
+//! peercoin: the coins are followed by m_kernel_count SnapshotKernelTx
+//! entries, one for each transaction with coins in the snapshot.
 class SnapshotMetadata
 {
 public:
@@ -32,6 +70,13 @@ public:
     //! during snapshot load to estimate progress of UTXO set reconstruction.
     uint64_t m_coins_count = 0;
 
+    //! peercoin: stake state of the blocks of the window before the base,
+    //! oldest first and ending with the base block.
+    std::vector<SnapshotStakeBlock> m_stake_blocks;
+
+    //! peercoin: number of kernel entries following the coins.
+    uint64_t m_kernel_count = 0;
+
     SnapshotMetadata() { }
     SnapshotMetadata(
         const uint256& base_blockhash,
@@ -40,9 +85,13 @@ public:
             m_base_blockhash(base_blockhash),
             m_coins_count(coins_count) { }
 
-    SERIALIZE_METHODS(SnapshotMetadata, obj) { READWRITE(obj.m_base_blockhash, obj.m_coins_count); }
+    SERIALIZE_METHODS(SnapshotMetadata, obj) { READWRITE(obj.m_base_blockhash, obj.m_coins_count, obj.m_stake_blocks, obj.m_kernel_count); }
 };
 
+//! peercoin: hash of the stake state of a snapshot, which is compared with
+//! AssumeutxoData::hash_stake before it is used.
+uint256 ComputeSnapshotStakeHash(const SnapshotMetadata& metadata, const std::vector<SnapshotKernelTx>& kernel_txs);
+
 //! The file in the snapshot chainstate dir which stores the base blockhash. This is
 //! needed to reconstruct snapshot chainstates on init.
 //!
@@ -6,6 +6,7 @@
 
 #include <kernel/validation_cache_sizes.h>
 
+#include <util/fs.h>
 #include <util/system.h>
 
 #include <algorithm>
@@ -31,4 +32,14 @@ void ApplyArgsManOptions(const ArgsManager& argsman, ValidationCacheSizes& cache
         };
     }
 }
+
+bool ShouldPersistValidationCaches(const ArgsManager& argsman)
+{
+    return argsman.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_VALIDATION_CACHES);
+}
+
+fs::path ValidationCachesPath(const ArgsManager& argsman)
+{
+    return argsman.GetDataDirNet() / "sigcache.dat";
+}
 } // namespace node
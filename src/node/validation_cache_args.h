@@ -5,13 +5,23 @@
 #ifndef BITCOIN_NODE_VALIDATION_CACHE_ARGS_H
 #define BITCOIN_NODE_VALIDATION_CACHE_ARGS_H
 
+#include <util/fs.h>
+
 class ArgsManager;
 namespace kernel {
 struct ValidationCacheSizes;
 };
 
 namespace node {
+/**
+ * Default for -persistsigcache, indicating whether the node should save the
+ * signature and script execution caches on shutdown and load them on start
+ */
+static constexpr bool DEFAULT_PERSIST_VALIDATION_CACHES{false};
+
 void ApplyArgsManOptions(const ArgsManager& argsman, kernel::ValidationCacheSizes& cache_sizes);
+bool ShouldPersistValidationCaches(const ArgsManager& argsman);
+fs::path ValidationCachesPath(const ArgsManager& argsman);
 } // namespace node
 
 #endif // BITCOIN_NODE_VALIDATION_CACHE_ARGS_H
@@ -106,7 +106,7 @@ public:
     SERIALIZE_METHODS(CBlock, obj)
     {
         READWRITEAS(CBlockHeader, obj);
-        READWRITE(obj.vtx);
+        READWRITE(Using<TransactionsFormatter>(obj.vtx));
         READWRITE(obj.vchBlockSig);
     }
 
@@ -9,6 +9,7 @@
 #include <hash.h>
 #include <script/script.h>
 #include <serialize.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <uint256.h>
 #include <util/strencodings.h>
@@ -86,6 +87,47 @@ uint256 CTransaction::ComputeWitnessHash() const
 
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nTime(tx.nTime), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nTime(tx.nTime), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(CMutableTransaction&& tx, const uint256& hash_in, const uint256& witness_hash_in) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nTime(tx.nTime), nLockTime(tx.nLockTime), hash{hash_in}, m_witness_hash{witness_hash_in} {}
+
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs)
+{
+    // Serialize the transactions as ComputeHash() and ComputeWitnessHash()
+    // do, into one buffer, and hash all of them at once.
+    std::vector<unsigned char> buffer;
+    std::vector<size_t> ends;
+    for (const CMutableTransaction& tx : txs) {
+        CVectorWriter{SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS, buffer, buffer.size()} << tx;
+        ends.push_back(buffer.size());
+        if (tx.HasWitness()) {
+            CVectorWriter{SER_GETHASH, 0, buffer, buffer.size()} << tx;
+            ends.push_back(buffer.size());
+        }
+    }
+    std::vector<Span<const unsigned char>> messages;
+    messages.reserve(ends.size());
+    size_t begin{0};
+    for (const size_t end : ends) {
+        messages.emplace_back(buffer.data() + begin, end - begin);
+        begin = end;
+    }
+    std::vector<unsigned char> hashes(messages.size() * CSHA256::OUTPUT_SIZE);
+    SHA256DMulti(hashes.data(), messages.data(), messages.size());
+
+    std::vector<CTransactionRef> ret;
+    ret.reserve(txs.size());
+    Span<const unsigned char> next_hash{hashes};
+    for (CMutableTransaction& tx : txs) {
+        const uint256 hash{next_hash.first(CSHA256::OUTPUT_SIZE)};
+        next_hash = next_hash.subspan(CSHA256::OUTPUT_SIZE);
+        uint256 witness_hash{hash};
+        if (tx.HasWitness()) {
+            witness_hash = uint256{next_hash.first(CSHA256::OUTPUT_SIZE)};
+            next_hash = next_hash.subspan(CSHA256::OUTPUT_SIZE);
+        }
+        ret.emplace_back(new CTransaction(std::move(tx), hash, witness_hash));
+    }
+    return ret;
+}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -335,6 +335,10 @@ private:
     uint256 ComputeHash() const;
     uint256 ComputeWitnessHash() const;
 
+    /** Convert a CMutableTransaction whose hashes are already known. */
+    CTransaction(CMutableTransaction&& tx, const uint256& hash_in, const uint256& witness_hash_in);
+    friend std::vector<std::shared_ptr<const CTransaction>> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+
 public:
     /** Convert a CMutableTransaction into a CTransaction. */
     explicit CTransaction(const CMutableTransaction& tx);
@@ -448,6 +452,29 @@ struct CMutableTransaction
 typedef std::shared_ptr<const CTransaction> CTransactionRef;
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/** Convert many CMutableTransactions at once, computing their txids and
+ *  wtxids in one batch (see SHA256DMulti). */
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+
+/** Formatter for the transactions of a block. Deserialization computes their
+ *  hashes with MakeTransactionRefs() rather than one transaction at a time. */
+struct TransactionsFormatter
+{
+    template <typename Stream>
+    void Ser(Stream& s, const std::vector<CTransactionRef>& txs)
+    {
+        s << txs;
+    }
+
+    template <typename Stream>
+    void Unser(Stream& s, std::vector<CTransactionRef>& txs)
+    {
+        std::vector<CMutableTransaction> mtxs;
+        s >> mtxs;
+        txs = MakeTransactionRefs(std::move(mtxs));
+    }
+};
+
 /** A generic txid reference (txid or wtxid). */
 class GenTxid
 {
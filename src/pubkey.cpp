@@ -15,6 +15,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <map>
 
 namespace {
 
@@ -217,6 +218,111 @@ bool XOnlyPubKey::VerifySchnorr(const uint256& msg, Span<const unsigned char> si
     return secp256k1_schnorrsig_verify(secp256k1_context_static, sigbytes.data(), msg.begin(), 32, &pubkey);
 }
 
+void SchnorrSigBatch::Add(Span<const unsigned char> sigbytes, const XOnlyPubKey& pubkey, const uint256& msg)
+{
+    assert(sigbytes.size() == 64);
+    Entry& entry = m_entries.emplace_back();
+    std::copy(sigbytes.begin(), sigbytes.end(), entry.sig.begin());
+    entry.pubkey = pubkey;
+    entry.msg = msg;
+}
+
+static const HashWriter HASHER_BIP340_CHALLENGE{TaggedHash("BIP0340/challenge")};
+static const HashWriter HASHER_SCHNORR_BATCH{TaggedHash("Peercoin/SchnorrSigBatch")};
+
+bool SchnorrSigBatch::Verify() const
+{
+    if (m_entries.empty()) return true;
+
+    // Inputs the batch equation cannot take, such as an s of zero or a point
+    // sum at infinity, are left to checking each signature on its own.
+    const auto verify_each = [&] {
+        return std::all_of(m_entries.begin(), m_entries.end(), [](const Entry& entry) {
+            return entry.pubkey.VerifySchnorr(entry.msg, entry.sig);
+        });
+    };
+    // The point with x coordinate x32 and even y, as BIP340 lifts R and P
+    const auto lift_x = [](secp256k1_pubkey& point, const unsigned char* x32) {
+        unsigned char ser[33]{0x02};
+        std::copy(x32, x32 + 32, ser + 1);
+        return secp256k1_ec_pubkey_parse(secp256k1_context_static, &point, ser, sizeof(ser));
+    };
+
+    // The weighted sum below multiplies one point per signature and one per
+    // distinct key, where checking each signature costs little more than one
+    // point multiplication. It only pays off once keys repeat.
+    std::map<XOnlyPubKey, uint256> key_weights;
+    for (const Entry& entry : m_entries) key_weights.try_emplace(entry.pubkey);
+    if (key_weights.size() * 3 > m_entries.size()) return verify_each();
+
+    // Check the BIP340 batch equation
+    //   (sum a_i * s_i) * G = R_0 + sum_{i>0} a_i * R_i + sum a_i * e_i * P_i
+    // with a_0 = 1. The weights a_i hash everything in the batch, so the
+    // signatures cannot be chosen to cancel each other out. The libsecp256k1
+    // API multiplies one point at a time, so the e_i terms of the signatures
+    // of one key are summed into one multiplication.
+    HashWriter seed_hasher{HASHER_SCHNORR_BATCH};
+    for (const Entry& entry : m_entries) {
+        seed_hasher.write(MakeByteSpan(entry.sig));
+        seed_hasher << entry.pubkey << entry.msg;
+    }
+    const uint256 seed{seed_hasher.GetSHA256()};
+
+    std::array<unsigned char, 32> s_sum;
+    std::copy(m_entries[0].sig.begin() + 32, m_entries[0].sig.end(), s_sum.begin());
+    if (!secp256k1_ec_seckey_verify(secp256k1_context_static, s_sum.data())) return verify_each();
+    secp256k1_pubkey r0;
+    std::vector<secp256k1_pubkey> points;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        const Entry& entry{m_entries[i]};
+        secp256k1_pubkey r;
+        if (!lift_x(r, entry.sig.data())) return verify_each();
+        HashWriter challenge{HASHER_BIP340_CHALLENGE};
+        challenge.write(MakeByteSpan(entry.sig).first(32));
+        challenge << entry.pubkey << entry.msg;
+        uint256 weight{challenge.GetSHA256()};
+        if (i == 0) {
+            r0 = r;
+            if (!secp256k1_ec_seckey_verify(secp256k1_context_static, weight.begin())) return verify_each();
+        } else {
+            HashWriter a_hasher{HASHER_SCHNORR_BATCH};
+            a_hasher << seed << uint64_t{i};
+            const uint256 a{a_hasher.GetSHA256()};
+            std::array<unsigned char, 32> s;
+            std::copy(entry.sig.begin() + 32, entry.sig.end(), s.begin());
+            if (!secp256k1_ec_pubkey_tweak_mul(secp256k1_context_static, &r, a.begin()) ||
+                !secp256k1_ec_seckey_tweak_mul(secp256k1_context_static, s.data(), a.begin()) ||
+                !secp256k1_ec_seckey_tweak_add(secp256k1_context_static, s_sum.data(), s.data()) ||
+                !secp256k1_ec_seckey_tweak_mul(secp256k1_context_static, weight.begin(), a.begin())) {
+                return verify_each();
+            }
+            points.push_back(r);
+        }
+        uint256& key_weight{key_weights[entry.pubkey]};
+        if (key_weight.IsNull()) {
+            key_weight = weight;
+        } else if (!secp256k1_ec_seckey_tweak_add(secp256k1_context_static, key_weight.begin(), weight.begin())) {
+            return verify_each();
+        }
+    }
+    for (const auto& [pubkey, weight] : key_weights) {
+        secp256k1_pubkey p;
+        if (!lift_x(p, pubkey.data()) || !secp256k1_ec_pubkey_tweak_mul(secp256k1_context_static, &p, weight.begin())) return verify_each();
+        points.push_back(p);
+    }
+
+    // (sum a_i * s_i) * G minus all other points must be R_0
+    std::vector<const secp256k1_pubkey*> point_ptrs;
+    for (const secp256k1_pubkey& point : points) point_ptrs.push_back(&point);
+    secp256k1_pubkey sum;
+    if (!secp256k1_ec_pubkey_combine(secp256k1_context_static, &sum, point_ptrs.data(), point_ptrs.size()) ||
+        !secp256k1_ec_pubkey_negate(secp256k1_context_static, &sum) ||
+        !secp256k1_ec_pubkey_tweak_add(secp256k1_context_static, &sum, s_sum.data())) {
+        return verify_each();
+    }
+    return secp256k1_ec_pubkey_cmp(secp256k1_context_static, &sum, &r0) == 0;
+}
+
 static const HashWriter HASHER_TAPTWEAK{TaggedHash("TapTweak")};
 
 uint256 XOnlyPubKey::ComputeTapTweakHash(const uint256* merkle_root) const
@@ -12,6 +12,7 @@
 #include <span.h>
 #include <uint256.h>
 
+#include <array>
 #include <cstring>
 #include <optional>
 #include <vector>
@@ -291,6 +292,32 @@ public:
     SERIALIZE_METHODS(XOnlyPubKey, obj) { READWRITE(obj.m_keydata); }
 };
 
+/** A set of Schnorr signatures that are verified together. Verify() checks
+ *  them in one BIP340 batch equation when many of them share a key, and with
+ *  XOnlyPubKey::VerifySchnorr otherwise. It only tells whether all of them are
+ *  valid, not which one is not. */
+class SchnorrSigBatch
+{
+private:
+    struct Entry {
+        std::array<unsigned char, 64> sig;
+        XOnlyPubKey pubkey;
+        uint256 msg;
+    };
+    std::vector<Entry> m_entries;
+
+public:
+    /** Add a signature to the batch. sigbytes must be exactly 64 bytes. */
+    void Add(Span<const unsigned char> sigbytes, const XOnlyPubKey& pubkey, const uint256& msg);
+
+    /** Verify all signatures in the batch. Returns true for an empty batch. */
+    bool Verify() const;
+
+    void Clear() { m_entries.clear(); }
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+};
+
 struct CExtPubKey {
     unsigned char version[4];
     unsigned char nDepth;
@@ -17,6 +17,7 @@
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 #include <rpc/mempool.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
@@ -25,21 +26,30 @@
 #include <sync.h>
 #include <txmempool.h>
 #include <util/check.h>
+#include <util/perfstats.h>
 #include <util/system.h>
 #include <validation.h>
 #include <version.h>
 
+#include <algorithm>
 #include <any>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <univalue.h>
 
 using node::GetTransaction;
 using node::NodeContext;
+using node::OpenBlockFile;
 using node::ReadBlockFromDisk;
+using node::ReadRawBlockFromDisk;
+using node::ReadRawBlockSize;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
 static constexpr unsigned int MAX_REST_HEADERS_RESULTS = 2000;
+static constexpr unsigned int MAX_REST_BLOCKS_RESULTS = 1000;
 
 static const struct {
     RESTResponseFormat rf;
@@ -65,6 +75,31 @@ struct CCoin {
     }
 };
 
+/** Block header with the proof-of-stake fields of its block index entry, as returned by /rest/blockheaders/ */
+struct CPoSBlockHeader {
+    CBlockHeader header;
+    uint32_t nHeight;
+    uint32_t nFlags;
+    uint64_t nStakeModifier;
+    uint256 hashProofOfStake;
+    COutPoint prevoutStake;
+    uint32_t nStakeTime;
+    int64_t nMint;
+    int64_t nMoneySupply;
+
+    explicit CPoSBlockHeader(const CBlockIndex& index)
+        : header(index.GetBlockHeader()), nHeight(index.nHeight), nFlags(index.nFlags),
+          nStakeModifier(index.nStakeModifier), hashProofOfStake(index.hashProofOfStake),
+          prevoutStake(index.prevoutStake), nStakeTime(index.nStakeTime),
+          nMint(index.nMint), nMoneySupply(index.nMoneySupply) {}
+
+    SERIALIZE_METHODS(CPoSBlockHeader, obj)
+    {
+        READWRITE(obj.header, obj.nHeight, obj.nFlags, obj.nStakeModifier, obj.hashProofOfStake,
+                  obj.prevoutStake, obj.nStakeTime, obj.nMint, obj.nMoneySupply);
+    }
+};
+
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, std::string message)
 {
     req->WriteHeader("Content-Type", "text/plain");
@@ -333,10 +368,10 @@ static bool rest_block(const std::any& context,
     }
 
     case RESTResponseFormat::JSON: {
-        UniValue objBlock = blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity);
-        std::string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        HTTPStreamedReply reply{req, "application/json"};
+        JSONStreamWriter writer{[&](std::string&& chunk) { reply.Write(std::move(chunk)); }};
+        blockToJSON(writer, chainman.m_blockman, block, tip, pblockindex, tx_verbosity);
+        reply.Finish(writer.TakeBuffer() + "\n");
         return true;
     }
 
@@ -356,6 +391,230 @@ static bool rest_block_notxdetails(const std::any& context, HTTPRequest* req, co
     return rest_block(context, req, strURIPart, TxVerbosity::SHOW_TXID);
 }
 
+/**
+ * Parse the "<start_height>/<count>" part of a range request.
+ *
+ * @param[in]  req        The HTTP request, whose status code will be set on a parse error.
+ * @param[in]  param      The request path without the endpoint prefix and data format.
+ * @param[in]  max_count  The largest count accepted.
+ * @param[out] start      The first height requested.
+ * @param[out] count      The number of blocks requested.
+ * @returns false if the range could not be parsed.
+ */
+static bool ParseHeightRange(HTTPRequest* req, const std::string& param, unsigned int max_count, int& start, int& count)
+{
+    const std::vector<std::string> path = SplitString(param, '/');
+    if (path.size() != 2) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected <start_height>/<count>.<ext>");
+    }
+    const auto parsed_start{ToIntegral<int32_t>(path[0])};
+    if (!parsed_start.has_value() || *parsed_start < 0) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + SanitizeString(path[0]));
+    }
+    const auto parsed_count{ToIntegral<int32_t>(path[1])};
+    if (!parsed_count.has_value() || *parsed_count < 1 || static_cast<unsigned int>(*parsed_count) > max_count) {
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Count is invalid or out of acceptable range (1-%u): %s", max_count, SanitizeString(path[1])));
+    }
+    start = *parsed_start;
+    count = *parsed_count;
+    return true;
+}
+
+/**
+ * Look up the active chain entries for a range request. The range is cut off
+ * at the tip.
+ *
+ * @returns false, with the status code of req set, if the start height is
+ *          above the tip or, if need_data is set, the data of a block in the
+ *          range is not available.
+ */
+static bool GetChainRange(HTTPRequest* req, ChainstateManager& chainman, int start, int count, bool need_data,
+                          std::vector<const CBlockIndex*>& blocks, std::vector<FlatFilePos>* positions = nullptr)
+{
+    LOCK(cs_main);
+    const CChain& active_chain = chainman.ActiveChain();
+    if (start > active_chain.Height()) {
+        return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+    }
+    const int end = std::min(active_chain.Height(), start + count - 1);
+    blocks.reserve(end - start + 1);
+    for (int height = start; height <= end; ++height) {
+        const CBlockIndex* pindex = active_chain[height];
+        if (need_data && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+        }
+        blocks.push_back(pindex);
+        if (positions) positions->push_back(pindex->GetBlockPos());
+    }
+    return true;
+}
+
+/**
+ * Send the blocks stored at positions back to back, exactly as they are
+ * stored in the block files. The HTTP server sends the data straight from
+ * the files, without copying it into memory. Every file is opened and every
+ * block located before the reply starts, so a missing block still results in
+ * an error reply, and pruning cannot pull a file away while it is sent.
+ */
+static bool WriteRawBlocks(HTTPRequest* req, const std::vector<FlatFilePos>& positions, const CMessageHeader::MessageStartChars& message_start)
+{
+    struct OpenFile {
+        FILE* file;
+        std::unique_ptr<HTTPReplyFile> reply_file;
+    };
+    struct Part {
+        const HTTPReplyFile* file;
+        int64_t offset;
+        int64_t length;
+    };
+    std::map<int, OpenFile> files;
+    std::vector<Part> parts;
+    parts.reserve(positions.size());
+    for (const FlatFilePos& pos : positions) {
+        auto it = files.find(pos.nFile);
+        if (it == files.end()) {
+            FILE* file = OpenBlockFile(FlatFilePos{pos.nFile, 0}, /*fReadOnly=*/true);
+            if (!file) {
+                return RESTERR(req, HTTP_NOT_FOUND, "Block data not available");
+            }
+            auto reply_file{std::make_unique<HTTPReplyFile>(file)};
+            if (reply_file->IsNull()) {
+                return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Block file could not be mapped");
+            }
+            it = files.emplace(pos.nFile, OpenFile{file, std::move(reply_file)}).first;
+        }
+        unsigned int size;
+        if (!ReadRawBlockSize(it->second.file, pos, message_start, size)) {
+            return RESTERR(req, HTTP_NOT_FOUND, "Block data not available");
+        }
+        parts.push_back({it->second.reply_file.get(), pos.nPos, size});
+    }
+
+    HTTPStreamedReply reply{req, "application/octet-stream"};
+    for (const Part& part : parts) {
+        reply.Write(*part.file, part.offset, part.length);
+    }
+    reply.Finish("");
+    return true;
+}
+
+static bool rest_blocks(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req)) return false;
+    std::string param;
+    const RESTResponseFormat rf = ParseDataFormat(param, strURIPart);
+    if (rf != RESTResponseFormat::BINARY && rf != RESTResponseFormat::HEX) {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: bin, hex)");
+    }
+
+    int start, count;
+    if (!ParseHeightRange(req, param, MAX_REST_BLOCKS_RESULTS, start, count)) return false;
+
+    ChainstateManager* maybe_chainman = GetChainman(context, req);
+    if (!maybe_chainman) return false;
+    ChainstateManager& chainman = *maybe_chainman;
+    std::vector<const CBlockIndex*> blocks;
+    std::vector<FlatFilePos> positions;
+    if (!GetChainRange(req, chainman, start, count, /*need_data=*/true, blocks, &positions)) return false;
+
+    // The block files hold blocks in the format served here, unless witness
+    // data has to be stripped.
+    const bool raw{RPCSerializationFlags() == 0};
+    if (rf == RESTResponseFormat::BINARY && raw) {
+        return WriteRawBlocks(req, positions, chainman.GetParams().MessageStart());
+    }
+
+    HTTPStreamedReply reply{req, rf == RESTResponseFormat::BINARY ? "application/octet-stream" : "text/plain"};
+    for (size_t i = 0; i < positions.size(); ++i) {
+        std::vector<uint8_t> data;
+        bool read_ok;
+        if (raw) {
+            read_ok = ReadRawBlockFromDisk(data, positions[i], chainman.GetParams().MessageStart());
+        } else {
+            CBlock block;
+            read_ok = ReadBlockFromDisk(block, positions[i], chainman.GetParams().GetConsensus());
+            if (read_ok) {
+                CVectorWriter writer{SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), data, 0};
+                writer << block;
+            }
+        }
+        if (!read_ok) {
+            const std::string hash{blocks[i]->GetBlockHash().GetHex()};
+            if (!reply.Started()) return RESTERR(req, HTTP_NOT_FOUND, hash + " not found");
+            // Part of the reply is out already, the client sees a short reply
+            LogPrintf("%s: block %s could not be read, reply cut short\n", __func__, hash);
+            break;
+        }
+        if (rf == RESTResponseFormat::BINARY) {
+            reply.Write(std::string{data.begin(), data.end()});
+        } else {
+            reply.Write(HexStr(data));
+        }
+    }
+    reply.Finish(rf == RESTResponseFormat::HEX ? "\n" : "");
+    return true;
+}
+
+static bool rest_blockheaders(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req)) return false;
+    std::string param;
+    const RESTResponseFormat rf = ParseDataFormat(param, strURIPart);
+
+    int start, count;
+    if (!ParseHeightRange(req, param, MAX_REST_HEADERS_RESULTS, start, count)) return false;
+
+    ChainstateManager* maybe_chainman = GetChainman(context, req);
+    if (!maybe_chainman) return false;
+    std::vector<const CBlockIndex*> headers;
+    if (!GetChainRange(req, *maybe_chainman, start, count, /*need_data=*/false, headers)) return false;
+
+    switch (rf) {
+    case RESTResponseFormat::BINARY:
+    case RESTResponseFormat::HEX: {
+        CDataStream ssHeaders(SER_NETWORK, PROTOCOL_VERSION);
+        for (const CBlockIndex* pindex : headers) {
+            ssHeaders << CPoSBlockHeader{*pindex};
+        }
+        if (rf == RESTResponseFormat::BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssHeaders.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssHeaders) + "\n");
+        }
+        return true;
+    }
+    case RESTResponseFormat::JSON: {
+        const CBlockIndex* tip{WITH_LOCK(cs_main, return maybe_chainman->ActiveChain().Tip())};
+        UniValue jsonHeaders(UniValue::VARR);
+        for (const CBlockIndex* pindex : headers) {
+            UniValue header = blockheaderToJSON(tip, pindex);
+            header.pushKV("flags", strprintf("%s%s", pindex->IsProofOfStake() ? "proof-of-stake" : "proof-of-work", pindex->GeneratedStakeModifier() ? " stake-modifier" : ""));
+            header.pushKV("proofhash", pindex->IsProofOfStake() ? pindex->hashProofOfStake.GetHex() : pindex->GetBlockHash().GetHex());
+            header.pushKV("entropybit", (int)pindex->GetStakeEntropyBit());
+            header.pushKV("modifier", strprintf("%016llx", pindex->nStakeModifier));
+            if (pindex->IsProofOfStake()) {
+                UniValue prevout(UniValue::VOBJ);
+                prevout.pushKV("txid", pindex->prevoutStake.hash.GetHex());
+                prevout.pushKV("vout", (uint64_t)pindex->prevoutStake.n);
+                header.pushKV("prevoutstake", prevout);
+                header.pushKV("staketime", (int64_t)pindex->nStakeTime);
+            }
+            header.pushKV("mint", ValueFromAmount(pindex->nMint));
+            header.pushKV("moneysupply", ValueFromAmount(pindex->nMoneySupply));
+            jsonHeaders.push_back(std::move(header));
+        }
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, jsonHeaders.write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 static bool rest_filter_header(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req)) return false;
@@ -656,7 +915,6 @@ static bool rest_mempool(const std::any& context, HTTPRequest* req, const std::s
 
     switch (rf) {
     case RESTResponseFormat::JSON: {
-        std::string str_json;
         if (param == "contents") {
             std::string raw_verbose;
             try {
@@ -681,11 +939,14 @@ static bool rest_mempool(const std::any& context, HTTPRequest* req, const std::s
             if (verbose && mempool_sequence) {
                 return RESTERR(req, HTTP_BAD_REQUEST, "Verbose results cannot contain mempool sequence values. (hint: set \"verbose=false\")");
             }
-            str_json = MempoolToJSON(*mempool, verbose, mempool_sequence).write() + "\n";
-        } else {
-            str_json = MempoolInfoToJSON(*mempool).write() + "\n";
+            HTTPStreamedReply reply{req, "application/json"};
+            JSONStreamWriter writer{[&](std::string&& chunk) { reply.Write(std::move(chunk)); }};
+            MempoolToJSON(writer, *mempool, verbose, mempool_sequence);
+            reply.Finish(writer.TakeBuffer() + "\n");
+            return true;
         }
 
+        std::string str_json = MempoolInfoToJSON(*mempool).write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, str_json);
         return true;
@@ -696,6 +957,20 @@ static bool rest_mempool(const std::any& context, HTTPRequest* req, const std::s
     }
 }
 
+static bool rest_metrics(const std::any& context, HTTPRequest* req, const std::string& str_uri_part)
+{
+    // Served during warmup too, so that slow startups can be profiled.
+    if (!str_uri_part.empty()) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/metrics");
+    }
+    if (!perf::Enabled()) {
+        return RESTERR(req, HTTP_NOT_FOUND, "Performance statistics are disabled (start with -perfstats)");
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+    req->WriteReply(HTTP_OK, perf::FormatPrometheus());
+    return true;
+}
+
 static bool rest_tx(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -1006,6 +1281,8 @@ static const struct {
       {"/rest/tx/", rest_tx},
       {"/rest/block/notxdetails/", rest_block_notxdetails},
       {"/rest/block/", rest_block_extended},
+      {"/rest/blocks/", rest_blocks},
+      {"/rest/blockheaders/", rest_blockheaders},
       {"/rest/blockfilter/", rest_block_filter},
       {"/rest/blockfilterheaders/", rest_filter_header},
       {"/rest/chaininfo", rest_chaininfo},
@@ -1015,13 +1292,14 @@ static const struct {
       {"/rest/deploymentinfo/", rest_deploymentinfo},
       {"/rest/deploymentinfo", rest_deploymentinfo},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/metrics", rest_metrics},
 };
 
 void StartREST(const std::any& context)
 {
     for (const auto& up : uri_prefixes) {
         auto handler = [context, up](HTTPRequest* req, const std::string& prefix) { return up.handler(context, req, prefix); };
-        RegisterHTTPHandler(up.prefix, false, handler);
+        RegisterHTTPHandler(up.prefix, false, handler, HTTPWorkClass::REST);
     }
 }
 
@@ -18,6 +18,7 @@
 #include <hash.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <index/txindex.h>
 #include <kernel/coinstats.h>
 #include <logging/timer.h>
 #include <net.h>
@@ -28,6 +29,7 @@
 #include <node/utxo_snapshot.h>
 #include <policy/policy.h>
 #include <primitives/transaction.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <rpc/util.h>
@@ -110,10 +112,15 @@ double GetDifficulty(const CBlockIndex* blockindex, const CBlockIndex* tip)
             blockindex = GetLastBlockIndex(tip, false);
     }
 
-    int nShift = (blockindex->nBits >> 24) & 0xff;
+    return GetDifficultyFromBits(blockindex->nBits);
+}
+
+double GetDifficultyFromBits(uint32_t nBits)
+{
+    int nShift = (nBits >> 24) & 0xff;
 
     double dDiff =
-        (double)0x0000ffff / (double)(blockindex->nBits & 0x00ffffff);
+        (double)0x0000ffff / (double)(nBits & 0x00ffffff);
 
     while (nShift < 29) {
         dDiff *= 256.0;
@@ -194,7 +201,8 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
-UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity)
+/** Block fields other than the transactions */
+static UniValue blockInfoToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex)
 {
     UniValue result = blockheaderToJSON(tip, blockindex);
 
@@ -209,12 +217,17 @@ UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIn
     result.pushKV("modifier", strprintf("%016llx", blockindex->nStakeModifier));
     result.pushKV("modifierchecksum", strprintf("%08x", blockindex->nStakeModifierChecksum));
     result.pushKV("blocksignature", HexStr(block.vchBlockSig));
-    UniValue txs(UniValue::VARR);
+    return result;
+}
 
+/** Pass the "tx" entries of a block description to fn, in order */
+template <typename Fn>
+static void ForEachBlockTxToJSON(const CBlock& block, const CBlockIndex* blockindex, TxVerbosity verbosity, Fn&& fn)
+{
     switch (verbosity) {
         case TxVerbosity::SHOW_TXID:
             for (const CTransactionRef& tx : block.vtx) {
-                txs.push_back(tx->GetHash().GetHex());
+                fn(UniValue{tx->GetHash().GetHex()});
             }
             break;
 
@@ -229,16 +242,33 @@ UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIn
                 const CTxUndo* txundo = (have_undo && i > 0) ? &blockUndo.vtxundo.at(i - 1) : nullptr;
                 UniValue objTx(UniValue::VOBJ);
                 TxToUniv(*tx, /*block_hash=*/uint256(), /*entry=*/objTx, /*include_hex=*/true, RPCSerializationFlags(), txundo, verbosity);
-                txs.push_back(objTx);
+                fn(std::move(objTx));
             }
             break;
     }
+}
 
+UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity)
+{
+    UniValue result = blockInfoToJSON(block, tip, blockindex);
+    UniValue txs(UniValue::VARR);
+    ForEachBlockTxToJSON(block, blockindex, verbosity, [&](UniValue&& tx) { txs.push_back(std::move(tx)); });
     result.pushKV("tx", txs);
 
     return result;
 }
 
+void blockToJSON(JSONStreamWriter& writer, BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity)
+{
+    writer.BeginObject();
+    writer.ObjectFields(blockInfoToJSON(block, tip, blockindex));
+    writer.Key("tx");
+    writer.BeginArray();
+    ForEachBlockTxToJSON(block, blockindex, verbosity, [&](UniValue&& tx) { writer.Value(tx); });
+    writer.EndArray();
+    writer.EndObject();
+}
+
 static RPCHelpMan getblockcount()
 {
     return RPCHelpMan{"getblockcount",
@@ -254,8 +284,7 @@ static RPCHelpMan getblockcount()
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
-    return chainman.ActiveChain().Height();
+    return CHECK_NONFATAL(chainman.GetTipSnapshot())->height;
 },
     };
 }
@@ -274,8 +303,7 @@ static RPCHelpMan getbestblockhash()
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
-    return chainman.ActiveChain().Tip()->GetBlockHash().GetHex();
+    return CHECK_NONFATAL(chainman.GetTipSnapshot())->hash.GetHex();
 },
     };
 }
@@ -461,10 +489,10 @@ static RPCHelpMan getdifficulty()
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
+    const auto snapshot{CHECK_NONFATAL(chainman.GetTipSnapshot())};
     UniValue obj(UniValue::VOBJ);
-    obj.pushKV("proof-of-work",        GetDifficulty(NULL, chainman.ActiveChain().Tip()));
-    obj.pushKV("proof-of-stake",       GetDifficulty(GetLastBlockIndex(chainman.ActiveChain().Tip(), true), chainman.ActiveChain().Tip()));
+    obj.pushKV("proof-of-work",        GetDifficultyFromBits(snapshot->pow_bits));
+    obj.pushKV("proof-of-stake",       GetDifficultyFromBits(snapshot->pos_bits));
     obj.pushKV("search-interval",      (int)nLastCoinStakeSearchInterval);
     return obj;
 },
@@ -787,6 +815,11 @@ static RPCHelpMan getblock()
         tx_verbosity = TxVerbosity::SHOW_DETAILS_AND_PREVOUT;
     }
 
+    if (request.result_writer && tx_verbosity != TxVerbosity::SHOW_TXID) {
+        // Avoid holding all transaction details in memory at once
+        blockToJSON(*request.result_writer, chainman.m_blockman, block, tip, pblockindex, tx_verbosity);
+        return NullUniValue;
+    }
     return blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity);
 },
     };
@@ -1154,6 +1187,7 @@ RPCHelpMan getblockchaininfo()
                         {RPCResult::Type::NUM, "verificationprogress", "estimate of verification progress [0..1]"},
                         {RPCResult::Type::BOOL, "initialblockdownload", "(debug information) estimate of whether this node is in Initial Block Download mode"},
                         {RPCResult::Type::STR_HEX, "chainwork", "total amount of work in active chain, in hexadecimal"},
+                        {RPCResult::Type::STR_AMOUNT, "moneysupply", "total amount of coins in existence as of the tip"},
                         {RPCResult::Type::NUM, "size_on_disk", "the estimated size of the block and undo files on disk"},
                         {RPCResult::Type::STR, "warnings", "any network and blockchain warnings"},
                     }},
@@ -1164,22 +1198,24 @@ RPCHelpMan getblockchaininfo()
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
-    Chainstate& active_chainstate = chainman.ActiveChainstate();
+    // Read the published tip summary rather than taking cs_main, so that this
+    // stays responsive while a block is being connected.
+    const auto snapshot{CHECK_NONFATAL(chainman.GetTipSnapshot())};
+    CHECK_NONFATAL(snapshot->tip);
 
-    const CBlockIndex& tip{*CHECK_NONFATAL(active_chainstate.m_chain.Tip())};
-    const int height{tip.nHeight};
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("chain", chainman.GetParams().NetworkIDString());
-    obj.pushKV("blocks", height);
-    obj.pushKV("headers", chainman.m_best_header ? chainman.m_best_header->nHeight : -1);
-    obj.pushKV("bestblockhash", tip.GetBlockHash().GetHex());
-    obj.pushKV("difficulty", GetDifficulty(&tip, &tip));
-    obj.pushKV("time", tip.GetBlockTime());
-    obj.pushKV("mediantime", tip.GetMedianTimePast());
-    obj.pushKV("verificationprogress", GuessVerificationProgress(chainman.GetParams().TxData(), &tip));
-    obj.pushKV("initialblockdownload", active_chainstate.IsInitialBlockDownload());
-    obj.pushKV("chainwork", tip.nChainTrust.GetHex());
+    obj.pushKV("blocks", snapshot->height);
+    obj.pushKV("headers", snapshot->header_height);
+    obj.pushKV("bestblockhash", snapshot->hash.GetHex());
+    obj.pushKV("difficulty", GetDifficultyFromBits(snapshot->bits));
+    obj.pushKV("time", snapshot->time);
+    obj.pushKV("mediantime", snapshot->median_time);
+    // Both depend on the current time, so they are not part of the snapshot
+    obj.pushKV("verificationprogress", GuessVerificationProgress(chainman.GetParams().TxData(), snapshot->tip));
+    obj.pushKV("initialblockdownload", chainman.ActiveChainstate().IsInitialBlockDownload());
+    obj.pushKV("chainwork", snapshot->chain_trust.GetHex());
+    obj.pushKV("moneysupply", ValueFromAmount(snapshot->money_supply));
     obj.pushKV("size_on_disk", chainman.m_blockman.CalculateCurrentUsage());
 /*
     UniValue softforks(UniValue::VARR);
@@ -2512,7 +2548,8 @@ static RPCHelpMan dumptxoutset()
 {
     return RPCHelpMan{
         "dumptxoutset",
-        "Write the serialized UTXO set to disk.",
+        "Write the serialized UTXO set to disk.\n"
+        "The snapshot also carries the stake state of the blocks before its base and the kernel data of its coins, which the proof-of-stake checks of the next blocks need.",
         {
             {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the output file. If relative, will be prefixed by datadir."},
         },
@@ -2525,6 +2562,8 @@ static RPCHelpMan dumptxoutset()
                     {RPCResult::Type::STR, "path", "the absolute path that the snapshot was written to"},
                     {RPCResult::Type::STR_HEX, "txoutset_hash", "the hash of the UTXO set contents"},
                     {RPCResult::Type::NUM, "nchaintx", "the number of transactions in the chain up to and including the base block"},
+                    {RPCResult::Type::NUM, "stake_blocks", "the number of blocks before the base whose stake state is written in the snapshot"},
+                    {RPCResult::Type::STR_HEX, "stake_hash", "the hash of the stake state of the snapshot"},
                 }
         },
         RPCExamples{
@@ -2564,6 +2603,86 @@ static RPCHelpMan dumptxoutset()
     };
 }
 
+static RPCHelpMan loadtxoutset()
+{
+    return RPCHelpMan{
+        "loadtxoutset",
+        "Load the serialized UTXO set from disk.\n"
+        "Once this snapshot is loaded, its contents will be "
+        "deserialized into a second chainstate data structure, which is then used to sync to "
+        "the network's tip. Meanwhile, the original chainstate will complete the initial block "
+        "download process in the background, eventually validating up to the block that the "
+        "snapshot is based upon.\n\n"
+        "The stake state the snapshot carries lets the node check the proof-of-stake of the "
+        "blocks after its base and stake its own coins right away. The background validation "
+        "recomputes it and shuts the node down if it does not match.\n\n"
+        "The snapshot must match the assumeutxo data compiled into the node. The transaction "
+        "index is required.",
+        {
+            {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the snapshot file. If relative, will be prefixed by datadir."},
+        },
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::NUM, "coins_loaded", "the number of coins loaded from the snapshot"},
+                    {RPCResult::Type::STR_HEX, "tip_hash", "the hash of the base of the snapshot"},
+                    {RPCResult::Type::NUM, "base_height", "the height of the base of the snapshot"},
+                    {RPCResult::Type::NUM, "stake_blocks", "the number of blocks whose stake state was loaded"},
+                    {RPCResult::Type::STR, "path", "the absolute path that the snapshot was loaded from"},
+                }
+        },
+        RPCExamples{
+            HelpExampleCli("loadtxoutset", "utxo.dat")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    NodeContext& node = EnsureAnyNodeContext(request.context);
+    ChainstateManager& chainman = EnsureChainman(node);
+    const ArgsManager& args{EnsureAnyArgsman(request.context)};
+    const fs::path path = fsbridge::AbsPathJoin(args.GetDataDirNet(), fs::u8path(request.params[0].get_str()));
+
+    FILE* file{fsbridge::fopen(path, "rb")};
+    AutoFile afile{file};
+    if (afile.IsNull()) {
+        throw JSONRPCError(
+            RPC_INVALID_PARAMETER,
+            "Couldn't open file " + path.u8string() + " for reading.");
+    }
+
+    SnapshotMetadata metadata;
+    try {
+        afile >> metadata;
+    } catch (const std::ios_base::failure&) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Unable to parse snapshot metadata");
+    }
+
+    {
+        LOCK(cs_main);
+        const CBlockIndex* snapshot_start_block{chainman.m_blockman.LookupBlockIndex(metadata.m_base_blockhash)};
+        if (!snapshot_start_block) {
+            throw JSONRPCError(RPC_MISC_ERROR, "The base block header of the snapshot is not in the headers chain yet");
+        }
+        if (chainman.ActiveChain().Contains(snapshot_start_block)) {
+            throw JSONRPCError(RPC_MISC_ERROR, "The base block of the snapshot is already in the active chain");
+        }
+    }
+
+    if (!chainman.ActivateSnapshot(afile, metadata, /*in_memory=*/false)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to load UTXO snapshot " + path.u8string() + ", see debug.log for details");
+    }
+    const CBlockIndex* new_tip{WITH_LOCK(::cs_main, return chainman.ActiveTip())};
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("coins_loaded", metadata.m_coins_count);
+    result.pushKV("tip_hash", new_tip->GetBlockHash().ToString());
+    result.pushKV("base_height", new_tip->nHeight);
+    result.pushKV("stake_blocks", uint64_t{metadata.m_stake_blocks.size()});
+    result.pushKV("path", path.u8string());
+    return result;
+},
+    };
+}
+
 UniValue CreateUTXOSnapshot(
     NodeContext& node,
     Chainstate& chainstate,
@@ -2574,6 +2693,13 @@ UniValue CreateUTXOSnapshot(
     std::unique_ptr<CCoinsViewCursor> pcursor;
     std::optional<CCoinsStats> maybe_stats;
     const CBlockIndex* tip;
+    std::vector<node::SnapshotStakeBlock> stake_blocks;
+
+    // peercoin: the kernel data of the coins is read from the transaction index
+    if (!g_txindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The transaction index is required to create a UTXO snapshot");
+    }
+    g_txindex->BlockUntilSyncedToCurrentChain();
 
     {
         // We need to lock cs_main to ensure that the coinsdb isn't written to
@@ -2599,6 +2725,15 @@ UniValue CreateUTXOSnapshot(
 
         pcursor = chainstate.CoinsDB().Cursor();
         tip = CHECK_NONFATAL(chainstate.m_blockman.LookupBlockIndex(maybe_stats->hashBlock));
+
+        // peercoin: stake state of the blocks the proof-of-stake checks after the tip read
+        // (the genesis block has no stake state to carry)
+        const CBlockIndex* window_start{GetStakeStateWindowStart(tip)};
+        if (!window_start->pprev) window_start = chainstate.m_chain.Next(window_start);
+        for (const CBlockIndex* pindex{window_start}; pindex; pindex = chainstate.m_chain.Next(pindex)) {
+            stake_blocks.push_back({pindex->GetBlockHash(), pindex->nFlags, pindex->nStakeModifier, pindex->hashProofOfStake,
+                                    pindex->prevoutStake, pindex->nStakeTime, pindex->nMint, pindex->nMoneySupply});
+        }
     }
 
     LOG_TIME_SECONDS(strprintf("writing UTXO snapshot at height %s (%s) to file %s (via %s)",
@@ -2606,12 +2741,17 @@ UniValue CreateUTXOSnapshot(
         fs::PathToString(path), fs::PathToString(temppath)));
 
     SnapshotMetadata metadata{tip->GetBlockHash(), maybe_stats->coins_count, tip->nChainTx};
+    metadata.m_stake_blocks = std::move(stake_blocks);
+    metadata.m_kernel_count = maybe_stats->nTransactions;
 
     afile << metadata;
 
     COutPoint key;
     Coin coin;
     unsigned int iter{0};
+    // The cursor returns the coins of a transaction next to each other
+    std::vector<uint256> txids;
+    txids.reserve(maybe_stats->nTransactions);
 
     while (pcursor->Valid()) {
         if (iter % 5000 == 0) node.rpc_interruption_point();
@@ -2619,11 +2759,33 @@ UniValue CreateUTXOSnapshot(
         if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
             afile << key;
             afile << coin;
+            if (txids.empty() || txids.back() != key.hash) txids.push_back(key.hash);
         }
 
         pcursor->Next();
     }
 
+    if (txids.size() != metadata.m_kernel_count) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+    }
+
+    // peercoin: offset of each transaction in its block for the kernels of its coins
+    std::vector<node::SnapshotKernelTx> kernel_txs;
+    kernel_txs.reserve(txids.size());
+    for (const uint256& txid : txids) {
+        if (kernel_txs.size() % 5000 == 0) node.rpc_interruption_point();
+        CDiskTxPos postx;
+        SnapshotTxPos snapshot_pos;
+        if (g_txindex->FindTxPosition(txid, postx)) {
+            kernel_txs.push_back({txid, postx.nTxOffset});
+        } else if (g_txindex->FindSnapshotTx(txid, snapshot_pos)) {
+            kernel_txs.push_back({txid, snapshot_pos.tx_offset});
+        } else {
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("Transaction %s is not in the transaction index", txid.ToString()));
+        }
+        afile << kernel_txs.back();
+    }
+
     afile.fclose();
 
     UniValue result(UniValue::VOBJ);
@@ -2635,6 +2797,8 @@ UniValue CreateUTXOSnapshot(
     // Cast required because univalue doesn't have serialization specified for
     // `unsigned int`, nChainTx's type.
     result.pushKV("nchaintx", uint64_t{tip->nChainTx});
+    result.pushKV("stake_blocks", uint64_t{metadata.m_stake_blocks.size()});
+    result.pushKV("stake_hash", node::ComputeSnapshotStakeHash(metadata, kernel_txs).ToString());
     return result;
 }
 
@@ -2660,13 +2824,14 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"blockchain", &scantxoutset},
         {"blockchain", &scanblocks},
         {"blockchain", &getblockfilter},
+        {"blockchain", &dumptxoutset},
+        {"blockchain", &loadtxoutset},
         {"hidden", &invalidateblock},
         {"hidden", &reconsiderblock},
         {"hidden", &waitfornewblock},
         {"hidden", &waitforblock},
         {"hidden", &waitforblockheight},
         {"hidden", &syncwithvalidationinterfacequeue},
-        {"hidden", &dumptxoutset},
     };
     for (const auto& c : commands) {
         t.appendCommand(c.name, &c);
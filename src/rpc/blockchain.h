@@ -21,6 +21,7 @@ class CBlockIndex;
 class CChainState;
 class CTxMemPool;
 class ChainstateManager;
+class JSONStreamWriter;
 class UniValue;
 namespace node {
 struct NodeContext;
@@ -36,12 +37,18 @@ static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
  */
 double GetDifficulty(const CBlockIndex* blockindex, const CBlockIndex* tip);
 
+/** Difficulty as a multiple of the minimum difficulty for a compact target. */
+double GetDifficultyFromBits(uint32_t nBits);
+
 /** Callback for when block tip changed. */
 void RPCNotifyBlockChange(const CBlockIndex*);
 
 /** Block description to JSON */
 UniValue blockToJSON(node::BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity) LOCKS_EXCLUDED(cs_main);
 
+/** Block description streamed to writer, one transaction at a time */
+void blockToJSON(JSONStreamWriter& writer, node::BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity) LOCKS_EXCLUDED(cs_main);
+
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex) LOCKS_EXCLUDED(cs_main);
 
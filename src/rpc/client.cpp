@@ -180,6 +180,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "psbtbumpfee", 1, "options" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
+    { "getperfstats", 0, "reset" },
     { "disconnectnode", 1, "nodeid" },
     { "upgradewallet", 0, "version" },
     // Echo with conversion (For testing only)
@@ -213,6 +214,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "listminting", 0, "count" },
     { "optimizeutxoset", 1, "amount" },
     { "optimizeutxoset", 2, "transmit" },
+    { "optimizeutxoset", 4, "options" },
     { "reservebalance", 0, "reserve" },
     { "reservebalance", 1, "amount" },
     { "sendalert", 2, "minver"},
@@ -0,0 +1,98 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <util/check.h>
+
+#include <univalue.h>
+
+JSONStreamWriter::JSONStreamWriter(Sink sink, size_t chunk_size)
+    : m_sink(std::move(sink)), m_chunk_size(chunk_size)
+{
+    m_buffer.reserve(m_chunk_size + 1024);
+}
+
+void JSONStreamWriter::Separate()
+{
+    if (m_need_comma) m_buffer += ',';
+    m_has_output = true;
+}
+
+void JSONStreamWriter::MaybeFlush()
+{
+    if (m_buffer.size() < m_chunk_size) return;
+    std::string chunk;
+    chunk.reserve(m_chunk_size + 1024);
+    std::swap(chunk, m_buffer);
+    m_sink(std::move(chunk));
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Separate();
+    m_buffer += '{';
+    m_stack.push_back('{');
+    m_need_comma = false;
+}
+
+void JSONStreamWriter::EndObject()
+{
+    Assume(!m_stack.empty() && m_stack.back() == '{');
+    m_stack.pop_back();
+    m_buffer += '}';
+    m_need_comma = true;
+    MaybeFlush();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Separate();
+    m_buffer += '[';
+    m_stack.push_back('[');
+    m_need_comma = false;
+}
+
+void JSONStreamWriter::EndArray()
+{
+    Assume(!m_stack.empty() && m_stack.back() == '[');
+    m_stack.pop_back();
+    m_buffer += ']';
+    m_need_comma = true;
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    Assume(!m_stack.empty() && m_stack.back() == '{');
+    Separate();
+    m_buffer += UniValue{UniValue::VSTR, key}.write();
+    m_buffer += ':';
+    m_need_comma = false;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    Separate();
+    m_buffer += value.write();
+    m_need_comma = true;
+    MaybeFlush();
+}
+
+void JSONStreamWriter::ObjectFields(const UniValue& obj)
+{
+    const std::vector<std::string>& keys = obj.getKeys();
+    const std::vector<UniValue>& values = obj.getValues();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        Key(keys[i]);
+        Value(values[i]);
+    }
+}
+
+std::string JSONStreamWriter::TakeBuffer()
+{
+    std::string rest;
+    std::swap(rest, m_buffer);
+    return rest;
+}
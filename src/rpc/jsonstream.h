@@ -0,0 +1,60 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONSTREAM_H
+#define BITCOIN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+/**
+ * Incremental JSON writer producing byte-for-byte the same compact output as
+ * UniValue::write(), without holding the complete document in memory.
+ *
+ * Large containers are opened and closed explicitly while their elements are
+ * written one at a time, usually as small UniValue subtrees. Output collects
+ * in a buffer that is handed to the sink whenever it grows past chunk_size.
+ */
+class JSONStreamWriter
+{
+public:
+    using Sink = std::function<void(std::string&& chunk)>;
+
+    static constexpr size_t DEFAULT_CHUNK_SIZE{64 * 1024};
+
+    explicit JSONStreamWriter(Sink sink, size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Write an object key. Must be followed by exactly one value. */
+    void Key(const std::string& key);
+    /** Write a complete value, an array element or the value for the last key. */
+    void Value(const UniValue& value);
+    /** Write all key/value pairs of obj into the currently open object. */
+    void ObjectFields(const UniValue& obj);
+
+    /** Whether anything has been written to this writer. */
+    bool HasOutput() const { return m_has_output; }
+    /** Return and clear the output not yet handed to the sink. */
+    std::string TakeBuffer();
+
+private:
+    const Sink m_sink;
+    const size_t m_chunk_size;
+    std::string m_buffer;
+    //! Open containers, '{' or '['
+    std::vector<char> m_stack;
+    bool m_need_comma{false};
+    bool m_has_output{false};
+
+    void Separate();
+    void MaybeFlush();
+};
+
+#endif // BITCOIN_RPC_JSONSTREAM_H
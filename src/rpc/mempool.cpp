@@ -14,6 +14,7 @@
 #include <policy/rbf.h>
 #include <policy/settings.h>
 #include <primitives/transaction.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <rpc/util.h>
@@ -324,6 +325,52 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempoo
     }
 }
 
+void MempoolToJSON(JSONStreamWriter& writer, const CTxMemPool& pool, bool verbose, bool include_mempool_sequence)
+{
+    if (!verbose) {
+        // Only txids, small enough to build in memory
+        writer.Value(MempoolToJSON(pool, verbose, include_mempool_sequence));
+        return;
+    }
+    if (include_mempool_sequence) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbose results cannot contain mempool sequence values.");
+    }
+    // Describe the entries a batch at a time, and write each batch without
+    // holding pool.cs, so a slow client neither holds up the mempool nor makes
+    // the whole result pile up in memory. Entries that left the mempool in the
+    // meantime are skipped.
+    static constexpr size_t BATCH_SIZE{1000};
+    std::vector<uint256> vtxid;
+    {
+        // Same order as the non-streamed result
+        LOCK(pool.cs);
+        vtxid.reserve(pool.mapTx.size());
+        for (const CTxMemPoolEntry& e : pool.mapTx) vtxid.push_back(e.GetTx().GetHash());
+    }
+    std::vector<std::pair<std::string, UniValue>> batch;
+    batch.reserve(std::min(BATCH_SIZE, vtxid.size()));
+    writer.BeginObject();
+    for (size_t start = 0; start < vtxid.size(); start += BATCH_SIZE) {
+        const size_t end = std::min(start + BATCH_SIZE, vtxid.size());
+        {
+            LOCK(pool.cs);
+            for (size_t i = start; i < end; ++i) {
+                const auto it = pool.mapTx.find(vtxid[i]);
+                if (it == pool.mapTx.end()) continue;
+                UniValue info(UniValue::VOBJ);
+                entryToJSON(pool, info, *it);
+                batch.emplace_back(vtxid[i].ToString(), std::move(info));
+            }
+        }
+        for (const auto& [txid, info] : batch) {
+            writer.Key(txid);
+            writer.Value(info);
+        }
+        batch.clear();
+    }
+    writer.EndObject();
+}
+
 static RPCHelpMan getrawmempool()
 {
     return RPCHelpMan{"getrawmempool",
@@ -369,6 +416,10 @@ static RPCHelpMan getrawmempool()
         include_mempool_sequence = request.params[1].get_bool();
     }
 
+    if (request.result_writer && fVerbose) {
+        MempoolToJSON(*request.result_writer, EnsureAnyMemPool(request.context), fVerbose, include_mempool_sequence);
+        return NullUniValue;
+    }
     return MempoolToJSON(EnsureAnyMemPool(request.context), fVerbose, include_mempool_sequence);
 },
     };
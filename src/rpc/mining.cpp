@@ -61,13 +61,11 @@ using wallet::GetWalletForJSONRPCRequest;
  * or from the last difficulty change if 'lookup' is nonpositive.
  * If 'height' is nonnegative, compute the estimate at the time when a given block was found.
  */
-static UniValue GetNetworkHashPS(int lookup, int height, const CChain& active_chain) {
-    const CBlockIndex* pb = active_chain.Tip();
-
-    if (height >= 0 && height < active_chain.Height()) {
-        pb = active_chain[height];
-    }
-
+/**
+ * Only walks pprev links of pb, whose fields never change once the block is
+ * in the block index, so this does not need cs_main.
+ */
+static UniValue GetNetworkHashPS(int lookup, const CBlockIndex* pb) {
     if (pb == nullptr || !pb->nHeight)
         return 0;
 
@@ -120,11 +118,25 @@ static RPCHelpMan getnetworkhashps()
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
     LOCK(cs_main);
-    return GetNetworkHashPS(!request.params[0].isNull() ? request.params[0].getInt<int>() : 120, !request.params[1].isNull() ? request.params[1].getInt<int>() : -1, chainman.ActiveChain());
+    const CChain& active_chain = chainman.ActiveChain();
+    const int height{!request.params[1].isNull() ? request.params[1].getInt<int>() : -1};
+    const CBlockIndex* pb = active_chain.Tip();
+    if (height >= 0 && height < active_chain.Height()) {
+        pb = active_chain[height];
+    }
+    return GetNetworkHashPS(!request.params[0].isNull() ? request.params[0].getInt<int>() : 120, pb);
 },
     };
 }
 
+// peercoin: network Gh/s estimate from the moving average of proof-of-work
+// block spacing, which is maintained along with the tip snapshot
+static double GetNetworkGHPS(const ChainTipSnapshot& snapshot)
+{
+    if (snapshot.pow_target_spacing <= 0) return 0;
+    return GetDifficultyFromBits(snapshot.pow_bits) * 4.294967296 / snapshot.pow_target_spacing;
+}
+
 // peercoin: get network Gh/s estimate
 static RPCHelpMan getnetworkghps()
 {
@@ -141,27 +153,7 @@ static RPCHelpMan getnetworkghps()
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
-
-    int64_t nTargetSpacingWorkMin = 30;
-    int64_t nTargetSpacingWork = nTargetSpacingWorkMin;
-    int64_t nInterval = 72;
-    CBlockIndex* pindex = chainman.ActiveChain().Genesis();
-    CBlockIndex* pindexPrevWork = chainman.ActiveChain().Genesis();
-    while (pindex)
-    {
-        // Exponential moving average of recent proof-of-work block spacing
-        if (pindex->IsProofOfWork())
-        {
-            int64_t nActualSpacingWork = pindex->GetBlockTime() - pindexPrevWork->GetBlockTime();
-            nTargetSpacingWork = ((nInterval - 1) * nTargetSpacingWork + nActualSpacingWork + nActualSpacingWork) / (nInterval + 1);
-            nTargetSpacingWork = std::max(nTargetSpacingWork, nTargetSpacingWorkMin);
-            pindexPrevWork = pindex;
-        }
-        pindex = chainman.ActiveChain().Next(pindex);
-    }
-    double dNetworkGhps = GetDifficulty(pindex, chainman.ActiveChain().Tip()) * 4.294967296 / nTargetSpacingWork;
-    return dNetworkGhps;
+    return GetNetworkGHPS(*CHECK_NONFATAL(chainman.GetTipSnapshot()));
 },
     };
 }
@@ -478,16 +470,15 @@ static RPCHelpMan getmininginfo()
     NodeContext& node = EnsureAnyNodeContext(request.context);
     const CTxMemPool& mempool = EnsureMemPool(node);
     ChainstateManager& chainman = EnsureChainman(node);
-    LOCK(cs_main);
-    const CChain& active_chain = chainman.ActiveChain();
+    const auto snapshot{CHECK_NONFATAL(chainman.GetTipSnapshot())};
 
     UniValue obj(UniValue::VOBJ);
-    obj.pushKV("blocks",           active_chain.Height());
-    if (BlockAssembler::m_last_block_weight) obj.pushKV("currentblockweight", *BlockAssembler::m_last_block_weight);
-    if (BlockAssembler::m_last_block_num_txs) obj.pushKV("currentblocktx", *BlockAssembler::m_last_block_num_txs);
-    obj.pushKV("difficulty",       (double)GetDifficulty(active_chain.Tip(), active_chain.Tip()));
-    obj.pushKV("networkhashps",    getnetworkhashps().HandleRequest(request));
-    obj.pushKV("networkghps",      getnetworkghps().HandleRequest(request));
+    obj.pushKV("blocks",           snapshot->height);
+    if (const int64_t weight{BlockAssembler::m_last_block_weight}; weight >= 0) obj.pushKV("currentblockweight", weight);
+    if (const int64_t num_txs{BlockAssembler::m_last_block_num_txs}; num_txs >= 0) obj.pushKV("currentblocktx", num_txs);
+    obj.pushKV("difficulty",       GetDifficultyFromBits(snapshot->bits));
+    obj.pushKV("networkhashps",    GetNetworkHashPS(120, snapshot->tip));
+    obj.pushKV("networkghps",      GetNetworkGHPS(*snapshot));
     obj.pushKV("pooledtx",         (uint64_t)mempool.size());
     obj.pushKV("chain", chainman.GetParams().NetworkIDString());
     obj.pushKV("warnings",         GetWarnings(false).original);
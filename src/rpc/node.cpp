@@ -20,8 +20,11 @@
 #include <scheduler.h>
 #include <univalue.h>
 #include <util/check.h>
+#include <util/perfstats.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/time.h>
+#include <validationinterface.h>
 
 #include <stdint.h>
 #ifdef HAVE_MALLOC_INFO
@@ -417,12 +420,176 @@ static RPCHelpMan getindexinfo()
     };
 }
 
+static RPCHelpMan getvalidationqueueinfo()
+{
+    return RPCHelpMan{"getvalidationqueueinfo",
+                "\nReturns the state of the queues delivering chain and mempool notifications to wallets, indexes and other subscribers.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::ARR, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR, "name", "The name of the subscriber, \"functions\" for functions waiting on all subscribers"},
+                            {RPCResult::Type::BOOL, "registered", "Whether the subscriber is still registered"},
+                            {RPCResult::Type::NUM, "pending", "The number of notifications waiting to be delivered"},
+                            {RPCResult::Type::NUM, "processed", "The number of notifications delivered"},
+                            {RPCResult::Type::NUM, "skipped", "The number of notifications dropped because the subscriber was unregistered"},
+                            {RPCResult::Type::NUM, "oldest_pending_us", "How long the oldest pending notification has been waiting, in microseconds"},
+                            {RPCResult::Type::NUM, "last_lag_us", "How long the last notification waited before delivery, in microseconds"},
+                            {RPCResult::Type::NUM, "max_lag_us", "The longest time a notification waited before delivery, in microseconds"},
+                            {RPCResult::Type::NUM, "max_exec_us", "The longest time the subscriber took to handle a notification, in microseconds"},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getvalidationqueueinfo", "")
+                  + HelpExampleRpc("getvalidationqueueinfo", "")
+                },
+                [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue result(UniValue::VARR);
+    for (const ValidationSubscriberStats& stats : GetMainSignals().GetSubscriberStats()) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", stats.name);
+        entry.pushKV("registered", stats.registered);
+        entry.pushKV("pending", (uint64_t)stats.pending);
+        entry.pushKV("processed", stats.processed);
+        entry.pushKV("skipped", stats.skipped);
+        entry.pushKV("oldest_pending_us", count_microseconds(stats.oldest_pending_age));
+        entry.pushKV("last_lag_us", count_microseconds(stats.last_lag));
+        entry.pushKV("max_lag_us", count_microseconds(stats.max_lag));
+        entry.pushKV("max_exec_us", count_microseconds(stats.max_exec_time));
+        result.push_back(entry);
+    }
+    return result;
+},
+    };
+}
+
+static const RPCResult PERF_HISTOGRAM_DOC{RPCResult::Type::ARR, "histogram", "Non-empty buckets of the duration histogram",
+    {
+        {RPCResult::Type::OBJ, "", "",
+        {
+            {RPCResult::Type::NUM, "below_us", /*optional=*/true, "Upper bound of the bucket in microseconds, absent for the last, unbounded bucket"},
+            {RPCResult::Type::NUM, "count", "Number of durations in the bucket"},
+        }},
+    }};
+
+static UniValue PerfHistogramToJSON(const perf::Histogram::Snapshot& snapshot)
+{
+    UniValue result(UniValue::VARR);
+    for (size_t i = 0; i < perf::Histogram::BUCKETS; ++i) {
+        if (snapshot.buckets[i] == 0) continue;
+        UniValue bucket(UniValue::VOBJ);
+        if (i + 1 < perf::Histogram::BUCKETS) bucket.pushKV("below_us", perf::Histogram::BucketLimit(i));
+        bucket.pushKV("count", snapshot.buckets[i]);
+        result.push_back(bucket);
+    }
+    return result;
+}
+
+static RPCHelpMan getperfstats()
+{
+    return RPCHelpMan{"getperfstats",
+                "\nReturns the timings recorded with -perfstats for proof-of-stake checks, minting, block connection and chainstate flushes,\n"
+                "and how long each call site waited for and held cs_main.\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, RPCArg::Default{false}, "Clear the statistics after returning them"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::BOOL, "enabled", "Whether statistics are being recorded (-perfstats)"},
+                        {RPCResult::Type::ARR, "timers", "",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR, "name", "The name of the timer"},
+                                {RPCResult::Type::STR, "description", "What is being timed"},
+                                {RPCResult::Type::NUM, "count", "The number of timed calls"},
+                                {RPCResult::Type::NUM, "total_us", "The total time, in microseconds"},
+                                {RPCResult::Type::NUM, "mean_us", "The mean time per call, in microseconds"},
+                                {RPCResult::Type::NUM, "max_us", "The longest call, in microseconds"},
+                                {RPCResult::Type::STR, "items_name", /*optional=*/true, "What the items counter counts"},
+                                {RPCResult::Type::NUM, "items", /*optional=*/true, "The number of items processed during the timed calls"},
+                                PERF_HISTOGRAM_DOC,
+                            }},
+                        }},
+                        {RPCResult::Type::ARR, "cs_main", "Call sites that locked cs_main, longest total hold time first",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR, "site", "The source file and line of the lock"},
+                                {RPCResult::Type::NUM, "count", "The number of times the lock was taken"},
+                                {RPCResult::Type::NUM, "contended", "The number of times acquiring the lock took a microsecond or more"},
+                                {RPCResult::Type::NUM, "wait_total_us", "The total time spent waiting for the lock, in microseconds"},
+                                {RPCResult::Type::NUM, "wait_max_us", "The longest wait, in microseconds"},
+                                {RPCResult::Type::NUM, "hold_total_us", "The total time the lock was held, in microseconds"},
+                                {RPCResult::Type::NUM, "hold_max_us", "The longest time the lock was held, in microseconds"},
+                                PERF_HISTOGRAM_DOC,
+                            }},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getperfstats", "")
+                  + HelpExampleCli("getperfstats", "true")
+                  + HelpExampleRpc("getperfstats", "")
+                },
+                [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue timers(UniValue::VARR);
+    for (const perf::TimerStats& stats : perf::GetTimerStats()) {
+        const auto& hist{stats.histogram};
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", stats.name);
+        entry.pushKV("description", stats.description);
+        entry.pushKV("count", hist.count);
+        entry.pushKV("total_us", Ticks<std::chrono::microseconds>(hist.total));
+        entry.pushKV("mean_us", hist.count ? Ticks<std::chrono::microseconds>(hist.total) / int64_t(hist.count) : 0);
+        entry.pushKV("max_us", Ticks<std::chrono::microseconds>(hist.max));
+        if (!stats.items_name.empty()) {
+            entry.pushKV("items_name", stats.items_name);
+            entry.pushKV("items", stats.items);
+        }
+        entry.pushKV("histogram", PerfHistogramToJSON(hist));
+        timers.push_back(entry);
+    }
+
+    UniValue sites(UniValue::VARR);
+    for (const perf::LockSiteStats& stats : perf::GetLockSiteStats()) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("site", stats.site);
+        entry.pushKV("count", stats.hold.count);
+        entry.pushKV("contended", stats.wait.count - stats.wait.buckets[0]);
+        entry.pushKV("wait_total_us", Ticks<std::chrono::microseconds>(stats.wait.total));
+        entry.pushKV("wait_max_us", Ticks<std::chrono::microseconds>(stats.wait.max));
+        entry.pushKV("hold_total_us", Ticks<std::chrono::microseconds>(stats.hold.total));
+        entry.pushKV("hold_max_us", Ticks<std::chrono::microseconds>(stats.hold.max));
+        entry.pushKV("histogram", PerfHistogramToJSON(stats.hold));
+        sites.push_back(entry);
+    }
+
+    if (!request.params[0].isNull() && request.params[0].get_bool()) perf::Reset();
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("enabled", perf::Enabled());
+    result.pushKV("timers", timers);
+    result.pushKV("cs_main", sites);
+    return result;
+},
+    };
+}
+
 void RegisterNodeRPCCommands(CRPCTable& t)
 {
     static const CRPCCommand commands[]{
         {"control", &getmemoryinfo},
         {"control", &logging},
         {"util", &getindexinfo},
+        {"control", &getvalidationqueueinfo},
+        {"control", &getperfstats},
         {"hidden", &setmocktime},
         {"hidden", &mockscheduler},
         {"hidden", &echo},
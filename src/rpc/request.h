@@ -11,6 +11,8 @@
 
 #include <univalue.h>
 
+class JSONStreamWriter;
+
 UniValue JSONRPCRequestObj(const std::string& strMethod, const UniValue& params, const UniValue& id);
 UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const UniValue& id);
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
@@ -36,6 +38,12 @@ public:
     std::string authUser;
     std::string peerAddr;
     std::any context;
+    /**
+     * If set, methods with large results may write their result to this
+     * writer instead of returning it, in which case they return null. Left
+     * unset where the caller needs the result as a value, e.g. in batches.
+     */
+    JSONStreamWriter* result_writer{nullptr};
 
     void parse(const UniValue& valRequest);
 };
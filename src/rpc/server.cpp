@@ -10,15 +10,22 @@
 #include <sync.h>
 #include <util/strencodings.h>
 #include <util/string.h>
+#include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <util/time.h>
 
 #include <boost/signals2/signal.hpp>
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
 #include <unordered_map>
 
 static GlobalMutex g_rpc_warmup_mutex;
@@ -32,6 +39,134 @@ static GlobalMutex g_deadline_timers_mutex;
 static std::map<std::string, std::unique_ptr<RPCTimerBase> > deadlineTimers GUARDED_BY(g_deadline_timers_mutex);
 static bool ExecuteCommand(const CRPCCommand& command, const JSONRPCRequest& request, UniValue& result, bool last_handler);
 
+/**
+ * Methods that only read node state and take whatever locks they need
+ * themselves. Consecutive calls to these inside one JSON-RPC batch are
+ * independent of each other and may be executed concurrently. Any other
+ * method acts as an ordering barrier within the batch.
+ */
+static const std::set<std::string> PARALLEL_SAFE_RPC_METHODS{
+    "decoderawtransaction",
+    "decodescript",
+    "getbestblockhash",
+    "getblock",
+    "getblockcount",
+    "getblockfilter",
+    "getblockhash",
+    "getblockheader",
+    "getblockstats",
+    "getdifficulty",
+    "getmempoolancestors",
+    "getmempooldescendants",
+    "getmempoolentry",
+    "getmempoolinfo",
+    "getrawmempool",
+    "getrawtransaction",
+    "gettxout",
+    "gettxoutproof",
+    "validateaddress",
+    "verifytxoutproof",
+};
+
+/**
+ * Methods that may run for minutes. The HTTP server serves them from a
+ * separate work queue so that they cannot occupy all regular RPC workers.
+ */
+static const std::set<std::string> LONG_RUNNING_RPC_METHODS{
+    "dumptxoutset",
+    "dumpwallet",
+    "gettxoutsetinfo",
+    "importaddress",
+    "importdescriptors",
+    "importmulti",
+    "importprivkey",
+    "importpubkey",
+    "importwallet",
+    "loadtxoutset",
+    "pruneblockchain",
+    "rescanblockchain",
+    "scanblocks",
+    "scantxoutset",
+    "verifychain",
+    "waitforblock",
+    "waitforblockheight",
+    "waitfornewblock",
+};
+
+bool IsLongRunningRPCMethod(const std::string& method)
+{
+    return LONG_RUNNING_RPC_METHODS.count(method);
+}
+
+/**
+ * Small dedicated thread pool that JSON-RPC batches fan out onto. Tasks
+ * are only ever helpers: the submitting thread always drains its own batch
+ * as well, so dropped or late tasks never stall a request.
+ */
+class RPCBatchExecutor
+{
+private:
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<std::function<void()>> m_queue GUARDED_BY(m_mutex);
+    bool m_running GUARDED_BY(m_mutex){true};
+    std::vector<std::thread> m_threads;
+
+    void Run() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return !m_running || !m_queue.empty(); });
+                if (!m_running) break;
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit RPCBatchExecutor(int num_threads)
+    {
+        for (int i = 0; i < num_threads; ++i) {
+            m_threads.emplace_back([this, i] {
+                util::ThreadRename(strprintf("rpcbatch.%i", i));
+                SetSyscallSandboxPolicy(SyscallSandboxPolicy::NET_HTTP_SERVER_WORKER);
+                Run();
+            });
+        }
+    }
+
+    ~RPCBatchExecutor()
+    {
+        Interrupt();
+        for (auto& thread : m_threads) thread.join();
+    }
+
+    /** Stop accepting tasks and drop the ones that have not started yet. */
+    void Interrupt() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_running = false;
+        m_queue.clear();
+        m_cond.notify_all();
+    }
+
+    void Submit(std::function<void()> task) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (!m_running) return;
+        m_queue.push_back(std::move(task));
+        m_cond.notify_one();
+    }
+};
+
+static GlobalMutex g_rpc_batch_mutex;
+static std::shared_ptr<RPCBatchExecutor> g_rpc_batch_executor GUARDED_BY(g_rpc_batch_mutex);
+static int g_rpc_batch_concurrency GUARDED_BY(g_rpc_batch_mutex){DEFAULT_RPC_BATCH_CONCURRENCY};
+
 struct RPCCommandExecutionInfo
 {
     std::string method;
@@ -205,6 +340,15 @@ static RPCHelpMan uptime()
     };
 }
 
+static GlobalMutex g_rpc_work_queue_info_mutex;
+static RPCWorkQueueInfoFn g_rpc_work_queue_info GUARDED_BY(g_rpc_work_queue_info_mutex);
+
+void RPCSetWorkQueueInfo(RPCWorkQueueInfoFn fn)
+{
+    LOCK(g_rpc_work_queue_info_mutex);
+    g_rpc_work_queue_info = std::move(fn);
+}
+
 static RPCHelpMan getrpcinfo()
 {
     return RPCHelpMan{"getrpcinfo",
@@ -222,6 +366,23 @@ static RPCHelpMan getrpcinfo()
                             }},
                         }},
                         {RPCResult::Type::STR, "logpath", "The complete file path to the debug log"},
+                        {RPCResult::Type::ARR, "work_queues", "HTTP work queues, one per class of request",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR, "name", "The class of requests served (rpc_chain, rpc_wallet, rest, long_running)"},
+                                {RPCResult::Type::NUM, "threads", "Number of worker threads"},
+                                {RPCResult::Type::NUM, "queued", "Requests waiting for a worker"},
+                                {RPCResult::Type::NUM, "max_queued", "Queue depth at which further requests are rejected with HTTP 503"},
+                                {RPCResult::Type::NUM, "active", "Requests being executed"},
+                                {RPCResult::Type::NUM, "processed", "Requests executed since startup"},
+                                {RPCResult::Type::NUM, "rejected", "Requests rejected because the queue was full"},
+                                {RPCResult::Type::NUM, "avg_wait_us", "Average time requests spent queued, in microseconds"},
+                                {RPCResult::Type::NUM, "max_wait_us", "Longest time a request spent queued, in microseconds"},
+                                {RPCResult::Type::NUM, "avg_exec_us", "Average execution time, in microseconds"},
+                                {RPCResult::Type::NUM, "max_exec_us", "Longest execution time, in microseconds"},
+                            }},
+                        }},
                     }
                 },
                 RPCExamples{
@@ -245,6 +406,12 @@ static RPCHelpMan getrpcinfo()
     UniValue log_path(UniValue::VSTR, path);
     result.pushKV("logpath", log_path);
 
+    UniValue work_queues(UniValue::VARR);
+    if (const auto work_queue_info{WITH_LOCK(g_rpc_work_queue_info_mutex, return g_rpc_work_queue_info)}) {
+        work_queues = work_queue_info();
+    }
+    result.pushKV("work_queues", work_queues);
+
     return result;
 }
     };
@@ -272,6 +439,13 @@ void CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
     mapCommands[name].push_back(pcmd);
 }
 
+std::string CRPCTable::commandCategory(const std::string& name) const
+{
+    const auto it = mapCommands.find(name);
+    if (it == mapCommands.end() || it->second.empty()) return "";
+    return it->second.front()->category;
+}
+
 bool CRPCTable::removeCommand(const std::string& name, const CRPCCommand* pcmd)
 {
     auto it = mapCommands.find(name);
@@ -288,6 +462,14 @@ bool CRPCTable::removeCommand(const std::string& name, const CRPCCommand* pcmd)
 void StartRPC()
 {
     LogPrint(BCLog::RPC, "Starting RPC\n");
+    const int batch_threads{std::max(int(gArgs.GetIntArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS)), 0)};
+    const int batch_concurrency{std::max(int(gArgs.GetIntArg("-rpcbatchconcurrency", DEFAULT_RPC_BATCH_CONCURRENCY)), 1)};
+    if (batch_threads > 0 && batch_concurrency > 1) {
+        LogPrint(BCLog::RPC, "Starting %d RPC batch threads (per-batch concurrency %d)\n", batch_threads, batch_concurrency);
+        LOCK(g_rpc_batch_mutex);
+        g_rpc_batch_executor = std::make_shared<RPCBatchExecutor>(batch_threads);
+        g_rpc_batch_concurrency = batch_concurrency;
+    }
     g_rpc_running = true;
     g_rpcSignals.Started();
 }
@@ -300,6 +482,8 @@ void InterruptRPC()
         LogPrint(BCLog::RPC, "Interrupting RPC\n");
         // Interrupt e.g. running longpolls
         g_rpc_running = false;
+        LOCK(g_rpc_batch_mutex);
+        if (g_rpc_batch_executor) g_rpc_batch_executor->Interrupt();
     });
 }
 
@@ -311,6 +495,8 @@ void StopRPC()
     std::call_once(g_rpc_stop_flag, []() {
         LogPrint(BCLog::RPC, "Stopping RPC\n");
         WITH_LOCK(g_deadline_timers_mutex, deadlineTimers.clear());
+        // Batches still running on HTTP workers keep their own reference.
+        WITH_LOCK(g_rpc_batch_mutex, g_rpc_batch_executor.reset());
         DeleteAuthCookie();
         g_rpcSignals.Stopped();
     });
@@ -377,11 +563,86 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
+static bool IsParallelSafeRequest(const UniValue& req)
+{
+    if (!req.isObject()) return false;
+    const UniValue& method = find_value(req, "method");
+    return method.isStr() && PARALLEL_SAFE_RPC_METHODS.count(method.get_str());
+}
+
+/**
+ * State shared between the thread serving a batch and the executor threads
+ * helping it. Workers claim request indices until none are left, so every
+ * request is executed exactly once, by whichever thread gets to it first.
+ */
+struct RPCBatchRun
+{
+    const JSONRPCRequest jreq;
+    const UniValue& requests;
+    const size_t begin;
+    const size_t end;
+    std::vector<UniValue> results;
+    std::atomic<size_t> next;
+
+    Mutex mutex;
+    std::condition_variable cond;
+    size_t done GUARDED_BY(mutex){0};
+
+    RPCBatchRun(const JSONRPCRequest& jreq_in, const UniValue& requests_in, size_t begin_in, size_t end_in)
+        : jreq(jreq_in), requests(requests_in), begin(begin_in), end(end_in), results(end_in - begin_in), next(begin_in) {}
+
+    /** Execute unclaimed requests. Must not touch `requests` once all are claimed, as it is owned by the caller. */
+    void Work() EXCLUSIVE_LOCKS_REQUIRED(!mutex)
+    {
+        for (size_t i = next++; i < end; i = next++) {
+            results[i - begin] = JSONRPCExecOne(jreq, requests[i]);
+            LOCK(mutex);
+            if (++done == end - begin) cond.notify_all();
+        }
+    }
+
+    void Wait() EXCLUSIVE_LOCKS_REQUIRED(!mutex)
+    {
+        WAIT_LOCK(mutex, lock);
+        cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(mutex) { return done == end - begin; });
+    }
+};
+
 std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
 {
+    std::shared_ptr<RPCBatchExecutor> executor;
+    int concurrency;
+    {
+        LOCK(g_rpc_batch_mutex);
+        executor = g_rpc_batch_executor;
+        concurrency = g_rpc_batch_concurrency;
+    }
+
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    size_t reqIdx = 0;
+    while (reqIdx < vReq.size()) {
+        // Find the run of independent read-only requests starting here.
+        size_t run_end = reqIdx;
+        while (run_end < vReq.size() && IsParallelSafeRequest(vReq[run_end])) ++run_end;
+
+        if (!executor || run_end - reqIdx < 2) {
+            ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+            ++reqIdx;
+            continue;
+        }
+
+        auto run = std::make_shared<RPCBatchRun>(jreq, vReq, reqIdx, run_end);
+        const size_t helpers{std::min<size_t>(concurrency - 1, run_end - reqIdx - 1)};
+        for (size_t i = 0; i < helpers; ++i) {
+            executor->Submit([run] { run->Work(); });
+        }
+        run->Work();
+        run->Wait();
+        for (UniValue& result : run->results) {
+            ret.push_back(std::move(result));
+        }
+        reqIdx = run_end;
+    }
 
     return ret.write() + "\n";
 }
@@ -17,6 +17,10 @@
 #include <univalue.h>
 
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
+/** Number of threads JSON-RPC batches may fan out onto (0 = execute batches serially) */
+static const int DEFAULT_RPC_BATCH_THREADS = 4;
+/** Maximum number of requests of a single batch that are executed concurrently */
+static const int DEFAULT_RPC_BATCH_CONCURRENCY = 4;
 
 class CRPCCommand;
 
@@ -163,10 +167,25 @@ public:
      */
     void appendCommand(const std::string& name, const CRPCCommand* pcmd);
     bool removeCommand(const std::string& name, const CRPCCommand* pcmd);
+
+    /**
+     * Return the category of a registered command, or an empty string if
+     * there is none. Commands are only added before the RPC server starts, so
+     * this may be called from the HTTP event thread.
+     */
+    std::string commandCategory(const std::string& name) const;
 };
 
 bool IsDeprecatedRPCEnabled(const std::string& method);
 
+/** Provides the "work_queues" array of getrpcinfo */
+using RPCWorkQueueInfoFn = std::function<UniValue()>;
+/** Set (or clear, with an empty function) the getrpcinfo work queue provider */
+void RPCSetWorkQueueInfo(RPCWorkQueueInfoFn fn);
+
+/** Whether method may run for minutes (scans, imports, waits) */
+bool IsLongRunningRPCMethod(const std::string& method);
+
 extern CRPCTable tableRPC;
 
 void StartRPC();
@@ -6,6 +6,7 @@
 #include <consensus/amount.h>
 #include <key_io.h>
 #include <outputtype.h>
+#include <rpc/jsonstream.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
 #include <script/signingprovider.h>
@@ -568,7 +569,9 @@ UniValue RPCHelpMan::HandleRequest(const JSONRPCRequest& request) const
         throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Wrong type passed:\n%s", arg_mismatch.write(4)));
     }
     UniValue ret = m_fun(*this, request);
-    if (gArgs.GetBoolArg("-rpcdoccheck", DEFAULT_RPC_DOC_CHECK)) {
+    // A result streamed to the caller is not available for checking.
+    const bool streamed{request.result_writer && request.result_writer->HasOutput()};
+    if (!streamed && gArgs.GetBoolArg("-rpcdoccheck", DEFAULT_RPC_DOC_CHECK)) {
         UniValue mismatch{UniValue::VARR};
         for (const auto& res : m_results.m_results) {
             UniValue match{res.MatchesType(ret)};
@@ -28,28 +28,36 @@ class CSignatureCache
 {
 private:
      //! Entries are SHA256(nonce || 'E' or 'S' || 31 zero bytes || signature hash || public key || signature):
+    uint256 m_nonce;
     CSHA256 m_salted_hasher_ecdsa;
     CSHA256 m_salted_hasher_schnorr;
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
     map_type setValid;
     std::shared_mutex cs_sigcache;
 
-public:
-    CSignatureCache()
+    void SetNonce(const uint256& nonce)
     {
-        uint256 nonce = GetRandHash();
         // We want the nonce to be 64 bytes long to force the hasher to process
         // this chunk, which makes later hash computations more efficient. We
         // just write our 32-byte entropy, and then pad with 'E' for ECDSA and
         // 'S' for Schnorr (followed by 0 bytes).
         static constexpr unsigned char PADDING_ECDSA[32] = {'E'};
         static constexpr unsigned char PADDING_SCHNORR[32] = {'S'};
+        m_nonce = nonce;
+        m_salted_hasher_ecdsa = CSHA256{};
         m_salted_hasher_ecdsa.Write(nonce.begin(), 32);
         m_salted_hasher_ecdsa.Write(PADDING_ECDSA, 32);
+        m_salted_hasher_schnorr = CSHA256{};
         m_salted_hasher_schnorr.Write(nonce.begin(), 32);
         m_salted_hasher_schnorr.Write(PADDING_SCHNORR, 32);
     }
 
+public:
+    CSignatureCache()
+    {
+        SetNonce(GetRandHash());
+    }
+
     void
     ComputeEntryECDSA(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey) const
     {
@@ -80,6 +88,22 @@ public:
     {
         return setValid.setup_bytes(n);
     }
+
+    std::vector<uint256> Dump(uint256& nonce)
+    {
+        std::shared_lock<std::shared_mutex> lock(cs_sigcache);
+        nonce = m_nonce;
+        return setValid.elements();
+    }
+
+    void Load(const uint256& nonce, const std::vector<uint256>& entries)
+    {
+        std::unique_lock<std::shared_mutex> lock(cs_sigcache);
+        SetNonce(nonce);
+        for (const uint256& entry : entries) {
+            setValid.insert(entry);
+        }
+    }
 };
 
 /* In previous versions of this code, signatureCache was a local static variable
@@ -104,6 +128,16 @@ bool InitSignatureCache(size_t max_size_bytes)
     return true;
 }
 
+std::vector<uint256> DumpSignatureCache(uint256& nonce)
+{
+    return signatureCache.Dump(nonce);
+}
+
+void LoadSignatureCache(const uint256& nonce, const std::vector<uint256>& entries)
+{
+    signatureCache.Load(nonce, entries);
+}
+
 bool CachingTransactionSignatureChecker::VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -122,6 +156,12 @@ bool CachingTransactionSignatureChecker::VerifySchnorrSignature(Span<const unsig
     uint256 entry;
     signatureCache.ComputeEntrySchnorr(entry, sighash, sig, pubkey);
     if (signatureCache.Get(entry, !store)) return true;
+    if (m_batch && !store) {
+        // A failing Schnorr signature always fails the script (BIP340/342), so
+        // deferring it to the batch cannot change which scripts are valid.
+        m_batch->Add(sig, pubkey, sighash);
+        return true;
+    }
     if (!TransactionSignatureChecker::VerifySchnorrSignature(sig, pubkey, sighash)) return false;
     if (store) signatureCache.Set(entry);
     return true;
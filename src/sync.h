@@ -13,7 +13,9 @@
 
 #include <threadsafety.h> // IWYU pragma: export
 #include <util/macros.h>
+#include <util/perfstats.h>
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <string>
@@ -154,9 +156,38 @@ class SCOPED_LOCKABLE UniqueLock : public MutexType::unique_lock
 private:
     using Base = typename MutexType::unique_lock;
 
+    /** Call site holding the mutex profiled by -perfstats through this lock, if any. */
+    const char* m_profile_file{nullptr};
+    int m_profile_line{0};
+    std::chrono::nanoseconds m_profile_wait{0};
+    std::chrono::steady_clock::time_point m_profile_locked;
+
+    void ProfiledLock(const char* pszFile, int nLine)
+    {
+        const auto start{std::chrono::steady_clock::now()};
+        Base::lock();
+        m_profile_locked = std::chrono::steady_clock::now();
+        m_profile_wait = m_profile_locked - start;
+        m_profile_file = pszFile;
+        m_profile_line = nLine;
+    }
+
+    /** Unlock, then record the wait and hold times of a profiled lock. */
+    void ProfiledUnlock()
+    {
+        const std::chrono::nanoseconds hold{std::chrono::steady_clock::now() - m_profile_locked};
+        Base::unlock();
+        perf::RecordLock(m_profile_file, m_profile_line, m_profile_wait, hold);
+        m_profile_file = nullptr;
+    }
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, Base::mutex());
+        if (perf::IsProfiledMutex(Base::mutex())) {
+            ProfiledLock(pszFile, nLine);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (Base::try_lock()) return;
         LOG_TIME_MICROS_WITH_CATEGORY(strprintf("lock contention %s, %s:%d", pszName, pszFile, nLine), BCLog::LOCK);
@@ -168,6 +199,11 @@ private:
     {
         EnterCritical(pszName, pszFile, nLine, Base::mutex(), true);
         if (Base::try_lock()) {
+            if (perf::IsProfiledMutex(Base::mutex())) {
+                m_profile_locked = std::chrono::steady_clock::now();
+                m_profile_file = pszFile;
+                m_profile_line = nLine;
+            }
             return true;
         }
         LeaveCritical();
@@ -196,8 +232,10 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
             LeaveCritical();
+            if (m_profile_file) ProfiledUnlock();
+        }
     }
 
     operator bool()
@@ -217,7 +255,13 @@ public:
     public:
         explicit reverse_lock(UniqueLock& _lock, const char* _guardname, const char* _file, int _line) : lock(_lock), file(_file), line(_line) {
             CheckLastCritical((void*)lock.mutex(), lockname, _guardname, _file, _line);
-            lock.unlock();
+            profile_file = lock.m_profile_file;
+            profile_line = lock.m_profile_line;
+            if (profile_file) {
+                lock.ProfiledUnlock();
+            } else {
+                lock.unlock();
+            }
             LeaveCritical();
             lock.swap(templock);
         }
@@ -225,7 +269,11 @@ public:
         ~reverse_lock() {
             templock.swap(lock);
             EnterCritical(lockname.c_str(), file.c_str(), line, lock.mutex());
-            lock.lock();
+            if (profile_file) {
+                lock.ProfiledLock(profile_file, profile_line);
+            } else {
+                lock.lock();
+            }
         }
 
      private:
@@ -237,6 +285,8 @@ public:
         std::string lockname;
         const std::string file;
         const int line;
+        const char* profile_file{nullptr};
+        int profile_line{0};
      };
      friend class reverse_lock;
 };
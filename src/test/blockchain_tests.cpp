@@ -5,11 +5,15 @@
 #include <boost/test/unit_test.hpp>
 
 #include <chain.h>
+#include <consensus/validation.h>
 #include <rpc/blockchain.h>
 #include <test/util/setup_common.h>
 #include <util/string.h>
+#include <validation.h>
 
 #include <cstdlib>
+#include <map>
+#include <tuple>
 
 /* Equality between doubles is imprecise. Comparison should be done
  * with a small threshold of tolerance, rather than exact equality.
@@ -74,4 +78,71 @@ BOOST_AUTO_TEST_CASE(get_difficulty_for_very_high_target)
     TestDifficulty(0x12345678, 5913134931067755359633408.0);
 }
 
+BOOST_AUTO_TEST_CASE(get_difficulty_from_bits)
+{
+    RejectDifficultyMismatch(GetDifficultyFromBits(0x1cf88f6f), 1.029916);
+    RejectDifficultyMismatch(GetDifficultyFromBits(0x1f111111), 0.000001);
+}
+
+BOOST_FIXTURE_TEST_CASE(tip_snapshot_matches_chain, TestingSetup)
+{
+    ChainstateManager& chainman{*Assert(m_node.chainman)};
+    const auto snapshot{chainman.GetTipSnapshot()};
+    BOOST_REQUIRE(snapshot);
+
+    LOCK(cs_main);
+    const CBlockIndex* tip{chainman.ActiveTip()};
+    BOOST_CHECK_EQUAL(snapshot->tip, tip);
+    BOOST_CHECK_EQUAL(snapshot->height, tip->nHeight);
+    BOOST_CHECK_EQUAL(snapshot->hash, tip->GetBlockHash());
+    BOOST_CHECK_EQUAL(snapshot->median_time, tip->GetMedianTimePast());
+    BOOST_CHECK(snapshot->chain_trust == tip->nChainTrust);
+    BOOST_CHECK_EQUAL(snapshot->pow_bits, GetLastBlockIndex(tip, false)->nBits);
+    BOOST_CHECK_EQUAL(snapshot->pos_bits, GetLastBlockIndex(tip, true)->nBits);
+    BOOST_CHECK_EQUAL(snapshot->money_supply, tip->nMoneySupply);
+    BOOST_CHECK_EQUAL(snapshot->header_height, chainman.m_best_header->nHeight);
+
+    // Republishing without a change keeps the same instance
+    chainman.UpdateTipSnapshot();
+    BOOST_CHECK_EQUAL(chainman.GetTipSnapshot(), snapshot);
+}
+
+BOOST_FIXTURE_TEST_CASE(tip_snapshot_after_reorg, TestChain100Setup)
+{
+    ChainstateManager& chainman{*Assert(m_node.chainman)};
+    Chainstate& chainstate{chainman.ActiveChainstate()};
+    const auto fields = [](const ChainTipSnapshot& snapshot) {
+        return std::make_tuple(snapshot.height, snapshot.pow_bits, snapshot.pos_bits, snapshot.pow_target_spacing, snapshot.last_pow_time);
+    };
+
+    // Snapshots published while the chain grew one block at a time
+    std::map<int, decltype(fields(ChainTipSnapshot{}))> grown;
+    grown.emplace(chainman.GetTipSnapshot()->height, fields(*chainman.GetTipSnapshot()));
+    for (int i = 0; i < 15; ++i) {
+        CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+        grown.emplace(chainman.GetTipSnapshot()->height, fields(*chainman.GetTipSnapshot()));
+    }
+    const int top{chainman.GetTipSnapshot()->height};
+    BOOST_REQUIRE_GT(top, 110);
+
+    // Rewinding resumes from a checkpoint and must land on the same values,
+    // both above and below the checkpoint at height 100
+    for (const int fork : {top - 3, 101, 98}) {
+        CBlockIndex* disconnected{WITH_LOCK(cs_main, return chainman.ActiveChain()[fork])};
+        BlockValidationState state;
+        BOOST_REQUIRE(chainstate.InvalidateBlock(state, disconnected));
+        const auto snapshot{chainman.GetTipSnapshot()};
+        BOOST_CHECK_EQUAL(snapshot->height, fork - 1);
+        if (grown.count(fork - 1)) BOOST_CHECK(fields(*snapshot) == grown.at(fork - 1));
+        {
+            LOCK(cs_main);
+            BOOST_CHECK_EQUAL(snapshot->pow_bits, GetLastBlockIndex(snapshot->tip, false)->nBits);
+            BOOST_CHECK_EQUAL(snapshot->pos_bits, GetLastBlockIndex(snapshot->tip, true)->nBits);
+            chainstate.ResetBlockFailureFlags(disconnected);
+        }
+        BOOST_REQUIRE(chainstate.ActivateBestChain(state));
+        BOOST_CHECK(fields(*chainman.GetTipSnapshot()) == grown.at(top));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
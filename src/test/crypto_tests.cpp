@@ -853,6 +853,29 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256_multi)
+{
+    for (int count = 0; count <= 40; ++count) {
+        // Lengths around the padding boundaries, and longer ones
+        std::vector<std::vector<unsigned char>> msgs;
+        std::vector<Span<const unsigned char>> spans;
+        for (int j = 0; j < count; ++j) {
+            const int len = InsecureRandBool() ? 48 + InsecureRandRange(24) : InsecureRandRange(600);
+            msgs.push_back(g_insecure_rand_ctx.randbytes(len));
+        }
+        for (const auto& msg : msgs) spans.emplace_back(msg);
+        std::vector<unsigned char> single(32 * count), singled(32 * count), multi(32 * count), multid(32 * count);
+        for (int j = 0; j < count; ++j) {
+            CSHA256().Write(msgs[j].data(), msgs[j].size()).Finalize(single.data() + 32 * j);
+            CHash256().Write(msgs[j]).Finalize({singled.data() + 32 * j, 32});
+        }
+        SHA256Multi(multi.data(), spans.data(), count);
+        SHA256DMulti(multid.data(), spans.data(), count);
+        BOOST_CHECK(single == multi);
+        BOOST_CHECK(singled == multid);
+    }
+}
+
 static void TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
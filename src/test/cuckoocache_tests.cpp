@@ -10,6 +10,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
 #include <deque>
 #include <mutex>
 #include <shared_mutex>
@@ -49,6 +50,28 @@ BOOST_AUTO_TEST_CASE(test_cuckoocache_no_fakes)
     }
 };
 
+/* Test that elements() copies out what was inserted and not erased since */
+BOOST_AUTO_TEST_CASE(cuckoocache_elements)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    cc.setup(1000);
+    std::vector<uint256> inserted;
+    for (int x = 0; x < 100; ++x) {
+        inserted.push_back(InsecureRand256());
+        cc.insert(inserted.back());
+    }
+    BOOST_CHECK(cc.contains(inserted[0], /*erase=*/true));
+
+    std::vector<uint256> elements{cc.elements()};
+    std::sort(elements.begin(), elements.end());
+    BOOST_CHECK_EQUAL(elements.size(), inserted.size() - 1);
+    BOOST_CHECK(!std::binary_search(elements.begin(), elements.end(), inserted[0]));
+    for (size_t i = 1; i < inserted.size(); ++i) {
+        BOOST_CHECK(std::binary_search(elements.begin(), elements.end(), inserted[i]));
+    }
+}
+
 /** This helper returns the hit rate when megabytes*load worth of entries are
  * inserted into a megabytes sized cache
  */
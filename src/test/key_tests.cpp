@@ -13,7 +13,9 @@
 #include <util/string.h>
 #include <util/system.h>
 
+#include <array>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -293,12 +295,27 @@ BOOST_AUTO_TEST_CASE(bip340_test_vectors)
         {{"FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC30", "243F6A8885A308D313198A2E03707344A4093822299F31D0082EFA98EC4E6C89", "6CFF5C3BA86C69EA4B7376F31A9BCB4F74C1976089B2D9963DA2E5543E17776969E89B4C5564D00349106B8497785DD7D1D713A8AE82B32FA79D5F7FC407D39B"}, false}
     };
 
+    SchnorrSigBatch valid_batch;
     for (const auto& test : VECTORS) {
         auto pubkey = ParseHex(test.first[0]);
         auto msg = ParseHex(test.first[1]);
         auto sig = ParseHex(test.first[2]);
         BOOST_CHECK_EQUAL(XOnlyPubKey(pubkey).VerifySchnorr(uint256(msg), sig), test.second);
+
+        // Batch verification agrees, on its own and among valid signatures.
+        SchnorrSigBatch batch;
+        batch.Add(sig, XOnlyPubKey(pubkey), uint256(msg));
+        BOOST_CHECK_EQUAL(batch.Verify(), test.second);
+        if (test.second) {
+            valid_batch.Add(sig, XOnlyPubKey(pubkey), uint256(msg));
+        } else {
+            SchnorrSigBatch mixed_batch{valid_batch};
+            mixed_batch.Add(sig, XOnlyPubKey(pubkey), uint256(msg));
+            BOOST_CHECK(!mixed_batch.Verify());
+        }
     }
+    BOOST_CHECK_EQUAL(valid_batch.size(), 5U);
+    BOOST_CHECK(valid_batch.Verify());
 
     static const std::vector<std::array<std::string, 5>> SIGN_VECTORS = {
         {{"0000000000000000000000000000000000000000000000000000000000000003", "F9308A019258C31049344F85F89D5229B531C845836F99B08601F113BCE036F9", "0000000000000000000000000000000000000000000000000000000000000000", "0000000000000000000000000000000000000000000000000000000000000000", "E907831F80848D1069A5371B402410364BDF1C5F8307B0084C55F1CE2DCA821525F66A4A85EA8B71E482A74F382D2CE5EBEEE8FDB2172F477DF4900D310536C0"}},
@@ -343,4 +360,45 @@ BOOST_AUTO_TEST_CASE(bip340_test_vectors)
     }
 }
 
+BOOST_AUTO_TEST_CASE(schnorr_sig_batch)
+{
+    SchnorrSigBatch batch;
+    BOOST_CHECK(batch.Verify());
+
+    // Signatures of distinct keys are checked one by one, and those of a few
+    // keys in one batch equation.
+    for (const size_t num_keys : {200, 4}) {
+        std::vector<CKey> keys(num_keys);
+        for (CKey& key : keys) key.MakeNewKey(true);
+
+        std::vector<std::tuple<std::array<unsigned char, 64>, XOnlyPubKey, uint256>> sigs(200);
+        batch.Clear();
+        for (size_t i = 0; i < sigs.size(); ++i) {
+            auto& [sig, pubkey, msg] = sigs[i];
+            const CKey& key{keys[i % num_keys]};
+            pubkey = XOnlyPubKey(key.GetPubKey());
+            msg = InsecureRand256();
+            BOOST_CHECK(key.SignSchnorr(msg, sig, nullptr, InsecureRand256()));
+            batch.Add(sig, pubkey, msg);
+        }
+        BOOST_CHECK(batch.Verify());
+
+        // Any single wrong signature, message or key fails the whole batch.
+        for (int i = 0; i < 3; ++i) {
+            const size_t pos = InsecureRandRange(sigs.size());
+            for (int field = 0; field < 3; ++field) {
+                batch.Clear();
+                for (size_t j = 0; j < sigs.size(); ++j) {
+                    auto [sig, pubkey, msg] = sigs[j];
+                    if (j == pos && field == 0) sig[InsecureRandRange(64)] ^= 1 << InsecureRandBits(3);
+                    if (j == pos && field == 1) pubkey = std::get<1>(sigs[(j + 1) % sigs.size()]);
+                    if (j == pos && field == 2) *msg.begin() ^= 1;
+                    batch.Add(sig, pubkey, msg);
+                }
+                BOOST_CHECK(!batch.Verify());
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
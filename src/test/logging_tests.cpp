@@ -6,7 +6,9 @@
 #include <logging.h>
 #include <logging/timer.h>
 #include <test/util/setup_common.h>
+#include <util/strencodings.h>
 #include <util/string.h>
+#include <util/time.h>
 
 #include <chrono>
 #include <fstream>
@@ -46,6 +48,8 @@ struct LogSetup : public BasicTestingSetup {
                  prev_category_levels{LogInstance().CategoryLevels()},
                  prev_log_level{LogInstance().LogLevel()}
     {
+        // Write out what was logged before, so it does not go to the new file.
+        LogInstance().Flush();
         LogInstance().m_file_path = tmp_log_path;
         LogInstance().m_reopen_file = true;
         LogInstance().m_print_to_file = true;
@@ -63,6 +67,7 @@ struct LogSetup : public BasicTestingSetup {
     {
         LogInstance().m_file_path = prev_log_path;
         LogPrintf("Sentinel log to reopen log file\n");
+        LogInstance().Flush();
         LogInstance().m_print_to_file = prev_print_to_file;
         LogInstance().m_reopen_file = prev_reopen_file;
         LogInstance().m_log_timestamps = prev_log_timestamps;
@@ -87,6 +92,7 @@ BOOST_FIXTURE_TEST_CASE(logging_LogPrintf_, LogSetup)
     LogPrintf_("fn2", "src2", 2, BCLog::LogFlags::NET, BCLog::Level::None, "foo2: %s", "bar2\n");
     LogPrintf_("fn3", "src3", 3, BCLog::LogFlags::NONE, BCLog::Level::Debug, "foo3: %s", "bar3\n");
     LogPrintf_("fn4", "src4", 4, BCLog::LogFlags::NONE, BCLog::Level::None, "foo4: %s", "bar4\n");
+    LogInstance().Flush();
     std::ifstream file{tmp_log_path};
     std::vector<std::string> log_lines;
     for (std::string log; std::getline(file, log);) {
@@ -110,6 +116,7 @@ BOOST_FIXTURE_TEST_CASE(logging_LogPrintMacros, LogSetup)
     LogPrintLevel(BCLog::NET, BCLog::Level::Warning, "foo9: %s\n", "bar9");
     LogPrintLevel(BCLog::NET, BCLog::Level::Error, "foo10: %s\n", "bar10");
     LogPrintfCategory(BCLog::VALIDATION, "foo11: %s\n", "bar11");
+    LogInstance().Flush();
     std::ifstream file{tmp_log_path};
     std::vector<std::string> log_lines;
     for (std::string log; std::getline(file, log);) {
@@ -149,6 +156,7 @@ BOOST_FIXTURE_TEST_CASE(logging_LogPrintMacros_CategoryName, LogSetup)
         expected.push_back(expected_log);
     }
 
+    LogInstance().Flush();
     std::ifstream file{tmp_log_path};
     std::vector<std::string> log_lines;
     for (std::string log; std::getline(file, log);) {
@@ -182,6 +190,7 @@ BOOST_FIXTURE_TEST_CASE(logging_SeverityLevels, LogSetup)
         "[net:warning] foo5: bar5",
         "[net:error] foo7: bar7",
     };
+    LogInstance().Flush();
     std::ifstream file{tmp_log_path};
     std::vector<std::string> log_lines;
     for (std::string log; std::getline(file, log);) {
@@ -190,6 +199,71 @@ BOOST_FIXTURE_TEST_CASE(logging_SeverityLevels, LogSetup)
     BOOST_CHECK_EQUAL_COLLECTIONS(log_lines.begin(), log_lines.end(), expected.begin(), expected.end());
 }
 
+BOOST_FIXTURE_TEST_CASE(logging_RateLimit, LogSetup)
+{
+    LogInstance().EnableCategory(BCLog::LogFlags::NET);
+    LogInstance().SetRateLimit(3);
+    for (int i = 0; i < 10; ++i) {
+        LogPrint(BCLog::NET, "limited %d\n", i);
+        LogPrintf("unlimited %d\n", i);
+    }
+
+    // The background writer reports the end of the burst by itself, without
+    // another message in that category.
+    int limited{0}, unlimited{0}, suppressed{0};
+    for (int attempt = 0; attempt < 100 && suppressed + limited < 10; ++attempt) {
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+        LogInstance().Flush();
+        limited = unlimited = suppressed = 0;
+        std::ifstream file{tmp_log_path};
+        for (std::string log; std::getline(file, log);) {
+            if (log.find("[net] limited ") == 0) ++limited;
+            if (log.find("unlimited ") == 0) ++unlimited;
+            if (log.find("Suppressed ") == 0) {
+                BOOST_CHECK(log.find(" net messages in the last ") != std::string::npos);
+                suppressed += LocaleIndependentAtoi<int>(log.substr(11));
+            }
+        }
+    }
+    LogInstance().SetRateLimit(0);
+    LogInstance().DisableCategory(BCLog::LogFlags::NET);
+
+    BOOST_CHECK_EQUAL(unlimited, 10);
+    // The ten messages may straddle a second boundary.
+    BOOST_CHECK(limited >= 3 && limited <= 6);
+    BOOST_CHECK(suppressed > 0);
+    BOOST_CHECK_EQUAL(limited + suppressed, 10);
+}
+
+BOOST_FIXTURE_TEST_CASE(logging_WriteQueued, LogSetup)
+{
+    const auto read_log = [&] {
+        std::ifstream file{tmp_log_path};
+        std::vector<std::string> log_lines;
+        for (std::string log; std::getline(file, log);) {
+            log_lines.push_back(log);
+        }
+        return log_lines;
+    };
+
+    // An error is written with the messages queued before it, without Flush()
+    LogPrintf("foo1: %s\n", "bar1");
+    LogPrintLevel(BCLog::NET, BCLog::Level::Error, "foo2: %s\n", "bar2");
+    std::vector<std::string> expected = {
+        "foo1: bar1",
+        "[net:error] foo2: bar2",
+    };
+    std::vector<std::string> log_lines{read_log()};
+    BOOST_CHECK_EQUAL_COLLECTIONS(log_lines.begin(), log_lines.end(), expected.begin(), expected.end());
+
+    // As are the queued messages before an assertion failure
+    LogPrintf("foo3: %s\n", "bar3");
+    LogInstance().WriteQueued();
+    expected.push_back("foo3: bar3");
+    log_lines = read_log();
+    BOOST_CHECK_EQUAL_COLLECTIONS(log_lines.begin(), log_lines.end(), expected.begin(), expected.end());
+}
+
 BOOST_FIXTURE_TEST_CASE(logging_Conf, LogSetup)
 {
     // Set global log level
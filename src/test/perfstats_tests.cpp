@@ -0,0 +1,126 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <util/perfstats.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+namespace {
+perf::Timer g_test_timer{"test_timer", "Timer used by perfstats_tests", "items"};
+
+const perf::TimerStats& FindTimer(const std::vector<perf::TimerStats>& timers)
+{
+    const auto it{std::find_if(timers.begin(), timers.end(), [](const perf::TimerStats& t) { return t.name == "test_timer"; })};
+    BOOST_REQUIRE(it != timers.end());
+    return *it;
+}
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(perfstats_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(histogram_buckets)
+{
+    perf::Histogram histogram;
+    histogram.Add(std::chrono::nanoseconds{999});      // < 1us
+    histogram.Add(std::chrono::microseconds{1});       // < 2us
+    histogram.Add(std::chrono::microseconds{3});       // < 4us
+    histogram.Add(std::chrono::microseconds{4});       // < 8us
+    histogram.Add(std::chrono::hours{1});              // unbounded
+    const auto snapshot{histogram.GetSnapshot()};
+    BOOST_CHECK_EQUAL(snapshot.count, 5U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[0], 1U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[1], 1U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[2], 1U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[3], 1U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[perf::Histogram::BUCKETS - 1], 1U);
+    BOOST_CHECK(snapshot.max == std::chrono::hours{1});
+    BOOST_CHECK(snapshot.total == std::chrono::hours{1} + std::chrono::nanoseconds{999 + 8000});
+
+    histogram.Reset();
+    BOOST_CHECK_EQUAL(histogram.GetSnapshot().count, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(timers)
+{
+    perf::Reset();
+    {
+        // Nothing is recorded while disabled.
+        perf::ScopedTimer timer{g_test_timer};
+        timer.AddItems(5);
+    }
+    BOOST_CHECK_EQUAL(FindTimer(perf::GetTimerStats()).histogram.count, 0U);
+
+    perf::Enable();
+    {
+        perf::ScopedTimer timer{g_test_timer};
+        timer.AddItems(2);
+        timer.Stop();
+        timer.AddItems(3);
+    }
+    {
+        perf::ScopedTimer timer{g_test_timer};
+        timer.AddItems();
+    }
+    perf::Disable();
+
+    const perf::TimerStats& stats{FindTimer(perf::GetTimerStats())};
+    BOOST_CHECK_EQUAL(stats.histogram.count, 2U);
+    BOOST_CHECK_EQUAL(stats.items, 3U);
+    BOOST_CHECK_EQUAL(stats.items_name, "items");
+
+    const std::string prometheus{perf::FormatPrometheus()};
+    BOOST_CHECK(prometheus.find("peercoin_perf_duration_seconds_count{timer=\"test_timer\"} 2\n") != std::string::npos);
+    BOOST_CHECK(prometheus.find("peercoin_perf_duration_seconds_bucket{timer=\"test_timer\",le=\"+Inf\"} 2\n") != std::string::npos);
+    BOOST_CHECK(prometheus.find("peercoin_perf_items_total{timer=\"test_timer\",item=\"items\"} 3\n") != std::string::npos);
+
+    perf::Reset();
+    BOOST_CHECK_EQUAL(FindTimer(perf::GetTimerStats()).histogram.count, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(lock_sites)
+{
+    RecursiveMutex profiled;
+    Mutex other;
+    perf::Reset();
+    perf::Enable(&profiled);
+    {
+        LOCK(other);
+    }
+    {
+        LOCK(profiled);
+        LOCK(profiled);
+    }
+    {
+        WAIT_LOCK(profiled, lock);
+        REVERSE_LOCK(lock);
+    }
+    {
+        TRY_LOCK(profiled, lock);
+        BOOST_CHECK(bool{lock});
+    }
+    perf::Disable();
+    {
+        LOCK(profiled);
+    }
+
+    const auto sites{perf::GetLockSiteStats()};
+    uint64_t total{0};
+    for (const perf::LockSiteStats& site : sites) {
+        BOOST_CHECK(site.site.find("perfstats_tests.cpp:") == 0);
+        BOOST_CHECK_EQUAL(site.wait.count, site.hold.count);
+        total += site.hold.count;
+    }
+    // Both nested locks, the lock and relock around REVERSE_LOCK, and the TRY_LOCK.
+    BOOST_CHECK_EQUAL(sites.size(), 4U);
+    BOOST_CHECK_EQUAL(total, 5U);
+    perf::Reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
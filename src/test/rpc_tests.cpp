@@ -7,9 +7,13 @@
 #include <node/context.h>
 #include <rpc/blockchain.h>
 #include <rpc/client.h>
+#include <rpc/jsonstream.h>
+#include <rpc/mempool.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <test/util/setup_common.h>
+#include <test/util/txmempool.h>
+#include <txmempool.h>
 #include <univalue.h>
 #include <util/time.h>
 
@@ -319,6 +323,80 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_jsonstream)
+{
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("str", "esc\"aped\n\x01");
+    entry.pushKV("num", 42);
+    entry.pushKV("amount", ValueFromAmount(123456));
+    entry.pushKV("bool", true);
+    entry.pushKV("null", NullUniValue);
+    entry.pushKV("empty_arr", UniValue(UniValue::VARR));
+    entry.pushKV("empty_obj", UniValue(UniValue::VOBJ));
+
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("first", "value");
+    UniValue arr(UniValue::VARR);
+    for (int i = 0; i < 50; ++i) arr.push_back(entry);
+    expected.pushKV("arr", arr);
+    expected.pushKV("k\"ey", 1);
+
+    // Tiny chunks, so the output is cut at every possible position
+    std::vector<std::string> chunks;
+    JSONStreamWriter writer{[&](std::string&& chunk) { chunks.push_back(std::move(chunk)); }, /*chunk_size=*/1};
+    BOOST_CHECK(!writer.HasOutput());
+    writer.BeginObject();
+    writer.Key("first");
+    writer.Value("value");
+    writer.Key("arr");
+    writer.BeginArray();
+    for (int i = 0; i < 50; ++i) {
+        writer.BeginObject();
+        writer.ObjectFields(entry);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.Key("k\"ey");
+    writer.Value(1);
+    writer.EndObject();
+    BOOST_CHECK(writer.HasOutput());
+    BOOST_CHECK(chunks.size() > 50);
+
+    std::string streamed;
+    for (const auto& chunk : chunks) streamed += chunk;
+    streamed += writer.TakeBuffer();
+    BOOST_CHECK_EQUAL(streamed, expected.write());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_mempool_stream)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    TestMemPoolEntryHelper entry;
+    {
+        LOCK2(cs_main, pool.cs);
+        // More entries than one batch, each child spending its parent
+        uint256 parent;
+        for (int i = 0; i < 1200; ++i) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = i % 2 ? COutPoint{parent, 0} : COutPoint{uint256{uint8_t(i % 256)}, uint32_t(i)};
+            tx.vout.resize(1);
+            tx.vout[0].nValue = 1000 + i;
+            tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+            parent = tx.GetHash();
+            pool.addUnchecked(entry.Fee(10000).FromTx(tx));
+        }
+    }
+    const UniValue expected{MempoolToJSON(pool, /*verbose=*/true)};
+    BOOST_CHECK_EQUAL(expected.size(), 1200U);
+
+    std::string streamed;
+    JSONStreamWriter writer{[&](std::string&& chunk) { streamed += chunk; }};
+    MempoolToJSON(writer, pool, /*verbose=*/true);
+    streamed += writer.TakeBuffer();
+    BOOST_CHECK_EQUAL(streamed, expected.write());
+}
+
 BOOST_AUTO_TEST_CASE(rpc_ban)
 {
     BOOST_CHECK_NO_THROW(CallRPC(std::string("clearbanned")));
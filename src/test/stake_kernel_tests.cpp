@@ -0,0 +1,138 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <chainparams.h>
+#include <kernel.h>
+#include <logging.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <optional>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(stake_kernel_tests, TestingSetup)
+
+namespace {
+// A coin as CheckStakeKernelHash() reads it
+struct KernelCoin {
+    CBlockHeader block_from;
+    unsigned int tx_prev_offset{0};
+    CTransactionRef tx_prev;
+    COutPoint prevout;
+};
+
+StakeKernelCandidate MakeCandidate(const KernelCoin& coin)
+{
+    StakeKernelCandidate candidate;
+    candidate.nTimeBlockFrom = coin.block_from.GetBlockTime();
+    candidate.nTxPrevOffset = coin.tx_prev_offset;
+    candidate.nTimeTxPrev = coin.tx_prev->nTime ? coin.tx_prev->nTime : candidate.nTimeBlockFrom;
+    candidate.nPrevout = coin.prevout.n;
+    candidate.nValueIn = coin.tx_prev->vout[coin.prevout.n].nValue;
+    return candidate;
+}
+} // namespace
+
+// Test that the batched kernel search picks the first coin that
+// CheckStakeKernelHash() accepts, for random coins and the edge cases of the
+// timestamp and min age checks.
+BOOST_AUTO_TEST_CASE(find_stake_kernel_v05)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    Chainstate& chainstate = m_node.chainman->ActiveChainstate();
+    // Well after the v0.5 protocol switch
+    const unsigned int time_tx{1700000000};
+    BOOST_REQUIRE(IsProtocolV05(time_tx));
+    // The debug log of CheckStakeKernelHash() also runs for the blocks of
+    // these coins, which are not in the block index
+    BOOST_REQUIRE(g_log_debug);
+    const auto compact_power_of_two = [](int bits) {
+        arith_uint256 target{1};
+        target <<= bits;
+        return target.GetCompact();
+    };
+    KernelStakeModifier modifier;
+    modifier.nStakeModifier = g_insecure_rand_ctx.rand64();
+
+    const auto make_coin = [&](unsigned int time_block_from, unsigned int time_tx_prev, CAmount value) {
+        KernelCoin coin;
+        coin.block_from.nTime = time_block_from;
+        coin.tx_prev_offset = 80 + InsecureRandRange(100000);
+        CMutableTransaction tx;
+        tx.nTime = time_tx_prev;
+        tx.vout.resize(1 + InsecureRandRange(4));
+        coin.prevout = COutPoint(InsecureRand256(), InsecureRandRange(tx.vout.size()));
+        tx.vout[coin.prevout.n].nValue = value;
+        coin.tx_prev = MakeTransactionRef(std::move(tx));
+        return coin;
+    };
+
+    std::vector<KernelCoin> coins;
+    for (int i = 0; i < 1000; ++i) {
+        // Aged between the min age and past the max age, with values up to 1000 coins
+        const unsigned int time_block_from{time_tx - (unsigned int)params.nStakeMinAge - (unsigned int)InsecureRandRange(params.nStakeMaxAge)};
+        const unsigned int time_tx_prev{InsecureRandBool() ? 0 : time_block_from + (unsigned int)InsecureRandRange(3600)};
+        coins.push_back(make_coin(time_block_from, time_tx_prev, 1 + InsecureRandRange(1000 * COIN)));
+    }
+    // Coins at the edges of the min age and the transaction timestamp checks,
+    // with whether they pass them and whether they meet any target. A
+    // transaction at the kernel time passes the timestamp check, but has no
+    // weight.
+    struct EdgeCase {
+        KernelCoin coin;
+        bool time_valid;
+        bool kernel;
+    };
+    const std::vector<EdgeCase> edge_cases{
+        {make_coin(time_tx - params.nStakeMinAge, time_tx - params.nStakeMinAge - 10 * 24 * 60 * 60, 500 * COIN), true, true},
+        {make_coin(time_tx - params.nStakeMinAge + 1, time_tx - params.nStakeMinAge - 10 * 24 * 60 * 60, 500 * COIN), false, false},
+        {make_coin(time_tx - params.nStakeMaxAge, time_tx, 500 * COIN), true, false},
+        {make_coin(time_tx - params.nStakeMaxAge, time_tx + 1, 500 * COIN), false, false},
+    };
+    for (const EdgeCase& edge_case : edge_cases) {
+        coins.push_back(edge_case.coin);
+    }
+    Shuffle(coins.begin(), coins.end(), g_insecure_rand_ctx);
+
+    std::vector<StakeKernelCandidate> candidates;
+    for (const KernelCoin& coin : coins) {
+        candidates.push_back(MakeCandidate(coin));
+    }
+
+    // Targets that most, some and hardly any of the coins meet
+    for (const int target_bits : {250, 240, 230}) {
+        const unsigned int bits{compact_power_of_two(target_bits)};
+        std::optional<size_t> first;
+        for (size_t i = 0; i < coins.size(); ++i) {
+            const KernelCoin& coin{coins[i]};
+            uint256 hash_proof;
+            const bool valid{CheckStakeKernelHash(bits, /*pindexPrev=*/nullptr, coin.block_from, coin.tx_prev_offset, coin.tx_prev, coin.prevout,
+                                                  time_tx, hash_proof, /*fPrintProofOfStake=*/false, chainstate, &modifier, /*fCheckTarget=*/true)};
+            BOOST_CHECK_EQUAL(FindStakeKernelV05(bits, modifier, {candidates[i]}, time_tx) == std::optional<size_t>{0}, valid);
+            if (valid && !first) first = i;
+        }
+        if (target_bits >= 240) BOOST_CHECK(first);
+        BOOST_CHECK(FindStakeKernelV05(bits, modifier, candidates, time_tx) == first);
+    }
+
+    // The edge cases on their own, with a target that any weight meets
+    const unsigned int easy_bits{compact_power_of_two(255)};
+    for (const EdgeCase& edge_case : edge_cases) {
+        const KernelCoin& coin{edge_case.coin};
+        uint256 hash_proof;
+        BOOST_CHECK_EQUAL(CheckStakeKernelHash(easy_bits, nullptr, coin.block_from, coin.tx_prev_offset, coin.tx_prev, coin.prevout,
+                                               time_tx, hash_proof, false, chainstate, &modifier, /*fCheckTarget=*/false), edge_case.time_valid);
+        BOOST_CHECK_EQUAL(CheckStakeKernelHash(easy_bits, nullptr, coin.block_from, coin.tx_prev_offset, coin.tx_prev, coin.prevout,
+                                               time_tx, hash_proof, false, chainstate, &modifier, /*fCheckTarget=*/true), edge_case.kernel);
+        BOOST_CHECK_EQUAL(FindStakeKernelV05(easy_bits, modifier, {MakeCandidate(coin)}, time_tx).has_value(), edge_case.kernel);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -555,6 +555,73 @@ BOOST_AUTO_TEST_CASE(test_big_witness_transaction)
     scriptcheckqueue.StopWorkerThreads();
 }
 
+static bool CheckInputsConcurrently(const CTransaction& tx, const std::vector<CTxOut>& spent_outputs, unsigned int flags)
+{
+    PrecomputedTransactionData txdata;
+    txdata.Init(tx, std::vector<CTxOut>{spent_outputs});
+    CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    scriptcheckqueue.StartWorkerThreads(4);
+    for (uint32_t i = 0; i < tx.vin.size(); i++) {
+        std::vector<CScriptCheck> vChecks;
+        vChecks.emplace_back(spent_outputs[i], tx, i, flags, false, &txdata);
+        control.Add(std::move(vChecks));
+    }
+    bool controlCheck = control.Wait();
+    scriptcheckqueue.StopWorkerThreads();
+    return controlCheck;
+}
+
+BOOST_AUTO_TEST_CASE(test_schnorr_batch_checkqueue)
+{
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_TAPROOT;
+
+    // A transaction spending many taproot outputs by key path, whose
+    // signatures the check queue verifies in batches
+    std::vector<CKey> keys(300);
+    std::vector<CTxOut> spent_outputs;
+    CMutableTransaction mtx;
+    for (uint32_t i = 0; i < keys.size(); i++) {
+        keys[i].MakeNewKey(true);
+        const auto tweaked = XOnlyPubKey(keys[i].GetPubKey()).CreateTapTweak(nullptr);
+        spent_outputs.emplace_back(1000, GetScriptForDestination(WitnessV1Taproot(tweaked->first)));
+        mtx.vin.emplace_back(COutPoint(InsecureRand256(), i));
+    }
+    mtx.vout.emplace_back(1000, CScript() << OP_TRUE);
+
+    PrecomputedTransactionData txdata;
+    txdata.Init(mtx, std::vector<CTxOut>{spent_outputs}, /*force=*/true);
+    for (uint32_t i = 0; i < mtx.vin.size(); i++) {
+        ScriptExecutionData execdata;
+        execdata.m_annex_init = true;
+        execdata.m_annex_present = false;
+        uint256 sighash;
+        BOOST_REQUIRE(SignatureHashSchnorr(sighash, execdata, mtx, i, SIGHASH_DEFAULT, SigVersion::TAPROOT, txdata, MissingDataBehavior::FAIL));
+        std::vector<unsigned char> sig(64);
+        const uint256 merkle_root;
+        BOOST_REQUIRE(keys[i].SignSchnorr(sighash, sig, &merkle_root, InsecureRand256()));
+        mtx.vin[i].scriptWitness.stack = {sig};
+    }
+    BOOST_CHECK(CheckInputsConcurrently(CTransaction{mtx}, spent_outputs, flags));
+
+    // One bad signature fails the queue, and running the chunk again one check
+    // at a time tells which input it is
+    const uint32_t bad_input = 123;
+    mtx.vin[bad_input].scriptWitness.stack[0][7] ^= 1;
+    const CTransaction bad_tx{mtx};
+    BOOST_CHECK(!CheckInputsConcurrently(bad_tx, spent_outputs, flags));
+
+    PrecomputedTransactionData bad_txdata;
+    bad_txdata.Init(bad_tx, std::vector<CTxOut>{spent_outputs});
+    std::vector<CScriptCheck> checks;
+    for (uint32_t i = 0; i < bad_tx.vin.size(); i++) {
+        checks.emplace_back(spent_outputs[i], bad_tx, i, flags, false, &bad_txdata);
+    }
+    BOOST_CHECK(!RunChecks(checks));
+    BOOST_CHECK_EQUAL(checks[bad_input - 1].GetScriptError(), SCRIPT_ERR_OK);
+    BOOST_CHECK_EQUAL(checks[bad_input].GetScriptError(), SCRIPT_ERR_SCHNORR_SIG);
+}
+
 SignatureData CombineSignatures(const CMutableTransaction& input1, const CMutableTransaction& input2, const CTransactionRef tx)
 {
     SignatureData sigdata;
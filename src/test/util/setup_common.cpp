@@ -171,7 +171,7 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     // from blocking due to queue overrun.
     m_node.scheduler = std::make_unique<CScheduler>();
     m_node.scheduler->m_service_thread = std::thread(util::TraceThread, "scheduler", [&] { m_node.scheduler->serviceQueue(); });
-    GetMainSignals().RegisterBackgroundSignalScheduler(*m_node.scheduler);
+    GetMainSignals().RegisterBackgroundSignalScheduler(*m_node.scheduler, DEFAULT_VALIDATION_CALLBACK_THREADS);
 
     m_node.mempool = std::make_unique<CTxMemPool>(MemPoolOptionsForTest(m_node));
 
@@ -284,7 +284,7 @@ TestChain100Setup::TestChain100Setup(
         LOCK(::cs_main);
         assert(
             m_node.chainman->ActiveChain().Tip()->GetBlockHash().ToString() ==
-            "08f515d8d025b6ddfc14784ea62fae6c8b2262f89e3a40f0a4e8ac7524b2a730");
+            "259c0b62ae36db0680fe7f29f0e9df2a1929d7332bf2c900177f7a116cab6d07");
     }
 }
 
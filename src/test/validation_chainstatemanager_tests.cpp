@@ -4,6 +4,8 @@
 //
 #include <chainparams.h>
 #include <consensus/validation.h>
+#include <index/txindex.h>
+#include <interfaces/chain.h>
 #include <node/utxo_snapshot.h>
 #include <random.h>
 #include <rpc/blockchain.h>
@@ -13,6 +15,7 @@
 #include <test/util/setup_common.h>
 #include <timedata.h>
 #include <uint256.h>
+#include <util/time.h>
 #include <validation.h>
 #include <validationinterface.h>
 
@@ -66,9 +69,10 @@ BOOST_AUTO_TEST_CASE(chainstatemanager)
 
     BOOST_CHECK(!manager.SnapshotBlockhash().has_value());
 
-    // Create a snapshot-based chainstate.
+    // Create a snapshot-based chainstate. Its base must be a real block, the
+    // only one it loads.
     //
-    const uint256 snapshot_blockhash = GetRandHash();
+    const uint256 snapshot_blockhash = Params().GenesisBlock().GetHash();
     Chainstate& c2 = WITH_LOCK(::cs_main, return manager.ActivateExistingSnapshot(
         &mempool, snapshot_blockhash));
     chainstates.push_back(&c2);
@@ -174,6 +178,28 @@ struct SnapshotTestSetup : TestChain100Setup {
                               /*block_tree_db_in_memory=*/false,
                           }
     {
+        // peercoin: snapshots are written from and loaded into the transaction index
+        g_txindex = std::make_unique<TxIndex>(interfaces::MakeChain(m_node), 1 << 20, /*f_memory=*/true);
+        BOOST_REQUIRE(g_txindex->Start());
+        constexpr int64_t timeout_ms = 10 * 1000;
+        int64_t time_start = GetTimeMillis();
+        while (!g_txindex->BlockUntilSyncedToCurrentChain()) {
+            BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+            UninterruptibleSleep(std::chrono::milliseconds{100});
+        }
+    }
+
+    ~SnapshotTestSetup()
+    {
+        StopTxIndex();
+    }
+
+    void StopTxIndex()
+    {
+        if (!g_txindex) return;
+        g_txindex->Interrupt();
+        g_txindex->Stop();
+        g_txindex.reset();
     }
 
     std::tuple<Chainstate*, Chainstate*> SetupSnapshot()
@@ -370,6 +396,8 @@ struct SnapshotTestSetup : TestChain100Setup {
         ChainstateManager& chainman = *Assert(m_node.chainman);
 
         BOOST_TEST_MESSAGE("Simulating node restart");
+        // peercoin: the index refers to the old manager, stop it as Shutdown() does
+        StopTxIndex();
         {
             for (Chainstate* cs : chainman.GetAll()) {
                 LOCK(::cs_main);
@@ -2,18 +2,28 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chain.h>
 #include <chainparams.h>
+#include <clientversion.h>
 #include <consensus/amount.h>
 #include <consensus/merkle.h>
 #include <core_io.h>
 #include <hash.h>
+#include <kernel/validation_cache_persist.h>
+#include <kernel/validation_cache_sizes.h>
 #include <net.h>
+#include <node/validation_cache_args.h>
+#include <script/sigcache.h>
 #include <signet.h>
 #include <uint256.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <cstdio>
 #include <string>
+#include <vector>
 
+#include <test/util/random.h>
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
@@ -96,12 +106,107 @@ BOOST_AUTO_TEST_CASE(test_assumeutxo)
     }
 
     const auto out110 = *ExpectedAssumeutxo(110, *params);
-    BOOST_CHECK_EQUAL(out110.hash_serialized.ToString(), "1ebbf5850204c0bdb15bf030f47c7fe91d45c44c712697e4509ba67adb01c618");
-    BOOST_CHECK_EQUAL(out110.nChainTx, 110U);
+    BOOST_CHECK_EQUAL(out110.hash_serialized.ToString(), "47c39285659fe1de23b61ed3c33e18d73ecf2ef471eb7adc7e6de0aa2f9fff8d");
+    BOOST_CHECK_EQUAL(out110.nChainTx, 111U);
+    BOOST_CHECK_EQUAL(out110.hash_stake.ToString(), "99a70aed9e46daf514d6b80c761d8ebe051a03644408fe23b89583387d76d162");
 
     const auto out210 = *ExpectedAssumeutxo(200, *params);
-    BOOST_CHECK_EQUAL(out210.hash_serialized.ToString(), "51c8d11d8b5c1de51543c579736e786aa2736206d1e11e627568029ce092cf62");
-    BOOST_CHECK_EQUAL(out210.nChainTx, 200U);
+    BOOST_CHECK_EQUAL(out210.hash_serialized.ToString(), "788261ee37034eede75254fc022fbdfb54e7e96260fc384dadac8846eb45f2b2");
+    BOOST_CHECK_EQUAL(out210.nChainTx, 201U);
+    BOOST_CHECK_EQUAL(out210.hash_stake.ToString(), "4dddf34fcf13dd045d11d9a3a6866bf34eca03ef836e74e6d83bb727fdb8bc7a");
+}
+
+//! Whether all of entries are among the cached ones
+static bool ContainsAll(std::vector<uint256> cached, const std::vector<uint256>& entries)
+{
+    std::sort(cached.begin(), cached.end());
+    return std::all_of(entries.begin(), entries.end(), [&](const uint256& entry) {
+        return std::binary_search(cached.begin(), cached.end(), entry);
+    });
+}
+
+//! Whether any of entries is among the cached ones
+static bool ContainsAny(std::vector<uint256> cached, const std::vector<uint256>& entries)
+{
+    std::sort(cached.begin(), cached.end());
+    return std::any_of(entries.begin(), entries.end(), [&](const uint256& entry) {
+        return std::binary_search(cached.begin(), cached.end(), entry);
+    });
+}
+
+BOOST_AUTO_TEST_CASE(validation_cache_persist)
+{
+    const fs::path path{m_args.GetDataDirNet() / "sigcache.dat"};
+    kernel::ValidationCacheSizes cache_sizes{};
+    node::ApplyArgsManOptions(m_args, cache_sizes);
+    // Empty both caches and salt them with new nonces, like a restart does
+    const auto restart = [&] {
+        BOOST_REQUIRE(InitSignatureCache(cache_sizes.signature_cache_bytes));
+        LoadSignatureCache(InsecureRand256(), {});
+        BOOST_REQUIRE(InitScriptExecutionCache(cache_sizes.script_execution_cache_bytes));
+    };
+    uint256 nonce;
+    uint256 orig_sig_nonce, orig_script_nonce;
+    DumpSignatureCache(orig_sig_nonce);
+    WITH_LOCK(cs_main, DumpScriptExecutionCache(orig_script_nonce));
+
+    const uint256 sig_nonce{InsecureRand256()};
+    const uint256 script_nonce{InsecureRand256()};
+    std::vector<uint256> sig_entries(20), script_entries(20);
+    for (uint256& entry : sig_entries) entry = InsecureRand256();
+    for (uint256& entry : script_entries) entry = InsecureRand256();
+    LoadSignatureCache(sig_nonce, sig_entries);
+    WITH_LOCK(cs_main, LoadScriptExecutionCache(script_nonce, script_entries));
+    BOOST_CHECK(kernel::DumpValidationCaches(path));
+
+    // After a restart, the caches are empty until they get back their nonces
+    // and entries, and the dump is used up
+    restart();
+    BOOST_CHECK(!ContainsAny(DumpSignatureCache(nonce), sig_entries));
+    BOOST_CHECK(nonce != sig_nonce);
+    BOOST_CHECK(!ContainsAny(WITH_LOCK(cs_main, return DumpScriptExecutionCache(nonce)), script_entries));
+    BOOST_CHECK(nonce != script_nonce);
+    BOOST_CHECK(kernel::LoadValidationCaches(path));
+    BOOST_CHECK(!fs::exists(path));
+    BOOST_CHECK(ContainsAll(DumpSignatureCache(nonce), sig_entries));
+    BOOST_CHECK(nonce == sig_nonce);
+    BOOST_CHECK(ContainsAll(WITH_LOCK(cs_main, return DumpScriptExecutionCache(nonce)), script_entries));
+    BOOST_CHECK(nonce == script_nonce);
+    BOOST_CHECK(!kernel::LoadValidationCaches(path));
+
+    // An incomplete dump leaves the caches empty, with the nonces they have
+    BOOST_CHECK(kernel::DumpValidationCaches(path));
+    fs::resize_file(path, fs::file_size(path) - 1);
+    restart();
+    const uint256 fresh_nonce{InsecureRand256()};
+    LoadSignatureCache(fresh_nonce, {});
+    BOOST_CHECK(!kernel::LoadValidationCaches(path));
+    BOOST_CHECK(!ContainsAny(DumpSignatureCache(nonce), sig_entries));
+    BOOST_CHECK(nonce == fresh_nonce);
+    BOOST_CHECK(!ContainsAny(WITH_LOCK(cs_main, return DumpScriptExecutionCache(nonce)), script_entries));
+
+    // A dump of another client version is discarded
+    LoadSignatureCache(sig_nonce, sig_entries);
+    WITH_LOCK(cs_main, LoadScriptExecutionCache(script_nonce, script_entries));
+    BOOST_CHECK(kernel::DumpValidationCaches(path));
+    {
+        FILE* filestr{fsbridge::fopen(path, "r+b")};
+        BOOST_REQUIRE(filestr);
+        // The client version follows the format version
+        BOOST_REQUIRE_EQUAL(std::fseek(filestr, sizeof(uint64_t), SEEK_SET), 0);
+        CAutoFile file{filestr, SER_DISK, CLIENT_VERSION};
+        file << int32_t{CLIENT_VERSION - 1};
+    }
+    restart();
+    BOOST_CHECK(!kernel::LoadValidationCaches(path));
+    BOOST_CHECK(!fs::exists(path));
+    BOOST_CHECK(!ContainsAny(DumpSignatureCache(nonce), sig_entries));
+    BOOST_CHECK(!ContainsAny(WITH_LOCK(cs_main, return DumpScriptExecutionCache(nonce)), script_entries));
+
+    // Leave the process-wide caches empty and salted as they were
+    restart();
+    LoadSignatureCache(orig_sig_nonce, {});
+    WITH_LOCK(cs_main, LoadScriptExecutionCache(orig_script_nonce, {}));
 }
 
 BOOST_AUTO_TEST_CASE(block_malleation)
@@ -315,4 +420,55 @@ BOOST_AUTO_TEST_CASE(block_malleation)
     }
 }
 
+static void BuildChain(std::vector<CBlockIndex>& blocks, CBlockIndex* parent)
+{
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        CBlockIndex* prev{i ? &blocks[i - 1] : parent};
+        blocks[i].pprev = prev;
+        blocks[i].nHeight = prev ? prev->nHeight + 1 : 0;
+        blocks[i].nBits = 0x207fffff;
+        blocks[i].nChainTrust = prev ? prev->nChainTrust + GetBlockTrust(*prev) : arith_uint256(0);
+        blocks[i].BuildSkip();
+    }
+}
+
+//! Blocks of a chain without the assumed valid block never skip checks
+BOOST_AUTO_TEST_CASE(assumevalid_block)
+{
+    const auto params = CreateChainParams(*m_node.args, CBaseChainParams::MAIN);
+    const Consensus::Params& consensus{params->GetConsensus()};
+    const int two_weeks{static_cast<int>(60 * 60 * 24 * 7 * 2 / consensus.nPowTargetSpacing)};
+
+    std::vector<CBlockIndex> chain(4 * two_weeks);
+    BuildChain(chain, nullptr);
+    const CBlockIndex& best{chain.back()};
+    const CBlockIndex* assumed_valid{&chain[3 * two_weeks]};
+    const arith_uint256 min_work{chain[2 * two_weeks].nChainTrust};
+
+    BOOST_CHECK(IsAssumedValidBlock(chain[10], assumed_valid, best, min_work, consensus));
+    BOOST_CHECK(IsAssumedValidBlock(chain[3 * two_weeks - 2], assumed_valid, best, min_work, consensus));
+    // Within two weeks of the best header
+    BOOST_CHECK(!IsAssumedValidBlock(chain[3 * two_weeks - 1], assumed_valid, best, min_work, consensus));
+    // Above the assumed valid block
+    BOOST_CHECK(!IsAssumedValidBlock(chain[3 * two_weeks + 1], &chain[3 * two_weeks], *assumed_valid, 0, consensus));
+    // Without an assumed valid block, or below the minimum chain work
+    BOOST_CHECK(!IsAssumedValidBlock(chain[10], nullptr, best, min_work, consensus));
+    BOOST_CHECK(!IsAssumedValidBlock(chain[10], assumed_valid, best, best.nChainTrust + 1, consensus));
+
+    // A fake chain forking off below the assumed valid block, with more work
+    // than the real one
+    std::vector<CBlockIndex> fake(6 * two_weeks);
+    BuildChain(fake, &chain[two_weeks]);
+    const CBlockIndex& fake_best{fake.back()};
+    BOOST_CHECK(fake_best.nChainTrust > best.nChainTrust);
+    // Its blocks are not ancestors of the assumed valid block, whichever is the best header
+    BOOST_CHECK(!IsAssumedValidBlock(fake[10], assumed_valid, fake_best, min_work, consensus));
+    BOOST_CHECK(!IsAssumedValidBlock(fake[10], assumed_valid, best, min_work, consensus));
+    // The assumed valid chain above the fork is not checked as assumed valid
+    // while the fake chain is the best header
+    BOOST_CHECK(!IsAssumedValidBlock(chain[two_weeks + 10], assumed_valid, fake_best, min_work, consensus));
+    // The common history below the fork still is
+    BOOST_CHECK(IsAssumedValidBlock(chain[10], assumed_valid, fake_best, min_work, consensus));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
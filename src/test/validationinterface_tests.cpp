@@ -8,8 +8,15 @@
 #include <scheduler.h>
 #include <test/util/setup_common.h>
 #include <util/check.h>
+#include <util/time.h>
 #include <validationinterface.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <numeric>
+#include <thread>
+
 BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, TestingSetup)
 
 struct TestSubscriberNoop final : public CValidationInterface {
@@ -71,6 +78,108 @@ public:
     std::function<void()> m_on_destroy;
 };
 
+class TestQueueSubscriber : public CValidationInterface
+{
+public:
+    explicit TestQueueSubscriber(std::string name, bool block = false) : m_name(std::move(name)), m_block(block) {}
+    void TransactionAddedToMempool(const CTransactionRef&, uint64_t mempool_sequence) override
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cv.wait(lock, [&] { return !m_block; });
+        m_sequences.push_back(mempool_sequence);
+        m_cv.notify_all();
+    }
+    std::string GetSubscriberName() const override { return m_name; }
+    void Release()
+    {
+        WITH_LOCK(m_mutex, m_block = false);
+        m_cv.notify_all();
+    }
+    void WaitFor(size_t count)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cv.wait(lock, [&] { return m_sequences.size() >= count; });
+    }
+    std::vector<uint64_t> Sequences() { return WITH_LOCK(m_mutex, return m_sequences); }
+
+private:
+    const std::string m_name;
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_block;
+    std::vector<uint64_t> m_sequences;
+};
+
+BOOST_AUTO_TEST_CASE(per_subscriber_queues)
+{
+    auto slow = std::make_shared<TestQueueSubscriber>("slow", /*block=*/true);
+    auto fast = std::make_shared<TestQueueSubscriber>("fast");
+    RegisterSharedValidationInterface(slow);
+    RegisterSharedValidationInterface(fast);
+
+    const CTransactionRef tx{MakeTransactionRef(CMutableTransaction{})};
+    const size_t count{3 * DEFAULT_MAX_VALIDATION_BACKLOG};
+    for (size_t i = 0; i < count; ++i) {
+        GetMainSignals().TransactionAddedToMempool(tx, i);
+    }
+
+    // The blocked subscriber does not hold back the other one, and functions
+    // queued for a single subscriber only wait for that subscriber.
+    fast->WaitFor(count);
+    std::promise<void> fast_function;
+    CallFunctionInValidationInterfaceQueue(*fast, [&] { fast_function.set_value(); });
+    fast_function.get_future().wait();
+    BOOST_CHECK(slow->Sequences().size() <= 1);
+    BOOST_CHECK(GetMainSignals().CallbacksPending() >= count - 1);
+
+    bool found{false};
+    for (const auto& stats : GetMainSignals().GetSubscriberStats()) {
+        if (stats.name != "slow") continue;
+        found = true;
+        BOOST_CHECK(stats.registered);
+        BOOST_CHECK(stats.pending >= count - 1);
+        BOOST_CHECK_EQUAL(stats.processed, 0U);
+    }
+    BOOST_CHECK(found);
+
+    // Validation waits for the subscriber that fell too far behind.
+    std::atomic<bool> limited{false};
+    std::thread limit{[&] {
+        GetMainSignals().LimitBacklog();
+        limited = true;
+    }};
+    UninterruptibleSleep(std::chrono::milliseconds{50});
+    BOOST_CHECK(!limited);
+    slow->Release();
+    limit.join();
+    BOOST_CHECK(GetMainSignals().CallbacksPending() <= DEFAULT_MAX_VALIDATION_BACKLOG / 2);
+
+    SyncWithValidationInterfaceQueue();
+    std::vector<uint64_t> expected(count);
+    std::iota(expected.begin(), expected.end(), 0);
+    BOOST_CHECK(slow->Sequences() == expected);
+    BOOST_CHECK(fast->Sequences() == expected);
+
+    UnregisterSharedValidationInterface(slow);
+    UnregisterSharedValidationInterface(fast);
+}
+
+BOOST_AUTO_TEST_CASE(unregister_releases_subscriber)
+{
+    // After the background callbacks have been flushed at shutdown, queued
+    // notifications are never run. Unregistering must still release the
+    // subscriber, or the wallet waits forever to be unloaded.
+    GetMainSignals().FlushBackgroundCallbacks();
+    auto subscriber = std::make_shared<TestQueueSubscriber>("subscriber");
+    std::weak_ptr<TestQueueSubscriber> weak{subscriber};
+    RegisterSharedValidationInterface(subscriber);
+    GetMainSignals().TransactionAddedToMempool(MakeTransactionRef(CMutableTransaction{}), 0);
+    BOOST_CHECK_EQUAL(GetMainSignals().CallbacksPending(), 1U);
+    UnregisterSharedValidationInterface(subscriber);
+    subscriber.reset();
+    BOOST_CHECK(weak.expired());
+}
+
 // Regression test to ensure UnregisterAllValidationInterfaces calls don't
 // destroy a validation interface while it is being called. Bug:
 // https://github.com/bitcoin/bitcoin/pull/18551
@@ -103,9 +103,21 @@ private:
     std::string val;                       // numbers are stored as C++ strings
     std::vector<std::string> keys;
     std::vector<UniValue> values;
+    /**
+     * Open-addressed hash index over `keys` (slot holds key index + 1, 0 is
+     * empty). Only maintained for objects with at least KEY_INDEX_MIN_KEYS
+     * keys, so that lookups in large objects do not degrade to a linear scan.
+     * Holds the first occurrence of duplicate keys, like the linear search.
+     */
+    std::vector<uint32_t> keyIndex;
+    static constexpr size_t KEY_INDEX_MIN_KEYS = 16;
 
     void checkType(const VType& expected) const;
     bool findKey(const std::string& key, size_t& retIdx) const;
+    void indexKey(size_t idx);
+    void insertKeyIndex(size_t idx);
+    void rebuildKeyIndex();
+    void writeValue(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
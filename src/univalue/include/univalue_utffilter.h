@@ -45,6 +45,16 @@ public:
                 push_back_u(codepoint);
         }
     }
+    // Write a run of 7-bit ASCII chars
+    void append_ascii(const char* first, const char* last)
+    {
+        if (state == 0) { // Not inside a UTF-8 sequence, pass through as a whole
+            str.append(first, last);
+        } else {
+            for (; first != last; ++first)
+                push_back(static_cast<unsigned char>(*first));
+        }
+    }
     // Write codepoint directly, possibly collating surrogate pairs
     void push_back_u(unsigned int codepoint_)
     {
@@ -5,6 +5,8 @@
 
 #include <univalue.h>
 
+#include <charconv>
+#include <functional>
 #include <iomanip>
 #include <map>
 #include <memory>
@@ -21,6 +23,7 @@ void UniValue::clear()
     val.clear();
     keys.clear();
     values.clear();
+    keyIndex.clear();
 }
 
 void UniValue::setNull()
@@ -55,22 +58,27 @@ void UniValue::setNumStr(std::string str)
     val = std::move(str);
 }
 
-void UniValue::setInt(uint64_t val_)
+template <typename Int>
+static std::string FormatInt(Int val)
 {
-    std::ostringstream oss;
-
-    oss << val_;
+    char buf[24];
+    const auto res = std::to_chars(buf, buf + sizeof(buf), val);
+    return std::string(buf, res.ptr);
+}
 
-    return setNumStr(oss.str());
+void UniValue::setInt(uint64_t val_)
+{
+    // to_chars output is always a valid JSON number, skip validNumStr
+    clear();
+    typ = VNUM;
+    val = FormatInt(val_);
 }
 
 void UniValue::setInt(int64_t val_)
 {
-    std::ostringstream oss;
-
-    oss << val_;
-
-    return setNumStr(oss.str());
+    clear();
+    typ = VNUM;
+    val = FormatInt(val_);
 }
 
 void UniValue::setFloat(double val_)
@@ -121,6 +129,7 @@ void UniValue::__pushKV(std::string key, UniValue val)
 
     keys.push_back(std::move(key));
     values.push_back(std::move(val));
+    indexKey(keys.size() - 1);
 }
 
 void UniValue::pushKV(std::string key, UniValue val)
@@ -153,8 +162,52 @@ void UniValue::getObjMap(std::map<std::string,UniValue>& kv) const
         kv[keys[i]] = values[i];
 }
 
+void UniValue::insertKeyIndex(size_t idx)
+{
+    const size_t mask = keyIndex.size() - 1;
+    size_t pos = std::hash<std::string>{}(keys[idx]) & mask;
+    while (keyIndex[pos] != 0) {
+        // keep the first occurrence of duplicate keys
+        if (keys[keyIndex[pos] - 1] == keys[idx]) return;
+        pos = (pos + 1) & mask;
+    }
+    keyIndex[pos] = idx + 1;
+}
+
+void UniValue::rebuildKeyIndex()
+{
+    size_t cap = 4 * KEY_INDEX_MIN_KEYS;
+    while (cap < 4 * keys.size()) cap *= 2;
+    keyIndex.assign(cap, 0);
+    for (size_t i = 0; i < keys.size(); i++) {
+        insertKeyIndex(i);
+    }
+}
+
+void UniValue::indexKey(size_t idx)
+{
+    if (keys.size() < KEY_INDEX_MIN_KEYS) return;
+    // keep the load factor at or below 1/2
+    if (keyIndex.empty() || 2 * keys.size() > keyIndex.size()) {
+        rebuildKeyIndex();
+    } else {
+        insertKeyIndex(idx);
+    }
+}
+
 bool UniValue::findKey(const std::string& key, size_t& retIdx) const
 {
+    if (!keyIndex.empty()) {
+        const size_t mask = keyIndex.size() - 1;
+        for (size_t pos = std::hash<std::string>{}(key) & mask; keyIndex[pos] != 0; pos = (pos + 1) & mask) {
+            if (keys[keyIndex[pos] - 1] == key) {
+                retIdx = keyIndex[pos] - 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
     for (size_t i = 0; i < keys.size(); i++) {
         if (keys[i] == key) {
             retIdx = i;
@@ -232,9 +285,9 @@ const char *uvTypeName(UniValue::VType t)
 
 const UniValue& find_value(const UniValue& obj, const std::string& name)
 {
-    for (unsigned int i = 0; i < obj.keys.size(); i++)
-        if (obj.keys[i] == name)
-            return obj.values.at(i);
+    size_t index;
+    if (obj.findKey(name, index))
+        return obj.values.at(index);
 
     return NullUniValue;
 }
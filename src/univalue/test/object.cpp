@@ -7,6 +7,7 @@
 
 #include <cassert>
 #include <cstdint>
+#include <limits>
 #include <map>
 #include <memory>
 #include <stdexcept>
@@ -428,6 +429,58 @@ void univalue_readwrite()
     BOOST_CHECK(!v.read("{} 42"));
 }
 
+void univalue_large_object()
+{
+    // Enough keys to exercise the hashed key index, including duplicates
+    UniValue obj(UniValue::VOBJ);
+    for (int i = 0; i < 100; ++i) {
+        obj.__pushKV("key" + std::to_string(i), i);
+    }
+    obj.__pushKV("key7", "dup");
+    BOOST_CHECK_EQUAL(obj.size(), 101);
+    for (int i = 0; i < 100; ++i) {
+        BOOST_CHECK_EQUAL(obj["key" + std::to_string(i)].getInt<int>(), i);
+        BOOST_CHECK_EQUAL(find_value(obj, "key" + std::to_string(i)).getInt<int>(), i);
+    }
+    BOOST_CHECK(obj["key100"].isNull());
+    BOOST_CHECK(!obj.exists("missing"));
+
+    obj.pushKV("key42", "replaced");
+    BOOST_CHECK_EQUAL(obj.size(), 101);
+    BOOST_CHECK_EQUAL(obj["key42"].get_str(), "replaced");
+
+    // Copies and parsed documents keep the index usable
+    UniValue copy = obj;
+    BOOST_CHECK_EQUAL(copy["key99"].getInt<int>(), 99);
+    UniValue parsed;
+    BOOST_CHECK(parsed.read(obj.write()));
+    BOOST_CHECK_EQUAL(parsed["key7"].getInt<int>(), 7);
+    BOOST_CHECK_EQUAL(parsed["key42"].get_str(), "replaced");
+    BOOST_CHECK_EQUAL(parsed.write(), obj.write());
+
+    obj.setObject();
+    BOOST_CHECK(obj["key1"].isNull());
+    obj.pushKV("key1", 1);
+    BOOST_CHECK_EQUAL(obj["key1"].getInt<int>(), 1);
+
+    // Long strings mixing plain runs, escapes and multi-byte characters
+    const std::string str = std::string(37, 'a') + "\"\\\n\t" + std::string(19, 'b') +
+                            "\xc3\xa9" + std::string(8, 'c') + "\x7f" + "\xe2\x82\xac";
+    UniValue v(str);
+    UniValue str_parsed;
+    BOOST_CHECK(str_parsed.read(v.write()));
+    BOOST_CHECK_EQUAL(str_parsed.get_str(), str);
+    BOOST_CHECK(str_parsed.read("\"" + std::string(20, 'x') + "\\u00e9" + std::string(20, 'y') + "\""));
+    BOOST_CHECK_EQUAL(str_parsed.get_str(), std::string(20, 'x') + "\xc3\xa9" + std::string(20, 'y'));
+    BOOST_CHECK(!str_parsed.read("\"" + std::string(20, 'x') + "\x01" + std::string(20, 'y') + "\""));
+    BOOST_CHECK(!str_parsed.read("\"" + std::string(20, 'x') + "\xc3" + std::string(20, 'y') + "\""));
+    BOOST_CHECK(!str_parsed.read("\"" + std::string(20, 'x')));
+
+    // Integer formatting
+    BOOST_CHECK_EQUAL(UniValue{std::numeric_limits<int64_t>::min()}.getValStr(), "-9223372036854775808");
+    BOOST_CHECK_EQUAL(UniValue{std::numeric_limits<uint64_t>::max()}.getValStr(), "18446744073709551615");
+}
+
 int main(int argc, char* argv[])
 {
     univalue_constructor();
@@ -437,5 +490,6 @@ int main(int argc, char* argv[])
     univalue_array();
     univalue_object();
     univalue_readwrite();
+    univalue_large_object();
     return 0;
 }
@@ -9,6 +9,7 @@
 #endif
 
 #include <clientversion.h>
+#include <logging.h>
 #include <tinyformat.h>
 
 #include <cstdio>
@@ -32,6 +33,8 @@ NonFatalCheckError::NonFatalCheckError(std::string_view msg, std::string_view fi
 void assertion_fail(std::string_view file, int line, std::string_view func, std::string_view assertion)
 {
     auto str = strprintf("%s:%s %s: Assertion `%s' failed.\n", file, line, func, assertion);
+    // Write the messages still queued for the background log writer
+    LogInstance().WriteQueued();
     fwrite(str.data(), 1, str.size(), stderr);
     std::abort();
 }
@@ -0,0 +1,217 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/perfstats.h>
+
+#include <crypto/common.h>
+#include <threadsafety.h>
+#include <tinyformat.h>
+#include <util/trace.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <utility>
+
+namespace perf {
+
+std::atomic<bool> g_enabled{false};
+std::atomic<const void*> g_profiled_mutex{nullptr};
+
+namespace {
+
+struct LockSite {
+    Histogram wait;
+    Histogram hold;
+};
+
+struct Registry {
+    StdMutex mutex;
+    std::vector<Timer*> timers GUARDED_BY(mutex);
+    /** Keyed by the __FILE__ literal and line of the call site. */
+    std::map<std::pair<const char*, int>, LockSite> lock_sites GUARDED_BY(mutex);
+};
+
+Registry& GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+/** Strip the directory, keeping the file name of a call site. */
+const char* BaseName(const char* file)
+{
+    const char* slash{std::strrchr(file, '/')};
+    return slash ? slash + 1 : file;
+}
+
+/** Format nanoseconds as seconds without going through the locale. */
+std::string FormatSeconds(int64_t ns)
+{
+    return strprintf("%d.%09d", ns / 1000000000, ns % 1000000000);
+}
+
+void FormatHistogram(std::string& out, const std::string& metric, const std::string& labels, const Histogram::Snapshot& snapshot)
+{
+    uint64_t cumulative{0};
+    for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+        cumulative += snapshot.buckets[i];
+        const std::string le{i + 1 == Histogram::BUCKETS ? "+Inf" : FormatSeconds(Histogram::BucketLimit(i) * 1000)};
+        out += strprintf("%s_bucket{%s,le=\"%s\"} %u\n", metric, labels, le, cumulative);
+    }
+    out += strprintf("%s_sum{%s} %s\n", metric, labels, FormatSeconds(snapshot.total.count()));
+    out += strprintf("%s_count{%s} %u\n", metric, labels, snapshot.count);
+}
+
+} // namespace
+
+void Enable(const void* profiled_mutex)
+{
+    g_profiled_mutex = profiled_mutex;
+    g_enabled = true;
+}
+
+void Disable()
+{
+    g_enabled = false;
+    g_profiled_mutex = nullptr;
+}
+
+void Reset()
+{
+    Registry& registry{GetRegistry()};
+    StdLockGuard lock{registry.mutex};
+    for (Timer* timer : registry.timers) {
+        timer->m_histogram.Reset();
+        timer->m_items = 0;
+    }
+    registry.lock_sites.clear();
+}
+
+void Histogram::Add(std::chrono::nanoseconds duration)
+{
+    const int64_t ns{std::max<int64_t>(duration.count(), 0)};
+    const size_t bucket{std::min<size_t>(CountBits(ns / 1000), BUCKETS - 1)};
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_total_ns.fetch_add(ns, std::memory_order_relaxed);
+    int64_t max{m_max_ns.load(std::memory_order_relaxed)};
+    while (ns > max && !m_max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+}
+
+Histogram::Snapshot Histogram::GetSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.count = m_count.load(std::memory_order_relaxed);
+    snapshot.total = std::chrono::nanoseconds{m_total_ns.load(std::memory_order_relaxed)};
+    snapshot.max = std::chrono::nanoseconds{m_max_ns.load(std::memory_order_relaxed)};
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void Histogram::Reset()
+{
+    m_count = 0;
+    m_total_ns = 0;
+    m_max_ns = 0;
+    for (auto& bucket : m_buckets) bucket = 0;
+}
+
+Timer::Timer(const char* name, const char* description, const char* items_name)
+    : m_name{name}, m_description{description}, m_items_name{items_name}
+{
+    Registry& registry{GetRegistry()};
+    StdLockGuard lock{registry.mutex};
+    registry.timers.push_back(this);
+}
+
+void ScopedTimer::Stop()
+{
+    if (!m_active) return;
+    m_active = false;
+    const std::chrono::nanoseconds duration{std::chrono::steady_clock::now() - m_start};
+    m_timer.m_histogram.Add(duration);
+    if (m_items) m_timer.m_items.fetch_add(m_items, std::memory_order_relaxed);
+    TRACE3(perf, timer, m_timer.m_name, duration.count(), m_items);
+}
+
+void RecordLock(const char* file, int line, std::chrono::nanoseconds wait, std::chrono::nanoseconds hold)
+{
+    TRACE4(perf, lock, file, line, wait.count(), hold.count());
+    Registry& registry{GetRegistry()};
+    StdLockGuard lock{registry.mutex};
+    LockSite& site{registry.lock_sites[{file, line}]};
+    site.wait.Add(wait);
+    site.hold.Add(hold);
+}
+
+std::vector<TimerStats> GetTimerStats()
+{
+    Registry& registry{GetRegistry()};
+    StdLockGuard lock{registry.mutex};
+    std::vector<TimerStats> result;
+    result.reserve(registry.timers.size());
+    for (const Timer* timer : registry.timers) {
+        TimerStats stats;
+        stats.name = timer->m_name;
+        stats.description = timer->m_description;
+        if (timer->m_items_name) stats.items_name = timer->m_items_name;
+        stats.items = timer->m_items.load(std::memory_order_relaxed);
+        stats.histogram = timer->m_histogram.GetSnapshot();
+        result.push_back(std::move(stats));
+    }
+    std::sort(result.begin(), result.end(), [](const TimerStats& a, const TimerStats& b) { return a.name < b.name; });
+    return result;
+}
+
+std::vector<LockSiteStats> GetLockSiteStats()
+{
+    Registry& registry{GetRegistry()};
+    StdLockGuard lock{registry.mutex};
+    std::vector<LockSiteStats> result;
+    result.reserve(registry.lock_sites.size());
+    for (const auto& [key, site] : registry.lock_sites) {
+        LockSiteStats stats;
+        stats.site = strprintf("%s:%d", BaseName(key.first), key.second);
+        stats.wait = site.wait.GetSnapshot();
+        stats.hold = site.hold.GetSnapshot();
+        result.push_back(std::move(stats));
+    }
+    std::sort(result.begin(), result.end(), [](const LockSiteStats& a, const LockSiteStats& b) { return a.hold.total > b.hold.total; });
+    return result;
+}
+
+std::string FormatPrometheus()
+{
+    std::string out;
+    const std::vector<TimerStats> timers{GetTimerStats()};
+    out += "# HELP peercoin_perf_duration_seconds Time spent in instrumented code paths.\n";
+    out += "# TYPE peercoin_perf_duration_seconds histogram\n";
+    for (const TimerStats& timer : timers) {
+        FormatHistogram(out, "peercoin_perf_duration_seconds", strprintf("timer=\"%s\"", timer.name), timer.histogram);
+    }
+    out += "# HELP peercoin_perf_items_total Work items processed in instrumented code paths.\n";
+    out += "# TYPE peercoin_perf_items_total counter\n";
+    for (const TimerStats& timer : timers) {
+        if (timer.items_name.empty()) continue;
+        out += strprintf("peercoin_perf_items_total{timer=\"%s\",item=\"%s\"} %u\n", timer.name, timer.items_name, timer.items);
+    }
+
+    const std::vector<LockSiteStats> sites{GetLockSiteStats()};
+    out += "# HELP peercoin_lock_wait_seconds Time spent waiting for cs_main, per call site.\n";
+    out += "# TYPE peercoin_lock_wait_seconds histogram\n";
+    for (const LockSiteStats& site : sites) {
+        FormatHistogram(out, "peercoin_lock_wait_seconds", strprintf("site=\"%s\"", site.site), site.wait);
+    }
+    out += "# HELP peercoin_lock_hold_seconds Time cs_main was held, per call site.\n";
+    out += "# TYPE peercoin_lock_hold_seconds histogram\n";
+    for (const LockSiteStats& site : sites) {
+        FormatHistogram(out, "peercoin_lock_hold_seconds", strprintf("site=\"%s\"", site.site), site.hold);
+    }
+    return out;
+}
+
+} // namespace perf
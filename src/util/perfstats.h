@@ -0,0 +1,143 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_PERFSTATS_H
+#define BITCOIN_UTIL_PERFSTATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Low overhead timers for hot paths (validation, the PoS kernel, minting).
+ *
+ * Timers are declared with static storage next to the code they measure and
+ * are only active with -perfstats: when disabled a ScopedTimer costs one
+ * relaxed atomic load. Results are reported by the getperfstats RPC, the
+ * /rest/metrics endpoint and the perf:timer tracepoint.
+ */
+namespace perf {
+
+static constexpr bool DEFAULT_PERFSTATS{false};
+
+extern std::atomic<bool> g_enabled;
+/** The mutex whose wait and hold times are recorded per call site (cs_main). */
+extern std::atomic<const void*> g_profiled_mutex;
+
+inline bool Enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+/** Start recording timers, and lock timings of profiled_mutex if given. */
+void Enable(const void* profiled_mutex = nullptr);
+void Disable();
+/** Clear all recorded values. */
+void Reset();
+
+/** Latency histogram with power-of-two microsecond buckets. */
+class Histogram
+{
+public:
+    /** Bucket i counts durations below 2^i us; the last one is unbounded. */
+    static constexpr size_t BUCKETS{24};
+
+    struct Snapshot {
+        uint64_t count{0};
+        std::chrono::nanoseconds total{0};
+        std::chrono::nanoseconds max{0};
+        std::array<uint64_t, BUCKETS> buckets{};
+    };
+
+    void Add(std::chrono::nanoseconds duration);
+    Snapshot GetSnapshot() const;
+    void Reset();
+
+    /** Upper bound of a bucket, in microseconds. */
+    static constexpr int64_t BucketLimit(size_t bucket) { return int64_t{1} << bucket; }
+
+private:
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<int64_t> m_total_ns{0};
+    std::atomic<int64_t> m_max_ns{0};
+    std::array<std::atomic<uint64_t>, BUCKETS> m_buckets{};
+};
+
+/** A named timer. Instances must have static storage duration. */
+class Timer
+{
+public:
+    Timer(const char* name, const char* description, const char* items_name = nullptr);
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    const char* const m_name;
+    const char* const m_description;
+    /** What the item counter counts, or nullptr if unused. */
+    const char* const m_items_name;
+
+    Histogram m_histogram;
+    std::atomic<uint64_t> m_items{0};
+};
+
+/** Time the enclosing scope, or until Stop(), and record it in a Timer. */
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Timer& timer)
+        : m_timer{timer}, m_active{Enabled()}
+    {
+        if (m_active) m_start = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() { Stop(); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    /** Count work items done inside the timed scope. */
+    void AddItems(uint64_t n = 1)
+    {
+        if (m_active) m_items += n;
+    }
+    void Stop();
+
+private:
+    Timer& m_timer;
+    bool m_active;
+    uint64_t m_items{0};
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/** Whether lock timings of this mutex should be recorded. */
+inline bool IsProfiledMutex(const void* cs)
+{
+    return Enabled() && g_profiled_mutex.load(std::memory_order_relaxed) == cs;
+}
+
+/** Record how long a call site waited for and then held the profiled mutex. */
+void RecordLock(const char* file, int line, std::chrono::nanoseconds wait, std::chrono::nanoseconds hold);
+
+struct TimerStats {
+    std::string name;
+    std::string description;
+    std::string items_name;
+    uint64_t items{0};
+    Histogram::Snapshot histogram;
+};
+
+struct LockSiteStats {
+    std::string site;
+    Histogram::Snapshot wait;
+    Histogram::Snapshot hold;
+};
+
+std::vector<TimerStats> GetTimerStats();
+/** Lock call sites, sorted by total hold time, longest first. */
+std::vector<LockSiteStats> GetLockSiteStats();
+
+/** All statistics in the Prometheus text exposition format. */
+std::string FormatPrometheus();
+
+} // namespace perf
+
+#endif // BITCOIN_UTIL_PERFSTATS_H
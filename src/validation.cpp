@@ -35,6 +35,7 @@
 #include <pow.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <pubkey.h>
 #include <random.h>
 #include <reverse_iterator.h>
 #include <script/script.h>
@@ -51,6 +52,7 @@
 #include <util/fs_helpers.h>
 #include <util/hasher.h>
 #include <util/moneystr.h>
+#include <util/perfstats.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <util/time.h>
@@ -85,7 +87,9 @@ using node::CBlockIndexHeightOnlyComparator;
 using node::CBlockIndexWorkComparator;
 using node::fReindex;
 using node::ReadBlockFromDisk;
+using node::SnapshotKernelTx;
 using node::SnapshotMetadata;
+using node::SnapshotStakeBlock;
 using node::UndoReadFromDisk;
 using node::fReindex;
 
@@ -1396,7 +1400,7 @@ int64_t GetProofOfWorkReward(unsigned int nBits, uint32_t nTime)
     while (bnLowerBound + CENT <= bnUpperBound)
     {
         CBigNum bnMidValue = (bnLowerBound + bnUpperBound) / 2;
-        if (gArgs.GetBoolArg("-printcreation", false))
+        if (g_print_creation)
             LogPrintf("%s: lower=%lld upper=%lld mid=%lld\n", __func__, bnLowerBound.getuint64(), bnUpperBound.getuint64(), bnMidValue.getuint64());
         if (bnMidValue * bnMidValue * bnMidValue * bnMidValue * bnTargetLimit > bnSubsidyLimit * bnSubsidyLimit * bnSubsidyLimit * bnSubsidyLimit * bnTarget)
             bnUpperBound = bnMidValue;
@@ -1409,7 +1413,7 @@ int64_t GetProofOfWorkReward(unsigned int nBits, uint32_t nTime)
 
     nSubsidy = std::min(nSubsidy, IsProtocolV10(nTime) ? MAX_MINT_PROOF_OF_WORK_V10 : MAX_MINT_PROOF_OF_WORK);
 
-    if (gArgs.GetBoolArg("-printcreation", false))
+    if (g_print_creation)
         LogPrintf("%s: create=%s nBits=0x%08x nSubsidy=%lld\n", __func__, FormatMoney(nSubsidy), nBits, nSubsidy);
 
     return nSubsidy;
@@ -1433,13 +1437,13 @@ int64_t GetProofOfStakeReward(int64_t nCoinAge, uint32_t nTime, uint64_t nMoneyS
         uint64_t nInflationAdjustment = bnInflationAdjustment.getuint64();
         uint64_t nSubsidyNew = (nSubsidy * 3) + nInflationAdjustment;
 
-        if (gArgs.GetBoolArg("-printcreation", false))
+        if (g_print_creation)
             LogPrintf("%s: money supply %ld, inflation adjustment %f, old subsidy %ld, new subsidy %ld\n", __func__, nMoneySupply, nInflationAdjustment/1000000.0, nSubsidy, nSubsidyNew);
 
         nSubsidy = nSubsidyNew;
         }
 
-    if (gArgs.GetBoolArg("-printcreation", false))
+    if (g_print_creation)
         LogPrintf("%s: create=%s nCoinAge=%lld\n", __func__, FormatMoney(nSubsidy), nCoinAge);
     return nSubsidy;
 }
@@ -1616,24 +1620,56 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
     AddCoins(inputs, tx, nHeight, false, skipZeroValue);
 }
 
-bool CScriptCheck::operator()() {
+bool CScriptCheck::operator()(SchnorrSigBatch* batch) {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
-    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
+    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata, batch), &error);
+}
+
+bool RunChecks(std::vector<CScriptCheck>& checks)
+{
+    SchnorrSigBatch batch;
+    for (CScriptCheck& check : checks) {
+        if (!check(&batch)) return false;
+    }
+    if (batch.Verify()) return true;
+
+    for (CScriptCheck& check : checks) {
+        if (!check()) return false;
+    }
+    return true;
 }
 
 static CuckooCache::cache<uint256, SignatureCacheHasher> g_scriptExecutionCache;
+static uint256 g_scriptExecutionCacheNonce;
 static CSHA256 g_scriptExecutionCacheHasher;
+//! Whether g_scriptExecutionCache holds entries loaded from disk that were not
+//! yet matched against the loaded mempool
+static bool g_script_execution_cache_loaded GUARDED_BY(cs_main){false};
 
-bool InitScriptExecutionCache(size_t max_size_bytes)
+static void SetScriptExecutionCacheNonce(const uint256& nonce)
 {
-    // Setup the salted hasher
-    uint256 nonce = GetRandHash();
     // We want the nonce to be 64 bytes long to force the hasher to process
     // this chunk, which makes later hash computations more efficient. We
     // just write our 32-byte entropy twice to fill the 64 bytes.
+    g_scriptExecutionCacheNonce = nonce;
+    g_scriptExecutionCacheHasher = CSHA256{};
     g_scriptExecutionCacheHasher.Write(nonce.begin(), 32);
     g_scriptExecutionCacheHasher.Write(nonce.begin(), 32);
+}
+
+static uint256 ScriptExecutionCacheEntry(const CTransaction& tx, unsigned int flags)
+{
+    uint256 entry;
+    CSHA256 hasher = g_scriptExecutionCacheHasher;
+    hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(entry.begin());
+    return entry;
+}
+
+bool InitScriptExecutionCache(size_t max_size_bytes)
+{
+    // Setup the salted hasher
+    SetScriptExecutionCacheNonce(GetRandHash());
 
     auto setup_results = g_scriptExecutionCache.setup_bytes(max_size_bytes);
     if (!setup_results) return false;
@@ -1644,6 +1680,46 @@ bool InitScriptExecutionCache(size_t max_size_bytes)
     return true;
 }
 
+std::vector<uint256> DumpScriptExecutionCache(uint256& nonce)
+{
+    AssertLockHeld(cs_main);
+    nonce = g_scriptExecutionCacheNonce;
+    return g_scriptExecutionCache.elements();
+}
+
+void LoadScriptExecutionCache(const uint256& nonce, const std::vector<uint256>& entries)
+{
+    AssertLockHeld(cs_main);
+    SetScriptExecutionCacheNonce(nonce);
+    for (const uint256& entry : entries) {
+        g_scriptExecutionCache.insert(entry);
+    }
+    g_script_execution_cache_loaded = true;
+}
+
+/** peercoin: Once the mempool is loaded, let the script execution cache evict
+ *  the entries loaded from disk that do not match a transaction in it under the
+ *  current flags first. Those were for transactions that were mined, expired
+ *  or conflicted in the meantime, or checked under other flags. */
+static void MatchScriptExecutionCacheToMempool(const CTxMemPool& pool, unsigned int flags) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::vector<uint256> expected;
+    for (const TxMempoolInfo& info : pool.infoAll()) {
+        expected.push_back(ScriptExecutionCacheEntry(*info.tx, flags));
+    }
+    std::sort(expected.begin(), expected.end());
+
+    const std::vector<uint256> entries{g_scriptExecutionCache.elements()};
+    size_t stale{0};
+    for (const uint256& entry : entries) {
+        if (!std::binary_search(expected.begin(), expected.end(), entry)) {
+            g_scriptExecutionCache.contains(entry, /*erase=*/true);
+            ++stale;
+        }
+    }
+    LogPrintf("Matched script execution cache to mempool: %u of %u entries are not for a mempool transaction\n", stale, entries.size());
+}
+
 /**
  * Check whether all of this transaction's input scripts succeed.
  *
@@ -1679,9 +1755,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
     // correct (ie that the transaction hash which is in tx's prevouts
     // properly commits to the scriptPubKey in the inputs view of that
     // transaction).
-    uint256 hashCacheEntry;
-    CSHA256 hasher = g_scriptExecutionCacheHasher;
-    hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+    uint256 hashCacheEntry{ScriptExecutionCacheEntry(tx, flags)};
     AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
     if (g_scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
         return true;
@@ -1922,18 +1996,29 @@ static SteadyClock::duration time_index{};
 static SteadyClock::duration time_total{};
 static int64_t num_blocks_total = 0;
 
+static perf::Timer g_perf_connect_block{"connect_block", "Chainstate::ConnectBlock", "transactions"};
+static perf::Timer g_perf_flush_state{"flush_state_to_disk", "Chainstate::FlushStateToDisk, including calls that do not write"};
+static perf::Timer g_perf_activate_best_chain_step{"activate_best_chain_step", "Chainstate::ActivateBestChainStep", "blocks_connected"};
+
 // These checks can only be done when all previous block have been added.
 bool PeercoinContextualBlockChecks(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex, bool fJustCheck, Chainstate& chainstate)
 {
+    AssertLockHeld(cs_main);
     uint256 hashProofOfStake = uint256();
-    // peercoin: verify hash target and signature of coinstake tx
-    if (block.IsProofOfStake() && !CheckProofOfStake(state, pindex->pprev, block.vtx[1], block.nBits, hashProofOfStake, block.vtx[1]->nTime ? block.vtx[1]->nTime : block.nTime, chainstate)) {
+    // peercoin: verify hash target and signature of coinstake tx, below the
+    // assumevalid block only the kernel hash the stake modifiers depend on
+    const bool fAssumeValid{block.IsProofOfStake() && chainstate.m_chainman.IsAssumedValid(*pindex)};
+    if (block.IsProofOfStake() && !CheckProofOfStake(state, pindex->pprev, block.vtx[1], block.nBits, hashProofOfStake, block.vtx[1]->nTime ? block.vtx[1]->nTime : block.nTime, chainstate, fAssumeValid)) {
         LogPrintf("WARNING: %s: check proof-of-stake failed for block %s\n", __func__, block.GetHash().ToString());
         return false; // do not error here as we expect this during initial block download
     }
 
+    // peercoin: the stake state of a block loaded from a UTXO snapshot is
+    // compared with the recomputed one below instead
+    const bool fSnapshotStake{(pindex->nStatus & BLOCK_SNAPSHOT_STAKE) != 0};
+
     // peercoin: check for duplicity of stake
-    if (block.IsProofOfStake()) {
+    if (block.IsProofOfStake() && !fSnapshotStake) {
         std::pair<COutPoint, unsigned int> proofOfStake = block.GetProofOfStake();
         if (pindex->IsProofOfStake() && proofOfStake.first == pindex->prevoutStake) {
             LogPrintf("WARNING: %s: duplicate proof-of-stake in block %s, invalidating tip\n", __func__, block.GetHash().ToString());
@@ -1954,6 +2039,17 @@ bool PeercoinContextualBlockChecks(const CBlock& block, BlockValidationState& st
     if (!ComputeNextStakeModifier(pindex, nStakeModifier, fGeneratedStakeModifier, chainstate))
         return error("ConnectBlock() : ComputeNextStakeModifier() failed");
 
+    if (fSnapshotStake && (pindex->GetStakeEntropyBit() != nEntropyBit ||
+                           pindex->nStakeModifier != nStakeModifier ||
+                           pindex->GeneratedStakeModifier() != fGeneratedStakeModifier ||
+                           pindex->hashProofOfStake != hashProofOfStake ||
+                           (block.IsProofOfStake() && (pindex->prevoutStake != block.vtx[1]->vin[0].prevout ||
+                                                       pindex->nStakeTime != block.vtx[1]->nTime)))) {
+        LogPrintf("[snapshot] stake state of block %s does not match the snapshot\n", block.GetHash().ToString());
+        chainstate.m_chainman.InvalidSnapshotFound();
+        return state.Error("snapshot-stake-mismatch");
+    }
+
     // compute nStakeModifierChecksum begin
     unsigned int nFlagsBackup      = pindex->nFlags;
     uint64_t nStakeModifierBackup  = pindex->nStakeModifier;
@@ -1973,7 +2069,11 @@ bool PeercoinContextualBlockChecks(const CBlock& block, BlockValidationState& st
     pindex->hashProofOfStake = hashProofOfStakeBackup;
     // compute nStakeModifierChecksum end
 
-    if (!CheckStakeModifierCheckpoints(pindex->nHeight, nStakeModifierChecksum))
+    // peercoin: the checksums after a UTXO snapshot chain from the stake state
+    // it carries, not from the checksums of the earlier blocks
+    const CBlockIndex* pindexSnapshot{chainstate.m_chainman.GetSnapshotBaseBlock()};
+    const bool fAfterSnapshot{pindexSnapshot && pindex->nHeight > pindexSnapshot->nHeight};
+    if (!fAfterSnapshot && !CheckStakeModifierCheckpoints(pindex->nHeight, nStakeModifierChecksum))
         return error("ConnectBlock() : Rejected by stake modifier checkpoint height=%d, modifier=0x%016llx", pindex->nHeight, nStakeModifier);
 
     if (fJustCheck)
@@ -2004,6 +2104,8 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
 {
     AssertLockHeld(cs_main);
     assert(pindex);
+    perf::ScopedTimer perf_timer{g_perf_connect_block};
+    perf_timer.AddItems(block.vtx.size());
 
     uint256 block_hash{block.GetHash()};
     assert(*pindex->phashBlock == block_hash);
@@ -2052,36 +2154,9 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         return true;
     }
 
-    bool fScriptChecks = true;
-    if (!m_chainman.AssumedValidBlock().IsNull()) {
-        // We've been configured with the hash of a block which has been externally verified to have a valid history.
-        // A suitable default value is included with the software and updated from time to time.  Because validity
-        //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
-        // This setting doesn't force the selection of any particular chain but makes validating some faster by
-        //  effectively caching the result of part of the verification.
-        BlockMap::const_iterator it{m_blockman.m_block_index.find(m_chainman.AssumedValidBlock())};
-        if (it != m_blockman.m_block_index.end()) {
-            if (it->second.GetAncestor(pindex->nHeight) == pindex &&
-                m_chainman.m_best_header->GetAncestor(pindex->nHeight) == pindex &&
-                m_chainman.m_best_header->nChainTrust >= m_chainman.MinimumChainWork()) {
-                // This block is a member of the assumed verified chain and an ancestor of the best header.
-                // Script verification is skipped when connecting blocks under the
-                // assumevalid block. Assuming the assumevalid block is valid this
-                // is safe because block merkle hashes are still computed and checked,
-                // Of course, if an assumed valid block is invalid due to false scriptSigs
-                // this optimization would allow an invalid chain to be accepted.
-                // The equivalent time check discourages hash power from extorting the network via DOS attack
-                //  into accepting an invalid block through telling users they must manually set assumevalid.
-                //  Requiring a software change or burying the invalid block, regardless of the setting, makes
-                //  it hard to hide the implication of the demand.  This also avoids having release candidates
-                //  that are hardly doing any signature verification at all in testing without having to
-                //  artificially set the default assumed verified block further back.
-                // The test against the minimum chain work prevents the skipping when denied access to any chain at
-                //  least as good as the expected chain.
-                fScriptChecks = (GetBlockProofEquivalentTime(*m_chainman.m_best_header, *pindex, *m_chainman.m_best_header, params.GetConsensus()) <= 60 * 60 * 24 * 7 * 2);
-            }
-        }
-    }
+    // Script verification is skipped when connecting blocks under the
+    // assumevalid block, see IsAssumedValidBlock()
+    const bool fScriptChecks{!m_chainman.IsAssumedValid(*pindex)};
 
     const auto time_1{SteadyClock::now()};
     time_check += time_1 - time_start;
@@ -2222,15 +2297,28 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         return true;
 
     // peercoin: track money supply and mint amount info
-    pindex->nMint = nValueOut - nValueIn + nFees;
-    pindex->nMoneySupply = (pindex->pprev? pindex->pprev->nMoneySupply : 0) + nValueOut - nValueIn;
+    const int64_t nMint{nValueOut - nValueIn + nFees};
+    const int64_t nMoneySupply{(pindex->pprev? pindex->pprev->nMoneySupply : 0) + nValueOut - nValueIn};
+    if (pindex->nStatus & BLOCK_SNAPSHOT_STAKE) {
+        // peercoin: the background validation confirms the mint and money
+        // supply loaded from the UTXO snapshot
+        if (pindex->nMint != nMint || pindex->nMoneySupply != nMoneySupply) {
+            LogPrintf("[snapshot] money supply of block %s does not match the snapshot\n", block_hash.ToString());
+            m_chainman.InvalidSnapshotFound();
+            return state.Error("snapshot-money-supply-mismatch");
+        }
+        pindex->nStatus &= ~BLOCK_SNAPSHOT_STAKE;
+        m_blockman.m_dirty_blockindex.insert(pindex);
+    }
+    pindex->nMint = nMint;
+    pindex->nMoneySupply = nMoneySupply;
 
     // peercoin increment nHeightStake if block is proof of stake
     pindex->nHeightStake = (pindex->pprev ? pindex->pprev->nHeightStake : 0) + block.IsProofOfStake();
 
     // peercoin: fees are not collected by miners as in bitcoin
     // peercoin: fees are destroyed to compensate the entire network
-    if (gArgs.GetBoolArg("-printcreation", false))
+    if (g_print_creation)
         LogPrintf("%s: destroy=%s nFees=%lld\n", __func__, FormatMoney(nFees), nFees);
 
     if (!m_blockman.WriteUndoDataForBlock(blockundo, state, pindex, params)) {
@@ -2308,6 +2396,7 @@ bool Chainstate::FlushStateToDisk(
     int nManualPruneHeight)
 {
     LOCK(cs_main);
+    perf::ScopedTimer perf_timer{g_perf_flush_state};
     assert(this->CanFlushToDisk());
     bool full_flush_completed = false;
 
@@ -2387,7 +2476,7 @@ bool Chainstate::FlushStateToDisk(
                    (u_int64_t)coins_mem_usage);
         }
     }
-    if (full_flush_completed) {
+    if (full_flush_completed && this == &m_chainman.ActiveChainstate()) {
         // Update best block in wallet (so we can detect restored wallets).
         GetMainSignals().ChainStateFlushed(m_chain.GetLocator());
     }
@@ -2443,6 +2532,91 @@ static void UpdateTipLog(
         !warning_messages.empty() ? strprintf(" warning='%s'", warning_messages) : "");
 }
 
+/** Advance the per-kind difficulties and the proof-of-work spacing average used for network hash rate estimates by one block. */
+static void UpdateBlockKindFields(ChainTipSnapshot& snapshot, const CBlockIndex& block)
+{
+    constexpr int64_t TARGET_SPACING_WORK_MIN{30};
+    constexpr int64_t INTERVAL{72};
+    if (block.IsProofOfStake()) {
+        snapshot.pos_bits = block.nBits;
+        return;
+    }
+    snapshot.pow_bits = block.nBits;
+    const int64_t actual_spacing{block.GetBlockTime() - snapshot.last_pow_time};
+    snapshot.pow_target_spacing = std::max(((INTERVAL - 1) * snapshot.pow_target_spacing + actual_spacing + actual_spacing) / (INTERVAL + 1),
+                                           TARGET_SPACING_WORK_MIN);
+    snapshot.last_pow_time = block.GetBlockTime();
+}
+
+void ChainstateManager::UpdateTipSnapshot()
+{
+    AssertLockHeld(::cs_main);
+    if (!m_active_chainstate) return;
+    const auto prev{GetTipSnapshot()};
+    const CBlockIndex* tip{m_active_chainstate->m_chain.Tip()};
+    const int header_height{m_best_header ? m_best_header->nHeight : -1};
+    if (prev && prev->tip == tip && prev->header_height == header_height) return;
+
+    auto snapshot{std::make_shared<ChainTipSnapshot>()};
+    if (prev && prev->tip == tip) {
+        // only the best header moved
+        *snapshot = *prev;
+    } else if (tip) {
+        snapshot->tip = tip;
+        snapshot->height = tip->nHeight;
+        snapshot->hash = tip->GetBlockHash();
+        snapshot->time = tip->GetBlockTime();
+        snapshot->median_time = tip->GetMedianTimePast();
+        snapshot->chain_trust = tip->nChainTrust;
+        snapshot->bits = tip->nBits;
+        snapshot->money_supply = tip->nMoneySupply;
+
+        const auto add_checkpoint = [&](const CBlockIndex& block) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+            if (block.nHeight % TIP_CHECKPOINT_INTERVAL != 0) return;
+            if (!m_tip_checkpoints.empty() && m_tip_checkpoints.back().block->nHeight >= block.nHeight) return;
+            m_tip_checkpoints.push_back({&block, snapshot->pow_bits, snapshot->pos_bits, snapshot->pow_target_spacing, snapshot->last_pow_time});
+        };
+        if (prev && prev->tip && tip->pprev == prev->tip) {
+            // Common case, the tip was extended by one block: derive the
+            // per-kind difficulties and the spacing average incrementally.
+            snapshot->pow_bits = prev->pow_bits;
+            snapshot->pos_bits = prev->pos_bits;
+            snapshot->pow_target_spacing = prev->pow_target_spacing;
+            snapshot->last_pow_time = prev->last_pow_time;
+            UpdateBlockKindFields(*snapshot, *tip);
+            add_checkpoint(*tip);
+        } else {
+            // Reorg, invalidation or chainstate switch: resume from the last
+            // checkpoint that is still on the active chain.
+            while (!m_tip_checkpoints.empty() && tip->GetAncestor(m_tip_checkpoints.back().block->nHeight) != m_tip_checkpoints.back().block) {
+                m_tip_checkpoints.pop_back();
+            }
+            const CChain& chain{m_active_chainstate->m_chain};
+            const CBlockIndex* pindex;
+            if (m_tip_checkpoints.empty()) {
+                snapshot->pow_bits = chain.Genesis()->nBits;
+                snapshot->pos_bits = chain.Genesis()->nBits;
+                snapshot->last_pow_time = chain.Genesis()->GetBlockTime();
+                snapshot->pow_target_spacing = 30;
+                pindex = chain.Genesis();
+            } else {
+                const TipCheckpoint& checkpoint{m_tip_checkpoints.back()};
+                snapshot->pow_bits = checkpoint.pow_bits;
+                snapshot->pos_bits = checkpoint.pos_bits;
+                snapshot->pow_target_spacing = checkpoint.pow_target_spacing;
+                snapshot->last_pow_time = checkpoint.last_pow_time;
+                pindex = chain.Next(checkpoint.block);
+            }
+            for (; pindex; pindex = chain.Next(pindex)) {
+                UpdateBlockKindFields(*snapshot, *pindex);
+                add_checkpoint(*pindex);
+            }
+        }
+    }
+    snapshot->header_height = header_height;
+    std::atomic_store_explicit(&m_tip_snapshot, std::shared_ptr<const ChainTipSnapshot>{std::move(snapshot)}, std::memory_order_release);
+}
+
 void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
 {
     AssertLockHeld(::cs_main);
@@ -2471,6 +2645,7 @@ void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
         g_best_block = pindexNew->GetBlockHash();
         g_best_block_cv.notify_all();
     }
+    m_chainman.UpdateTipSnapshot();
 
     bilingual_str warning_messages;
     if (!this->IsInitialBlockDownload()) {
@@ -2781,6 +2956,22 @@ CBlockIndex* Chainstate::FindMostWorkChain()
     } while(true);
 }
 
+void Chainstate::TryAddBlockIndexCandidate(CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (m_chain.Tip() != nullptr && setBlockIndexCandidates.value_comp()(pindex, m_chain.Tip())) {
+        return;
+    }
+    if (this == &m_chainman.ActiveChainstate()) {
+        setBlockIndexCandidates.insert(pindex);
+    } else if (!m_disabled) {
+        const CBlockIndex* snapshot_base{Assert(m_chainman.GetSnapshotBaseBlock())};
+        if (snapshot_base->GetAncestor(pindex->nHeight) == pindex) {
+            setBlockIndexCandidates.insert(pindex);
+        }
+    }
+}
+
 /** Delete all entries in setBlockIndexCandidates that are worse than the current tip. */
 void Chainstate::PruneBlockIndexCandidates() {
     // Note that we can't delete the current block itself, as we may need to return to it later in case a
@@ -2803,6 +2994,7 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
 {
     AssertLockHeld(cs_main);
     if (m_mempool) AssertLockHeld(m_mempool->cs);
+    perf::ScopedTimer perf_timer{g_perf_activate_best_chain_step};
 
     const CBlockIndex* pindexOldTip = m_chain.Tip();
     const CBlockIndex* pindexFork = m_chain.FindFork(pindexMostWork);
@@ -2862,6 +3054,7 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
                     return false;
                 }
             } else {
+                perf_timer.AddItems();
                 PruneBlockIndexCandidates();
                 if (!pindexOldTip || m_chain.Tip()->nChainTrust > pindexOldTip->nChainTrust) {
                     // We're in a better position than we were. Return temporarily to release the lock.
@@ -2916,9 +3109,7 @@ static bool NotifyHeaderTip(Chainstate& chainstate) LOCKS_EXCLUDED(cs_main) {
 static void LimitValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main) {
     AssertLockNotHeld(cs_main);
 
-    if (GetMainSignals().CallbacksPending() > 10) {
-        SyncWithValidationInterfaceQueue();
-    }
+    GetMainSignals().LimitBacklog();
 }
 
 bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<const CBlock> pblock)
@@ -2991,9 +3182,16 @@ bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<
                 }
                 pindexNewTip = m_chain.Tip();
 
+                // peercoin: the background validation chainstate only notifies
+                // the listeners filling in the blocks of a UTXO snapshot
+                const bool is_active{this == &m_chainman.ActiveChainstate()};
                 for (const PerBlockConnectTrace& trace : connectTrace.GetBlocksConnected()) {
                     assert(trace.pblock && trace.pindex);
-                    GetMainSignals().BlockConnected(trace.pblock, trace.pindex);
+                    if (is_active) {
+                        GetMainSignals().BlockConnected(trace.pblock, trace.pindex);
+                    } else {
+                        GetMainSignals().BackgroundBlockConnected(trace.pblock, trace.pindex);
+                    }
                 }
 
                 // This will have been toggled in
@@ -3012,7 +3210,7 @@ bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<
 
             // Notify external listeners about the new tip.
             // Enqueue while holding cs_main to ensure that UpdatedBlockTip is called in the order in which blocks are connected
-            if (pindexFork != pindexNewTip) {
+            if (pindexFork != pindexNewTip && this == &m_chainman.ActiveChainstate()) {
                 // Notify ValidationInterface subscribers
                 GetMainSignals().UpdatedBlockTip(pindexNewTip, pindexFork, fInitialDownload);
 
@@ -3278,8 +3476,8 @@ void Chainstate::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pin
             queue.pop_front();
             pindex->nChainTx = (pindex->pprev ? pindex->pprev->nChainTx : 0) + pindex->nTx;
             pindex->nSequenceId = nBlockSequenceId++;
-            if (m_chain.Tip() == nullptr || !setBlockIndexCandidates.value_comp()(pindex, m_chain.Tip())) {
-                setBlockIndexCandidates.insert(pindex);
+            for (Chainstate* chainstate : m_chainman.GetAll()) {
+                chainstate->TryAddBlockIndexCandidate(pindex);
             }
             std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = m_blockman.m_blocks_unlinked.equal_range(pindex);
             while (range.first != range.second) {
@@ -3538,6 +3736,43 @@ bool IsBlockMutated(const CBlock& block, bool check_witness_root)
     return false;
 }
 
+bool IsAssumedValidBlock(const CBlockIndex& index, const CBlockIndex* assumed_valid, const CBlockIndex& best_header, const arith_uint256& minimum_chain_work, const Consensus::Params& params)
+{
+    // We've been configured with the hash of a block which has been externally verified to have a valid history.
+    // A suitable default value is included with the software and updated from time to time.  Because validity
+    //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
+    // This setting doesn't force the selection of any particular chain but makes validating some faster by
+    //  effectively caching the result of part of the verification.
+    if (!assumed_valid) return false;
+    if (assumed_valid->GetAncestor(index.nHeight) != &index ||
+        best_header.GetAncestor(index.nHeight) != &index ||
+        best_header.nChainTrust < minimum_chain_work) {
+        return false;
+    }
+    // This block is a member of the assumed verified chain and an ancestor of the best header.
+    // Assuming the assumevalid block is valid skipping the checks is safe because block merkle
+    // hashes are still computed and checked, and the stake modifiers and their checkpoints are
+    // still computed and verified.
+    // Of course, if an assumed valid block is invalid due to false scriptSigs
+    // this optimization would allow an invalid chain to be accepted.
+    // The equivalent time check discourages hash power from extorting the network via DOS attack
+    //  into accepting an invalid block through telling users they must manually set assumevalid.
+    //  Requiring a software change or burying the invalid block, regardless of the setting, makes
+    //  it hard to hide the implication of the demand.  This also avoids having release candidates
+    //  that are hardly doing any signature verification at all in testing without having to
+    //  artificially set the default assumed verified block further back.
+    // The test against the minimum chain work prevents the skipping when denied access to any chain at
+    //  least as good as the expected chain.
+    return GetBlockProofEquivalentTime(best_header, index, best_header, params) > 60 * 60 * 24 * 7 * 2;
+}
+
+bool ChainstateManager::IsAssumedValid(const CBlockIndex& index) const
+{
+    AssertLockHeld(::cs_main);
+    if (AssumedValidBlock().IsNull() || !m_best_header) return false;
+    return IsAssumedValidBlock(index, m_blockman.LookupBlockIndex(AssumedValidBlock()), *m_best_header, MinimumChainWork(), GetConsensus());
+}
+
 arith_uint256 CalculateHeadersWork(const std::vector<CBlockHeader>& headers)
 {
     arith_uint256 total_work{0};
@@ -3749,6 +3984,7 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
         return state.Invalid(BlockValidationResult::BLOCK_HEADER_LOW_WORK, "too-little-chainwork");
     }
     CBlockIndex* pindex{m_blockman.AddToBlockIndex(block, m_best_header)};
+    UpdateTipSnapshot();
 
     if (ppindex)
         *ppindex = pindex;
@@ -3863,8 +4099,10 @@ bool Chainstate::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockV
     if (!accepted_header)
         return false;
 
-    // peercoin: we should only accept blocks that can be connected to a prev block with validated PoS
-    if (fCheckPoS && pindex->pprev && !pindex->pprev->IsValid(BLOCK_VALID_TRANSACTIONS)) {
+    // peercoin: we should only accept blocks that can be connected to a prev block with validated PoS,
+    // or to the base of a UTXO snapshot, which carries the stake state
+    if (fCheckPoS && pindex->pprev && !pindex->pprev->IsValid(BLOCK_VALID_TRANSACTIONS) &&
+        pindex->pprev != m_chainman.GetSnapshotBaseBlock()) {
         return error("%s: this block does not connect to any valid known block", __func__);
     }
 
@@ -3915,6 +4153,7 @@ bool Chainstate::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockV
 
     // peercoin: check PoS
     if (fCheckPoS && !PeercoinContextualBlockChecks(block, state, pindex, false, m_chainman.ActiveChainstate())) {
+        if (state.IsError()) return false;
         pindex->nStatus |= BLOCK_FAILED_VALID;
         m_blockman.m_dirty_blockindex.insert(pindex);
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-pos", "proof of stake is incorrect");
@@ -3990,6 +4229,13 @@ bool ChainstateManager::ProcessNewBlock(const std::shared_ptr<const CBlock>& blo
         return error("%s: ActivateBestChain failed (%s)", __func__, state.ToString());
     }
 
+    // peercoin: blocks below the snapshot base advance the background validation
+    Chainstate* bg_chain{WITH_LOCK(cs_main, return BackgroundSyncInProgress() ? m_ibd_chainstate.get() : nullptr)};
+    BlockValidationState bg_state;
+    if (bg_chain && !bg_chain->ActivateBestChain(bg_state, block)) {
+        return error("%s: [background] ActivateBestChain failed (%s)", __func__, bg_state.ToString());
+    }
+
     return true;
 }
 
@@ -4045,6 +4291,11 @@ void Chainstate::LoadMempool(const fs::path& load_path, FopenFn mockable_fopen_f
     if (!m_mempool) return;
     ::LoadMempool(*m_mempool, load_path, *this, mockable_fopen_function);
     m_mempool->SetLoadTried(!ShutdownRequested());
+
+    LOCK(cs_main);
+    if (std::exchange(g_script_execution_cache_loaded, false) && m_chain.Tip()) {
+        MatchScriptExecutionCacheToMempool(*m_mempool, GetBlockScriptFlags(*m_chain.Tip(), m_chainman));
+    }
 }
 
 bool Chainstate::LoadChainTip()
@@ -4055,6 +4306,7 @@ bool Chainstate::LoadChainTip()
     const CBlockIndex* tip = m_chain.Tip();
 
     if (tip && tip->GetBlockHash() == coins_cache.GetBestBlock()) {
+        if (this == &m_chainman.ActiveChainstate()) m_chainman.UpdateTipSnapshot();
         return true;
     }
 
@@ -4065,6 +4317,7 @@ bool Chainstate::LoadChainTip()
     }
     m_chain.SetTip(*pindex);
     PruneBlockIndexCandidates();
+    if (this == &m_chainman.ActiveChainstate()) m_chainman.UpdateTipSnapshot();
 
     tip = m_chain.Tip();
     LogPrintf("Loaded best chain: hashBestChain=%s height=%d date=%s progress=%f\n",
@@ -4412,6 +4665,13 @@ bool ChainstateManager::LoadBlockIndex()
                     }
                 }
             }
+            // peercoin: blocks below the snapshot base that were downloaded but
+            // not connected before the restart continue the background validation
+            if (pindex->IsAssumedValid() && (pindex->nStatus & BLOCK_HAVE_DATA) &&
+                    pindex->nHeight >= first_assumed_valid_height && BackgroundSyncInProgress() &&
+                    GetSnapshotBaseBlock()->GetAncestor(pindex->nHeight) == pindex) {
+                m_ibd_chainstate->setBlockIndexCandidates.insert(pindex);
+            }
             if (pindex->nStatus & BLOCK_FAILED_MASK && (!m_best_invalid || pindex->nChainTrust > m_best_invalid->nChainTrust)) {
                 m_best_invalid = pindex;
             }
@@ -4692,8 +4952,14 @@ void Chainstate::CheckBlockIndex()
         if (!pindex->HaveTxsDownloaded()) assert(pindex->nSequenceId <= 0); // nSequenceId can't be set positive for blocks that aren't linked (negative is used for preciousblock)
         // VALID_TRANSACTIONS is equivalent to nTx > 0 for all nodes (whether or not pruning has occurred).
         // HAVE_DATA is only equivalent to nTx > 0 (or VALID_TRANSACTIONS) if no pruning has occurred.
-        assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
-        assert(pindexFirstMissing == pindexFirstNeverProcessed);
+        // Blocks assumed valid from a snapshot have an nTx value before their
+        // data is downloaded by the background chainstate.
+        if (!pindex->IsAssumedValid()) {
+            assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
+            assert(pindexFirstMissing == pindexFirstNeverProcessed);
+        } else if (pindex->nStatus & BLOCK_HAVE_DATA) {
+            assert(pindex->nTx > 0);
+        }
         if (pindex->nStatus & BLOCK_HAVE_UNDO) assert(pindex->nStatus & BLOCK_HAVE_DATA);
         if (pindex->IsAssumedValid()) {
             // Assumed-valid blocks should have some nTx value.
@@ -4902,28 +5168,32 @@ bool GetCoinAge(const CTransaction& tx, const CCoinsViewCache &view, uint64_t& n
             return false;  // Transaction timestamp violation
 
         CDiskTxPos postx;
+        SnapshotTxPos snapshot_pos;
         CBlockHeader header;
         CTransactionRef txPrev;
         auto it = g_txindex->cachedTxs.find(prevout.hash);
         if (it != g_txindex->cachedTxs.end()) {
             header = it->second.first;
             txPrev = it->second.second;
-        } else {
-            if (g_txindex->FindTxPosition(prevout.hash, postx)) {
-                CAutoFile file(node::OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-                try {
-                    file >> header;
-                    fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                    file >> txPrev;
-                } catch (std::exception &e) {
-                    return error("%s() : deserialize or I/O error in GetCoinAge()", __PRETTY_FUNCTION__);
-                }
-            } else
-                return error("%s() : tx missing in tx index in GetCoinAge()", __PRETTY_FUNCTION__);
+        } else if (g_txindex->FindTxPosition(prevout.hash, postx)) {
+            CAutoFile file(node::OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+            try {
+                file >> header;
+                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
+                file >> txPrev;
+            } catch (std::exception &e) {
+                return error("%s() : deserialize or I/O error in GetCoinAge()", __PRETTY_FUNCTION__);
+            }
             g_txindex->cachedTxs[prevout.hash] = std::pair(header,txPrev);
-        }
-
-        if (txPrev->GetHash() != prevout.hash)
+        } else if (g_txindex->FindSnapshotTx(prevout.hash, snapshot_pos) && (isTrueCoinAge || view.GetCoin(prevout, coin))) {
+            // peercoin: coin loaded from a UTXO snapshot whose block the
+            // background validation has not downloaded yet
+            header.nTime = snapshot_pos.block_time;
+            txPrev = MakeSnapshotKernelTx(coin, prevout.n);
+        } else
+            return error("%s() : tx missing in tx index in GetCoinAge()", __PRETTY_FUNCTION__);
+
+        if (snapshot_pos.block_hash.IsNull() && txPrev->GetHash() != prevout.hash)
             return error("%s() : txid mismatch in GetCoinAge()", __PRETTY_FUNCTION__);
 
         if (header.GetBlockTime() + Params().GetConsensus().nStakeMinAge > nTimeTx)
@@ -4937,12 +5207,12 @@ bool GetCoinAge(const CTransaction& tx, const CCoinsViewCache &view, uint64_t& n
 
         bnCentSecond += arith_uint256(nValueIn) * nEffectiveAge / CENT;
 
-        if (gArgs.GetBoolArg("-printcoinage", false))
+        if (g_print_coinage)
             LogPrintf("coin age nValueIn=%-12lld nTimeDiff=%d bnCentSecond=%s\n", nValueIn, nEffectiveAge, bnCentSecond.ToString());
     }
 
     arith_uint256 bnCoinDay = bnCentSecond * CENT / COIN / (24 * 60 * 60);
-    if (gArgs.GetBoolArg("-printcoinage", false))
+    if (g_print_coinage)
         LogPrintf("coin age bnCoinDay=%s\n", bnCoinDay.ToString());
     nCoinAge = bnCoinDay.GetLow64();
     return true;
@@ -5182,6 +5452,7 @@ bool ChainstateManager::ActivateSnapshot(
         assert(chaintip_loaded);
 
         m_active_chainstate = m_snapshot_chainstate.get();
+        UpdateTipSnapshot();
 
         LogPrintf("[snapshot] successfully activated snapshot %s\n", base_blockhash.ToString());
         LogPrintf("[snapshot] (%.2f MB)\n",
@@ -5248,10 +5519,23 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
 
     const AssumeutxoData& au_data = *maybe_au_data;
 
+    // peercoin: the proof-of-stake checks after the base need the stake state
+    // of the snapshot and the transaction index to record its kernel data
+    if (au_data.hash_stake.IsNull()) {
+        LogPrintf("[snapshot] assumeutxo data at height %d has no stake state hash - refusing to load snapshot\n", base_height);
+        return false;
+    }
+    if (!g_txindex) {
+        LogPrintf("[snapshot] the transaction index is required to load a snapshot\n");
+        return false;
+    }
+
     COutPoint outpoint;
     Coin coin;
     const uint64_t coins_count = metadata.m_coins_count;
     uint64_t coins_left = metadata.m_coins_count;
+    // peercoin: height of the block of each transaction with coins, for its kernel data
+    std::unordered_map<uint256, int, SaltedTxidHasher> tx_heights;
 
     LogPrintf("[snapshot] loading coins from snapshot %s\n", base_blockhash.ToString());
     int64_t coins_processed{0};
@@ -5273,6 +5557,7 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
             return false;
         }
 
+        tx_heights.emplace(outpoint.hash, static_cast<int>(coin.nHeight));
         coins_cache.EmplaceCoinInternalDANGER(std::move(outpoint), std::move(coin));
 
         --coins_left;
@@ -5316,6 +5601,33 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     // method.
     coins_cache.SetBestBlock(base_blockhash);
 
+    // peercoin: one kernel entry follows the coins for each of their transactions
+    if (metadata.m_kernel_count != tx_heights.size()) {
+        LogPrintf("[snapshot] bad snapshot - %d kernel entries for %d transactions\n",
+                  metadata.m_kernel_count, tx_heights.size());
+        return false;
+    }
+    std::vector<SnapshotKernelTx> kernel_txs(metadata.m_kernel_count);
+    for (SnapshotKernelTx& kernel_tx : kernel_txs) {
+        try {
+            coins_file >> kernel_tx;
+        } catch (const std::ios_base::failure&) {
+            LogPrintf("[snapshot] bad snapshot format or truncated snapshot in the kernel entries\n");
+            return false;
+        }
+        if (!tx_heights.count(kernel_tx.txid)) {
+            LogPrintf("[snapshot] bad snapshot - kernel entry for unknown transaction %s\n", kernel_tx.txid.ToString());
+            return false;
+        }
+    }
+
+    const uint256 hash_stake{node::ComputeSnapshotStakeHash(metadata, kernel_txs)};
+    if (hash_stake != au_data.hash_stake) {
+        LogPrintf("[snapshot] bad snapshot stake state hash: expected %s, got %s\n",
+                  au_data.hash_stake.ToString(), hash_stake.ToString());
+        return false;
+    }
+
     bool out_of_coins{false};
     try {
         coins_file >> outpoint;
@@ -5411,6 +5723,11 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
 
     assert(index);
     index->nChainTx = au_data.nChainTx;
+
+    if (!LoadSnapshotStakeState(*snapshot_start_block, metadata, kernel_txs, tx_heights)) {
+        return false;
+    }
+
     snapshot_chainstate.setBlockIndexCandidates.insert(snapshot_start_block);
 
     LogPrintf("[snapshot] validated snapshot (%.2f MB)\n",
@@ -5418,6 +5735,106 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     return true;
 }
 
+void ChainstateManager::InvalidSnapshotFound(std::function<void(bilingual_str)> shutdown_fnc)
+{
+    AssertLockHeld(cs_main);
+    if (!IsSnapshotActive()) return;
+    const int snapshot_tip_height = this->ActiveHeight();
+    const int snapshot_base_height = *Assert(this->GetSnapshotBaseHeight());
+
+    bilingual_str user_error = strprintf(_(
+        "%s failed to validate the -assumeutxo snapshot state. "
+        "This indicates a hardware problem, or a bug in the software, or a "
+        "bad software modification that allowed an invalid snapshot to be "
+        "loaded. As a result of this, the node will shut down and stop using any "
+        "state that was built on the snapshot, resetting the chain height "
+        "from %d to %d. On the next "
+        "restart, the node will resume syncing from %d "
+        "without using any snapshot data. "
+        "Please report this incident to %s, including how you obtained the snapshot. "
+        "The invalid snapshot chainstate has been left on disk in case it is "
+        "helpful in diagnosing the issue that caused this error."),
+        PACKAGE_NAME, snapshot_tip_height, snapshot_base_height, snapshot_base_height, PACKAGE_BUGREPORT
+    );
+
+    LogPrintf("[snapshot] !!! %s\n", user_error.original);
+    LogPrintf("[snapshot] deleting snapshot, reverting to validated chain, and stopping node\n");
+
+    m_active_chainstate = m_ibd_chainstate.get();
+    UpdateTipSnapshot();
+    m_snapshot_chainstate->m_disabled = true;
+    assert(!this->IsUsable(m_snapshot_chainstate.get()));
+    assert(this->IsUsable(m_ibd_chainstate.get()));
+
+    m_snapshot_chainstate->InvalidateCoinsDBOnDisk();
+
+    shutdown_fnc(user_error);
+}
+
+bool ChainstateManager::LoadSnapshotStakeState(
+    CBlockIndex& base,
+    const SnapshotMetadata& metadata,
+    const std::vector<SnapshotKernelTx>& kernel_txs,
+    const std::unordered_map<uint256, int, SaltedTxidHasher>& tx_heights)
+{
+    AssertLockHeld(::cs_main);
+    const std::vector<SnapshotStakeBlock>& stake_blocks{metadata.m_stake_blocks};
+    if (stake_blocks.empty() || stake_blocks.back().hash != base.GetBlockHash() ||
+        stake_blocks.size() > static_cast<size_t>(base.nHeight)) {
+        LogPrintf("[snapshot] bad snapshot - stake state does not end at the base block\n");
+        return false;
+    }
+
+    const int start_height{base.nHeight - static_cast<int>(stake_blocks.size()) + 1};
+    for (size_t i = 0; i < stake_blocks.size(); ++i) {
+        const SnapshotStakeBlock& stake_block{stake_blocks[i]};
+        CBlockIndex* pindex{Assert(base.GetAncestor(start_height + i))};
+        if (stake_block.hash != pindex->GetBlockHash() ||
+            (stake_block.flags & CBlockIndex::BLOCK_PROOF_OF_STAKE) != (pindex->nFlags & CBlockIndex::BLOCK_PROOF_OF_STAKE)) {
+            LogPrintf("[snapshot] bad snapshot - stake state of block %s does not match the headers\n", pindex->GetBlockHash().ToString());
+            return false;
+        }
+        if (pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
+            // Already connected by this node, the snapshot must agree with it
+            if (pindex->nFlags != stake_block.flags || pindex->nStakeModifier != stake_block.stake_modifier ||
+                pindex->hashProofOfStake != stake_block.hash_proof_of_stake || pindex->nMoneySupply != stake_block.money_supply) {
+                LogPrintf("[snapshot] bad snapshot - stake state of block %s does not match the validated one\n", pindex->GetBlockHash().ToString());
+                return false;
+            }
+            continue;
+        }
+        pindex->nFlags = stake_block.flags;
+        pindex->nStakeModifier = stake_block.stake_modifier;
+        pindex->hashProofOfStake = stake_block.hash_proof_of_stake;
+        pindex->prevoutStake = stake_block.prevout_stake;
+        pindex->nStakeTime = stake_block.stake_time;
+        pindex->nMint = stake_block.mint;
+        pindex->nMoneySupply = stake_block.money_supply;
+        pindex->nStatus |= BLOCK_SNAPSHOT_STAKE;
+        m_blockman.m_dirty_blockindex.insert(pindex);
+    }
+
+    // Record where the kernels of the snapshot coins find their transactions
+    static constexpr size_t KERNEL_BATCH_SIZE{100000};
+    std::vector<std::pair<uint256, SnapshotTxPos>> v_pos;
+    v_pos.reserve(std::min(kernel_txs.size(), KERNEL_BATCH_SIZE));
+    for (const SnapshotKernelTx& kernel_tx : kernel_txs) {
+        const CBlockIndex* pindex{Assert(base.GetAncestor(tx_heights.at(kernel_tx.txid)))};
+        v_pos.emplace_back(kernel_tx.txid, SnapshotTxPos{pindex->GetBlockHash(), pindex->nTime, kernel_tx.tx_offset});
+        if (v_pos.size() == KERNEL_BATCH_SIZE || &kernel_tx == &kernel_txs.back()) {
+            if (!g_txindex->WriteSnapshotTxs(v_pos)) {
+                LogPrintf("[snapshot] failed to write the kernel entries to the transaction index\n");
+                return false;
+            }
+            v_pos.clear();
+        }
+    }
+
+    LogPrintf("[snapshot] loaded the stake state of %d blocks and %d kernel entries\n",
+              stake_blocks.size(), kernel_txs.size());
+    return true;
+}
+
 // Currently, this function holds cs_main for its duration, which could be for
 // multiple minutes due to the ComputeUTXOStats call. This hold is necessary
 // because we need to avoid advancing the background validation chainstate
@@ -5444,7 +5861,6 @@ SnapshotCompletionResult ChainstateManager::MaybeCompleteSnapshotValidation(
        // validation chainstate.
        return SnapshotCompletionResult::SKIPPED;
     }
-    const int snapshot_tip_height = this->ActiveHeight();
     const int snapshot_base_height = *Assert(this->GetSnapshotBaseHeight());
     const CBlockIndex& index_new = *Assert(m_ibd_chainstate->m_chain.Tip());
 
@@ -5457,32 +5873,7 @@ SnapshotCompletionResult ChainstateManager::MaybeCompleteSnapshotValidation(
     uint256 snapshot_blockhash = *Assert(SnapshotBlockhash());
 
     auto handle_invalid_snapshot = [&]() EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
-        bilingual_str user_error = strprintf(_(
-            "%s failed to validate the -assumeutxo snapshot state. "
-            "This indicates a hardware problem, or a bug in the software, or a "
-            "bad software modification that allowed an invalid snapshot to be "
-            "loaded. As a result of this, the node will shut down and stop using any "
-            "state that was built on the snapshot, resetting the chain height "
-            "from %d to %d. On the next "
-            "restart, the node will resume syncing from %d "
-            "without using any snapshot data. "
-            "Please report this incident to %s, including how you obtained the snapshot. "
-            "The invalid snapshot chainstate has been left on disk in case it is "
-            "helpful in diagnosing the issue that caused this error."),
-            PACKAGE_NAME, snapshot_tip_height, snapshot_base_height, snapshot_base_height, PACKAGE_BUGREPORT
-        );
-
-        LogPrintf("[snapshot] !!! %s\n", user_error.original);
-        LogPrintf("[snapshot] deleting snapshot, reverting to validated chain, and stopping node\n");
-
-        m_active_chainstate = m_ibd_chainstate.get();
-        m_snapshot_chainstate->m_disabled = true;
-        assert(!this->IsUsable(m_snapshot_chainstate.get()));
-        assert(this->IsUsable(m_ibd_chainstate.get()));
-
-        m_snapshot_chainstate->InvalidateCoinsDBOnDisk();
-
-        shutdown_fnc(user_error);
+        InvalidSnapshotFound(shutdown_fnc);
     };
 
     if (index_new.GetBlockHash() != snapshot_blockhash) {
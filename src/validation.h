@@ -42,6 +42,7 @@
 #include <stdint.h>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -60,9 +61,11 @@ struct ChainTxData;
 struct DisconnectedBlockTransactions;
 struct PrecomputedTransactionData;
 struct LockPoints;
+class SchnorrSigBatch;
 struct AssumeutxoData;
 namespace node {
 class SnapshotMetadata;
+struct SnapshotKernelTx;
 } // namespace node
 namespace Consensus {
 struct Params;
@@ -332,14 +335,32 @@ public:
     CScriptCheck(CScriptCheck&&) = default;
     CScriptCheck& operator=(CScriptCheck&&) = default;
 
-    bool operator()();
+    /** Run the check. With a batch, Schnorr signatures that miss the signature
+     *  cache are added to it instead of verified, and the check only holds if
+     *  the batch verifies too. */
+    bool operator()(SchnorrSigBatch* batch = nullptr);
 
     ScriptError GetScriptError() const { return error; }
 };
 
+/** Run a chunk of script checks taken off the script check queue, verifying
+ *  the Schnorr signatures of all of them in one batch. If the batch fails, the
+ *  checks are run again one by one to find the failing input. Found by
+ *  CCheckQueue through argument-dependent lookup. */
+bool RunChecks(std::vector<CScriptCheck>& checks);
+
 /** Initializes the script-execution cache */
 [[nodiscard]] bool InitScriptExecutionCache(size_t max_size_bytes);
 
+/** Copy out the entries of the script-execution cache, and the nonce they are
+ *  salted with, e.g. to persist them across restarts. */
+std::vector<uint256> DumpScriptExecutionCache(uint256& nonce) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/** Salt the script-execution cache with nonce and add entries salted with it.
+ *  Only call it before the cache is used. Entries that turn out not to match a
+ *  transaction of the mempool loaded afterwards are the first to be evicted. */
+void LoadScriptExecutionCache(const uint256& nonce, const std::vector<uint256>& entries) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
@@ -361,6 +382,12 @@ bool HasValidProofOfWork(const std::vector<CBlockHeader>& headers, const Consens
 /** Check if a block has been mutated (with respect to its merkle root and witness commitments). */
 bool IsBlockMutated(const CBlock& block, bool check_witness_root);
 
+/** Whether the checks that -assumevalid covers may be skipped for a block: it is
+ *  an ancestor of the assumed valid block and of a best header with at least the
+ *  minimum chain work, and that header is more than two weeks of equivalent
+ *  work past the block. Blocks of any other chain are always checked in full. */
+bool IsAssumedValidBlock(const CBlockIndex& index, const CBlockIndex* assumed_valid, const CBlockIndex& best_header, const arith_uint256& minimum_chain_work, const Consensus::Params& params);
+
 /** Return the sum of the work on a given set of headers */
 arith_uint256 CalculateHeadersWork(const std::vector<CBlockHeader>& headers);
 
@@ -734,6 +761,11 @@ public:
 
     void PruneBlockIndexCandidates();
 
+    //! peercoin: add pindex to setBlockIndexCandidates if it may extend the
+    //! chain. The background validation chainstate only takes the blocks
+    //! towards the snapshot base.
+    void TryAddBlockIndexCandidate(CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     void UnloadBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
     /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -822,6 +854,33 @@ private:
 };
 
 
+/**
+ * Immutable summary of the active chain tip. A new instance is published by
+ * ChainstateManager on every tip (and best header) change, so that frequently
+ * polled RPCs can read it without taking cs_main.
+ */
+struct ChainTipSnapshot {
+    //! The tip itself. Block index entries live until shutdown, and the fields
+    //! used by readers (nHeight, pprev, nChainTrust, nChainTx, nTime) never
+    //! change. Values that depend on the current time, like the verification
+    //! progress, are computed from it by the reader.
+    const CBlockIndex* tip{nullptr};
+    int height{-1};
+    uint256 hash;
+    int64_t time{0};
+    int64_t median_time{0};
+    arith_uint256 chain_trust;
+    //! nBits of the tip, of the last proof-of-work and of the last proof-of-stake block
+    uint32_t bits{0};
+    uint32_t pow_bits{0};
+    uint32_t pos_bits{0};
+    CAmount money_supply{0};
+    int header_height{-1};
+    //! Moving average of proof-of-work block spacing, for network hash rate estimates
+    int64_t pow_target_spacing{0};
+    int64_t last_pow_time{0};
+};
+
 enum class SnapshotCompletionResult {
     SUCCESS,
     SKIPPED,
@@ -920,6 +979,14 @@ private:
         AutoFile& coins_file,
         const node::SnapshotMetadata& metadata);
 
+    //! peercoin: apply the stake state of a snapshot to the blocks before its
+    //! base and record the kernel data of its coins in the transaction index.
+    [[nodiscard]] bool LoadSnapshotStakeState(
+        CBlockIndex& base,
+        const node::SnapshotMetadata& metadata,
+        const std::vector<node::SnapshotKernelTx>& kernel_txs,
+        const std::unordered_map<uint256, int, SaltedTxidHasher>& tx_heights) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     /**
      * If a block header hasn't already been seen, call CheckBlockHeader on it, ensure
      * that it doesn't descend from an invalid block, and then add it to m_block_index.
@@ -934,15 +1001,24 @@ private:
         bool min_pow_checked) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     friend Chainstate;
 
-    /** Most recent headers presync progress update, for rate-limiting. */
-    std::chrono::time_point<std::chrono::steady_clock> m_last_presync_update GUARDED_BY(::cs_main) {};
+    //! Published summary of the active tip, see GetTipSnapshot().
+    std::shared_ptr<const ChainTipSnapshot> m_tip_snapshot;
 
-    //! Returns nullptr if no snapshot has been loaded.
-    const CBlockIndex* GetSnapshotBaseBlock() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    //! The fields of the tip snapshot that depend on the whole chain, as of one block.
+    struct TipCheckpoint {
+        const CBlockIndex* block;
+        uint32_t pow_bits;
+        uint32_t pos_bits;
+        int64_t pow_target_spacing;
+        int64_t last_pow_time;
+    };
+    static constexpr int TIP_CHECKPOINT_INTERVAL{100};
+    //! One entry every TIP_CHECKPOINT_INTERVAL blocks of the active chain, so a
+    //! reorg resumes from below the fork point instead of walking from genesis.
+    std::vector<TipCheckpoint> m_tip_checkpoints GUARDED_BY(::cs_main);
 
-    //! Return the height of the base block of the snapshot in use, if one exists, else
-    //! nullopt.
-    std::optional<int> GetSnapshotBaseHeight() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    /** Most recent headers presync progress update, for rate-limiting. */
+    std::chrono::time_point<std::chrono::steady_clock> m_last_presync_update GUARDED_BY(::cs_main) {};
 
     //! Return true if a chainstate is considered usable.
     //!
@@ -963,6 +1039,9 @@ public:
     bool ShouldCheckBlockIndex() const { return *Assert(m_options.check_block_index); }
     const arith_uint256& MinimumChainWork() const { return *Assert(m_options.minimum_chain_work); }
     const uint256& AssumedValidBlock() const { return *Assert(m_options.assumed_valid_block); }
+    //! Whether the script and coinstake signature checks of a block are covered
+    //! by -assumevalid, see IsAssumedValidBlock()
+    bool IsAssumedValid(const CBlockIndex& index) const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
     /**
      * Alias for ::cs_main.
@@ -1052,6 +1131,15 @@ public:
             [](bilingual_str msg) { AbortNode(msg.original, msg); })
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
+    //! Revert to the ibd chainstate and shut down once the snapshot chainstate
+    //! is found to be invalid. peercoin: also called when the stake state a
+    //! snapshot carries does not match the one the background validation
+    //! recomputes.
+    void InvalidSnapshotFound(
+        std::function<void(bilingual_str)> shutdown_fnc =
+            [](bilingual_str msg) { AbortNode(msg.original, msg); })
+        EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     //! The most-work chain.
     Chainstate& ActiveChainstate() const;
     CChain& ActiveChain() const EXCLUSIVE_LOCKS_REQUIRED(GetMutex()) { return ActiveChainstate().m_chain; }
@@ -1064,12 +1152,43 @@ public:
         return m_blockman.m_block_index;
     }
 
+    //! Summary of the active tip as of its last change. Lock-free; may lag the
+    //! chain by the block currently being connected. Null before the chain is loaded.
+    std::shared_ptr<const ChainTipSnapshot> GetTipSnapshot() const
+    {
+        return std::atomic_load_explicit(&m_tip_snapshot, std::memory_order_acquire);
+    }
+
+    //! Rebuild and publish the tip snapshot from the active chain.
+    void UpdateTipSnapshot() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     //! @returns true if a snapshot-based chainstate is in use. Also implies
     //!          that a background validation chainstate is also in use.
     bool IsSnapshotActive() const;
 
     std::optional<uint256> SnapshotBlockhash() const;
 
+    //! Returns nullptr if no snapshot has been loaded.
+    const CBlockIndex* GetSnapshotBaseBlock() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    //! Return the height of the base block of the snapshot in use, if one exists, else
+    //! nullopt.
+    std::optional<int> GetSnapshotBaseHeight() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    //! peercoin: whether the background validation chainstate is still
+    //! connecting the blocks below the snapshot base
+    bool BackgroundSyncInProgress() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
+    {
+        return IsUsable(m_snapshot_chainstate.get()) && IsUsable(m_ibd_chainstate.get());
+    }
+
+    //! peercoin: tip of the background validation chainstate, nullptr if it
+    //! is not in use
+    const CBlockIndex* GetBackgroundSyncTip() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
+    {
+        return BackgroundSyncInProgress() ? m_ibd_chainstate->m_chain.Tip() : nullptr;
+    }
+
     //! Is there a snapshot in use and has it been fully validated?
     bool IsSnapshotValidated() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
     {
@@ -12,10 +12,17 @@
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <scheduler.h>
+#include <tinyformat.h>
+#include <util/thread.h>
+#include <util/time.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <future>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 std::string RemovalReasonToString(const MemPoolRemovalReason& r) noexcept;
 
@@ -26,32 +33,199 @@ std::string RemovalReasonToString(const MemPoolRemovalReason& r) noexcept;
  * registered, and a std::list is used to store the callbacks that are
  * currently registered as well as any callbacks that are just unregistered
  * and about to be deleted when they are done executing.
+ *
+ * Background notifications are queued per subscriber, so a slow subscriber
+ * only delays its own notifications. Queues are run by a small pool of
+ * worker threads (or by the scheduler when there are none), and a queue is
+ * only ever run by one thread at a time, which keeps the notifications of
+ * each subscriber in order.
  */
 class MainSignalsImpl
 {
 private:
+    using Event = std::function<void(CValidationInterface&)>;
+
+    //! Functions queued with CallFunctionInValidationInterfaceQueue wait
+    //! until every queue has run all callbacks queued before them.
+    struct Barrier { int remaining{0}; };
+
+    struct QueuedCallback {
+        //! Notification for the queue's subscriber, shared by all queues
+        std::shared_ptr<const Event> event;
+        //! Plain function to run
+        std::function<void()> func;
+        //! Not runnable until this barrier has been reached by all queues
+        std::shared_ptr<Barrier> gate;
+        //! Marks that this queue has reached the barrier
+        std::shared_ptr<Barrier> arrive;
+        SteadyClock::time_point time;
+    };
+
+    struct CallbackQueue {
+        std::string name;
+        std::shared_ptr<CValidationInterface> subscriber;
+        std::deque<QueuedCallback> pending;
+        //! Whether the subscriber is registered. Notifications left in the
+        //! queue of an unregistered subscriber are skipped.
+        bool registered{true};
+        //! Set while the queue is waiting in m_ready or a callback of it is running
+        bool scheduled{false};
+        uint64_t processed{0};
+        uint64_t skipped{0};
+        std::chrono::microseconds last_lag{0};
+        std::chrono::microseconds max_lag{0};
+        std::chrono::microseconds max_exec_time{0};
+    };
+
     Mutex m_mutex;
     //! List entries consist of a callback pointer and reference count. The
     //! count is equal to the number of current executions of that entry, plus 1
     //! if it's registered. It cannot be 0 because that would imply it is
     //! unregistered and also not being executed (so shouldn't exist).
-    struct ListEntry { std::shared_ptr<CValidationInterface> callbacks; int count = 1; };
+    struct ListEntry { std::shared_ptr<CValidationInterface> callbacks; int count = 1; std::shared_ptr<CallbackQueue> queue; };
     std::list<ListEntry> m_list GUARDED_BY(m_mutex);
     std::unordered_map<CValidationInterface*, std::list<ListEntry>::iterator> m_map GUARDED_BY(m_mutex);
 
+    CScheduler& m_scheduler;
+    const size_t m_max_backlog;
+    //! Queue for functions not bound to a subscriber
+    const std::shared_ptr<CallbackQueue> m_control;
+    //! All queues with a registered subscriber or pending callbacks
+    std::vector<std::shared_ptr<CallbackQueue>> m_queues GUARDED_BY(m_mutex);
+    //! Queues with a runnable callback, in the order they became runnable
+    std::deque<std::shared_ptr<CallbackQueue>> m_ready GUARDED_BY(m_mutex);
+    std::condition_variable m_work_cv;
+    std::condition_variable m_progress_cv;
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    static bool IsRunnable(const CallbackQueue& queue)
+    {
+        return !queue.pending.empty() && (!queue.pending.front().gate || queue.pending.front().gate->remaining == 0);
+    }
+
+    void MaybeSchedule(const std::shared_ptr<CallbackQueue>& queue) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        if (queue->scheduled || !IsRunnable(*queue)) return;
+        queue->scheduled = true;
+        m_ready.push_back(queue);
+        if (m_threads.empty()) {
+            m_scheduler.schedule([this] { RunReady(); }, SteadyClock::now());
+        } else {
+            m_work_cv.notify_one();
+        }
+    }
+
+    void Push(const std::shared_ptr<CallbackQueue>& queue, QueuedCallback callback) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        callback.time = SteadyClock::now();
+        queue->pending.push_back(std::move(callback));
+        MaybeSchedule(queue);
+    }
+
+    void MaybeRetire(const std::shared_ptr<CallbackQueue>& queue) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        if (queue->registered || queue->scheduled || !queue->pending.empty()) return;
+        m_queues.erase(std::remove(m_queues.begin(), m_queues.end(), queue), m_queues.end());
+    }
+
+    size_t MaxPending() const EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        size_t max_pending{0};
+        for (const auto& queue : m_queues) max_pending = std::max(max_pending, queue->pending.size());
+        return max_pending;
+    }
+
+    //! Run the next callback of the first queue in m_ready
+    void RunOne(UniqueLock<Mutex>& lock) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        std::shared_ptr<CallbackQueue> queue{std::move(m_ready.front())};
+        m_ready.pop_front();
+        QueuedCallback callback{std::move(queue->pending.front())};
+        queue->pending.pop_front();
+
+        if (callback.arrive) {
+            if (--callback.arrive->remaining == 0) MaybeSchedule(m_control);
+        } else if (callback.event && !queue->registered) {
+            ++queue->skipped;
+        } else {
+            // Keep the subscriber alive for the call even if it is unregistered meanwhile.
+            const std::shared_ptr<CValidationInterface> subscriber{queue->subscriber};
+            const auto start{SteadyClock::now()};
+            queue->last_lag = std::chrono::duration_cast<std::chrono::microseconds>(start - callback.time);
+            queue->max_lag = std::max(queue->max_lag, queue->last_lag);
+            {
+                REVERSE_LOCK(lock);
+                if (callback.event) {
+                    (*callback.event)(*subscriber);
+                } else {
+                    callback.func();
+                }
+                // Release whatever the callback holds on to outside of m_mutex.
+                callback = {};
+            }
+            queue->max_exec_time = std::max(queue->max_exec_time, std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start));
+            ++queue->processed;
+        }
+        queue->scheduled = false;
+        MaybeSchedule(queue);
+        MaybeRetire(queue);
+        m_progress_cv.notify_all();
+    }
+
+    void RunReady() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        if (!m_ready.empty()) RunOne(lock);
+    }
+
+    void ThreadWork() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        while (true) {
+            m_work_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_ready.empty(); });
+            if (m_stop) return;
+            RunOne(lock);
+        }
+    }
+
+    void StopThreads() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_work_cv.notify_all();
+        for (auto& thread : m_threads) {
+            if (thread.joinable()) thread.join();
+        }
+    }
+
 public:
-    // We are not allowed to assume the scheduler only runs in one thread,
-    // but must ensure all callbacks happen in-order, so we end up creating
-    // our own queue here :(
-    SingleThreadedSchedulerClient m_schedulerClient;
+    MainSignalsImpl(CScheduler& scheduler LIFETIMEBOUND, int worker_threads, size_t max_backlog)
+        : m_scheduler{scheduler}, m_max_backlog{max_backlog}, m_control{std::make_shared<CallbackQueue>()}
+    {
+        m_control->name = "functions";
+        m_queues.push_back(m_control);
+        for (int i = 0; i < worker_threads; ++i) {
+            m_threads.emplace_back(&util::TraceThread, strprintf("valsig.%i", i), [this] { ThreadWork(); });
+        }
+    }
 
-    explicit MainSignalsImpl(CScheduler& scheduler LIFETIMEBOUND) : m_schedulerClient(scheduler) {}
+    ~MainSignalsImpl()
+    {
+        StopThreads();
+    }
 
     void Register(std::shared_ptr<CValidationInterface> callbacks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
+        auto queue{std::make_shared<CallbackQueue>()};
+        queue->name = callbacks->GetSubscriberName();
+        queue->subscriber = callbacks;
         LOCK(m_mutex);
         auto inserted = m_map.emplace(callbacks.get(), m_list.end());
-        if (inserted.second) inserted.first->second = m_list.emplace(m_list.end());
+        if (inserted.second) {
+            inserted.first->second = m_list.emplace(m_list.end());
+            inserted.first->second->queue = queue;
+            m_queues.push_back(std::move(queue));
+        }
         inserted.first->second->callbacks = std::move(callbacks);
     }
 
@@ -60,6 +234,7 @@ public:
         LOCK(m_mutex);
         auto it = m_map.find(callbacks);
         if (it != m_map.end()) {
+            Retire(it->second->queue);
             if (!--it->second->count) m_list.erase(it->second);
             m_map.erase(it);
         }
@@ -73,11 +248,22 @@ public:
     {
         LOCK(m_mutex);
         for (const auto& entry : m_map) {
+            Retire(entry.second->queue);
             if (!--entry.second->count) m_list.erase(entry.second);
         }
         m_map.clear();
     }
 
+    void Retire(const std::shared_ptr<CallbackQueue>& queue) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        queue->registered = false;
+        // Callbacks left in the queue do not need the subscriber any more.
+        // Release it now, as the queue may outlive it once the worker
+        // threads have stopped, e.g. during shutdown.
+        queue->subscriber.reset();
+        MaybeRetire(queue);
+    }
+
     template<typename F> void Iterate(F&& f) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
         WAIT_LOCK(m_mutex, lock);
@@ -90,14 +276,107 @@ public:
             it = --it->count ? std::next(it) : m_list.erase(it);
         }
     }
+
+    //! Queue an event for every registered subscriber
+    void Enqueue(Event event) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        auto shared_event{std::make_shared<const Event>(std::move(event))};
+        LOCK(m_mutex);
+        for (const auto& entry : m_map) {
+            QueuedCallback callback;
+            callback.event = shared_event;
+            Push(entry.second->queue, std::move(callback));
+        }
+    }
+
+    void CallFunction(std::function<void()> func) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        auto barrier{std::make_shared<Barrier>()};
+        LOCK(m_mutex);
+        for (const auto& queue : m_queues) {
+            if (queue == m_control) continue;
+            ++barrier->remaining;
+            QueuedCallback arrive;
+            arrive.arrive = barrier;
+            Push(queue, std::move(arrive));
+        }
+        QueuedCallback callback;
+        callback.func = std::move(func);
+        callback.gate = std::move(barrier);
+        Push(m_control, std::move(callback));
+    }
+
+    void CallFunction(CValidationInterface& callbacks, std::function<void()> func) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            LOCK(m_mutex);
+            auto it = m_map.find(&callbacks);
+            if (it != m_map.end()) {
+                QueuedCallback callback;
+                callback.func = std::move(func);
+                Push(it->second->queue, std::move(callback));
+                return;
+            }
+        }
+        CallFunction(std::move(func));
+    }
+
+    //! Stop the worker threads and run all remaining callbacks on the calling thread
+    void Flush() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        if (m_threads.empty()) {
+            assert(!m_scheduler.AreThreadsServicingQueue());
+        } else {
+            StopThreads();
+        }
+        WAIT_LOCK(m_mutex, lock);
+        while (!m_ready.empty()) RunOne(lock);
+    }
+
+    size_t CallbacksPending() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        return WITH_LOCK(m_mutex, return MaxPending());
+    }
+
+    void LimitBacklog() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        if (m_max_backlog == 0) return;
+        WAIT_LOCK(m_mutex, lock);
+        if (MaxPending() <= m_max_backlog) return;
+        // Let the subscribers catch up on a good part of their backlog, so
+        // validation does not end up waiting after every single block.
+        m_progress_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return MaxPending() <= m_max_backlog / 2; });
+    }
+
+    std::vector<ValidationSubscriberStats> GetStats() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const auto now{SteadyClock::now()};
+        std::vector<ValidationSubscriberStats> stats;
+        LOCK(m_mutex);
+        for (const auto& queue : m_queues) {
+            ValidationSubscriberStats& s{stats.emplace_back()};
+            s.name = queue->name;
+            s.registered = queue->registered;
+            s.pending = queue->pending.size();
+            s.processed = queue->processed;
+            s.skipped = queue->skipped;
+            if (!queue->pending.empty()) {
+                s.oldest_pending_age = std::chrono::duration_cast<std::chrono::microseconds>(now - queue->pending.front().time);
+            }
+            s.last_lag = queue->last_lag;
+            s.max_lag = queue->max_lag;
+            s.max_exec_time = queue->max_exec_time;
+        }
+        return stats;
+    }
 };
 
 static CMainSignals g_signals;
 
-void CMainSignals::RegisterBackgroundSignalScheduler(CScheduler& scheduler)
+void CMainSignals::RegisterBackgroundSignalScheduler(CScheduler& scheduler, int worker_threads, size_t max_backlog)
 {
     assert(!m_internals);
-    m_internals = std::make_unique<MainSignalsImpl>(scheduler);
+    m_internals = std::make_unique<MainSignalsImpl>(scheduler, worker_threads, max_backlog);
 }
 
 void CMainSignals::UnregisterBackgroundSignalScheduler()
@@ -108,14 +387,25 @@ void CMainSignals::UnregisterBackgroundSignalScheduler()
 void CMainSignals::FlushBackgroundCallbacks()
 {
     if (m_internals) {
-        m_internals->m_schedulerClient.EmptyQueue();
+        m_internals->Flush();
     }
 }
 
 size_t CMainSignals::CallbacksPending()
 {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    return m_internals->CallbacksPending();
+}
+
+void CMainSignals::LimitBacklog()
+{
+    if (m_internals) m_internals->LimitBacklog();
+}
+
+std::vector<ValidationSubscriberStats> CMainSignals::GetSubscriberStats()
+{
+    if (!m_internals) return {};
+    return m_internals->GetStats();
 }
 
 CMainSignals& GetMainSignals()
@@ -159,7 +449,12 @@ void UnregisterAllValidationInterfaces()
 
 void CallFunctionInValidationInterfaceQueue(std::function<void()> func)
 {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    g_signals.m_internals->CallFunction(std::move(func));
+}
+
+void CallFunctionInValidationInterfaceQueue(CValidationInterface& callbacks, std::function<void()> func)
+{
+    g_signals.m_internals->CallFunction(callbacks, std::move(func));
 }
 
 void SyncWithValidationInterfaceQueue()
@@ -181,9 +476,9 @@ void SyncWithValidationInterfaceQueue()
     do {                                                       \
         auto local_name = (name);                              \
         LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);  \
-        m_internals->m_schedulerClient.AddToProcessQueue([=] { \
+        m_internals->Enqueue([=](CValidationInterface& callbacks) { \
             LOG_EVENT(fmt, local_name, __VA_ARGS__);           \
-            event();                                           \
+            event(callbacks);                                  \
         });                                                    \
     } while (0)
 
@@ -195,8 +490,8 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    auto event = [pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload); });
+    auto event = [pindexNew, pindexFork, fInitialDownload](CValidationInterface& callbacks) {
+        callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: new block hash=%s fork block hash=%s (in IBD=%s)", __func__,
                           pindexNew->GetBlockHash().ToString(),
@@ -205,8 +500,8 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) {
-    auto event = [tx, mempool_sequence, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionAddedToMempool(tx, mempool_sequence); });
+    auto event = [tx, mempool_sequence](CValidationInterface& callbacks) {
+        callbacks.TransactionAddedToMempool(tx, mempool_sequence);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s", __func__,
                           tx->GetHash().ToString(),
@@ -214,8 +509,8 @@ void CMainSignals::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t
 }
 
 void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) {
-    auto event = [tx, reason, mempool_sequence, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionRemovedFromMempool(tx, reason, mempool_sequence); });
+    auto event = [tx, reason, mempool_sequence](CValidationInterface& callbacks) {
+        callbacks.TransactionRemovedFromMempool(tx, reason, mempool_sequence);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s reason=%s", __func__,
                           tx->GetHash().ToString(),
@@ -224,8 +519,17 @@ void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& tx, MemP
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex) {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockConnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockConnected(pblock, pindex);
+    };
+    ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
+                          pblock->GetHash().ToString(),
+                          pindex->nHeight);
+}
+
+void CMainSignals::BackgroundBlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex) {
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BackgroundBlockConnected(pblock, pindex);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
@@ -234,8 +538,8 @@ void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, c
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
 {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockDisconnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockDisconnected(pblock, pindex);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
@@ -243,8 +547,8 @@ void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    auto event = [locator, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.ChainStateFlushed(locator); });
+    auto event = [locator](CValidationInterface& callbacks) {
+        callbacks.ChainStateFlushed(locator);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s", __func__,
                           locator.IsNull() ? "null" : locator.vHave.front().ToString());
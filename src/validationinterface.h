@@ -10,8 +10,12 @@
 #include <primitives/transaction.h> // CTransaction(Ref)
 #include <sync.h>
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 class BlockValidationState;
 class CBlock;
@@ -21,6 +25,11 @@ class CValidationInterface;
 class CScheduler;
 enum class MemPoolRemovalReason;
 
+/** Default number of threads running background callbacks (0 runs them on the scheduler thread) */
+static constexpr int DEFAULT_VALIDATION_CALLBACK_THREADS{2};
+/** Maximum number of background callbacks validation lets a single subscriber fall behind by default */
+static constexpr size_t DEFAULT_MAX_VALIDATION_BACKLOG{10};
+
 /** Register subscriber */
 void RegisterValidationInterface(CValidationInterface* callbacks);
 /** Unregister subscriber. DEPRECATED. This is not safe to use when the RPC server or main message handler thread is running. */
@@ -47,6 +56,14 @@ void UnregisterSharedValidationInterface(std::shared_ptr<CValidationInterface> c
  * will result in a deadlock (that DEBUG_LOCKORDER will miss).
  */
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+/**
+ * Pushes a function onto the notification queue of a single subscriber, to be
+ * called after all callbacks to that subscriber generated prior to now and
+ * before any callbacks to it generated later. Other subscribers may be ahead
+ * or behind. Falls back to the function above if the subscriber is not
+ * registered.
+ */
+void CallFunctionInValidationInterfaceQueue(CValidationInterface& callbacks, std::function<void ()> func);
 /**
  * This is a synonym for the following, which asserts certain locks are not
  * held:
@@ -71,7 +88,9 @@ void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
  * UpdatedBlockTip() callback may depend on an operation performed in
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
- * ValidationInterface() subscribers.
+ * ValidationInterface() subscribers: each subscriber has its own queue of
+ * background callbacks and the queues of different subscribers are run
+ * concurrently.
  */
 class CValidationInterface {
 protected:
@@ -136,6 +155,14 @@ protected:
      * Called on a background thread.
      */
     virtual void BlockConnected(const std::shared_ptr<const CBlock> &block, const CBlockIndex *pindex) {}
+    /**
+     * peercoin: notifies listeners of a block below the base of a UTXO
+     * snapshot being connected by the background validation chainstate.
+     * BlockConnected() is only called for the active chainstate.
+     *
+     * Called on a background thread.
+     */
+    virtual void BackgroundBlockConnected(const std::shared_ptr<const CBlock> &block, const CBlockIndex *pindex) {}
     /**
      * Notifies listeners of a block being disconnected
      *
@@ -170,10 +197,30 @@ protected:
      * Notifies listeners that a block which builds directly on our current tip
      * has been received and connected to the headers tree, though not validated yet */
     virtual void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) {};
+    /** Name of the subscriber, used in logs and queue statistics */
+    virtual std::string GetSubscriberName() const { return "unnamed"; }
     friend class CMainSignals;
+    friend class MainSignalsImpl;
     friend class ValidationInterfaceTest;
 };
 
+/** State of the background callback queue of one subscriber */
+struct ValidationSubscriberStats {
+    std::string name;
+    //! False for subscribers that have been unregistered but whose queue still holds callbacks
+    bool registered{true};
+    size_t pending{0};
+    uint64_t processed{0};
+    //! Callbacks dropped because the subscriber was unregistered before they ran
+    uint64_t skipped{0};
+    //! Time the oldest pending callback has been waiting
+    std::chrono::microseconds oldest_pending_age{0};
+    //! Time between queuing and running of the last and of the slowest callback
+    std::chrono::microseconds last_lag{0};
+    std::chrono::microseconds max_lag{0};
+    std::chrono::microseconds max_exec_time{0};
+};
+
 class MainSignalsImpl;
 class CMainSignals {
 private:
@@ -183,22 +230,33 @@ private:
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+    friend void ::CallFunctionInValidationInterfaceQueue(CValidationInterface& callbacks, std::function<void ()> func);
 
 public:
-    /** Register a CScheduler to give callbacks which should run in the background (may only be called once) */
-    void RegisterBackgroundSignalScheduler(CScheduler& scheduler);
+    /**
+     * Register a CScheduler to give callbacks which should run in the background (may only be called once).
+     * With worker_threads > 0 the callbacks run on that many dedicated threads instead of the scheduler.
+     * max_backlog is the number of callbacks a subscriber may fall behind before LimitBacklog() waits
+     * for it (0 for no limit).
+     */
+    void RegisterBackgroundSignalScheduler(CScheduler& scheduler, int worker_threads = 0, size_t max_backlog = DEFAULT_MAX_VALIDATION_BACKLOG);
     /** Unregister a CScheduler to give callbacks which should run in the background - these callbacks will now be dropped! */
     void UnregisterBackgroundSignalScheduler();
     /** Call any remaining callbacks on the calling thread */
     void FlushBackgroundCallbacks();
 
+    /** Number of callbacks pending in the longest subscriber queue */
     size_t CallbacksPending();
+    /** Wait for subscribers that are further behind than the configured backlog limit to catch up */
+    void LimitBacklog() LOCKS_EXCLUDED(cs_main);
+    std::vector<ValidationSubscriberStats> GetSubscriberStats();
 
 
     void UpdatedBlockTip(const CBlockIndex *, const CBlockIndex *, bool fInitialDownload);
     void TransactionAddedToMempool(const CTransactionRef&, uint64_t mempool_sequence);
     void TransactionRemovedFromMempool(const CTransactionRef&, MemPoolRemovalReason, uint64_t mempool_sequence);
     void BlockConnected(const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex);
+    void BackgroundBlockConnected(const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex);
     void BlockDisconnected(const std::shared_ptr<const CBlock> &, const CBlockIndex* pindex);
     void ChainStateFlushed(const CBlockLocator &);
     void BlockChecked(const CBlock&, const BlockValidationState&);
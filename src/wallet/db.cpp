@@ -9,6 +9,7 @@
 #include <util/system.h>
 #include <wallet/db.h>
 
+#include <algorithm>
 #include <exception>
 #include <fstream>
 #include <string>
@@ -16,6 +17,37 @@
 #include <vector>
 
 namespace wallet {
+namespace {
+class PrefixFilterCursor : public DatabaseCursor
+{
+public:
+    PrefixFilterCursor(std::unique_ptr<DatabaseCursor> cursor, Span<const std::byte> prefix)
+        : m_cursor{std::move(cursor)}, m_prefix{prefix.begin(), prefix.end()} {}
+
+    Status Next(DataStream& key, DataStream& value) override
+    {
+        while (true) {
+            key.clear();
+            value.clear();
+            const Status status{m_cursor->Next(key, value)};
+            if (status != Status::MORE) return status;
+            if (key.size() >= m_prefix.size() && std::equal(m_prefix.begin(), m_prefix.end(), key.begin())) return status;
+        }
+    }
+
+private:
+    const std::unique_ptr<DatabaseCursor> m_cursor;
+    const std::vector<std::byte> m_prefix;
+};
+} // namespace
+
+std::unique_ptr<DatabaseCursor> DatabaseBatch::GetNewPrefixCursor(Span<const std::byte> prefix)
+{
+    std::unique_ptr<DatabaseCursor> cursor{GetNewCursor()};
+    if (!cursor) return nullptr;
+    return std::make_unique<PrefixFilterCursor>(std::move(cursor), prefix);
+}
+
 std::vector<fs::path> ListDatabases(const fs::path& wallet_dir)
 {
     std::vector<fs::path> paths;
@@ -143,6 +175,7 @@ void ReadDatabaseArgs(const ArgsManager& args, DatabaseOptions& options)
 {
     // Override current options with args values, if any were specified
     options.use_unsafe_sync = args.GetBoolArg("-unsafesqlitesync", options.use_unsafe_sync);
+    options.use_full_sync = args.GetBoolArg("-walletfullsync", options.use_full_sync);
     options.use_shared_memory = !args.GetBoolArg("-privdb", !options.use_shared_memory);
     options.max_log_mb = args.GetIntArg("-dblogsize", options.max_log_mb);
 }
@@ -9,14 +9,17 @@
 #include <clientversion.h>
 
 #include <util/fs.h>
+#include <span.h>
 #include <streams.h>
 #include <support/allocators/secure.h>
 #include <util/fs.h>
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 class ArgsManager;
 struct bilingual_str;
@@ -114,11 +117,26 @@ public:
     }
 
     virtual std::unique_ptr<DatabaseCursor> GetNewCursor() = 0;
+    /** Cursor over the records whose key starts with prefix, in key order.
+     * The default implementation skips other records of a full cursor. */
+    virtual std::unique_ptr<DatabaseCursor> GetNewPrefixCursor(Span<const std::byte> prefix);
     virtual bool TxnBegin() = 0;
     virtual bool TxnCommit() = 0;
     virtual bool TxnAbort() = 0;
 };
 
+/** Write activity of a database since it was opened */
+struct DatabaseWriteStats {
+    //! Records written or erased
+    uint64_t writes{0};
+    //! Transactions committed, including single writes outside of a transaction
+    uint64_t commits{0};
+    std::chrono::microseconds write_time{0};
+    std::chrono::microseconds max_write_time{0};
+    std::chrono::microseconds commit_time{0};
+    std::chrono::microseconds max_commit_time{0};
+};
+
 /** An instance of this class represents one database.
  **/
 class WalletDatabase
@@ -173,6 +191,37 @@ public:
 
     /** Make a DatabaseBatch connected to this database */
     virtual std::unique_ptr<DatabaseBatch> MakeBatch(bool flush_on_close = true) = 0;
+
+    /** Commit the writes of all batches made on this thread until
+     * EndWriteGroup() together, as one transaction. Groups may nest, only the
+     * outermost one commits.
+     * Batches may still use their own transactions within a group. Returns
+     * false if the backend does not support write groups, in which case
+     * every write is committed on its own as usual. */
+    virtual bool BeginWriteGroup() { return false; }
+    virtual void EndWriteGroup() {}
+
+    /** Make the writes committed so far, or by the transaction or write group
+     * in progress on this thread once it commits, survive a power failure.
+     * Used after writing key material, for backends that do not sync every
+     * commit. */
+    virtual void MakeDurable() {}
+
+    virtual DatabaseWriteStats GetWriteStats() const { return {}; }
+};
+
+/** RAII helper grouping the writes to a database while in scope, see WalletDatabase::BeginWriteGroup() */
+class DatabaseWriteGroup
+{
+public:
+    explicit DatabaseWriteGroup(WalletDatabase& database) : m_database(database), m_active(database.BeginWriteGroup()) {}
+    ~DatabaseWriteGroup() { if (m_active) m_database.EndWriteGroup(); }
+    DatabaseWriteGroup(const DatabaseWriteGroup&) = delete;
+    DatabaseWriteGroup& operator=(const DatabaseWriteGroup&) = delete;
+
+private:
+    WalletDatabase& m_database;
+    const bool m_active;
 };
 
 class DummyCursor : public DatabaseCursor
@@ -234,6 +283,7 @@ struct DatabaseOptions {
     // Specialized options. Not every option is supported by every backend.
     bool verify = true;             //!< Check data integrity on load.
     bool use_unsafe_sync = false;   //!< Disable file sync for faster performance.
+    bool use_full_sync = false;     //!< Sync every transaction to disk, not only at checkpoints.
     bool use_shared_memory = false; //!< Let other processes access the database.
     int64_t max_log_mb = 100;       //!< Max log size to allow before consolidating.
 };
@@ -320,6 +320,67 @@ bool CachedTxIsTrusted(const CWallet& wallet, const CWalletTx& wtx)
     return CachedTxIsTrusted(wallet, wtx, trusted_parents);
 }
 
+static Balance GetTxBalance(const CWallet& wallet, const CWalletTx& wtx, const int min_depth, const isminefilter reuse_filter, std::set<uint256>& trusted_parents)
+    EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
+{
+    Balance ret;
+    const bool is_trusted{CachedTxIsTrusted(wallet, wtx, trusted_parents)};
+    const int tx_depth{wallet.GetTxDepthInMainChain(wtx)};
+    const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_SPENDABLE | reuse_filter)};
+    const CAmount tx_credit_watchonly{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_WATCH_ONLY | reuse_filter)};
+    if (is_trusted && tx_depth >= min_depth) {
+        ret.m_mine_trusted = tx_credit_mine;
+        ret.m_watchonly_trusted = tx_credit_watchonly;
+    }
+    if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
+        ret.m_mine_untrusted_pending = tx_credit_mine;
+        ret.m_watchonly_untrusted_pending = tx_credit_watchonly;
+    }
+    ret.m_mine_immature = CachedTxGetImmatureCredit(wallet, wtx, ISMINE_SPENDABLE);
+    ret.m_watchonly_immature = CachedTxGetImmatureCredit(wallet, wtx, ISMINE_WATCH_ONLY);
+    return ret;
+}
+
+static void AddBalance(Balance& total, const Balance& tx, const int sign)
+{
+    total.m_mine_trusted += sign * tx.m_mine_trusted;
+    total.m_mine_untrusted_pending += sign * tx.m_mine_untrusted_pending;
+    total.m_mine_immature += sign * tx.m_mine_immature;
+    total.m_mine_stake += sign * tx.m_mine_stake;
+    total.m_watchonly_trusted += sign * tx.m_watchonly_trusted;
+    total.m_watchonly_untrusted_pending += sign * tx.m_watchonly_untrusted_pending;
+    total.m_watchonly_immature += sign * tx.m_watchonly_immature;
+}
+
+static bool IsZero(const Balance& balance)
+{
+    return balance.m_mine_trusted == 0 && balance.m_mine_untrusted_pending == 0 && balance.m_mine_immature == 0 && balance.m_mine_stake == 0 &&
+           balance.m_watchonly_trusted == 0 && balance.m_watchonly_untrusted_pending == 0 && balance.m_watchonly_immature == 0;
+}
+
+/** Recompute the contribution of a transaction to a balance cache. */
+static void UpdateCachedBalance(const CWallet& wallet, CWallet::BalanceCache& cache, const uint256& hash, const isminefilter reuse_filter, std::set<uint256>& trusted_parents)
+    EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
+{
+    const auto old_it{cache.txs.find(hash)};
+    if (old_it != cache.txs.end()) {
+        AddBalance(cache.total, old_it->second, -1);
+        cache.txs.erase(old_it);
+    }
+    cache.immature.erase(hash);
+
+    const CWalletTx* wtx{wallet.GetWalletTx(hash)};
+    if (!wtx) return;
+    const Balance tx_balance{GetTxBalance(wallet, *wtx, /*min_depth=*/0, reuse_filter, trusted_parents)};
+    if (!IsZero(tx_balance)) {
+        AddBalance(cache.total, tx_balance, 1);
+        cache.txs.emplace(hash, tx_balance);
+    }
+    if (wallet.IsTxImmatureCoinBase(*wtx) && wallet.IsTxInMainChain(*wtx)) {
+        cache.immature.insert(hash);
+    }
+}
+
 Balance GetBalance(const CWallet& wallet, const int min_depth, bool avoid_reuse)
 {
     Balance ret;
@@ -327,24 +388,27 @@ Balance GetBalance(const CWallet& wallet, const int min_depth, bool avoid_reuse)
     {
         LOCK(wallet.cs_wallet);
         std::set<uint256> trusted_parents;
-        for (const auto& entry : wallet.mapWallet)
-        {
-            const CWalletTx& wtx = entry.second;
-            const bool is_trusted{CachedTxIsTrusted(wallet, wtx, trusted_parents)};
-            const int tx_depth{wallet.GetTxDepthInMainChain(wtx)};
-            const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_SPENDABLE | reuse_filter)};
-            const CAmount tx_credit_watchonly{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_WATCH_ONLY | reuse_filter)};
-            if (is_trusted && tx_depth >= min_depth) {
-                ret.m_mine_trusted += tx_credit_mine;
-                ret.m_watchonly_trusted += tx_credit_watchonly;
+        if (min_depth != 0) {
+            for (const auto& entry : wallet.mapWallet) {
+                AddBalance(ret, GetTxBalance(wallet, entry.second, min_depth, reuse_filter, trusted_parents), 1);
+            }
+            return ret;
+        }
+
+        CWallet::BalanceCache& cache{wallet.m_balance_cache[avoid_reuse]};
+        if (cache.stale) {
+            cache = CWallet::BalanceCache{};
+            for (const auto& entry : wallet.mapWallet) {
+                UpdateCachedBalance(wallet, cache, entry.first, reuse_filter, trusted_parents);
             }
-            if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
-                ret.m_mine_untrusted_pending += tx_credit_mine;
-                ret.m_watchonly_untrusted_pending += tx_credit_watchonly;
+            cache.stale = false;
+        } else {
+            for (const uint256& hash : cache.dirty) {
+                UpdateCachedBalance(wallet, cache, hash, reuse_filter, trusted_parents);
             }
-            ret.m_mine_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_SPENDABLE);
-            ret.m_watchonly_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_WATCH_ONLY);
+            cache.dirty.clear();
         }
+        ret = cache.total;
     }
     return ret;
 }
@@ -2,20 +2,27 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chain.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <interfaces/chain.h>
 #include <key_io.h>
 #include <policy/policy.h>
+#include <rpc/blockchain.h>
 #include <rpc/rawtransaction_util.h>
 #include <rpc/util.h>
 #include <timedata.h>
 #include <util/fees.h>
+#include <util/moneystr.h>
 #include <util/rbf.h>
 #include <util/translation.h>
 #include <util/vector.h>
+#include <validation.h>
 #include <wallet/coincontrol.h>
+#include <wallet/context.h>
 #include <wallet/rpc/util.h>
 #include <wallet/spend.h>
+#include <wallet/utxoplan.h>
 #include <wallet/wallet.h>
 
 #include <univalue.h>
@@ -261,112 +268,190 @@ RPCHelpMan sendtoaddress()
 RPCHelpMan optimizeutxoset()
 {
     return RPCHelpMan{"optimizeutxoset",
-                "\nOptimize the UTXO set in order to maximize the PoS yield. This is only valid for continuous minting. The accumulated coinage will be reset!" +
+                "\nOptimize the UTXO set in order to maximize the PoS yield. This is only valid for continuous minting.\n"
+                "Coins above the output amount are split and coins below a third of it are merged, in as many transactions as needed.\n"
+                "An operation is only part of the plan if the expected minting reward it adds over the horizon exceeds its fee and the coin age it resets." +
         HELP_REQUIRING_PASSPHRASE,
                 {
-                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The peercoin address to recieve all the new UTXOs. If not provided, new UTOXs will be assigned to the address of the input UTXOs."},
-                    {"amount", RPCArg::Type::AMOUNT, RPCArg::Optional::NO, "The " + CURRENCY_UNIT + " amount to set the value of new UTXOs, i.e. make new UTXOs with value of 110. If amount is not provided, hardcoded value will be used."},
-                    {"transmit", RPCArg::Type::BOOL, RPCArg::Default{false}, "If true, transmit transaction after generating it."},
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The peercoin address to recieve all the new UTXOs."},
+                    {"amount", RPCArg::Type::AMOUNT, RPCArg::DefaultHint{"the rfc28 target for the balance"}, "The " + CURRENCY_UNIT + " amount to set the value of new UTXOs, i.e. make new UTXOs with value of 110. 0 uses the rfc28 target."},
+                    {"transmit", RPCArg::Type::BOOL, RPCArg::Default{false}, "If true, transmit the transactions after generating them."},
                     {"fromAddress", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The peercoin address to split coins from. If not provided, all available coins will be used."},
-                },
-                {
-                    RPCResult{"if transmit is not set or set to false",
-                        RPCResult::Type::OBJ, "", "",
+                    {"options", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
                         {
-                            {RPCResult::Type::STR_HEX, "tx", /*optional=*/true, "The transaction hex."}
+                            {"max_tx_size", RPCArg::Type::NUM, RPCArg::Default{(int)DEFAULT_UTXO_PLAN_MAX_TX_SIZE}, "The maximum size of each transaction in bytes"},
+                            {"max_transactions", RPCArg::Type::NUM, RPCArg::Default{(int)DEFAULT_UTXO_PLAN_MAX_TRANSACTIONS}, "The maximum number of transactions"},
+                            {"horizon_days", RPCArg::Type::NUM, RPCArg::Default{DEFAULT_UTXO_PLAN_HORIZON_DAYS}, "The number of days over which an operation has to pay off"},
                         },
                     },
-                    RPCResult{"if transmit is set to true",
-                        RPCResult::Type::OBJ, "", "",
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::STR_AMOUNT, "target_amount", "The amount of the new UTXOs"},
+                        {RPCResult::Type::NUM, "transactions", "The number of transactions of the plan"},
+                        {RPCResult::Type::STR_AMOUNT, "fees", "The fees of the transactions, as estimated by the plan"},
+                        {RPCResult::Type::STR_AMOUNT, "lost_reward", "The minting reward earned by the coin age of the spent coins"},
+                        {RPCResult::Type::STR_AMOUNT, "yearly_reward_before", "The expected yearly minting reward of the coins before the plan"},
+                        {RPCResult::Type::STR_AMOUNT, "yearly_reward_after", "The expected yearly minting reward of the coins after the plan"},
+                        {RPCResult::Type::NUM, "coins_kept", "The number of coins left as they are"},
+                        {RPCResult::Type::ARR, "txids", /*optional=*/true, "if transmit is set to true",
                         {
-                            {RPCResult::Type::STR_HEX, "txid", /*optional=*/true, "The transaction id."}
-                        },
+                            {RPCResult::Type::STR_HEX, "", "The transaction id"},
+                        }},
+                        {RPCResult::Type::ARR, "txs", /*optional=*/true, "if transmit is not set or set to false",
+                        {
+                            {RPCResult::Type::STR_HEX, "", "The transaction hex"},
+                        }},
+                        {RPCResult::Type::STR_HEX, "txid", /*optional=*/true, "DEPRECATED: the first element of txids"},
+                        {RPCResult::Type::STR_HEX, "tx", /*optional=*/true, "DEPRECATED: the first element of txs"},
                     },
                 },
                 RPCExamples{
                     "\nTrigger UTXO optimization and assign all the new UTXOs to some peercoin address with user defined UTXO value\n"
                     + HelpExampleCli("optimizeutxoset", EXAMPLE_ADDRESS[0] + " 110")
+                    + "\nPlan an optimization towards the rfc28 target in transactions of at most 20000 bytes\n"
+                    + HelpExampleCli("-named optimizeutxoset", "address=" + EXAMPLE_ADDRESS[0] + " options='{\"max_tx_size\": 20000}'")
                },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     std::shared_ptr<CWallet> const pwallet = GetWalletForJSONRPCRequest(request);
     if (!pwallet) return UniValue::VNULL;
+    const WalletContext& context = EnsureWalletContext(request.context);
 
     // Make sure the results are valid at least up to the most recent block
     // the user could have gotten from another RPC command prior to now
     pwallet->BlockUntilSyncedToCurrentChain();
 
-    LOCK(pwallet->cs_wallet);
-
-    EnsureWalletIsUnlocked(*pwallet);
-    CAmount availableCoins = 0;
-
-    mapValue_t mapValue;
-    CCoinControl coin_control;
     const std::string address = request.params[0].get_str();
-    std::vector<CRecipient> recipients;
+    CTxDestination dest = DecodeDestination(address);
+    if (!IsValidDestination(dest)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, std::string("Invalid Peercoin address: ") + address);
+    }
+    const CScript script_pub_key = GetScriptForDestination(dest);
+    const CAmount amount{request.params[1].isNull() ? 0 : AmountFromValue(request.params[1])};
     const bool transmit{request.params[2].isNull() ? false : request.params[2].get_bool()};
-    int nChangePosRet = -1;
-    bilingual_str error;
-    CTransactionRef tx;
-
-    if (request.params[3].isNull() == false) {
-        std::vector<COutput> vAvailableCoins;
-        vAvailableCoins = AvailableCoins(*pwallet, &coin_control).All();
-        CTxDestination tmpAddress, fromAddress;
-        fromAddress = DecodeDestination(request.params[3].get_str());
-        for (const COutput& out : vAvailableCoins) {
-            const CScript& scriptPubKey = out.txout.scriptPubKey;
-            bool fValidAddress = ExtractDestination(scriptPubKey, tmpAddress);
-            if (fValidAddress && (tmpAddress == fromAddress)) {
-                coin_control.Select(COutPoint(out.outpoint.hash, out.outpoint.n));
-                availableCoins += out.txout.nValue;
-            }
+    std::optional<CTxDestination> from_address;
+    if (!request.params[3].isNull()) {
+        from_address = DecodeDestination(request.params[3].get_str());
+        if (!IsValidDestination(*from_address)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, std::string("Invalid Peercoin address: ") + request.params[3].get_str());
         }
-        coin_control.m_allow_other_inputs = false;
-    } else {
-        availableCoins = AvailableCoins(*pwallet).GetTotalAmount();
     }
 
-    if (availableCoins == 0) {
-        LogPrintf("no available coins to optimize\n");
-        return UniValue::VOBJ;
+    const Consensus::Params& consensus = Params().GetConsensus();
+    UtxoPlanParams plan_params;
+    plan_params.output_bytes = ::GetSerializeSize(CTxOut(0, script_pub_key), PROTOCOL_VERSION);
+    plan_params.now = TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime());
+    plan_params.stake_min_age = consensus.nStakeMinAge;
+    plan_params.stake_max_age = consensus.nStakeMaxAge;
+    if (!request.params[4].isNull()) {
+        const UniValue& options = request.params[4];
+        RPCTypeCheckObj(options,
+            {
+                {"max_tx_size", UniValueType(UniValue::VNUM)},
+                {"max_transactions", UniValueType(UniValue::VNUM)},
+                {"horizon_days", UniValueType(UniValue::VNUM)},
+            },
+            true, true);
+        if (options.exists("max_tx_size")) {
+            const int64_t max_tx_size{options["max_tx_size"].getInt<int64_t>()};
+            const int64_t max_standard_size{MAX_STANDARD_TX_WEIGHT / WITNESS_SCALE_FACTOR};
+            if (max_tx_size < 1000 || max_tx_size > max_standard_size) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid max_tx_size, must be between 1000 and %d", max_standard_size));
+            }
+            plan_params.max_tx_bytes = max_tx_size;
+        }
+        if (options.exists("max_transactions")) {
+            const int max_transactions{options["max_transactions"].getInt<int>()};
+            if (max_transactions < 1) throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid max_transactions, must be at least 1");
+            plan_params.max_transactions = max_transactions;
+        }
+        if (options.exists("horizon_days")) {
+            plan_params.horizon_days = options["horizon_days"].getInt<int>();
+            if (plan_params.horizon_days < 1) throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid horizon_days, must be at least 1");
+        }
+    }
+    {
+        LOCK(cs_main);
+        const CBlockIndex* tip{context.chain->chainman().ActiveChain().Tip()};
+        plan_params.difficulty = GetDifficulty(GetLastBlockIndex(tip, true), tip);
+        plan_params.money_supply = tip->nMoneySupply;
     }
 
-    LogPrintf("optimizing outputs %d satoshis\n", availableCoins);
+    LOCK(pwallet->cs_wallet);
 
-    CTxDestination dest = DecodeDestination(address);
-    if (!IsValidDestination(dest)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, std::string("Invalid Peercoin address: ") + address);
-    }
+    EnsureWalletIsUnlocked(*pwallet);
 
-    CScript script_pub_key = GetScriptForDestination(dest);
-    CAmount amount = AmountFromValue(request.params[1]);
-    CAmount remaining = availableCoins;
+    std::vector<UtxoPlanCoin> coins;
+    CAmount balance = 0;
+    for (const COutput& out : AvailableCoins(*pwallet).All()) {
+        if (!out.spendable || out.input_bytes <= 0) continue;
+        if (from_address) {
+            CTxDestination out_address;
+            const bool from{ExtractDestination(out.txout.scriptPubKey, out_address) && out_address == *from_address};
+            if (!from) continue;
+        }
+        coins.push_back({out.outpoint, out.txout.nValue, out.time, out.input_bytes});
+        balance += out.txout.nValue;
+    }
 
-    CRecipient recipient = {script_pub_key, amount, false};
-    CAmount fee = GetMinFee( 2000 + remaining / amount * 40, TicksSinceEpoch<std::chrono::seconds>(GetAdjustedTime())); // very approximate
-    while (remaining > amount + fee) {
-        recipients.push_back(recipient);
-        remaining -= amount;
+    if (amount > 0) {
+        plan_params.target_amount = amount;
+        plan_params.combine_threshold = amount / RECOMBINE_DIVISOR;
+    } else if (balance > 0) {
+        const StakeOutputTarget target{GetStakeOutputTarget(plan_params.difficulty, plan_params.money_supply, consensus, balance)};
+        plan_params.target_amount = target.amount;
+        plan_params.combine_threshold = target.combine_threshold;
+        plan_params.constrained = target.constrained;
     }
 
-    auto res = CreateTransaction(*pwallet, recipients, nChangePosRet, coin_control, true);
-    if (!res) {
-        error = util::ErrorString(res);
-        throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, error.original);
+    const UtxoPlan plan{PlanUtxoSet(std::move(coins), plan_params)};
+    LogPrintf("optimizeutxoset: %d transactions, fees %s, yearly reward %s -> %s\n", plan.txs.size(), FormatMoney(plan.fees),
+              FormatMoney(plan.yearly_reward_before), FormatMoney(plan.yearly_reward_after));
+
+    // Build all transactions before transmitting any of them
+    std::vector<CTransactionRef> txs;
+    for (const UtxoPlanTx& plan_tx : plan.txs) {
+        CCoinControl coin_control;
+        coin_control.m_allow_other_inputs = false;
+        for (const COutPoint& input : plan_tx.inputs) {
+            coin_control.Select(input);
+        }
+        std::vector<CRecipient> recipients;
+        for (const CAmount output : plan_tx.outputs) {
+            recipients.push_back({script_pub_key, output, false});
+        }
+        recipients.back().fSubtractFeeFromAmount = true;
+        auto res = CreateTransaction(*pwallet, recipients, /*change_pos=*/-1, coin_control, true);
+        if (!res) {
+            throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, util::ErrorString(res).original);
+        }
+        txs.push_back(res->tx);
     }
-    const auto& txr = *res;
-    tx = txr.tx;
 
     UniValue entry(UniValue::VOBJ);
-    if (transmit) {
-        pwallet->CommitTransaction(tx, std::move(mapValue), {} /* orderForm */);
-        entry.pushKV("txid", tx->GetHash().GetHex());
+    entry.pushKV("target_amount", ValueFromAmount(plan_params.target_amount));
+    entry.pushKV("transactions", (uint64_t)txs.size());
+    entry.pushKV("fees", ValueFromAmount(plan.fees));
+    entry.pushKV("lost_reward", ValueFromAmount(plan.lost_reward));
+    entry.pushKV("yearly_reward_before", ValueFromAmount(plan.yearly_reward_before));
+    entry.pushKV("yearly_reward_after", ValueFromAmount(plan.yearly_reward_after));
+    entry.pushKV("coins_kept", (uint64_t)plan.coins_kept);
+    UniValue result_txs(UniValue::VARR);
+    for (const CTransactionRef& tx : txs) {
+        if (transmit) {
+            pwallet->CommitTransaction(tx, {} /* mapValue */, {} /* orderForm */);
+            result_txs.push_back(tx->GetHash().GetHex());
+        } else {
+            result_txs.push_back(EncodeHexTx(*tx));
+        }
     }
-    else {
-        entry.pushKV("tx", EncodeHexTx(*tx));
+    // Keep the keys of the single transaction this command used to create
+    if (!result_txs.empty()) {
+        entry.pushKV(transmit ? "txid" : "tx", result_txs[0]);
     }
+    entry.pushKV(transmit ? "txids" : "txs", result_txs);
     return entry;
 },
     };
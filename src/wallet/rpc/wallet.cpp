@@ -11,6 +11,7 @@
 #include <rpc/util.h>
 #include <timedata.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <util/translation.h>
 #include <wallet/context.h>
 #include <wallet/receive.h>
@@ -77,6 +78,25 @@ static RPCHelpMan getwalletinfo()
                         }, /*skip_type_check=*/true},
                         {RPCResult::Type::BOOL, "descriptors", "whether this wallet uses descriptors for scriptPubKey management"},
                         {RPCResult::Type::BOOL, "external_signer", "whether this wallet is configured to use an external signer such as a hardware wallet"},
+                        {RPCResult::Type::OBJ, "database_writes", "database write activity since the wallet was loaded",
+                        {
+                            {RPCResult::Type::NUM, "writes", "number of records written or erased"},
+                            {RPCResult::Type::NUM, "commits", "number of transactions committed, counting writes outside of a transaction as one each"},
+                            {RPCResult::Type::NUM, "average_write_us", "average time of a write in microseconds"},
+                            {RPCResult::Type::NUM, "max_write_us", "longest write in microseconds"},
+                            {RPCResult::Type::NUM, "average_commit_us", "average time of a commit in microseconds"},
+                            {RPCResult::Type::NUM, "max_commit_us", "longest commit in microseconds"},
+                        }},
+                        {RPCResult::Type::OBJ, "staking", "proof-of-stake minting of this wallet",
+                        {
+                            {RPCResult::Type::BOOL, "enabled", "false if the disable_staking flag leaves this wallet out of minting"},
+                            {RPCResult::Type::NUM, "coins", /*optional=*/true, "number of coins in the last kernel search"},
+                            {RPCResult::Type::STR_AMOUNT, "balance", /*optional=*/true, "amount of the coins in the last kernel search"},
+                            {RPCResult::Type::NUM, "searches", "kernel searches that included this wallet since it was loaded"},
+                            {RPCResult::Type::NUM_TIME, "last_search", "the " + UNIX_EPOCH_TIME + " of the last kernel search, 0 if none"},
+                            {RPCResult::Type::NUM, "kernels", "kernels found for the coins of this wallet"},
+                            {RPCResult::Type::NUM, "blocks", "minted blocks accepted by this node"},
+                        }},
                     }},
                 },
                 RPCExamples{
@@ -138,6 +158,26 @@ static RPCHelpMan getwalletinfo()
     }
     obj.pushKV("descriptors", pwallet->IsWalletFlagSet(WALLET_FLAG_DESCRIPTORS));
     obj.pushKV("external_signer", pwallet->IsWalletFlagSet(WALLET_FLAG_EXTERNAL_SIGNER));
+    const DatabaseWriteStats db_stats{pwallet->GetDatabase().GetWriteStats()};
+    UniValue database_writes(UniValue::VOBJ);
+    database_writes.pushKV("writes", db_stats.writes);
+    database_writes.pushKV("commits", db_stats.commits);
+    database_writes.pushKV("average_write_us", db_stats.writes ? count_microseconds(db_stats.write_time) / int64_t(db_stats.writes) : 0);
+    database_writes.pushKV("max_write_us", count_microseconds(db_stats.max_write_time));
+    database_writes.pushKV("average_commit_us", db_stats.commits ? count_microseconds(db_stats.commit_time) / int64_t(db_stats.commits) : 0);
+    database_writes.pushKV("max_commit_us", count_microseconds(db_stats.max_commit_time));
+    obj.pushKV("database_writes", database_writes);
+    UniValue staking(UniValue::VOBJ);
+    staking.pushKV("enabled", !pwallet->IsWalletFlagSet(WALLET_FLAG_DISABLE_STAKING));
+    if (const auto stake_coins{pwallet->GetStakeSnapshot()}) {
+        staking.pushKV("coins", (uint64_t)stake_coins->coins.size());
+        staking.pushKV("balance", ValueFromAmount(stake_coins->balance));
+    }
+    staking.pushKV("searches", pwallet->m_staking_stats.searches.load());
+    staking.pushKV("last_search", pwallet->m_staking_stats.last_search.load());
+    staking.pushKV("kernels", pwallet->m_staking_stats.kernels.load());
+    staking.pushKV("blocks", pwallet->m_staking_stats.blocks.load());
+    obj.pushKV("staking", staking);
     return obj;
 },
     };
@@ -556,6 +596,7 @@ static RPCHelpMan importcoinstake()
         }
 
         // add to in memory structure
+        LOCK(pwallet->m_coinstakes_mutex);
         pwallet->m_coinstakes[timestamp] = tx;
     }
     UniValue result(UniValue::VOBJ);
@@ -679,7 +720,7 @@ static RPCHelpMan listminting()
         }
     }
 
-    if (pwallet->m_coinstakes.size()) {
+    if (LOCK(pwallet->m_coinstakes_mutex); pwallet->m_coinstakes.size()) {
         for (const auto& [timestamp, txn] : pwallet->m_coinstakes) {
             UniValue obj(UniValue::VOBJ);
             CTxDestination address;
@@ -11,15 +11,22 @@
 #include <util/bip32.h>
 #include <util/strencodings.h>
 #include <util/string.h>
+#include <util/system.h>
+#include <util/thread.h>
 #include <util/time.h>
 #include <util/translation.h>
 #include <wallet/scriptpubkeyman.h>
 
+#include <algorithm>
 #include <optional>
+#include <thread>
 
 namespace wallet {
 //! Value for the first BIP 32 hardened derivation. Can be used as a bit mask and as a value. See BIP 32 for more details.
 const uint32_t BIP32_HARDENED_KEY_LIMIT = 0x80000000;
+//! Descriptor indices each thread derives at least when topping up, and the most threads used
+static constexpr int MIN_TOPUP_INDICES_PER_THREAD{100};
+static constexpr int MAX_TOPUP_THREADS{8};
 
 util::Result<CTxDestination> LegacyScriptPubKeyMan::GetNewDestination(const OutputType type)
 {
@@ -2171,36 +2178,76 @@ bool DescriptorScriptPubKeyMan::TopUp(unsigned int size)
     FlatSigningProvider provider;
     provider.keys = GetKeys();
 
-    WalletBatch batch(m_storage.GetDatabase());
-    uint256 id = GetID();
-    for (int32_t i = m_max_cached_index + 1; i < new_range_end; ++i) {
+    struct ExpandedIndex {
+        bool expanded{false};
+        std::vector<CScript> scripts;
         FlatSigningProvider out_keys;
-        std::vector<CScript> scripts_temp;
-        DescriptorCache temp_cache;
+        DescriptorCache cache;
+    };
+    const auto expand = [&](int32_t i, ExpandedIndex& result) {
         // Maybe we have a cached xpub and we can expand from the cache first
-        if (!m_wallet_descriptor.descriptor->ExpandFromCache(i, m_wallet_descriptor.cache, scripts_temp, out_keys)) {
-            if (!m_wallet_descriptor.descriptor->Expand(i, provider, scripts_temp, out_keys, &temp_cache)) return false;
-        }
-        // Add all of the scriptPubKeys to the scriptPubKey set
-        for (const CScript& script : scripts_temp) {
-            m_map_script_pub_keys[script] = i;
-        }
-        for (const auto& pk_pair : out_keys.pubkeys) {
-            const CPubKey& pubkey = pk_pair.second;
-            if (m_map_pubkeys.count(pubkey) != 0) {
-                // We don't need to give an error here.
-                // It doesn't matter which of many valid indexes the pubkey has, we just need an index where we can derive it and it's private key
-                continue;
+        result.expanded = m_wallet_descriptor.descriptor->ExpandFromCache(i, m_wallet_descriptor.cache, result.scripts, result.out_keys) ||
+                          m_wallet_descriptor.descriptor->Expand(i, provider, result.scripts, result.out_keys, &result.cache);
+    };
+
+    // Commit the cache items and the descriptor in one go
+    DatabaseWriteGroup write_group{m_storage.GetDatabase()};
+    WalletBatch batch(m_storage.GetDatabase());
+    uint256 id = GetID();
+    DescriptorCache new_items;
+    bool expanded{true};
+    bool first{true};
+    int32_t i{m_max_cached_index + 1};
+    while (i < new_range_end) {
+        // The first index is expanded on its own. It caches the parent
+        // xpubs, from which each of the following indices is derived in
+        // parallel with a single unhardened derivation.
+        const int32_t count{first ? 1 : new_range_end - i};
+        first = false;
+        std::vector<ExpandedIndex> results(count);
+        const int num_threads{m_topup_threads > 0 ? std::min<int>(m_topup_threads, count) :
+                              std::clamp<int>(count / MIN_TOPUP_INDICES_PER_THREAD, 1, std::min(GetNumCores(), MAX_TOPUP_THREADS))};
+        if (num_threads == 1) {
+            for (int32_t j = 0; j < count; ++j) expand(i + j, results[j]);
+        } else {
+            std::vector<std::thread> threads;
+            for (int t = 0; t < num_threads; ++t) {
+                threads.emplace_back(&util::TraceThread, "topup", [&, t] {
+                    for (int32_t j = t; j < count; j += num_threads) expand(i + j, results[j]);
+                });
             }
-            m_map_pubkeys[pubkey] = i;
+            for (std::thread& thread : threads) thread.join();
         }
-        // Merge and write the cache
-        DescriptorCache new_items = m_wallet_descriptor.cache.MergeAndDiff(temp_cache);
-        if (!batch.WriteDescriptorCacheItems(id, new_items)) {
-            throw std::runtime_error(std::string(__func__) + ": writing cache items failed");
+
+        for (ExpandedIndex& result : results) {
+            if (!result.expanded) {
+                expanded = false;
+                break;
+            }
+            // Add all of the scriptPubKeys to the scriptPubKey set
+            for (const CScript& script : result.scripts) {
+                m_map_script_pub_keys[script] = i;
+            }
+            for (const auto& pk_pair : result.out_keys.pubkeys) {
+                const CPubKey& pubkey = pk_pair.second;
+                if (m_map_pubkeys.count(pubkey) != 0) {
+                    // We don't need to give an error here.
+                    // It doesn't matter which of many valid indexes the pubkey has, we just need an index where we can derive it and it's private key
+                    continue;
+                }
+                m_map_pubkeys[pubkey] = i;
+            }
+            // Merge the cache, it is written below
+            new_items.MergeAndDiff(m_wallet_descriptor.cache.MergeAndDiff(result.cache));
+            m_max_cached_index++;
+            ++i;
         }
-        m_max_cached_index++;
+        if (!expanded) break;
+    }
+    if (!batch.WriteDescriptorCacheItems(id, new_items)) {
+        throw std::runtime_error(std::string(__func__) + ": writing cache items failed");
     }
+    if (!expanded) return false;
     m_wallet_descriptor.range_end = new_range_end;
     batch.WriteDescriptor(GetID(), m_wallet_descriptor);
 
@@ -2211,6 +2258,12 @@ bool DescriptorScriptPubKeyMan::TopUp(unsigned int size)
     return true;
 }
 
+void DescriptorScriptPubKeyMan::SetTopUpThreads(int threads)
+{
+    LOCK(cs_desc_man);
+    m_topup_threads = threads;
+}
+
 std::vector<WalletDestination> DescriptorScriptPubKeyMan::MarkUnusedAddresses(const CScript& script)
 {
     LOCK(cs_desc_man);
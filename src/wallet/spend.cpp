@@ -13,6 +13,7 @@
 #include <timedata.h>
 #include <util/check.h>
 #include <util/fees.h>
+#include <util/hasher.h>
 #include <util/moneystr.h>
 #include <util/rbf.h>
 #include <util/trace.h>
@@ -201,6 +202,57 @@ util::Result<PreSelectedInputs> FetchSelectedInputs(const CWallet& wallet, const
     return result;
 }
 
+void UpdateUtxoPool(const CWallet& wallet)
+{
+    UtxoPool& pool{wallet.m_utxo_pool};
+    if (wallet.m_utxo_pool_stale) {
+        pool.Clear();
+        for (const auto& [txid, wtx] : wallet.mapWallet) {
+            for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+                pool.AddPending(COutPoint(txid, i));
+            }
+        }
+        wallet.m_utxo_pool_stale = false;
+    }
+
+    const bool can_grind_r = wallet.CanGrindR();
+    CCoinControl max_sig_control;
+    max_sig_control.fAllowWatchOnly = true;
+    for (const COutPoint& outpoint : pool.TakePending()) {
+        pool.Erase(outpoint);
+        const CWalletTx* wtx = wallet.GetWalletTx(outpoint.hash);
+        if (!wtx || outpoint.n >= wtx->tx->vout.size() || wallet.IsSpent(outpoint)) continue;
+        const CTxOut& output = wtx->tx->vout[outpoint.n];
+
+        isminetype mine = wallet.IsMine(output);
+        if (mine == ISMINE_NO) continue;
+
+        std::unique_ptr<SigningProvider> provider = wallet.GetSolvingProvider(output.scriptPubKey);
+        bool solvable = provider ? InferDescriptor(output.scriptPubKey, *provider)->IsSolvable() : false;
+
+        // Obtain script type
+        std::vector<std::vector<uint8_t>> script_solutions;
+        TxoutType type = Solver(output.scriptPubKey, script_solutions);
+
+        // If the output is P2SH and solvable, we want to know if it is
+        // a P2SH (legacy) or one of P2SH-P2WPKH, P2SH-P2WSH (P2SH-Segwit). We can determine
+        // this from the redeemScript. If the output is not solvable, it will be classified
+        // as a P2SH (legacy), since we have no way of knowing otherwise without the redeemScript
+        bool is_from_p2sh{false};
+        if (type == TxoutType::SCRIPTHASH && solvable) {
+            CScript script;
+            if (!provider->GetCScript(CScriptID(uint160(script_solutions[0])), script)) continue;
+            type = Solver(script, script_solutions);
+            is_from_p2sh = true;
+        }
+
+        pool.Insert(outpoint, {output, GetOutputType(type, is_from_p2sh), mine, solvable,
+                               CalculateMaximumSignedInputSize(output, COutPoint(), provider.get(), can_grind_r, /*coin_control=*/nullptr),
+                               CalculateMaximumSignedInputSize(output, COutPoint(), provider.get(), can_grind_r, &max_sig_control),
+                               /*stake_block_hash=*/uint256(), /*stake_tx_offset=*/0});
+    }
+}
+
 CoinsResult AvailableCoins(const CWallet& wallet,
                            const CCoinControl* coinControl,
                            std::optional<CFeeRate> feerate,
@@ -215,105 +267,115 @@ CoinsResult AvailableCoins(const CWallet& wallet,
     const int min_depth = {coinControl ? coinControl->m_min_depth : DEFAULT_MIN_DEPTH};
     const int max_depth = {coinControl ? coinControl->m_max_depth : DEFAULT_MAX_DEPTH};
     const bool only_safe = {coinControl ? !coinControl->m_include_unsafe_inputs : true};
-    const bool can_grind_r = wallet.CanGrindR();
-
+    // See DummySignInput()
+    const bool use_max_sig = coinControl && (coinControl->fAllowWatchOnly || !wallet.CanGrindR());
+
+    UpdateUtxoPool(wallet);
+
+    // The checks of the containing transaction, done once per transaction
+    struct TxInfo {
+        bool eligible{false};
+        int depth{0};
+        bool safe{false};
+        bool from_me{false};
+        int64_t time{0};
+    };
+    std::unordered_map<uint256, TxInfo, SaltedTxidHasher> tx_infos;
     std::set<uint256> trusted_parents;
-    for (const auto& entry : wallet.mapWallet)
-    {
-        const uint256& wtxid = entry.first;
-        const CWalletTx& wtx = entry.second;
+    const auto get_tx_info = [&](const CWalletTx& wtx) -> const TxInfo& {
+        auto [it, inserted] = tx_infos.try_emplace(wtx.GetHash());
+        TxInfo& info = it->second;
+        if (!inserted) return info;
 
         if (wallet.IsTxImmatureCoinBase(wtx) && !params.include_immature_coinbase)
-            continue;
+            return info;
 
-        int nDepth = wallet.GetTxDepthInMainChain(wtx);
-        if (nDepth < 0)
-            continue;
+        info.depth = wallet.GetTxDepthInMainChain(wtx);
+        if (info.depth < 0)
+            return info;
 
         // We should not consider coins which aren't at least in our mempool
         // It's possible for these to be conflicted via ancestors which we may never be able to detect
-        if (nDepth == 0 && !wtx.InMempool())
-            continue;
+        if (info.depth == 0 && !wtx.InMempool())
+            return info;
 
-        bool safeTx = CachedTxIsTrusted(wallet, wtx, trusted_parents);
+        info.safe = CachedTxIsTrusted(wallet, wtx, trusted_parents);
 
-        if (only_safe && !safeTx) {
-            continue;
+        if (only_safe && !info.safe) {
+            return info;
         }
 
-        if (nDepth < min_depth || nDepth > max_depth) {
-            continue;
+        if (info.depth < min_depth || info.depth > max_depth) {
+            return info;
         }
 
-        bool tx_from_me = CachedTxIsFromMe(wallet, wtx, ISMINE_ALL);
-
-        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
-            const CTxOut& output = wtx.tx->vout[i];
-            const COutPoint outpoint(wtxid, i);
-
-            if (output.nValue < params.min_amount || output.nValue > params.max_amount)
-                continue;
-
-            // Skip manually selected coins (the caller can fetch them directly)
-            if (coinControl && coinControl->HasSelected() && coinControl->IsSelected(outpoint))
-                continue;
+        info.from_me = CachedTxIsFromMe(wallet, wtx, ISMINE_ALL);
+        info.time = wtx.GetTxTime();
+        info.eligible = true;
+        return info;
+    };
 
-            if (wallet.IsLockedCoin(outpoint) && params.skip_locked)
-                continue;
+    // Walk the pool by output type and value, so each type's coins come out
+    // ordered by value. Spent outputs are dropped from the pool afterwards.
+    std::vector<COutPoint> spent;
+    const auto add_coins = [&]() {
+        for (const auto& [type, by_value] : wallet.m_utxo_pool.ByValue()) {
+            for (auto value_it = by_value.lower_bound({params.min_amount, COutPoint()}); value_it != by_value.end(); ++value_it) {
+                const auto& [value, outpoint] = *value_it;
+                if (value > params.max_amount) break;
+
+                // Skip manually selected coins (the caller can fetch them directly)
+                if (coinControl && coinControl->HasSelected() && coinControl->IsSelected(outpoint))
+                    continue;
+
+                if (wallet.IsLockedCoin(outpoint) && params.skip_locked)
+                    continue;
+
+                if (wallet.IsSpent(outpoint)) {
+                    spent.push_back(outpoint);
+                    continue;
+                }
 
-            if (wallet.IsSpent(outpoint))
-                continue;
+                const CWalletTx* wtx = wallet.GetWalletTx(outpoint.hash);
+                if (!wtx) {
+                    spent.push_back(outpoint);
+                    continue;
+                }
+                const TxInfo& info = get_tx_info(*wtx);
+                if (!info.eligible) continue;
 
-            isminetype mine = wallet.IsMine(output);
+                const UtxoPool::Entry& entry = *Assert(wallet.m_utxo_pool.Find(outpoint));
+                const CTxOut& output = entry.txout;
 
-            if (mine == ISMINE_NO) {
-                continue;
-            }
+                if (!allow_used_addresses && wallet.IsSpentKey(output.scriptPubKey)) {
+                    continue;
+                }
 
-            if (!allow_used_addresses && wallet.IsSpentKey(output.scriptPubKey)) {
-                continue;
-            }
+                bool spendable = ((entry.mine & ISMINE_SPENDABLE) != ISMINE_NO) || (((entry.mine & ISMINE_WATCH_ONLY) != ISMINE_NO) && (coinControl && coinControl->fAllowWatchOnly && entry.solvable));
 
-            std::unique_ptr<SigningProvider> provider = wallet.GetSolvingProvider(output.scriptPubKey);
-
-            int input_bytes = CalculateMaximumSignedInputSize(output, COutPoint(), provider.get(), can_grind_r, coinControl);
-            bool solvable = provider ? InferDescriptor(output.scriptPubKey, *provider)->IsSolvable() : false;
-            bool spendable = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) || (((mine & ISMINE_WATCH_ONLY) != ISMINE_NO) && (coinControl && coinControl->fAllowWatchOnly && solvable));
-
-            // Filter by spendable outputs only
-            if (!spendable && params.only_spendable) continue;
-
-            // Obtain script type
-            std::vector<std::vector<uint8_t>> script_solutions;
-            TxoutType type = Solver(output.scriptPubKey, script_solutions);
-
-            // If the output is P2SH and solvable, we want to know if it is
-            // a P2SH (legacy) or one of P2SH-P2WPKH, P2SH-P2WSH (P2SH-Segwit). We can determine
-            // this from the redeemScript. If the output is not solvable, it will be classified
-            // as a P2SH (legacy), since we have no way of knowing otherwise without the redeemScript
-            bool is_from_p2sh{false};
-            if (type == TxoutType::SCRIPTHASH && solvable) {
-                CScript script;
-                if (!provider->GetCScript(CScriptID(uint160(script_solutions[0])), script)) continue;
-                type = Solver(script, script_solutions);
-                is_from_p2sh = true;
-            }
+                // Filter by spendable outputs only
+                if (!spendable && params.only_spendable) continue;
 
-            result.Add(GetOutputType(type, is_from_p2sh),
-                       COutput(outpoint, output, nDepth, input_bytes, spendable, solvable, safeTx, wtx.GetTxTime(), tx_from_me));
+                result.Add(type, COutput(outpoint, output, info.depth, use_max_sig ? entry.input_bytes_max_sig : entry.input_bytes,
+                                         spendable, entry.solvable, info.safe, info.time, info.from_me));
 
-            // Checks the sum amount of all UTXO's.
-            if (params.min_sum_amount != MAX_MONEY) {
-                if (result.GetTotalAmount() >= params.min_sum_amount) {
-                    return result;
+                // Checks the sum amount of all UTXO's.
+                if (params.min_sum_amount != MAX_MONEY) {
+                    if (result.GetTotalAmount() >= params.min_sum_amount) {
+                        return;
+                    }
                 }
-            }
 
-            // Checks the maximum number of UTXO's.
-            if (params.max_count > 0 && result.Size() >= params.max_count) {
-                return result;
+                // Checks the maximum number of UTXO's.
+                if (params.max_count > 0 && result.Size() >= params.max_count) {
+                    return;
+                }
             }
         }
+    };
+    add_coins();
+    for (const COutPoint& outpoint : spent) {
+        wallet.m_utxo_pool.Erase(outpoint);
     }
 
     return result;
@@ -611,7 +673,59 @@ util::Result<SelectionResult> SelectCoins(const CWallet& wallet, CoinsResult& av
     return op_selection_result;
 }
 
-util::Result<SelectionResult> AutomaticCoinSelection(const CWallet& wallet, CoinsResult& available_coins, const CAmount& value_to_select, const CoinSelectionParams& coin_selection_params)
+CoinsResult SelectionWindow(const CoinsResult& coins, CAmount target, size_t max_candidates, bool whole_scripts)
+{
+    CoinsResult window;
+    for (const auto& [type, outputs] : coins.coins) {
+        const size_t count{outputs.size()};
+        if (count <= max_candidates) {
+            for (const COutput& output : outputs) window.Add(type, output);
+            continue;
+        }
+
+        std::vector<size_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        const auto by_value = [&](size_t a, size_t b) { return outputs[a].txout.nValue < outputs[b].txout.nValue; };
+        if (!std::is_sorted(order.begin(), order.end(), by_value)) {
+            std::stable_sort(order.begin(), order.end(), by_value);
+        }
+
+        // A quarter of the candidates from the target up, the rest below it
+        const size_t first_above = std::partition_point(order.begin(), order.end(), [&](size_t i) { return outputs[i].txout.nValue < target; }) - order.begin();
+        size_t begin = first_above - std::min(first_above, max_candidates - max_candidates / 4);
+        const size_t end = std::min(count, begin + max_candidates);
+        begin = end - std::min(end, max_candidates);
+
+        // Either a coin of at least the target is in the window, or the
+        // largest coins are
+        std::vector<bool> in_window(count, false);
+        for (size_t pos = begin; pos < end; ++pos) {
+            in_window[order[pos]] = true;
+        }
+
+        if (whole_scripts) {
+            std::map<CScript, size_t> script_counts;
+            for (size_t i = 0; i < count; ++i) {
+                if (in_window[i]) ++script_counts[outputs[i].txout.scriptPubKey];
+            }
+            for (size_t i = 0; i < count; ++i) {
+                if (in_window[i]) continue;
+                const auto it = script_counts.find(outputs[i].txout.scriptPubKey);
+                if (it == script_counts.end() || it->second >= OUTPUT_GROUP_MAX_ENTRIES) continue;
+                ++it->second;
+                in_window[i] = true;
+            }
+        }
+
+        for (const size_t i : order) {
+            if (in_window[i]) window.Add(type, outputs[i]);
+        }
+    }
+    return window;
+}
+
+static util::Result<SelectionResult> SelectFromAvailableCoins(const CWallet& wallet, CoinsResult& available_coins, const CAmount& value_to_select, const CoinSelectionParams& coin_selection_params)
+    EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
 {
     unsigned int limit_ancestor_count = 0;
     unsigned int limit_descendant_count = 0;
@@ -712,6 +826,18 @@ util::Result<SelectionResult> AutomaticCoinSelection(const CWallet& wallet, Coin
     return res;
 }
 
+util::Result<SelectionResult> AutomaticCoinSelection(const CWallet& wallet, CoinsResult& available_coins, const CAmount& value_to_select, const CoinSelectionParams& coin_selection_params)
+{
+    // The selection algorithms scale with the number of coins. For very large
+    // wallets, try the coins around the target first.
+    const bool large = std::any_of(available_coins.coins.begin(), available_coins.coins.end(), [](const auto& entry) { return entry.second.size() > MAX_SELECTION_CANDIDATES; });
+    if (large) {
+        CoinsResult window{SelectionWindow(available_coins, value_to_select, MAX_SELECTION_CANDIDATES, coin_selection_params.m_avoid_partial_spends)};
+        if (auto res{SelectFromAvailableCoins(wallet, window, value_to_select, coin_selection_params)}) return res;
+    }
+    return SelectFromAvailableCoins(wallet, available_coins, value_to_select, coin_selection_params);
+}
+
 static bool IsCurrentForAntiFeeSniping(interfaces::Chain& chain, const uint256& block_hash)
 {
     if (chain.isInitialBlockDownload()) {
@@ -80,6 +80,12 @@ struct CoinFilterParams {
     bool skip_locked{true};
 };
 
+/**
+ * Analyze the pending outputs of the wallet's UTXO pool, or all wallet outputs
+ * after the pool went stale.
+ */
+void UpdateUtxoPool(const CWallet& wallet) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet);
+
 /**
  * Populate the CoinsResult struct with vectors of available COutputs, organized by OutputType.
  */
@@ -177,6 +183,19 @@ struct PreSelectedInputs
 util::Result<PreSelectedInputs> FetchSelectedInputs(const CWallet& wallet, const CCoinControl& coin_control,
                                                     const CoinSelectionParams& coin_selection_params) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet);
 
+/** Coins of one output type above which AutomaticCoinSelection() first
+ * selects from a window of candidates around the target */
+static constexpr size_t MAX_SELECTION_CANDIDATES{1000};
+
+/**
+ * Narrow the coins of each output type to max_candidates candidates for the selection
+ * algorithms: the largest coins below the target and a quarter of the candidates from the
+ * target up, or the largest coins if fewer coins reach the target. With whole_scripts, other
+ * coins to the scripts of the candidates are added up to a full OutputGroup, so grouping by
+ * script is kept. Coins from AvailableCoins() are ordered by value, others are sorted first.
+ */
+CoinsResult SelectionWindow(const CoinsResult& coins, CAmount target, size_t max_candidates, bool whole_scripts);
+
 /**
  * Select a set of coins such that nTargetValue is met; never select unconfirmed coins if they are not ours
  * param@[in]   wallet                 The wallet which provides data necessary to spend the selected coins
@@ -16,6 +16,8 @@
 #include <sqlite3.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <chrono>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -84,7 +86,7 @@ Mutex SQLiteDatabase::g_sqlite_mutex;
 int SQLiteDatabase::g_sqlite_count = 0;
 
 SQLiteDatabase::SQLiteDatabase(const fs::path& dir_path, const fs::path& file_path, const DatabaseOptions& options, bool mock)
-    : WalletDatabase(), m_mock(mock), m_dir_path(fs::PathToString(dir_path)), m_file_path(fs::PathToString(file_path)), m_use_unsafe_sync(options.use_unsafe_sync)
+    : WalletDatabase(), m_mock(mock), m_dir_path(fs::PathToString(dir_path)), m_file_path(fs::PathToString(file_path)), m_use_unsafe_sync(options.use_unsafe_sync), m_use_full_sync(options.use_full_sync)
 {
     {
         LOCK(g_sqlite_mutex);
@@ -120,6 +122,14 @@ SQLiteDatabase::SQLiteDatabase(const fs::path& dir_path, const fs::path& file_pa
 
 void SQLiteBatch::SetupSQLStatements()
 {
+    if (const auto cached{m_database.TakeStatements()}) {
+        m_read_stmt = (*cached)[0];
+        m_insert_stmt = (*cached)[1];
+        m_overwrite_stmt = (*cached)[2];
+        m_delete_stmt = (*cached)[3];
+        return;
+    }
+
     const std::vector<std::pair<sqlite3_stmt**, const char*>> statements{
         {&m_read_stmt, "SELECT value FROM main WHERE key = ?"},
         {&m_insert_stmt, "INSERT INTO main VALUES(?, ?)"},
@@ -256,10 +266,24 @@ void SQLiteDatabase::Open()
     // Enable fullfsync for the platforms that use it
     SetPragma(m_db, "fullfsync", "true", "Failed to enable fullfsync");
 
+    // With a write ahead log a commit appends to the log instead of rewriting
+    // pages of the database file. As the database is locked exclusively, the
+    // log needs no shared memory index.
+    SetPragma(m_db, "journal_mode", "WAL", "Failed to enable the write ahead log");
+
     if (m_use_unsafe_sync) {
         // Use normal synchronous mode for the journal
         LogPrintf("WARNING SQLite is configured to not wait for data to be flushed to disk. Data loss and corruption may occur.\n");
         SetPragma(m_db, "synchronous", "OFF", "Failed to set synchronous mode to OFF");
+    } else if (!m_use_full_sync) {
+        // Durability policy: the log is synced at checkpoints, not on every
+        // commit. A crash of the process loses nothing that was committed,
+        // but a power failure or OS crash may roll back the latest
+        // transactions, leaving the database consistent. Keys, descriptors
+        // and seeds cannot be recovered, so their writes are followed by a
+        // full checkpoint (see MakeDurable()). Transactions are recovered by
+        // a rescan.
+        SetPragma(m_db, "synchronous", "NORMAL", "Failed to set synchronous mode to NORMAL");
     }
 
     // Make the table for our key-value pairs
@@ -336,6 +360,7 @@ bool SQLiteDatabase::Backup(const std::string& dest) const
 
 void SQLiteDatabase::Close()
 {
+    FinalizeCachedStatements();
     int res = sqlite3_close(m_db);
     if (res != SQLITE_OK) {
         throw std::runtime_error(strprintf("SQLiteDatabase: Failed to close database: %s\n", sqlite3_errstr(res)));
@@ -360,8 +385,8 @@ SQLiteBatch::SQLiteBatch(SQLiteDatabase& database)
 
 void SQLiteBatch::Close()
 {
-    // If m_db is in a transaction (i.e. not in autocommit mode), then abort the transaction in progress
-    if (m_database.m_db && sqlite3_get_autocommit(m_database.m_db) == 0) {
+    // If this batch is in a transaction, then abort the transaction in progress
+    if (m_database.m_db && m_txn != Txn::NONE) {
         if (TxnAbort()) {
             LogPrintf("SQLiteBatch: Batch closed unexpectedly without the transaction being explicitly committed or aborted\n");
         } else {
@@ -369,6 +394,13 @@ void SQLiteBatch::Close()
         }
     }
 
+    // Leave the prepared statements to the next batch
+    if (m_database.m_db && m_read_stmt && m_insert_stmt && m_overwrite_stmt && m_delete_stmt &&
+        m_database.ReturnStatements({m_read_stmt, m_insert_stmt, m_overwrite_stmt, m_delete_stmt})) {
+        m_read_stmt = m_insert_stmt = m_overwrite_stmt = m_delete_stmt = nullptr;
+        return;
+    }
+
     // Free all of the prepared statements
     const std::vector<std::pair<sqlite3_stmt**, const char*>> statements{
         {&m_read_stmt, "read"},
@@ -431,14 +463,7 @@ bool SQLiteBatch::WriteKey(DataStream&& key, DataStream&& value, bool overwrite)
     if (!BindBlobToStatement(stmt, 1, key, "key")) return false;
     if (!BindBlobToStatement(stmt, 2, value, "value")) return false;
 
-    // Execute
-    int res = sqlite3_step(stmt);
-    sqlite3_clear_bindings(stmt);
-    sqlite3_reset(stmt);
-    if (res != SQLITE_DONE) {
-        LogPrintf("%s: Unable to execute statement: %s\n", __func__, sqlite3_errstr(res));
-    }
-    return res == SQLITE_DONE;
+    return ExecWrite(stmt, __func__);
 }
 
 bool SQLiteBatch::EraseKey(DataStream&& key)
@@ -449,12 +474,24 @@ bool SQLiteBatch::EraseKey(DataStream&& key)
     // Bind: leftmost parameter in statement is index 1
     if (!BindBlobToStatement(m_delete_stmt, 1, key, "key")) return false;
 
-    // Execute
-    int res = sqlite3_step(m_delete_stmt);
-    sqlite3_clear_bindings(m_delete_stmt);
-    sqlite3_reset(m_delete_stmt);
+    return ExecWrite(m_delete_stmt, __func__);
+}
+
+bool SQLiteBatch::ExecWrite(sqlite3_stmt* stmt, const char* func)
+{
+    // Outside of a transaction every write is committed on its own
+    // Wait for a transaction of another thread to end instead of joining it
+    const bool writer{m_database.IsWriter()};
+    if (!writer) m_database.m_write_semaphore.wait();
+    const bool autocommit{sqlite3_get_autocommit(m_database.m_db) != 0};
+    const auto start{SteadyClock::now()};
+    int res = sqlite3_step(stmt);
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+    if (!writer) m_database.m_write_semaphore.post();
+    m_database.RecordWrite(std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start), autocommit);
     if (res != SQLITE_DONE) {
-        LogPrintf("%s: Unable to execute statement: %s\n", __func__, sqlite3_errstr(res));
+        LogPrintf("%s: Unable to execute statement: %s\n", func, sqlite3_errstr(res));
     }
     return res == SQLITE_DONE;
 }
@@ -518,34 +555,232 @@ std::unique_ptr<DatabaseCursor> SQLiteBatch::GetNewCursor()
     return cursor;
 }
 
+std::unique_ptr<DatabaseCursor> SQLiteBatch::GetNewPrefixCursor(Span<const std::byte> prefix)
+{
+    if (!m_database.m_db) return nullptr;
+
+    // Keys are compared as blobs, so the records with the prefix are those
+    // at or after the prefix and before the prefix incremented by one.
+    std::vector<std::byte> start_range(prefix.begin(), prefix.end());
+    std::vector<std::byte> end_range(prefix.begin(), prefix.end());
+    auto it = end_range.rbegin();
+    for (; it != end_range.rend(); ++it) {
+        if (*it == std::byte{0xff}) {
+            *it = std::byte{0};
+            continue;
+        }
+        *it = std::byte(std::to_integer<unsigned char>(*it) + 1);
+        break;
+    }
+    // A prefix of only 0xff bytes has no upper bound
+    if (it == end_range.rend()) end_range.clear();
+
+    auto cursor = std::make_unique<SQLiteCursor>(std::move(start_range), std::move(end_range));
+    const char* stmt_text = cursor->m_prefix_range_end.empty() ? "SELECT key, value FROM main WHERE key >= ?" :
+                                                                 "SELECT key, value FROM main WHERE key >= ? AND key < ?";
+    int res = sqlite3_prepare_v2(m_database.m_db, stmt_text, -1, &cursor->m_cursor_stmt, nullptr);
+    if (res != SQLITE_OK) {
+        throw std::runtime_error(strprintf(
+            "%s: Failed to setup cursor SQL statement: %s\n", __func__, sqlite3_errstr(res)));
+    }
+
+    if (!BindBlobToStatement(cursor->m_cursor_stmt, 1, cursor->m_prefix_range_start, "prefix_start")) return nullptr;
+    if (!cursor->m_prefix_range_end.empty()) {
+        if (!BindBlobToStatement(cursor->m_cursor_stmt, 2, cursor->m_prefix_range_end, "prefix_end")) return nullptr;
+    }
+
+    return cursor;
+}
+
 bool SQLiteBatch::TxnBegin()
 {
-    if (!m_database.m_db || sqlite3_get_autocommit(m_database.m_db) == 0) return false;
+    if (!m_database.m_db || m_txn != Txn::NONE) return false;
+    if (m_database.IsWriter()) {
+        // Another batch of this thread is in the middle of its own transaction
+        if (m_database.m_write_group_depth == 0) return false;
+        // Nest in the transaction of the write group
+        int res = sqlite3_exec(m_database.m_db, "SAVEPOINT batch", nullptr, nullptr, nullptr);
+        if (res != SQLITE_OK) {
+            LogPrintf("SQLiteBatch: Failed to begin the transaction\n");
+            return false;
+        }
+        m_txn = Txn::SAVEPOINT;
+        return true;
+    }
+    m_database.AcquireWrite();
     int res = sqlite3_exec(m_database.m_db, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK) {
         LogPrintf("SQLiteBatch: Failed to begin the transaction\n");
+        m_database.ReleaseWrite();
+        return false;
     }
-    return res == SQLITE_OK;
+    m_txn = Txn::TRANSACTION;
+    return true;
 }
 
 bool SQLiteBatch::TxnCommit()
 {
-    if (!m_database.m_db || sqlite3_get_autocommit(m_database.m_db) != 0) return false;
-    int res = sqlite3_exec(m_database.m_db, "COMMIT TRANSACTION", nullptr, nullptr, nullptr);
+    if (!m_database.m_db || m_txn == Txn::NONE) return false;
+    const auto start{SteadyClock::now()};
+    int res = sqlite3_exec(m_database.m_db, m_txn == Txn::TRANSACTION ? "COMMIT TRANSACTION" : "RELEASE batch", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK) {
         LogPrintf("SQLiteBatch: Failed to commit the transaction\n");
+        return false;
     }
-    return res == SQLITE_OK;
+    if (m_txn == Txn::TRANSACTION) {
+        m_database.RecordCommit(std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start));
+        m_database.ReleaseWrite();
+    }
+    m_txn = Txn::NONE;
+    return true;
 }
 
 bool SQLiteBatch::TxnAbort()
 {
-    if (!m_database.m_db || sqlite3_get_autocommit(m_database.m_db) != 0) return false;
-    int res = sqlite3_exec(m_database.m_db, "ROLLBACK TRANSACTION", nullptr, nullptr, nullptr);
+    if (!m_database.m_db || m_txn == Txn::NONE) return false;
+    int res = sqlite3_exec(m_database.m_db, m_txn == Txn::TRANSACTION ? "ROLLBACK TRANSACTION" : "ROLLBACK TO batch; RELEASE batch", nullptr, nullptr, nullptr);
+    // An error may have rolled the transaction back already
+    if (m_txn == Txn::TRANSACTION && sqlite3_get_autocommit(m_database.m_db) != 0) {
+        m_database.ReleaseWrite();
+        m_txn = Txn::NONE;
+    }
     if (res != SQLITE_OK) {
         LogPrintf("SQLiteBatch: Failed to abort the transaction\n");
+        return false;
     }
-    return res == SQLITE_OK;
+    m_txn = Txn::NONE;
+    return true;
+}
+
+std::optional<SQLiteDatabase::Statements> SQLiteDatabase::TakeStatements()
+{
+    LOCK(m_statements_mutex);
+    if (m_cached_statements.empty()) return std::nullopt;
+    Statements statements{m_cached_statements.back()};
+    m_cached_statements.pop_back();
+    return statements;
+}
+
+bool SQLiteDatabase::ReturnStatements(const Statements& statements)
+{
+    LOCK(m_statements_mutex);
+    if (m_cached_statements.size() >= MAX_CACHED_STATEMENTS) return false;
+    m_cached_statements.push_back(statements);
+    return true;
+}
+
+void SQLiteDatabase::FinalizeCachedStatements()
+{
+    LOCK(m_statements_mutex);
+    for (const Statements& statements : m_cached_statements) {
+        for (sqlite3_stmt* stmt : statements) {
+            int res = sqlite3_finalize(stmt);
+            if (res != SQLITE_OK) {
+                LogPrintf("SQLiteDatabase: Could not finalize cached statement: %s\n", sqlite3_errstr(res));
+            }
+        }
+    }
+    m_cached_statements.clear();
+}
+
+bool SQLiteDatabase::BeginWriteGroup()
+{
+    if (!m_db) return false;
+    if (IsWriter()) {
+        // A batch of this thread is in the middle of its own transaction
+        if (m_write_group_depth == 0) return false;
+        ++m_write_group_depth;
+        return true;
+    }
+    AcquireWrite();
+    int res = sqlite3_exec(m_db, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+    if (res != SQLITE_OK) {
+        LogPrintf("SQLiteDatabase: Failed to begin a write group: %s\n", sqlite3_errstr(res));
+        ReleaseWrite();
+        return false;
+    }
+    m_write_group_depth = 1;
+    return true;
+}
+
+void SQLiteDatabase::EndWriteGroup()
+{
+    assert(m_write_group_depth > 0 && IsWriter());
+    if (--m_write_group_depth > 0) return;
+    // The transaction may have been rolled back by an error
+    if (m_db && sqlite3_get_autocommit(m_db) == 0) {
+        const auto start{SteadyClock::now()};
+        int res = sqlite3_exec(m_db, "COMMIT TRANSACTION", nullptr, nullptr, nullptr);
+        if (res == SQLITE_OK) {
+            RecordCommit(std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start));
+        } else {
+            LogPrintf("SQLiteDatabase: Failed to commit a write group: %s\n", sqlite3_errstr(res));
+            sqlite3_exec(m_db, "ROLLBACK TRANSACTION", nullptr, nullptr, nullptr);
+        }
+    }
+    ReleaseWrite();
+}
+
+void SQLiteDatabase::AcquireWrite()
+{
+    m_write_semaphore.wait();
+    m_writer = std::this_thread::get_id();
+}
+
+void SQLiteDatabase::ReleaseWrite()
+{
+    if (m_checkpoint_pending.exchange(false) && m_db && sqlite3_get_autocommit(m_db) != 0) {
+        Checkpoint();
+    }
+    m_writer = std::thread::id{};
+    m_write_semaphore.post();
+}
+
+void SQLiteDatabase::Checkpoint()
+{
+    int res = sqlite3_wal_checkpoint_v2(m_db, nullptr, SQLITE_CHECKPOINT_FULL, nullptr, nullptr);
+    if (res != SQLITE_OK) {
+        LogPrintf("SQLiteDatabase: Failed to checkpoint the log: %s\n", sqlite3_errstr(res));
+    }
+}
+
+void SQLiteDatabase::MakeDurable()
+{
+    if (!m_db || m_mock || m_use_unsafe_sync || m_use_full_sync) return;
+    if (IsWriter()) {
+        // Checkpoint once the transaction of this thread commits
+        m_checkpoint_pending = true;
+        return;
+    }
+    m_write_semaphore.wait();
+    Checkpoint();
+    m_write_semaphore.post();
+}
+
+void SQLiteDatabase::RecordWrite(std::chrono::microseconds duration, bool committed)
+{
+    LOCK(m_stats_mutex);
+    ++m_stats.writes;
+    m_stats.write_time += duration;
+    m_stats.max_write_time = std::max(m_stats.max_write_time, duration);
+    if (committed) {
+        ++m_stats.commits;
+        m_stats.commit_time += duration;
+        m_stats.max_commit_time = std::max(m_stats.max_commit_time, duration);
+    }
+}
+
+void SQLiteDatabase::RecordCommit(std::chrono::microseconds duration)
+{
+    LOCK(m_stats_mutex);
+    ++m_stats.commits;
+    m_stats.commit_time += duration;
+    m_stats.max_commit_time = std::max(m_stats.max_commit_time, duration);
+}
+
+DatabaseWriteStats SQLiteDatabase::GetWriteStats() const
+{
+    return WITH_LOCK(m_stats_mutex, return m_stats);
 }
 
 std::unique_ptr<SQLiteDatabase> MakeSQLiteDatabase(const fs::path& path, const DatabaseOptions& options, DatabaseStatus& status, bilingual_str& error)
@@ -6,8 +6,14 @@
 #define BITCOIN_WALLET_SQLITE_H
 
 #include <sync.h>
+#include <util/time.h>
 #include <wallet/db.h>
 
+#include <array>
+#include <atomic>
+#include <optional>
+#include <thread>
+
 #include <sqlite3.h>
 
 struct bilingual_str;
@@ -19,8 +25,13 @@ class SQLiteCursor : public DatabaseCursor
 {
 public:
     sqlite3_stmt* m_cursor_stmt{nullptr};
+    //! Bounds of a prefix cursor, bound to m_cursor_stmt without copying
+    std::vector<std::byte> m_prefix_range_start;
+    std::vector<std::byte> m_prefix_range_end;
 
     explicit SQLiteCursor() {}
+    explicit SQLiteCursor(std::vector<std::byte> start_range, std::vector<std::byte> end_range)
+        : m_prefix_range_start(std::move(start_range)), m_prefix_range_end(std::move(end_range)) {}
     ~SQLiteCursor() override;
 
     Status Next(DataStream& key, DataStream& value) override;
@@ -37,7 +48,13 @@ private:
     sqlite3_stmt* m_overwrite_stmt{nullptr};
     sqlite3_stmt* m_delete_stmt{nullptr};
 
+    //! The transaction this batch began, if any
+    enum class Txn { NONE, TRANSACTION, SAVEPOINT };
+    Txn m_txn{Txn::NONE};
+
     void SetupSQLStatements();
+    //! Step a write statement, recording its timing
+    bool ExecWrite(sqlite3_stmt* stmt, const char* func);
 
     bool ReadKey(DataStream&& key, DataStream& value) override;
     bool WriteKey(DataStream&& key, DataStream&& value, bool overwrite = true) override;
@@ -54,6 +71,7 @@ public:
     void Close() override;
 
     std::unique_ptr<DatabaseCursor> GetNewCursor() override;
+    std::unique_ptr<DatabaseCursor> GetNewPrefixCursor(Span<const std::byte> prefix) override;
     bool TxnBegin() override;
     bool TxnCommit() override;
     bool TxnAbort() override;
@@ -64,6 +82,8 @@ public:
 class SQLiteDatabase : public WalletDatabase
 {
 private:
+    friend class SQLiteBatch;
+
     const bool m_mock{false};
 
     const std::string m_dir_path;
@@ -81,6 +101,41 @@ private:
 
     void Cleanup() noexcept EXCLUSIVE_LOCKS_REQUIRED(!g_sqlite_mutex);
 
+    //! Read, insert, overwrite and delete statements of a batch
+    using Statements = std::array<sqlite3_stmt*, 4>;
+    //! Number of statement sets kept around for reuse by later batches
+    static constexpr size_t MAX_CACHED_STATEMENTS{4};
+    Mutex m_statements_mutex;
+    //! Prepared statements of closed batches, reused by new batches instead of preparing them again
+    std::vector<Statements> m_cached_statements GUARDED_BY(m_statements_mutex);
+    std::optional<Statements> TakeStatements() EXCLUSIVE_LOCKS_REQUIRED(!m_statements_mutex);
+    //! Keep the statements for reuse, returns false if they should be finalized instead
+    bool ReturnStatements(const Statements& statements) EXCLUSIVE_LOCKS_REQUIRED(!m_statements_mutex);
+    void FinalizeCachedStatements() EXCLUSIVE_LOCKS_REQUIRED(!m_statements_mutex);
+
+    //! Depth of nested write groups, see BeginWriteGroup()
+    std::atomic<int> m_write_group_depth{0};
+
+    //! Held by the thread with an open transaction or write group, and around
+    //! each write outside of one, so that no thread writes into the
+    //! transaction of another on the shared connection.
+    CSemaphore m_write_semaphore{1};
+    //! Thread holding the semaphore for a transaction or write group
+    std::atomic<std::thread::id> m_writer{};
+    //! Key material was written in the transaction in progress, see MakeDurable()
+    std::atomic<bool> m_checkpoint_pending{false};
+
+    bool IsWriter() const { return m_writer.load() == std::this_thread::get_id(); }
+    void AcquireWrite();
+    void ReleaseWrite();
+    //! Sync the log and copy it into the database file
+    void Checkpoint();
+
+    mutable Mutex m_stats_mutex;
+    DatabaseWriteStats m_stats GUARDED_BY(m_stats_mutex);
+    void RecordWrite(std::chrono::microseconds duration, bool committed) EXCLUSIVE_LOCKS_REQUIRED(!m_stats_mutex);
+    void RecordCommit(std::chrono::microseconds duration) EXCLUSIVE_LOCKS_REQUIRED(!m_stats_mutex);
+
 public:
     SQLiteDatabase() = delete;
 
@@ -112,7 +167,8 @@ public:
      *
      * SQLite always flushes everything to the database file after each transaction
      * (each Read/Write/Erase that we do is its own transaction unless we called
-     * TxnBegin) so there is no need to have Flush or Periodic Flush.
+     * TxnBegin or are in a write group) so there is no need to have Flush or
+     * Periodic Flush.
      *
      * There is no DB env to reload, so ReloadDbEnv has nothing to do
      */
@@ -128,8 +184,21 @@ public:
     /** Make a SQLiteBatch connected to this database */
     std::unique_ptr<DatabaseBatch> MakeBatch(bool flush_on_close = true) override;
 
+    /** Batches of this thread write into the group's transaction and their
+     * transactions become savepoints in it. Writes of other threads wait
+     * until the group ends. */
+    bool BeginWriteGroup() override;
+    void EndWriteGroup() override;
+
+    /** Checkpoint the log once the writes are committed, as commits are not
+     * synced under synchronous=NORMAL */
+    void MakeDurable() override;
+
+    DatabaseWriteStats GetWriteStats() const override EXCLUSIVE_LOCKS_REQUIRED(!m_stats_mutex);
+
     sqlite3* m_db{nullptr};
     bool m_use_unsafe_sync;
+    bool m_use_full_sync;
 };
 
 std::unique_ptr<SQLiteDatabase> MakeSQLiteDatabase(const fs::path& path, const DatabaseOptions& options, DatabaseStatus& status, bilingual_str& error);
@@ -7,6 +7,7 @@
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <random.h>
+#include <test/util/random.h>
 #include <test/util/setup_common.h>
 #include <util/translation.h>
 #include <wallet/coincontrol.h>
@@ -1092,5 +1093,45 @@ BOOST_FIXTURE_TEST_CASE(wallet_coinsresult_test, BasicTestingSetup)
     }
 }
 
+BOOST_AUTO_TEST_CASE(selection_window_test)
+{
+    std::vector<COutput> outputs;
+    for (int i = 1; i <= 3000; ++i) {
+        add_coin(i * CENT, 0, outputs);
+    }
+    Shuffle(outputs.begin(), outputs.end(), g_insecure_rand_ctx);
+    CoinsResult coins;
+    for (const COutput& output : outputs) coins.Add(OutputType::LEGACY, output);
+
+    const auto values{[](const CoinsResult& window) {
+        std::vector<CAmount> result;
+        for (const COutput& output : window.All()) result.push_back(output.txout.nValue);
+        return result;
+    }};
+
+    // Three quarters below the target and a quarter from it up, ordered by value
+    std::vector<CAmount> window{values(SelectionWindow(coins, 1000 * CENT, 100, /*whole_scripts=*/false))};
+    BOOST_REQUIRE_EQUAL(window.size(), 100U);
+    BOOST_CHECK(std::is_sorted(window.begin(), window.end()));
+    BOOST_CHECK_EQUAL(window.front(), 925 * CENT);
+    BOOST_CHECK_EQUAL(window.back(), 1024 * CENT);
+
+    // Near the ends of the coins the window is moved to keep its size
+    window = values(SelectionWindow(coins, 50 * CENT, 100, /*whole_scripts=*/false));
+    BOOST_REQUIRE_EQUAL(window.size(), 100U);
+    BOOST_CHECK_EQUAL(window.front(), 1 * CENT);
+    BOOST_CHECK_EQUAL(window.back(), 100 * CENT);
+    window = values(SelectionWindow(coins, 100000 * CENT, 100, /*whole_scripts=*/false));
+    BOOST_REQUIRE_EQUAL(window.size(), 100U);
+    BOOST_CHECK_EQUAL(window.front(), 2901 * CENT);
+    BOOST_CHECK_EQUAL(window.back(), 3000 * CENT);
+
+    // All coins share the empty script, so whole scripts fill up a full group
+    BOOST_CHECK_EQUAL(SelectionWindow(coins, 1000 * CENT, 60, /*whole_scripts=*/true).Size(), 100U);
+
+    // Fewer coins than candidates are kept as they are
+    BOOST_CHECK_EQUAL(SelectionWindow(coins, 1000 * CENT, 3000, /*whole_scripts=*/false).Size(), 3000U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace wallet
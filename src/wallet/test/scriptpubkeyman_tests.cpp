@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <key.h>
+#include <key_io.h>
+#include <script/descriptor.h>
 #include <script/standard.h>
 #include <test/util/setup_common.h>
 #include <wallet/scriptpubkeyman.h>
@@ -10,6 +12,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <set>
+
 namespace wallet {
 BOOST_FIXTURE_TEST_SUITE(scriptpubkeyman_tests, BasicTestingSetup)
 
@@ -39,5 +43,65 @@ BOOST_AUTO_TEST_CASE(CanProvide)
     BOOST_CHECK(keyman.CanProvide(p2sh_script, data));
 }
 
+// Test that deriving a ranged descriptor on several threads gives the same
+// scripts, script indices and cache as deriving it on one.
+BOOST_AUTO_TEST_CASE(topup_threads)
+{
+    static constexpr int32_t TOPUP_SIZE{250};
+    CWallet wallet(m_node.chain.get(), "", CreateDummyWalletDatabase());
+
+    CKey seed;
+    seed.MakeNewKey(true);
+    CExtKey master;
+    master.SetSeed(seed);
+    const std::string xprv{EncodeExtKey(master)};
+    seed.MakeNewKey(true);
+    CExtKey other;
+    other.SetSeed(seed);
+    const std::string other_xpub{EncodeExtPubKey(other.Neuter())};
+
+    for (const std::string& desc_str : {"wpkh(" + xprv + "/0/*)", "pkh(" + xprv + "/1h/*h)", "sh(multi(1," + xprv + "/2/*," + other_xpub + "/*))"}) {
+        BOOST_TEST_MESSAGE(desc_str);
+        std::vector<std::unique_ptr<DescriptorScriptPubKeyMan>> spk_mans;
+        for (int threads : {1, 4}) {
+            FlatSigningProvider keys;
+            std::string error;
+            std::unique_ptr<Descriptor> desc{Parse(desc_str, keys, error, /*require_checksum=*/false)};
+            BOOST_REQUIRE(desc);
+            WalletDescriptor w_desc(std::move(desc), 0, 0, 0, 0);
+            auto& spk_man{spk_mans.emplace_back(std::make_unique<DescriptorScriptPubKeyMan>(wallet, w_desc, /*keypool_size=*/0))};
+            for (const auto& [id, key] : keys.keys) {
+                spk_man->AddDescriptorKey(key, key.GetPubKey());
+            }
+            spk_man->SetTopUpThreads(threads);
+            BOOST_CHECK(spk_man->TopUp(TOPUP_SIZE));
+            // The second top up derives from the parent xpubs cached by the first
+            BOOST_CHECK(spk_man->TopUp(2 * TOPUP_SIZE));
+        }
+        const DescriptorScriptPubKeyMan& sequential{*spk_mans[0]};
+        const DescriptorScriptPubKeyMan& threaded{*spk_mans[1]};
+
+        BOOST_CHECK_EQUAL(sequential.GetEndRange(), 2 * TOPUP_SIZE);
+        BOOST_CHECK_EQUAL(threaded.GetEndRange(), 2 * TOPUP_SIZE);
+        BOOST_CHECK_EQUAL(threaded.GetScriptPubKeys().size(), size_t{2 * TOPUP_SIZE});
+        // Equal sets above every index mean every script has the same index.
+        // The sets are compared ordered, as each one hashes with its own salt.
+        const auto scripts_from = [](const DescriptorScriptPubKeyMan& spk_man, int32_t index) {
+            const auto scripts{spk_man.GetScriptPubKeys(index)};
+            return std::set<CScript>(scripts.begin(), scripts.end());
+        };
+        for (int32_t i = 0; i <= 2 * TOPUP_SIZE; ++i) {
+            BOOST_CHECK(scripts_from(sequential, i) == scripts_from(threaded, i));
+        }
+
+        const WalletDescriptor sequential_desc{WITH_LOCK(sequential.cs_desc_man, return sequential.GetWalletDescriptor())};
+        const WalletDescriptor threaded_desc{WITH_LOCK(threaded.cs_desc_man, return threaded.GetWalletDescriptor())};
+        BOOST_CHECK_EQUAL(threaded_desc.range_end, sequential_desc.range_end);
+        BOOST_CHECK(threaded_desc.cache.GetCachedParentExtPubKeys() == sequential_desc.cache.GetCachedParentExtPubKeys());
+        BOOST_CHECK(threaded_desc.cache.GetCachedDerivedExtPubKeys() == sequential_desc.cache.GetCachedDerivedExtPubKeys());
+        BOOST_CHECK(threaded_desc.cache.GetCachedLastHardenedExtPubKeys() == sequential_desc.cache.GetCachedLastHardenedExtPubKeys());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace wallet
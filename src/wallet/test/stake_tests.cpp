@@ -0,0 +1,287 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <index/txindex.h>
+#include <interfaces/chain.h>
+#include <key_io.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <util/translation.h>
+#include <validation.h>
+#include <validationinterface.h>
+#include <wallet/coincontrol.h>
+#include <wallet/spend.h>
+#include <wallet/test/util.h>
+#include <wallet/wallet.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+
+namespace wallet {
+static CPubKey NewPubKey()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    return key.GetPubKey();
+}
+
+class StakeTestingSetup : public TestChain100Setup
+{
+public:
+    StakeTestingSetup()
+    {
+        // The wallet counts the maturity of coinbases in proof-of-stake
+        // blocks, so it stakes plain payments of coinbases to its key
+        const CScript script{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+        std::vector<CMutableTransaction> payments;
+        for (int i = 0; i < 5; ++i) {
+            payments.push_back(SimpleSpend(*m_coinbase_txns[i], script));
+        }
+        CreateAndProcessBlock(payments, script);
+        // AvailableStakeCoins() needs the block offsets of the coins
+        g_txindex = std::make_unique<TxIndex>(interfaces::MakeChain(m_node), 1 << 20, true);
+        BOOST_REQUIRE(g_txindex->Start());
+        SyncTxIndex();
+        wallet = CreateSyncedWallet(*m_node.chain, WITH_LOCK(Assert(m_node.chainman)->GetMutex(), return m_node.chainman->ActiveChain()), coinbaseKey);
+    }
+
+    ~StakeTestingSetup()
+    {
+        wallet.reset();
+        SyncWithValidationInterfaceQueue();
+        g_txindex->Stop();
+        g_txindex.reset();
+    }
+
+    void SyncTxIndex()
+    {
+        constexpr int64_t timeout_ms = 10 * 1000;
+        int64_t time_start = GetTimeMillis();
+        while (!g_txindex->BlockUntilSyncedToCurrentChain()) {
+            BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+            UninterruptibleSleep(std::chrono::milliseconds{100});
+        }
+    }
+
+    /** Spend the first output of a coinbase of the setup chain to a script */
+    CMutableTransaction SimpleSpend(const CTransaction& from, const CScript& script)
+    {
+        CMutableTransaction mtx;
+        mtx.vout.push_back({from.vout[0].nValue - PERKB_TX_FEE, script});
+        mtx.vin.push_back({CTxIn{from.GetHash(), 0}});
+        FillableSigningProvider keystore;
+        keystore.AddKey(coinbaseKey);
+        std::map<COutPoint, Coin> coins;
+        coins[mtx.vin[0].prevout].out = from.vout[0];
+        std::map<int, bilingual_str> input_errors;
+        BOOST_REQUIRE(SignTransaction(mtx, &keystore, coins, SIGHASH_ALL, input_errors));
+        return mtx;
+    }
+
+    /** Create and commit a transaction to the mempool, without a block */
+    CTransactionRef CommitTx(const CRecipient& recipient)
+    {
+        CCoinControl dummy;
+        constexpr int RANDOM_CHANGE_POSITION = -1;
+        auto res = CreateTransaction(*wallet, {recipient}, RANDOM_CHANGE_POSITION, dummy);
+        BOOST_REQUIRE(res);
+        wallet->CommitTransaction(res->tx, {}, {});
+        return res->tx;
+    }
+
+    /** Mine a committed transaction and confirm it in the wallet */
+    void ConfirmTx(const CTransactionRef& tx)
+    {
+        CreateAndProcessBlock({CMutableTransaction(*tx)}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+        SyncTxIndex();
+
+        LOCK(wallet->cs_wallet);
+        LOCK(Assert(m_node.chainman)->GetMutex());
+        wallet->SetLastBlockProcessed(wallet->GetLastBlockHeight() + 1, m_node.chainman->ActiveChain().Tip()->GetBlockHash());
+        auto it = wallet->mapWallet.find(tx->GetHash());
+        BOOST_REQUIRE(it != wallet->mapWallet.end());
+        it->second.m_state = TxStateConfirmed{m_node.chainman->ActiveChain().Tip()->GetBlockHash(), m_node.chainman->ActiveChain().Height(), /*index=*/1};
+        wallet->MarkDirty();
+    }
+
+    /** The stake coins, by a full scan of the wallet transactions */
+    std::set<COutPoint> ScanStakeCoins(CAmount& balance) EXCLUSIVE_LOCKS_REQUIRED(wallet->cs_wallet)
+    {
+        std::set<COutPoint> result;
+        balance = 0;
+        for (const auto& [hash, wtx] : wallet->mapWallet) {
+            if (!wtx.isConfirmed() || wallet->IsTxImmatureCoinBase(wtx)) continue;
+            for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+                const COutPoint outpoint{hash, i};
+                const CTxOut& txout{wtx.tx->vout[i]};
+                if (txout.nValue <= 0 || wallet->IsSpent(outpoint) || wallet->IsLockedCoin(outpoint)) continue;
+                if (!(wallet->IsMine(txout) & ISMINE_SPENDABLE)) continue;
+                result.insert(outpoint);
+                balance += txout.nValue;
+            }
+        }
+        return result;
+    }
+
+    /** Check the maintained candidate set against a full scan */
+    std::set<COutPoint> CheckStakeCoins()
+    {
+        LOCK2(wallet->cs_wallet, ::cs_main);
+        CAmount balance;
+        const std::set<COutPoint> expected{ScanStakeCoins(balance)};
+        const StakeCoins coins{wallet->AvailableStakeCoins(*m_node.chainman)};
+        std::set<COutPoint> actual;
+        for (const StakeCoin& coin : coins.coins) {
+            actual.insert(coin.outpoint);
+        }
+        BOOST_CHECK(actual == expected);
+        BOOST_CHECK_EQUAL(coins.coins.size(), expected.size());
+        BOOST_CHECK_EQUAL(coins.balance, balance);
+        return actual;
+    }
+
+    std::unique_ptr<CWallet> wallet;
+};
+
+BOOST_FIXTURE_TEST_SUITE(stake_tests, StakeTestingSetup)
+
+BOOST_AUTO_TEST_CASE(stake_candidates)
+{
+    // The payments of the setup chain
+    const std::set<COutPoint> initial{CheckStakeCoins()};
+    BOOST_REQUIRE(!initial.empty());
+
+    // An unconfirmed payment to the wallet does not stake until confirmed
+    const CScript own_script{GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()))};
+    const CTransactionRef add_tx{CommitTx({own_script, 1 * COIN, /*fSubtractFeeFromAmount=*/false})};
+    const std::set<COutPoint> unconfirmed{CheckStakeCoins()};
+    for (const CTxIn& txin : add_tx->vin) {
+        BOOST_CHECK(!unconfirmed.count(txin.prevout));
+    }
+    ConfirmTx(add_tx);
+    const std::set<COutPoint> added{CheckStakeCoins()};
+    for (unsigned int i = 0; i < add_tx->vout.size(); ++i) {
+        BOOST_CHECK(added.count(COutPoint{add_tx->GetHash(), i}));
+    }
+
+    // A spend in the mempool removes the coin
+    const CScript foreign_script{GetScriptForDestination(PKHash(NewPubKey()))};
+    const CTransactionRef spend_tx{CommitTx({foreign_script, COIN / 2, /*fSubtractFeeFromAmount=*/false})};
+    const std::set<COutPoint> spent{CheckStakeCoins()};
+    for (const CTxIn& txin : spend_tx->vin) {
+        BOOST_CHECK(!spent.count(txin.prevout));
+    }
+    BOOST_CHECK(spent.size() < added.size());
+
+    // Locked coins are skipped until unlocked
+    BOOST_REQUIRE(!spent.empty());
+    const COutPoint locked{*spent.begin()};
+    WITH_LOCK(wallet->cs_wallet, wallet->LockCoin(locked));
+    BOOST_CHECK(!CheckStakeCoins().count(locked));
+    WITH_LOCK(wallet->cs_wallet, wallet->UnlockCoin(locked));
+    BOOST_CHECK(CheckStakeCoins().count(locked));
+
+    // A stale candidate set is rebuilt from the wallet transactions
+    wallet->MarkDirty();
+    BOOST_CHECK(CheckStakeCoins() == spent);
+}
+
+BOOST_AUTO_TEST_CASE(stale_stake_snapshot)
+{
+    auto update_snapshot = [&] {
+        LOCK2(wallet->cs_wallet, ::cs_main);
+        wallet->UpdateStakeSnapshot(*m_node.chainman);
+        return wallet->GetStakeSnapshot();
+    };
+    auto is_current = [&](const StakeCoins& coins) {
+        LOCK2(wallet->cs_wallet, ::cs_main);
+        return wallet->IsStakeSnapshotCurrent(*m_node.chainman, coins);
+    };
+
+    std::shared_ptr<const StakeCoins> snapshot{update_snapshot()};
+    BOOST_REQUIRE(snapshot && !snapshot->coins.empty());
+    BOOST_CHECK(is_current(*snapshot));
+    // A current snapshot is not collected again
+    BOOST_CHECK(update_snapshot() == snapshot);
+
+    // Locking a coin
+    const COutPoint outpoint{snapshot->coins.front().outpoint};
+    WITH_LOCK(wallet->cs_wallet, wallet->LockCoin(outpoint));
+    BOOST_CHECK(!is_current(*snapshot));
+    WITH_LOCK(wallet->cs_wallet, wallet->UnlockCoin(outpoint));
+    snapshot = update_snapshot();
+    BOOST_CHECK(is_current(*snapshot));
+
+    // Spending a coin
+    CommitTx({GetScriptForDestination(PKHash(NewPubKey())), COIN / 2, /*fSubtractFeeFromAmount=*/false});
+    BOOST_CHECK(!is_current(*snapshot));
+    // No coinstake is signed for a kernel of a stale snapshot
+    CMutableTransaction coinstake;
+    BOOST_CHECK(!wallet->CreateCoinStake(*m_node.chainman, StakeKernel{snapshot, 0, coinstake.nTime}, coinstake, PKHash(coinbaseKey.GetPubKey())));
+    snapshot = update_snapshot();
+    BOOST_CHECK(is_current(*snapshot));
+
+    // A new tip
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    BOOST_CHECK(!is_current(*snapshot));
+    snapshot = update_snapshot();
+    BOOST_CHECK(is_current(*snapshot));
+}
+
+BOOST_AUTO_TEST_CASE(reserve_balance)
+{
+    BOOST_CHECK_EQUAL(*GetAllowedStakeBalance(20 * COIN), 20 * COIN);
+    BOOST_CHECK(!GetAllowedStakeBalance(0));
+
+    gArgs.ForceSetArg("-reservebalance", "10");
+    BOOST_CHECK(!GetAllowedStakeBalance(5 * COIN));
+    BOOST_CHECK(!GetAllowedStakeBalance(10 * COIN));
+    BOOST_CHECK(!GetAllowedStakeBalance(10 * COIN + MIN_TXOUT_AMOUNT - 1));
+    BOOST_CHECK_EQUAL(*GetAllowedStakeBalance(10 * COIN + MIN_TXOUT_AMOUNT), MIN_TXOUT_AMOUNT);
+    BOOST_CHECK_EQUAL(*GetAllowedStakeBalance(25 * COIN), 15 * COIN);
+
+    gArgs.ForceSetArg("-reservebalance", "invalid");
+    BOOST_CHECK(!GetAllowedStakeBalance(25 * COIN));
+}
+
+BOOST_AUTO_TEST_CASE(kernel_coin_selection)
+{
+    const unsigned int time{1700000000};
+    const int64_t min_age{Params().GetConsensus().nStakeMinAge};
+    const CScript p2pkh{GetScriptForDestination(PKHash(NewPubKey()))};
+    const CScript p2wpkh{GetScriptForDestination(WitnessV0KeyHash(NewPubKey()))};
+    const CScript p2sh{GetScriptForDestination(ScriptHash(p2pkh))};
+
+    StakeCoins coins;
+    auto add_coin = [&](CAmount value, const CScript& script, int64_t age) {
+        StakeCoin coin;
+        coin.outpoint = COutPoint{InsecureRand256(), 0};
+        coin.txout = CTxOut{value, script};
+        coin.header.nTime = time - age;
+        coin.tx_offset = 0;
+        coins.balance += value;
+        coins.coins.push_back(coin);
+    };
+    add_coin(5 * COIN, p2pkh, 2 * min_age);
+    add_coin(5 * COIN, p2wpkh, 2 * min_age);
+    // Script types CreateCoinStake() cannot sign a kernel for
+    add_coin(5 * COIN, p2sh, 2 * min_age);
+    // Too young, counting the search interval back from time
+    add_coin(5 * COIN, p2pkh, min_age);
+    add_coin(5 * COIN, p2pkh, min_age + 60);
+    // Above the balance allowed by -reservebalance
+    add_coin(50 * COIN, p2pkh, 2 * min_age);
+
+    BOOST_CHECK((SelectStakeKernelCoins(coins, 20 * COIN, time) == std::vector<size_t>{0, 1, 4}));
+    BOOST_CHECK((SelectStakeKernelCoins(coins, 50 * COIN, time) == std::vector<size_t>{0, 1, 4, 5}));
+    BOOST_CHECK((SelectStakeKernelCoins(coins, 1 * COIN, time).empty()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+} // namespace wallet
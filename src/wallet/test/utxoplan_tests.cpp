@@ -0,0 +1,152 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <random.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <wallet/utxoplan.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+namespace wallet {
+BOOST_FIXTURE_TEST_SUITE(utxoplan_tests, BasicTestingSetup)
+
+static constexpr int64_t NOW{1700000000};
+static constexpr int P2PKH_INPUT_BYTES{148};
+static constexpr int64_t DAY{24 * 60 * 60};
+
+static UtxoPlanParams MakeParams()
+{
+    UtxoPlanParams params;
+    params.target_amount = 100 * COIN;
+    params.combine_threshold = params.target_amount / 3;
+    params.output_bytes = 34;
+    params.now = NOW;
+    // The minting yield peaks around the target at this difficulty
+    params.difficulty = 20;
+    params.money_supply = 30000000 * COIN;
+    params.stake_min_age = Params().GetConsensus().nStakeMinAge;
+    params.stake_max_age = Params().GetConsensus().nStakeMaxAge;
+    return params;
+}
+
+static std::vector<UtxoPlanCoin> MakeCoins(size_t count, CAmount value, int64_t age = 0)
+{
+    std::vector<UtxoPlanCoin> coins;
+    for (size_t i = 0; i < count; ++i) {
+        coins.push_back({COutPoint{InsecureRand256(), static_cast<uint32_t>(i)}, value, NOW - age, P2PKH_INPUT_BYTES});
+    }
+    return coins;
+}
+
+static CAmount Sum(const std::vector<CAmount>& amounts)
+{
+    return std::accumulate(amounts.begin(), amounts.end(), CAmount{0});
+}
+
+BOOST_AUTO_TEST_CASE(split_large_coin)
+{
+    const UtxoPlan plan{PlanUtxoSet(MakeCoins(1, 1000 * COIN), MakeParams())};
+    BOOST_REQUIRE_EQUAL(plan.txs.size(), 1U);
+    BOOST_CHECK_EQUAL(plan.txs[0].inputs.size(), 1U);
+    // 1000 / 10 is closer to 100 in ratio than 1000 / 11
+    BOOST_CHECK_EQUAL(plan.txs[0].outputs.size(), 10U);
+    BOOST_CHECK_EQUAL(Sum(plan.txs[0].outputs), 1000 * COIN);
+    BOOST_CHECK_EQUAL(plan.txs[0].bytes, 16U + P2PKH_INPUT_BYTES + 10 * 34);
+    BOOST_CHECK_EQUAL(plan.fees, plan.txs[0].fee);
+    BOOST_CHECK(plan.fees > 0);
+    BOOST_CHECK(plan.yearly_reward_after > plan.yearly_reward_before);
+    BOOST_CHECK_EQUAL(plan.coins_kept, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(merge_small_coins)
+{
+    const UtxoPlan plan{PlanUtxoSet(MakeCoins(20, 5 * COIN), MakeParams())};
+    BOOST_REQUIRE_EQUAL(plan.txs.size(), 1U);
+    BOOST_CHECK_EQUAL(plan.txs[0].inputs.size(), 20U);
+    BOOST_REQUIRE_EQUAL(plan.txs[0].outputs.size(), 1U);
+    BOOST_CHECK_EQUAL(plan.txs[0].outputs[0], 100 * COIN);
+    BOOST_CHECK(plan.yearly_reward_after > plan.yearly_reward_before);
+
+    // A leftover that does not reach the target goes into the last group
+    const UtxoPlan leftover{PlanUtxoSet(MakeCoins(25, 5 * COIN), MakeParams())};
+    BOOST_REQUIRE_EQUAL(leftover.txs.size(), 1U);
+    BOOST_CHECK_EQUAL(leftover.txs[0].inputs.size(), 25U);
+    BOOST_CHECK_EQUAL(leftover.txs[0].outputs.size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(keep_coins_near_target)
+{
+    std::vector<UtxoPlanCoin> coins{MakeCoins(1, 100 * COIN)};
+    for (const auto& coin : MakeCoins(1, 140 * COIN)) coins.push_back(coin);
+    for (const auto& coin : MakeCoins(1, 34 * COIN)) coins.push_back(coin);
+    const UtxoPlan plan{PlanUtxoSet(coins, MakeParams())};
+    BOOST_CHECK(plan.txs.empty());
+    BOOST_CHECK_EQUAL(plan.coins_kept, 3U);
+    BOOST_CHECK_EQUAL(plan.yearly_reward_after, plan.yearly_reward_before);
+}
+
+BOOST_AUTO_TEST_CASE(keep_coin_age)
+{
+    // Splitting resets a year of coin age, which a day of better minting
+    // does not make up for
+    UtxoPlanParams params{MakeParams()};
+    params.horizon_days = 1;
+    const UtxoPlan plan{PlanUtxoSet(MakeCoins(1, 1000 * COIN, 365 * DAY), params)};
+    BOOST_CHECK(plan.txs.empty());
+    BOOST_CHECK_EQUAL(plan.coins_kept, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(batch_into_transactions)
+{
+    UtxoPlanParams params{MakeParams()};
+    params.max_tx_bytes = 5000;
+    params.max_transactions = 8;
+    const UtxoPlan plan{PlanUtxoSet(MakeCoins(100, 1000 * COIN), params)};
+    // Ten splits of 488 bytes fit into a transaction
+    BOOST_REQUIRE_EQUAL(plan.txs.size(), 8U);
+    CAmount fees{0};
+    for (const UtxoPlanTx& tx : plan.txs) {
+        BOOST_CHECK(tx.bytes <= params.max_tx_bytes);
+        BOOST_CHECK_EQUAL(tx.inputs.size(), 10U);
+        BOOST_CHECK_EQUAL(tx.outputs.size(), 100U);
+        BOOST_CHECK_EQUAL(Sum(tx.outputs), 10 * 1000 * COIN);
+        fees += tx.fee;
+    }
+    BOOST_CHECK_EQUAL(plan.fees, fees);
+    BOOST_CHECK_EQUAL(plan.coins_kept, 20U);
+
+    // A coin too large for a single transaction is split into as many
+    // outputs as fit
+    const UtxoPlan large{PlanUtxoSet(MakeCoins(1, 100000 * COIN), params)};
+    BOOST_REQUIRE_EQUAL(large.txs.size(), 1U);
+    BOOST_CHECK_EQUAL(large.txs[0].outputs.size(), (5000U - 16 - P2PKH_INPUT_BYTES) / 34);
+    BOOST_CHECK(large.txs[0].bytes <= params.max_tx_bytes);
+}
+
+BOOST_AUTO_TEST_CASE(deterministic)
+{
+    std::vector<UtxoPlanCoin> coins{MakeCoins(50, 3 * COIN, 10 * DAY)};
+    for (const auto& coin : MakeCoins(30, 700 * COIN, 40 * DAY)) coins.push_back(coin);
+    for (const auto& coin : MakeCoins(30, 90 * COIN)) coins.push_back(coin);
+    const UtxoPlan plan{PlanUtxoSet(coins, MakeParams())};
+    BOOST_CHECK(!plan.txs.empty());
+    Shuffle(coins.begin(), coins.end(), g_insecure_rand_ctx);
+    const UtxoPlan shuffled{PlanUtxoSet(coins, MakeParams())};
+    BOOST_REQUIRE_EQUAL(plan.txs.size(), shuffled.txs.size());
+    for (size_t i = 0; i < plan.txs.size(); ++i) {
+        BOOST_CHECK(plan.txs[i].inputs == shuffled.txs[i].inputs);
+        BOOST_CHECK(plan.txs[i].outputs == shuffled.txs[i].outputs);
+        BOOST_CHECK_EQUAL(plan.txs[i].fee, shuffled.txs[i].fee);
+    }
+    BOOST_CHECK_EQUAL(plan.yearly_reward_after, shuffled.yearly_reward_after);
+    BOOST_CHECK_EQUAL(plan.coins_kept, shuffled.coins_kept);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+} // namespace wallet
@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <vector>
 
+#include <consensus/validation.h>
 #include <interfaces/chain.h>
 #include <key_io.h>
 #include <node/blockstorage.h>
@@ -60,7 +61,8 @@ static void TestUnloadWallet(std::shared_ptr<CWallet>&& wallet)
 static CMutableTransaction TestSimpleSpend(const CTransaction& from, uint32_t index, const CKey& key, const CScript& pubkey)
 {
     CMutableTransaction mtx;
-    mtx.vout.push_back({from.vout[index].nValue - MIN_TX_FEE, pubkey});
+    // peercoin: the minimum fee of a transaction of less than 1000 bytes
+    mtx.vout.push_back({from.vout[index].nValue - PERKB_TX_FEE, pubkey});
     mtx.vin.push_back({CTxIn{from.GetHash(), index}});
     FillableSigningProvider keystore;
     keystore.AddKey(key);
@@ -188,6 +190,81 @@ BOOST_FIXTURE_TEST_CASE(scan_for_wallet_transactions, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(scan_for_wallet_transactions_threads, TestChain100Setup)
+{
+    // -rescanthreads sets the threads of a loaded wallet
+    m_args.ForceSetArg("-unsafesqlitesync", "1");
+    WalletContext context;
+    context.args = &m_args;
+    context.chain = m_node.chain.get();
+    for (const auto& [arg, threads] : std::vector<std::pair<std::string, int>>{{"1", 1}, {"4", 4}, {"100", MAX_RESCAN_THREADS}}) {
+        m_args.ForceSetArg("-rescanthreads", arg);
+        auto wallet = TestLoadWallet(context);
+        BOOST_CHECK_EQUAL(wallet->m_rescan_threads, threads);
+        TestUnloadWallet(std::move(wallet));
+    }
+
+    // More than a batch of blocks with payments to the wallet, spends of
+    // them whose outputs do not pay to the wallet, and unrelated transactions
+    CKey key;
+    key.MakeNewKey(true);
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    const CScript script{GetScriptForRawPubKey(key.GetPubKey())};
+    const CScript other_script{GetScriptForRawPubKey(other_key.GetPubKey())};
+    std::vector<CMutableTransaction> payments;
+    std::vector<uint256> spends;
+    for (int i = 0; i < RESCAN_BATCH_SIZE + 10; ++i) {
+        std::vector<CMutableTransaction> txs;
+        if (i % 3 == 0) {
+            payments.push_back(TestSimpleSpend(*m_coinbase_txns[i], 0, coinbaseKey, script));
+            txs.push_back(payments.back());
+        } else if (i % 3 == 1) {
+            txs.push_back(TestSimpleSpend(CTransaction{payments.back()}, 0, key, other_script));
+            spends.push_back(txs.back().GetHash());
+        }
+        if (i % 3 != 0) txs.push_back(TestSimpleSpend(*m_coinbase_txns[i], 0, coinbaseKey, other_script));
+        CreateAndProcessBlock(txs, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    }
+
+    auto scan = [&](int threads) {
+        auto wallet{std::make_unique<CWallet>(m_node.chain.get(), "", CreateDummyWalletDatabase())};
+        {
+            LOCK(wallet->cs_wallet);
+            LOCK(Assert(m_node.chainman)->GetMutex());
+            wallet->SetWalletFlag(WALLET_FLAG_DESCRIPTORS);
+            wallet->SetLastBlockProcessed(m_node.chainman->ActiveChain().Height(), m_node.chainman->ActiveChain().Tip()->GetBlockHash());
+        }
+        AddKey(*wallet, key);
+        wallet->m_rescan_threads = threads;
+        WalletRescanReserver reserver(*wallet);
+        reserver.reserve();
+        const CWallet::ScanResult result{wallet->ScanForWalletTransactions(WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Genesis()->GetBlockHash()), /*start_height=*/0, /*max_height=*/{}, reserver, /*fUpdate=*/false, /*save_progress=*/false)};
+        BOOST_CHECK_EQUAL(result.status, CWallet::ScanResult::SUCCESS);
+        BOOST_CHECK(result.last_failed_block.IsNull());
+        BOOST_CHECK_EQUAL(result.last_scanned_block, WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip()->GetBlockHash()));
+        return wallet;
+    };
+    const auto sequential{scan(1)};
+    const auto threaded{scan(4)};
+
+    LOCK2(sequential->cs_wallet, threaded->cs_wallet);
+    BOOST_CHECK_EQUAL(sequential->mapWallet.size(), payments.size() + spends.size());
+    BOOST_CHECK_EQUAL(threaded->mapWallet.size(), sequential->mapWallet.size());
+    for (const auto& [hash, wtx] : sequential->mapWallet) {
+        const CWalletTx* other{threaded->GetWalletTx(hash)};
+        BOOST_REQUIRE(other);
+        BOOST_CHECK(wtx.state<TxStateConfirmed>());
+        BOOST_CHECK(TxStateSerializedBlockHash(other->m_state) == TxStateSerializedBlockHash(wtx.m_state));
+        BOOST_CHECK_EQUAL(TxStateSerializedIndex(other->m_state), TxStateSerializedIndex(wtx.m_state));
+    }
+    // The spends are found through their inputs
+    for (const uint256& hash : spends) {
+        BOOST_CHECK(threaded->GetWalletTx(hash));
+    }
+    BOOST_CHECK_EQUAL(GetBalance(*threaded).m_mine_trusted, GetBalance(*sequential).m_mine_trusted);
+}
+
 BOOST_FIXTURE_TEST_CASE(importmulti_rescan, TestChain100Setup)
 {
     // Cap last block file size, and mine new block in a new block file.
@@ -879,6 +956,115 @@ BOOST_FIXTURE_TEST_CASE(ZapSelectTx, TestChain100Setup)
     TestUnloadWallet(std::move(wallet));
 }
 
+/** GetBalance() with min_depth 0 as a scan of all wallet transactions, without the balance cache */
+static Balance ScanBalance(const CWallet& wallet)
+{
+    Balance ret;
+    LOCK(wallet.cs_wallet);
+    std::set<uint256> trusted_parents;
+    for (const auto& [hash, wtx] : wallet.mapWallet) {
+        const bool is_trusted{CachedTxIsTrusted(wallet, wtx, trusted_parents)};
+        const int tx_depth{wallet.GetTxDepthInMainChain(wtx)};
+        const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_SPENDABLE)};
+        const CAmount tx_credit_watchonly{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_WATCH_ONLY)};
+        if (is_trusted) {
+            ret.m_mine_trusted += tx_credit_mine;
+            ret.m_watchonly_trusted += tx_credit_watchonly;
+        }
+        if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
+            ret.m_mine_untrusted_pending += tx_credit_mine;
+            ret.m_watchonly_untrusted_pending += tx_credit_watchonly;
+        }
+        ret.m_mine_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_SPENDABLE);
+        ret.m_watchonly_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_WATCH_ONLY);
+    }
+    return ret;
+}
+
+static void CheckCachedBalance(const CWallet& wallet, bool sync_notifications = true)
+{
+    if (sync_notifications) SyncWithValidationInterfaceQueue();
+    const Balance cached{GetBalance(wallet)};
+    const Balance scanned{ScanBalance(wallet)};
+    BOOST_CHECK_EQUAL(cached.m_mine_trusted, scanned.m_mine_trusted);
+    BOOST_CHECK_EQUAL(cached.m_mine_untrusted_pending, scanned.m_mine_untrusted_pending);
+    BOOST_CHECK_EQUAL(cached.m_mine_immature, scanned.m_mine_immature);
+    BOOST_CHECK_EQUAL(cached.m_watchonly_trusted, scanned.m_watchonly_trusted);
+    BOOST_CHECK_EQUAL(cached.m_watchonly_untrusted_pending, scanned.m_watchonly_untrusted_pending);
+    BOOST_CHECK_EQUAL(cached.m_watchonly_immature, scanned.m_watchonly_immature);
+}
+
+BOOST_FIXTURE_TEST_CASE(cached_balance, TestChain100Setup)
+{
+    m_args.ForceSetArg("-unsafesqlitesync", "1");
+    WalletContext context;
+    context.args = &m_args;
+    context.chain = m_node.chain.get();
+    auto wallet = TestLoadWallet(context);
+    CKey key;
+    key.MakeNewKey(true);
+    AddKey(*wallet, key);
+    const CScript script{GetScriptForRawPubKey(key.GetPubKey())};
+    CheckCachedBalance(*wallet);
+
+    // A payment from outside the wallet, and a spend of it by the wallet.
+    // Both are untrusted while the payment is unconfirmed.
+    std::string error;
+    m_coinbase_txns.push_back(CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey())).vtx[0]);
+    const CMutableTransaction parent{TestSimpleSpend(*m_coinbase_txns[0], 0, coinbaseKey, script)};
+    BOOST_CHECK(m_node.chain->broadcastTransaction(MakeTransactionRef(parent), false, error));
+    const CMutableTransaction child{TestSimpleSpend(CTransaction{parent}, 0, key, script)};
+    BOOST_CHECK(m_node.chain->broadcastTransaction(MakeTransactionRef(child), false, error));
+    CheckCachedBalance(*wallet);
+    BOOST_CHECK_EQUAL(GetBalance(*wallet).m_mine_trusted, 0);
+
+    // Confirming the parent makes the child trusted, without a notification for the child
+    const CBlock block{CreateAndProcessBlock({parent}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()))};
+    CheckCachedBalance(*wallet);
+    BOOST_CHECK_EQUAL(GetBalance(*wallet).m_mine_trusted, child.vout[0].nValue);
+
+    // A reorg returns the parent to the mempool
+    {
+        LOCK(::cs_main);
+        BlockValidationState state;
+        CBlockIndex* pindex{m_node.chainman->m_blockman.LookupBlockIndex(block.GetHash())};
+        BOOST_REQUIRE(m_node.chainman->ActiveChainstate().InvalidateBlock(state, pindex));
+    }
+    CheckCachedBalance(*wallet);
+    WITH_LOCK(::cs_main, m_node.chainman->ActiveChainstate().ResetBlockFailureFlags(m_node.chainman->m_blockman.LookupBlockIndex(block.GetHash())));
+    BlockValidationState state;
+    BOOST_REQUIRE(m_node.chainman->ActiveChainstate().ActivateBestChain(state));
+    CheckCachedBalance(*wallet);
+
+    // A parent evicted from the mempool takes the child with it
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    CheckCachedBalance(*wallet);
+    const CMutableTransaction unconfirmed{TestSimpleSpend(*m_coinbase_txns[1], 0, coinbaseKey, script)};
+    BOOST_CHECK(m_node.chain->broadcastTransaction(MakeTransactionRef(unconfirmed), false, error));
+    const CMutableTransaction unconfirmed_child{TestSimpleSpend(CTransaction{unconfirmed}, 0, key, script)};
+    BOOST_CHECK(m_node.chain->broadcastTransaction(MakeTransactionRef(unconfirmed_child), false, error));
+    CheckCachedBalance(*wallet);
+    WITH_LOCK(m_node.mempool->cs, m_node.mempool->removeRecursive(CTransaction{unconfirmed}, MemPoolRemovalReason::EXPIRY));
+    CheckCachedBalance(*wallet);
+
+    // Resubmitting puts the transactions in the mempool before the wallet is notified
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK(wallet->SubmitTxMemoryPoolAndRelay(wallet->mapWallet.at(unconfirmed.GetHash()), error, /*relay=*/false));
+        BOOST_CHECK(wallet->SubmitTxMemoryPoolAndRelay(wallet->mapWallet.at(unconfirmed_child.GetHash()), error, /*relay=*/false));
+        CheckCachedBalance(*wallet, /*sync_notifications=*/false);
+        BOOST_CHECK_EQUAL(GetBalance(*wallet).m_mine_untrusted_pending, unconfirmed_child.vout[0].nValue);
+    }
+    WITH_LOCK(m_node.mempool->cs, m_node.mempool->removeRecursive(CTransaction{unconfirmed}, MemPoolRemovalReason::EXPIRY));
+    CheckCachedBalance(*wallet);
+
+    // Abandoning the parent abandons the child
+    BOOST_CHECK(wallet->AbandonTransaction(unconfirmed.GetHash()));
+    CheckCachedBalance(*wallet);
+
+    TestUnloadWallet(std::move(wallet));
+}
+
 class FailCursor : public DatabaseCursor
 {
 public:
@@ -6,6 +6,8 @@
 #include <clientversion.h>
 #include <streams.h>
 #include <uint256.h>
+#include <wallet/db.h>
+#include <wallet/walletdb.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -27,5 +29,45 @@ BOOST_AUTO_TEST_CASE(walletdb_readkeyvalue)
     BOOST_CHECK_THROW(ssValue >> dummy, std::ios_base::failure);
 }
 
+#ifdef USE_SQLITE
+BOOST_AUTO_TEST_CASE(walletdb_write_group)
+{
+    DatabaseOptions options;
+    options.require_format = DatabaseFormat::SQLITE;
+    std::unique_ptr<WalletDatabase> database = CreateMockWalletDatabase(options);
+
+    // Outside of a group every write commits on its own
+    BOOST_CHECK(database->MakeBatch()->Write(std::string{"a"}, 1));
+    BOOST_CHECK_EQUAL(database->GetWriteStats().writes, 1U);
+    BOOST_CHECK_EQUAL(database->GetWriteStats().commits, 1U);
+
+    {
+        DatabaseWriteGroup group{*database};
+        DatabaseWriteGroup nested{*database};
+        BOOST_CHECK(database->MakeBatch()->Write(std::string{"b"}, 2));
+        BOOST_CHECK(database->MakeBatch()->Write(std::string{"c"}, 3));
+
+        // The transaction of a batch becomes a savepoint of the group
+        auto batch{database->MakeBatch()};
+        BOOST_CHECK(batch->TxnBegin());
+        BOOST_CHECK(batch->Write(std::string{"d"}, 4));
+        BOOST_CHECK(batch->TxnAbort());
+        BOOST_CHECK(batch->TxnBegin());
+        BOOST_CHECK(batch->Write(std::string{"e"}, 5));
+        BOOST_CHECK(batch->TxnCommit());
+        BOOST_CHECK_EQUAL(database->GetWriteStats().commits, 1U);
+    }
+    BOOST_CHECK_EQUAL(database->GetWriteStats().writes, 5U);
+    BOOST_CHECK_EQUAL(database->GetWriteStats().commits, 2U);
+
+    auto batch{database->MakeBatch()};
+    int value;
+    BOOST_CHECK(batch->Read(std::string{"b"}, value) && value == 2);
+    BOOST_CHECK(batch->Read(std::string{"c"}, value) && value == 3);
+    BOOST_CHECK(!batch->Exists(std::string{"d"}));
+    BOOST_CHECK(batch->Read(std::string{"e"}, value) && value == 5);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace wallet
@@ -51,6 +51,59 @@ BOOST_FIXTURE_TEST_CASE(wallet_load_unknown_descriptor, TestingSetup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(wallet_load_tx_records, TestingSetup)
+{
+    std::unique_ptr<WalletDatabase> database = CreateMockWalletDatabase();
+    std::set<uint256> hashes;
+    {
+        WalletBatch batch(*database, false);
+        for (int i = 0; i < 3; ++i) {
+            CMutableTransaction mtx;
+            mtx.vin.emplace_back(COutPoint(uint256::ONE, i));
+            mtx.vout.emplace_back(i + 1, CScript() << OP_TRUE);
+            CWalletTx wtx(MakeTransactionRef(mtx), TxStateInactive{});
+            wtx.nOrderPos = i;
+            BOOST_CHECK(batch.WriteTx(wtx));
+            hashes.insert(wtx.GetHash());
+        }
+        BOOST_CHECK(batch.WriteOrderPosNext(3));
+    }
+
+    // The prefix cursor only returns the transaction records
+    {
+        std::unique_ptr<DatabaseBatch> batch = database->MakeBatch(false);
+        DataStream prefix;
+        prefix << DBKeys::TX;
+        std::unique_ptr<DatabaseCursor> cursor = batch->GetNewPrefixCursor(prefix);
+        BOOST_REQUIRE(cursor);
+        std::set<uint256> found;
+        while (true) {
+            DataStream key{};
+            DataStream value{};
+            DatabaseCursor::Status status = cursor->Next(key, value);
+            BOOST_REQUIRE(status != DatabaseCursor::Status::FAIL);
+            if (status == DatabaseCursor::Status::DONE) break;
+            std::string type;
+            uint256 hash;
+            key >> type >> hash;
+            BOOST_CHECK_EQUAL(type, DBKeys::TX);
+            found.insert(hash);
+        }
+        BOOST_CHECK(found == hashes);
+    }
+
+    {
+        const std::shared_ptr<CWallet> wallet(new CWallet(m_node.chain.get(), "", std::move(database)));
+        BOOST_CHECK_EQUAL(wallet->LoadWallet(), DBErrors::LOAD_OK);
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK_EQUAL(wallet->mapWallet.size(), hashes.size());
+        for (const uint256& hash : hashes) {
+            BOOST_CHECK(wallet->GetWalletTx(hash));
+        }
+        BOOST_CHECK_EQUAL(wallet->wtxOrdered.size(), hashes.size());
+    }
+}
+
 bool HasAnyRecordOfType(WalletDatabase& db, const std::string& key)
 {
     std::unique_ptr<DatabaseBatch> batch = db.MakeBatch(false);
@@ -0,0 +1,222 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <wallet/utxoplan.h>
+
+#include <consensus/tx_verify.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace wallet {
+namespace {
+constexpr int64_t DAY{24 * 60 * 60};
+//! Coin age counts up to a year, see GetCoinAge()
+constexpr int64_t MAX_COIN_AGE{365 * DAY};
+//! Days of the minting cycle that are simulated. A coin that has not minted
+//! by then is treated as if it started over without a reward.
+constexpr int MAX_CYCLE_DAYS{3 * 365};
+//! Version, lock time and the input and output counts
+constexpr size_t TX_OVERHEAD_BYTES{10 + 3 + 3};
+
+/** A split or merge of wallet coins */
+struct Operation {
+    //! Indexes of the spent coins in the sorted coins
+    std::vector<size_t> coins;
+    std::vector<CAmount> outputs;
+    //! Size of the inputs and outputs
+    size_t bytes{0};
+    CAmount lost_reward{0};
+    CAmount reward_before{0};
+    CAmount reward_after{0};
+    CAmount gain{0};
+};
+
+class YieldModel
+{
+public:
+    explicit YieldModel(const UtxoPlanParams& params) : m_params{params} {}
+
+    CAmount YearlyReward(CAmount value)
+    {
+        const auto [it, inserted]{m_cache.try_emplace(value, 0)};
+        if (inserted) it->second = ExpectedYearlyStakeReward(value, m_params);
+        return it->second;
+    }
+
+    //! The part of the next minting reward already earned by the age of a coin
+    CAmount AccruedReward(const UtxoPlanCoin& coin) const
+    {
+        const int64_t age{std::clamp<int64_t>(m_params.now - coin.time, 0, MAX_COIN_AGE)};
+        const int64_t coin_age{static_cast<int64_t>(static_cast<double>(coin.value) * age / COIN / DAY)};
+        return GetProofOfStakeReward(coin_age, m_params.now, m_params.money_supply) - GetProofOfStakeReward(0, m_params.now, m_params.money_supply);
+    }
+
+private:
+    const UtxoPlanParams& m_params;
+    std::map<CAmount, CAmount> m_cache;
+};
+
+/** Number of outputs to split a coin of the given value into */
+size_t SplitCount(CAmount value, const UtxoPlanParams& params)
+{
+    const double ratio{static_cast<double>(value) / params.target_amount};
+    if (params.constrained) return static_cast<size_t>(ratio);
+    // The largest n with n * (n - 1) <= ratio^2, for which value / n is
+    // closest to the target in ratio. Coins below sqrt(2) * target stay whole.
+    return static_cast<size_t>((std::sqrt(4 * ratio * ratio + 1) + 1) / 2);
+}
+} // namespace
+
+CAmount ExpectedYearlyStakeReward(CAmount value, const UtxoPlanParams& params)
+{
+    if (value <= 0 || params.difficulty <= 0) return 0;
+    // The kernel of a coin with a weight of one coin day hits the target with a
+    // chance of 1 / (difficulty * 2^32) per second, see CheckStakeKernelHash()
+    const double day_hit_rate{static_cast<double>(DAY) / (params.difficulty * 4294967296.0)};
+    const double coins{static_cast<double>(value) / COIN};
+    double survival{1};
+    double expected_reward{0};
+    double expected_days{0};
+    for (int day = 0; day < MAX_CYCLE_DAYS && survival > 1e-9; ++day) {
+        expected_days += survival;
+        const int64_t age{(day + 1) * DAY};
+        const int64_t weight{std::min(age, params.stake_max_age) - params.stake_min_age};
+        if (weight <= 0) continue;
+        const double mint{-std::expm1(-day_hit_rate * coins * weight / DAY)};
+        const int64_t coin_age{static_cast<int64_t>(coins * std::min(age, MAX_COIN_AGE) / DAY)};
+        expected_reward += survival * mint * GetProofOfStakeReward(coin_age, params.now, params.money_supply);
+        survival *= 1 - mint;
+    }
+    return static_cast<CAmount>(expected_reward / expected_days * 365);
+}
+
+UtxoPlan PlanUtxoSet(std::vector<UtxoPlanCoin> coins, const UtxoPlanParams& params)
+{
+    UtxoPlan plan;
+    if (params.target_amount <= 0) return plan;
+
+    std::sort(coins.begin(), coins.end(), [](const UtxoPlanCoin& a, const UtxoPlanCoin& b) {
+        if (a.value != b.value) return a.value > b.value;
+        return a.outpoint < b.outpoint;
+    });
+
+    YieldModel model{params};
+    const size_t max_op_bytes{params.max_tx_bytes > TX_OVERHEAD_BYTES ? params.max_tx_bytes - TX_OVERHEAD_BYTES : 0};
+    const auto input_bytes{[&](size_t i) { return static_cast<size_t>(std::max(coins[i].input_bytes, 0)); }};
+
+    std::vector<Operation> ops;
+    const auto add_op{[&](Operation op) {
+        CAmount total{0};
+        for (const size_t i : op.coins) {
+            total += coins[i].value;
+            op.bytes += input_bytes(i);
+            op.lost_reward += model.AccruedReward(coins[i]);
+            op.reward_before += model.YearlyReward(coins[i].value);
+        }
+        // Spread the total evenly, the rounding goes to the last output
+        const CAmount part{total / static_cast<CAmount>(op.outputs.size())};
+        std::fill(op.outputs.begin(), op.outputs.end(), part);
+        op.outputs.back() += total - part * static_cast<CAmount>(op.outputs.size());
+        for (const CAmount output : op.outputs) op.reward_after += model.YearlyReward(output);
+        op.bytes += op.outputs.size() * params.output_bytes;
+        const CAmount change{(op.reward_after - op.reward_before) * params.horizon_days / 365};
+        op.gain = change - op.lost_reward - GetMinFee(op.bytes + TX_OVERHEAD_BYTES, params.now);
+        ops.push_back(std::move(op));
+    }};
+
+    std::vector<size_t> small;
+    for (size_t i = 0; i < coins.size(); ++i) {
+        plan.yearly_reward_before += model.YearlyReward(coins[i].value);
+        if (coins[i].value < params.combine_threshold) {
+            small.push_back(i);
+            continue;
+        }
+        const size_t split{SplitCount(coins[i].value, params)};
+        if (split < 2) continue;
+        if (input_bytes(i) + 2 * params.output_bytes > max_op_bytes) continue;
+        const size_t max_outputs{(max_op_bytes - input_bytes(i)) / params.output_bytes};
+        Operation op;
+        op.coins = {i};
+        op.outputs.resize(std::min(split, max_outputs));
+        add_op(std::move(op));
+    }
+
+    // Merge the small coins, largest first, into groups that reach the target.
+    // What is left is added to the last group.
+    std::vector<std::vector<size_t>> groups;
+    std::vector<size_t> group;
+    CAmount group_value{0};
+    size_t group_bytes{params.output_bytes};
+    for (const size_t i : small) {
+        if (!group.empty() && group_bytes + input_bytes(i) > max_op_bytes) {
+            groups.push_back(std::move(group));
+            group.clear();
+            group_value = 0;
+            group_bytes = params.output_bytes;
+        }
+        group.push_back(i);
+        group_value += coins[i].value;
+        group_bytes += input_bytes(i);
+        if (group_value >= params.target_amount) {
+            groups.push_back(std::move(group));
+            group.clear();
+            group_value = 0;
+            group_bytes = params.output_bytes;
+        }
+    }
+    if (!group.empty()) {
+        size_t last_bytes{params.output_bytes};
+        if (!groups.empty()) {
+            for (const size_t i : groups.back()) last_bytes += input_bytes(i);
+        }
+        if (!groups.empty() && last_bytes + group_bytes - params.output_bytes <= max_op_bytes) {
+            groups.back().insert(groups.back().end(), group.begin(), group.end());
+        } else {
+            groups.push_back(std::move(group));
+        }
+    }
+    for (auto& merge : groups) {
+        if (merge.size() < 2 || params.output_bytes > max_op_bytes) continue;
+        Operation op;
+        op.coins = std::move(merge);
+        op.outputs.resize(1);
+        add_op(std::move(op));
+    }
+
+    // Most beneficial first, ties by the order of the coins
+    ops.erase(std::remove_if(ops.begin(), ops.end(), [](const Operation& op) { return op.gain <= 0; }), ops.end());
+    std::sort(ops.begin(), ops.end(), [](const Operation& a, const Operation& b) {
+        if (a.gain != b.gain) return a.gain > b.gain;
+        return a.coins.front() < b.coins.front();
+    });
+
+    // Pack the operations into transactions, each operation goes into the
+    // last transaction if it fits and into a new one if there is room for it
+    size_t spent{0};
+    plan.yearly_reward_after = plan.yearly_reward_before;
+    for (const Operation& op : ops) {
+        if (plan.txs.empty() || plan.txs.back().bytes + op.bytes > params.max_tx_bytes) {
+            if (plan.txs.size() >= params.max_transactions) continue;
+            plan.txs.emplace_back().bytes = TX_OVERHEAD_BYTES;
+        }
+        UtxoPlanTx& tx{plan.txs.back()};
+        for (const size_t i : op.coins) tx.inputs.push_back(coins[i].outpoint);
+        tx.outputs.insert(tx.outputs.end(), op.outputs.begin(), op.outputs.end());
+        tx.bytes += op.bytes;
+        tx.lost_reward += op.lost_reward;
+        plan.yearly_reward_after += op.reward_after - op.reward_before;
+        spent += op.coins.size();
+    }
+    for (UtxoPlanTx& tx : plan.txs) {
+        tx.fee = GetMinFee(tx.bytes, params.now);
+        plan.fees += tx.fee;
+        plan.lost_reward += tx.lost_reward;
+    }
+    plan.coins_kept = coins.size() - spent;
+    return plan;
+}
+} // namespace wallet
@@ -0,0 +1,99 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_WALLET_UTXOPLAN_H
+#define BITCOIN_WALLET_UTXOPLAN_H
+
+#include <consensus/amount.h>
+#include <primitives/transaction.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace wallet {
+//! Default for the horizon_days option of optimizeutxoset
+static constexpr int DEFAULT_UTXO_PLAN_HORIZON_DAYS{365};
+//! Default for the max_tx_size option of optimizeutxoset
+static constexpr size_t DEFAULT_UTXO_PLAN_MAX_TX_SIZE{50000};
+//! Default for the max_transactions option of optimizeutxoset
+static constexpr size_t DEFAULT_UTXO_PLAN_MAX_TRANSACTIONS{10};
+
+/** A wallet coin the plan may spend */
+struct UtxoPlanCoin {
+    COutPoint outpoint;
+    CAmount value{0};
+    //! Time the coin started to age
+    int64_t time{0};
+    //! Size of the signed input spending the coin
+    int input_bytes{0};
+};
+
+struct UtxoPlanParams {
+    //! Amount the coins of the plan aim for
+    CAmount target_amount{0};
+    //! Coins below this amount are merged
+    CAmount combine_threshold{0};
+    //! Split into as many outputs of the target amount as fit, instead of the
+    //! number of outputs closest to the target (rfc28 -maxmintingutxos)
+    bool constrained{false};
+    //! Size of one output to the destination
+    size_t output_bytes{0};
+    size_t max_tx_bytes{DEFAULT_UTXO_PLAN_MAX_TX_SIZE};
+    size_t max_transactions{DEFAULT_UTXO_PLAN_MAX_TRANSACTIONS};
+    //! Period over which the change in expected minting reward of an
+    //! operation must make up for its fee and for the coin age it resets
+    int horizon_days{DEFAULT_UTXO_PLAN_HORIZON_DAYS};
+    int64_t now{0};
+    //! Minting model: PoS difficulty, money supply and stake ages of the chain
+    double difficulty{0};
+    uint64_t money_supply{0};
+    int64_t stake_min_age{0};
+    int64_t stake_max_age{0};
+};
+
+/** One transaction of a plan. The fee is taken from the last output. */
+struct UtxoPlanTx {
+    std::vector<COutPoint> inputs;
+    //! Output amounts before the fee, they add up to the inputs
+    std::vector<CAmount> outputs;
+    size_t bytes{0};
+    CAmount fee{0};
+    //! Coin age reward accrued by the inputs, which spending them resets
+    CAmount lost_reward{0};
+};
+
+struct UtxoPlan {
+    std::vector<UtxoPlanTx> txs;
+    CAmount fees{0};
+    CAmount lost_reward{0};
+    //! Expected yearly minting reward of the wallet coins before and after the plan
+    CAmount yearly_reward_before{0};
+    CAmount yearly_reward_after{0};
+    //! Coins left as they are
+    size_t coins_kept{0};
+};
+
+/** Expected minting reward per year of a coin that mints continuously.
+ *
+ * A day by day model of the chance to find a kernel as the coin weight
+ * grows from the minimum to the maximum stake age, with the reward of
+ * GetProofOfStakeReward() for the coin age reached at the time of the mint.
+ */
+CAmount ExpectedYearlyStakeReward(CAmount value, const UtxoPlanParams& params);
+
+/** Plan the transactions that split large coins and merge small ones into
+ * coins of the target amount.
+ *
+ * Coins between the combine threshold and the amount that is best split in
+ * two are left alone. Every other coin is part of a split or merge operation.
+ * An operation is only planned if the minting reward it adds over the horizon
+ * exceeds its fee plus the reward already accrued by the coins it spends.
+ * Operations are packed into at most max_transactions transactions of at most
+ * max_tx_bytes, the most beneficial first. The result only depends on the coins and the parameters,
+ * not on the order of the coins.
+ */
+UtxoPlan PlanUtxoSet(std::vector<UtxoPlanCoin> coins, const UtxoPlanParams& params);
+} // namespace wallet
+
+#endif // BITCOIN_WALLET_UTXOPLAN_H
@@ -0,0 +1,43 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <wallet/utxopool.h>
+
+namespace wallet {
+void UtxoPool::Insert(const COutPoint& outpoint, Entry entry)
+{
+    Erase(outpoint);
+    m_by_value[entry.type].emplace(entry.txout.nValue, outpoint);
+    m_entries.emplace(outpoint, std::move(entry));
+}
+
+void UtxoPool::Erase(const COutPoint& outpoint)
+{
+    const auto it{m_entries.find(outpoint)};
+    if (it == m_entries.end()) return;
+    const auto type_it{m_by_value.find(it->second.type)};
+    type_it->second.erase({it->second.txout.nValue, outpoint});
+    if (type_it->second.empty()) m_by_value.erase(type_it);
+    m_entries.erase(it);
+}
+
+void UtxoPool::Clear()
+{
+    m_entries.clear();
+    m_by_value.clear();
+    m_pending.clear();
+}
+
+const UtxoPool::Entry* UtxoPool::Find(const COutPoint& outpoint) const
+{
+    const auto it{m_entries.find(outpoint)};
+    return it == m_entries.end() ? nullptr : &it->second;
+}
+
+UtxoPool::Entry* UtxoPool::Find(const COutPoint& outpoint)
+{
+    const auto it{m_entries.find(outpoint)};
+    return it == m_entries.end() ? nullptr : &it->second;
+}
+} // namespace wallet
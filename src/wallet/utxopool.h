@@ -0,0 +1,71 @@
+// Copyright (c) 2026 The Peercoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_WALLET_UTXOPOOL_H
+#define BITCOIN_WALLET_UTXOPOOL_H
+
+#include <consensus/amount.h>
+#include <outputtype.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+#include <util/hasher.h>
+#include <wallet/types.h>
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace wallet {
+/** Wallet outputs that may be spent, indexed by output type and value.
+ *
+ * The pool is a superset of the unspent wallet outputs that AvailableCoins()
+ * and AvailableStakeCoins() walk instead of every output of every wallet
+ * transaction. Outputs are
+ * queued as pending when their transaction enters the wallet or when a
+ * transaction spending them changes state. Pending outputs are analyzed once
+ * (IsMine(), output type, signed input size) and the result is kept with the
+ * entry, so only the checks that depend on the chain or on the spending
+ * transactions are repeated for each selection.
+ */
+class UtxoPool
+{
+public:
+    struct Entry {
+        CTxOut txout;
+        OutputType type;
+        isminetype mine;
+        bool solvable;
+        //! Signed input size with a dummy signature and with a maximum size
+        //! one, -1 if the output cannot be signed
+        int input_bytes;
+        int input_bytes_max_sig;
+        //! Block the offset of the transaction in its block was looked up
+        //! for, to compute stake kernels
+        uint256 stake_block_hash;
+        unsigned int stake_tx_offset;
+    };
+    using ValueIndex = std::set<std::pair<CAmount, COutPoint>>;
+
+    void AddPending(const COutPoint& outpoint) { m_pending.insert(outpoint); }
+    std::set<COutPoint> TakePending() { return std::exchange(m_pending, {}); }
+
+    void Insert(const COutPoint& outpoint, Entry entry);
+    void Erase(const COutPoint& outpoint);
+    void Clear();
+
+    const Entry* Find(const COutPoint& outpoint) const;
+    Entry* Find(const COutPoint& outpoint);
+    size_t Size() const { return m_entries.size(); }
+    //! Outpoints of each output type, ordered by value
+    const std::map<OutputType, ValueIndex>& ByValue() const { return m_by_value; }
+
+private:
+    std::unordered_map<COutPoint, Entry, SaltedOutpointHasher> m_entries;
+    std::map<OutputType, ValueIndex> m_by_value;
+    std::set<COutPoint> m_pending;
+};
+} // namespace wallet
+
+#endif // BITCOIN_WALLET_UTXOPOOL_H
@@ -17,6 +17,7 @@
 #include <interfaces/wallet.h>
 #include <key.h>
 #include <key_io.h>
+#include <logging.h>
 #include <outputtype.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
@@ -36,8 +37,10 @@
 #include <util/fs.h>
 #include <util/fs_helpers.h>
 #include <util/moneystr.h>
+#include <util/perfstats.h>
 #include <util/string.h>
 #include <util/system.h>
+#include <util/thread.h>
 
 #include <util/translation.h>
 #include <validation.h>
@@ -55,7 +58,11 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <condition_variable>
+#include <functional>
 #include <optional>
+#include <thread>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/foreach.hpp>
@@ -290,8 +297,10 @@ public:
         }
     }
 
-    void UpdateIfNeeded()
+    /** Add scripts derived by a top-up since the last call. Returns whether there were any. */
+    bool UpdateIfNeeded()
     {
+        bool updated{false};
         // repopulate filter with new scripts if top-up has happened since last iteration
         for (const auto& [desc_spkm_id, last_range_end] : m_last_range_ends) {
             auto desc_spkm{dynamic_cast<DescriptorScriptPubKeyMan*>(m_wallet.GetScriptPubKeyMan(desc_spkm_id))};
@@ -300,8 +309,10 @@ public:
             if (current_range_end > last_range_end) {
                 AddScriptPubKeys(desc_spkm, last_range_end);
                 m_last_range_ends.at(desc_spkm->GetID()) = current_range_end;
+                updated = true;
             }
         }
+        return updated;
     }
 
     std::optional<bool> MatchesBlock(const uint256& block_hash) const
@@ -309,6 +320,14 @@ public:
         return m_wallet.chain().blockFilterMatchesAny(BlockFilterType::BASIC, block_hash, m_filter_set);
     }
 
+    /** Whether an output of tx pays to a script of the wallet. Only reads the
+     * snapshot of the wallet's scripts, so it can be called without cs_wallet
+     * from several threads as long as UpdateIfNeeded() is not running. */
+    bool MatchesOutputs(const CTransaction& tx) const
+    {
+        return std::any_of(tx.vout.begin(), tx.vout.end(), [&](const CTxOut& txout) { return m_scripts.count(txout.scriptPubKey) > 0; });
+    }
+
 private:
     const CWallet& m_wallet;
     /** Map for keeping track of each range descriptor's last seen end range.
@@ -319,11 +338,13 @@ private:
       */
     std::map<uint256, int32_t> m_last_range_ends;
     GCSFilter::ElementSet m_filter_set;
+    std::unordered_set<CScript, SaltedSipHasher> m_scripts;
 
     void AddScriptPubKeys(const DescriptorScriptPubKeyMan* desc_spkm, int32_t last_range_end = 0)
     {
         for (const auto& script_pub_key : desc_spkm->GetScriptPubKeys(last_range_end)) {
             m_filter_set.emplace(script_pub_key.begin(), script_pub_key.end());
+            m_scripts.insert(script_pub_key);
         }
     }
 };
@@ -738,10 +759,13 @@ bool CWallet::IsSpent(const COutPoint& outpoint) const
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid, WalletBatch* batch)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
+    MarkBalanceDirty(outpoint.hash);
 
     if (batch) {
         UnlockCoin(outpoint, batch);
-    } else {
+    } else if (IsLockedCoin(outpoint)) {
+        // Only open a batch when there is a lock to erase, LoadToWallet
+        // calls this for every input of every wallet transaction
         WalletBatch temp_batch(GetDatabase());
         UnlockCoin(outpoint, &temp_batch);
     }
@@ -938,6 +962,43 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for (std::pair<const uint256, CWalletTx>& item : mapWallet)
             item.second.MarkDirty();
+        MarkOutputCandidatesStale();
+        MarkBalanceStale();
+    }
+}
+
+void CWallet::MarkBalanceDirty(const uint256& hash) const
+{
+    AssertLockHeld(cs_wallet);
+    if (std::all_of(m_balance_cache.begin(), m_balance_cache.end(), [](const BalanceCache& cache) { return cache.stale; })) return;
+    // Whether an unconfirmed transaction is trusted depends on its parents, so
+    // the wallet transactions spending this one are recomputed too
+    std::vector<uint256> todo{hash};
+    std::set<uint256> done;
+    while (!todo.empty()) {
+        const uint256 now{todo.back()};
+        todo.pop_back();
+        if (!done.insert(now).second) continue;
+        for (BalanceCache& cache : m_balance_cache) {
+            if (!cache.stale) cache.dirty.insert(now);
+        }
+        const auto it{mapWallet.find(now)};
+        if (it == mapWallet.end()) continue;
+        for (unsigned int i = 0; i < it->second.tx->vout.size(); ++i) {
+            const auto range{mapTxSpends.equal_range(COutPoint(now, i))};
+            for (auto spend = range.first; spend != range.second; ++spend) {
+                todo.push_back(spend->second);
+            }
+        }
+    }
+}
+
+void CWallet::MarkBalanceStale()
+{
+    AssertLockHeld(cs_wallet);
+    for (BalanceCache& cache : m_balance_cache) {
+        cache.stale = true;
+        cache.dirty.clear();
     }
 }
 
@@ -1081,6 +1142,7 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
             desc_tx->m_state = inactive_state;
             // Break caches since we have changed the state
             desc_tx->MarkDirty();
+            MarkBalanceDirty(desc_tx->GetHash());
             batch.WriteTx(*desc_tx);
             MarkInputsDirty(desc_tx->tx);
             for (unsigned int i = 0; i < desc_tx->tx->vout.size(); ++i) {
@@ -1106,6 +1168,8 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
 
     // Break debit/credit balance caches:
     wtx.MarkDirty();
+    MarkBalanceDirty(hash);
+    AddOutputCandidates(*wtx.tx);
 
     // since AddToWallet is called directly for self-originating transactions, check for consumption of own coins
     WalletUpdateSpent(wtx.tx);
@@ -1176,6 +1240,8 @@ bool CWallet::LoadToWallet(const uint256& hash, const UpdateWalletTxFn& fill_wtx
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
     }
     AddToSpends(wtx);
+    AddOutputCandidates(*wtx.tx);
+    MarkBalanceDirty(hash);
     for (const CTxIn& txin : wtx.tx->vin) {
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
@@ -1267,8 +1333,12 @@ void CWallet::MarkInputsDirty(const CTransactionRef& tx)
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
             it->second.MarkDirty();
+            MarkBalanceDirty(txin.prevout.hash);
+            // The output may be unspent again
+            m_utxo_pool.AddPending(txin.prevout);
         }
     }
+    ++m_stake_generation;
 }
 
 bool CWallet::AbandonTransaction(const uint256& hashTx)
@@ -1306,6 +1376,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             assert(!wtx.InMempool());
             wtx.m_state = TxStateInactive{/*abandoned=*/true};
             wtx.MarkDirty();
+            MarkBalanceDirty(now);
             batch.WriteTx(wtx);
             NotifyTransactionChanged(wtx.GetHash(), CT_UPDATED);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them abandoned too.
@@ -1366,6 +1437,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, int conflicting_height, c
             // Mark transaction as conflicted with this block.
             wtx.m_state = TxStateConflicted{hashBlock, conflicting_height};
             wtx.MarkDirty();
+            MarkBalanceDirty(now);
             batch.WriteTx(wtx);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
             for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
@@ -1401,6 +1473,7 @@ void CWallet::transactionAddedToMempool(const CTransactionRef& tx) {
     auto it = mapWallet.find(tx->GetHash());
     if (it != mapWallet.end()) {
         RefreshMempoolStatus(it->second, chain());
+        MarkBalanceDirty(it->first);
     }
 }
 
@@ -1409,6 +1482,7 @@ void CWallet::transactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRe
     auto it = mapWallet.find(tx->GetHash());
     if (it != mapWallet.end()) {
         RefreshMempoolStatus(it->second, chain());
+        MarkBalanceDirty(it->first);
     }
     // Handle transactions that were removed from the mempool because they
     // conflict with transactions in a newly connected block.
@@ -1445,9 +1519,15 @@ void CWallet::blockConnected(const interfaces::BlockInfo& block)
 {
     assert(block.data);
     LOCK(cs_wallet);
+    // Commit the wallet transactions of the block in one go
+    DatabaseWriteGroup write_group{GetDatabase()};
 
     m_last_block_processed_height = block.height;
     m_last_block_processed = block.hash;
+    // Coinbases and coinstakes may have matured
+    for (BalanceCache& cache : m_balance_cache) {
+        cache.dirty.insert(cache.immature.begin(), cache.immature.end());
+    }
     for (size_t index = 0; index < block.data->vtx.size(); index++) {
         SyncTransaction(block.data->vtx[index], TxStateConfirmed{block.hash, block.height, static_cast<int>(index)});
         transactionRemovedFromMempool(block.data->vtx[index], MemPoolRemovalReason::BLOCK);
@@ -1458,6 +1538,7 @@ void CWallet::blockDisconnected(const interfaces::BlockInfo& block)
 {
     assert(block.data);
     LOCK(cs_wallet);
+    DatabaseWriteGroup write_group{GetDatabase()};
 
     // At block disconnection, this will change an abandoned transaction to
     // be unconfirmed, whether or not the transaction is added back to the mempool.
@@ -1465,6 +1546,8 @@ void CWallet::blockDisconnected(const interfaces::BlockInfo& block)
     // future with a stickier abandoned state or even removing abandontransaction call.
     m_last_block_processed_height = block.height - 1;
     m_last_block_processed = *Assert(block.prev_hash);
+    // Transactions of any depth may become immature again
+    MarkBalanceStale();
     for (const CTransactionRef& ptx : Assert(block.data)->vtx) {
         SyncTransaction(ptx, TxStateInactive{});
     }
@@ -1599,6 +1682,8 @@ void CWallet::SetWalletFlag(uint64_t flags)
 {
     LOCK(cs_wallet);
     m_wallet_flags |= flags;
+    // Avoiding reuse changes which outputs are counted
+    MarkBalanceStale();
     if (!WalletBatch(GetDatabase()).WriteWalletFlags(m_wallet_flags))
         throw std::runtime_error(std::string(__func__) + ": writing wallet flags failed");
 }
@@ -1613,6 +1698,7 @@ void CWallet::UnsetWalletFlagWithDB(WalletBatch& batch, uint64_t flag)
 {
     LOCK(cs_wallet);
     m_wallet_flags &= ~flag;
+    MarkBalanceStale();
     if (!batch.WriteWalletFlags(m_wallet_flags))
         throw std::runtime_error(std::string(__func__) + ": writing wallet flags failed");
 }
@@ -1752,6 +1838,7 @@ bool CWallet::ImportScripts(const std::set<CScript> scripts, int64_t timestamp)
         return false;
     }
     LOCK(spk_man->cs_KeyStore);
+    MarkOutputCandidatesStale();
     return spk_man->ImportScripts(scripts, timestamp);
 }
 
@@ -1762,6 +1849,7 @@ bool CWallet::ImportPrivKeys(const std::map<CKeyID, CKey>& privkey_map, const in
         return false;
     }
     LOCK(spk_man->cs_KeyStore);
+    MarkOutputCandidatesStale();
     return spk_man->ImportPrivKeys(privkey_map, timestamp);
 }
 
@@ -1772,6 +1860,7 @@ bool CWallet::ImportPubKeys(const std::vector<CKeyID>& ordered_pubkeys, const st
         return false;
     }
     LOCK(spk_man->cs_KeyStore);
+    MarkOutputCandidatesStale();
     return spk_man->ImportPubKeys(ordered_pubkeys, pubkey_map, key_origins, add_keypool, internal, timestamp);
 }
 
@@ -1782,6 +1871,7 @@ bool CWallet::ImportScriptPubKeys(const std::string& label, const std::set<CScri
         return false;
     }
     LOCK(spk_man->cs_KeyStore);
+    MarkOutputCandidatesStale();
     if (!spk_man->ImportScriptPubKeys(script_pub_keys, have_solving_data, timestamp)) {
         return false;
     }
@@ -1850,6 +1940,71 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
  * the main chain after to the addition of any new keys you want to detect
  * transactions for.
  */
+/** Threads reading and matching the blocks of a rescan, kept for all its batches */
+class RescanWorkers
+{
+private:
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::function<void()> m_task GUARDED_BY(m_mutex);
+    //! Incremented for every task, so each thread runs it once
+    uint64_t m_round GUARDED_BY(m_mutex){0};
+    //! Threads still running the task of the current round
+    size_t m_busy GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void Loop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        uint64_t round{0};
+        while (true) {
+            std::function<void()> task;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || m_round != round; });
+                if (m_stop) return;
+                round = m_round;
+                task = m_task;
+            }
+            task();
+            LOCK(m_mutex);
+            if (--m_busy == 0) m_cond.notify_all();
+        }
+    }
+
+public:
+    explicit RescanWorkers(int num_threads)
+    {
+        for (int i = 0; i < num_threads; ++i) {
+            m_threads.emplace_back(&util::TraceThread, "rescan", [this] { Loop(); });
+        }
+    }
+
+    ~RescanWorkers()
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_cond.notify_all();
+        for (std::thread& thread : m_threads) thread.join();
+    }
+
+    /** Run a task on all threads and the calling one, and wait for all of them */
+    void Run(const std::function<void()>& task) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        if (!m_threads.empty()) {
+            LOCK(m_mutex);
+            m_task = task;
+            m_busy = m_threads.size();
+            ++m_round;
+            m_cond.notify_all();
+        }
+        task();
+        if (!m_threads.empty()) {
+            WAIT_LOCK(m_mutex, lock);
+            m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_busy == 0; });
+        }
+    }
+};
+
 CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_block, int start_height, std::optional<int> max_height, const WalletRescanReserver& reserver, bool fUpdate, const bool save_progress)
 {
     constexpr auto INTERVAL_TIME{60s};
@@ -1861,11 +2016,15 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
     uint256 block_hash = start_block;
     ScanResult result;
 
+    // Descriptor wallets skip transactions that cannot involve them without
+    // taking cs_wallet for each of them, and blocks whose filter does not match.
     std::unique_ptr<FastWalletRescanFilter> fast_rescan_filter;
-    if (!IsLegacy() && chain().hasBlockFilterIndex(BlockFilterType::BASIC)) fast_rescan_filter = std::make_unique<FastWalletRescanFilter>(*this);
+    if (!IsLegacy()) fast_rescan_filter = std::make_unique<FastWalletRescanFilter>(*this);
+    const bool use_block_filters{fast_rescan_filter && chain().hasBlockFilterIndex(BlockFilterType::BASIC)};
+    const int threads{std::max(1, m_rescan_threads)};
 
-    WalletLogPrintf("Rescan started from block %s... (%s)\n", start_block.ToString(),
-                    fast_rescan_filter ? "fast variant using block filters" : "slow variant inspecting all blocks");
+    WalletLogPrintf("Rescan started from block %s... (%s, %d threads)\n", start_block.ToString(),
+                    use_block_filters ? "fast variant using block filters" : "slow variant inspecting all blocks", threads);
 
     fAbortRescan = false;
     ShowProgress(strprintf("%s " + _("Rescanning…").translated, GetDisplayName()), 0); // show rescan progress in GUI as dialog or on splashscreen, if rescan required on startup (e.g. due to corruption)
@@ -1876,105 +2035,182 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
     double progress_end = chain().guessVerificationProgress(end_hash);
     double progress_current = progress_begin;
     int block_height = start_height;
-    while (!fAbortRescan && !chain().shutdownRequested()) {
+
+    /** A block of the current batch, read and matched by the rescan threads. */
+    struct RescanBlock {
+        uint256 hash;
+        int height;
+        //! False if the block filter did not match, so the block does not need to be inspected
+        bool fetch{true};
+        CBlock block;
+        //! Per transaction: whether an output pays to the wallet
+        std::vector<bool> output_matches;
+        //! Whether the block was still in the active chain after it was read
+        bool active{false};
+        double progress{0};
+    };
+    std::vector<RescanBlock> blocks;
+    // Read and match blocks of a batch concurrently. The filter is only read here.
+    std::atomic<size_t> next_prepare{0};
+    auto prepare_blocks = [&] {
+        for (size_t i = next_prepare++; i < blocks.size(); i = next_prepare++) {
+            RescanBlock& rescan_block{blocks[i]};
+            if (use_block_filters) {
+                auto matches_block{fast_rescan_filter->MatchesBlock(rescan_block.hash)};
+                if (matches_block.has_value()) {
+                    if (!*matches_block) {
+                        rescan_block.fetch = false;
+                        continue;
+                    }
+                    LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (filter matched)\n", rescan_block.height, rescan_block.hash.ToString());
+                } else {
+                    LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (WARNING: block filter not found!)\n", rescan_block.height, rescan_block.hash.ToString());
+                }
+            }
+            chain().findBlock(rescan_block.hash, FoundBlock().data(rescan_block.block));
+            if (fast_rescan_filter) {
+                rescan_block.output_matches.reserve(rescan_block.block.vtx.size());
+                for (const CTransactionRef& tx : rescan_block.block.vtx) {
+                    rescan_block.output_matches.push_back(fast_rescan_filter->MatchesOutputs(*tx));
+                }
+            }
+        }
+    };
+    RescanWorkers workers{threads - 1};
+    // Whether a transaction whose outputs do not pay to the wallet may still
+    // involve it, see AddToWalletIfInvolvingMe().
+    auto may_involve_wallet = [&](const CTransaction& tx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet) {
+        if (mapWallet.count(tx.GetHash())) return true;
+        return std::any_of(tx.vin.begin(), tx.vin.end(), [&](const CTxIn& txin) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet) {
+            return mapWallet.count(txin.prevout.hash) || mapTxSpends.count(txin.prevout);
+        });
+    };
+
+    bool scan_done{false};
+    while (!scan_done && !fAbortRescan && !chain().shutdownRequested()) {
+        // Collect the next blocks of the active chain. Finding a next block
+        // only succeeds while the current one is still active, so a reorg
+        // ends the batch early; the apply phase checks again.
+        blocks.clear();
+        bool next_block{true};
+        uint256 next_block_hash{block_hash};
+        int next_block_height{block_height};
+        while (next_block && blocks.size() < static_cast<size_t>(RESCAN_BATCH_SIZE)) {
+            blocks.push_back({next_block_hash, next_block_height});
+            if (max_height && next_block_height >= *max_height) {
+                next_block = false;
+                break;
+            }
+            const uint256 hash{next_block_hash};
+            next_block = false;
+            chain().findBlock(hash, FoundBlock().nextBlock(FoundBlock().inActiveChain(next_block).hash(next_block_hash)));
+            ++next_block_height;
+        }
+        if (!next_block) scan_done = true;
+
+        next_prepare = 0;
+        workers.Run(prepare_blocks);
+
+        // The chain is queried and the GUI notified without cs_wallet
+        for (RescanBlock& rescan_block : blocks) {
+            if (rescan_block.fetch && !rescan_block.block.IsNull()) {
+                chain().findBlock(rescan_block.hash, FoundBlock().inActiveChain(rescan_block.active));
+            }
+            rescan_block.progress = chain().guessVerificationProgress(rescan_block.hash);
+        }
         if (progress_end - progress_begin > 0.0) {
             m_scanning_progress = (progress_current - progress_begin) / (progress_end - progress_begin);
         } else { // avoid divide-by-zero for single block scan range (i.e. start and stop hashes are equal)
             m_scanning_progress = 0;
         }
-        if (block_height % 100 == 0 && progress_end - progress_begin > 0.0) {
+        const int last_height{blocks.back().height};
+        if ((block_height % 100 == 0 || block_height / 100 != last_height / 100) && progress_end - progress_begin > 0.0) {
             ShowProgress(strprintf("%s " + _("Rescanning…").translated, GetDisplayName()), std::max(1, std::min(99, (int)(m_scanning_progress * 100))));
         }
 
-        bool next_interval = reserver.now() >= current_time + INTERVAL_TIME;
-        if (next_interval) {
-            current_time = reserver.now();
-            WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", block_height, progress_current);
-        }
-
-        bool fetch_block{true};
-        if (fast_rescan_filter) {
-            fast_rescan_filter->UpdateIfNeeded();
-            auto matches_block{fast_rescan_filter->MatchesBlock(block_hash)};
-            if (matches_block.has_value()) {
-                if (*matches_block) {
-                    LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (filter matched)\n", block_height, block_hash.ToString());
-                } else {
-                    result.last_scanned_block = block_hash;
-                    result.last_scanned_height = block_height;
-                    fetch_block = false;
+        std::optional<std::pair<uint256, int>> save_block;
+        {
+            LOCK(cs_wallet);
+            // Commit the wallet transactions found in these blocks together
+            DatabaseWriteGroup write_group{GetDatabase()};
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                RescanBlock& rescan_block{blocks[i]};
+                block_hash = rescan_block.hash;
+                block_height = rescan_block.height;
+                if (fAbortRescan || chain().shutdownRequested()) {
+                    scan_done = true;
+                    break;
                 }
-            } else {
-                LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (WARNING: block filter not found!)\n", block_height, block_hash.ToString());
-            }
-        }
 
-        // Find next block separately from reading data above, because reading
-        // is slow and there might be a reorg while it is read.
-        bool block_still_active = false;
-        bool next_block = false;
-        uint256 next_block_hash;
-        chain().findBlock(block_hash, FoundBlock().inActiveChain(block_still_active).nextBlock(FoundBlock().inActiveChain(next_block).hash(next_block_hash)));
+                bool next_interval = reserver.now() >= current_time + INTERVAL_TIME;
+                if (next_interval) {
+                    current_time = reserver.now();
+                    WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", block_height, progress_current);
+                }
 
-        if (fetch_block) {
-            // Read block data
-            CBlock block;
-            chain().findBlock(block_hash, FoundBlock().data(block));
+                bool scripts_added{false};
+                if (!rescan_block.fetch) {
+                    result.last_scanned_block = block_hash;
+                    result.last_scanned_height = block_height;
+                } else if (!rescan_block.block.IsNull()) {
+                    if (!rescan_block.active) {
+                        // Abort scan if current block is no longer active, to prevent
+                        // marking transactions as coming from the wrong block.
+                        result.last_failed_block = block_hash;
+                        result.status = ScanResult::FAILURE;
+                        scan_done = true;
+                        break;
+                    }
+                    const CBlock& block{rescan_block.block};
+                    for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                        if (fast_rescan_filter && !rescan_block.output_matches[posInBlock] && !may_involve_wallet(*block.vtx[posInBlock])) continue;
+                        SyncTransaction(block.vtx[posInBlock], TxStateConfirmed{block_hash, block_height, static_cast<int>(posInBlock)}, fUpdate, /*rescanning_old_block=*/true);
+                    }
+                    // scan succeeded, record block as most recent successfully scanned
+                    result.last_scanned_block = block_hash;
+                    result.last_scanned_height = block_height;
 
-            if (!block.IsNull()) {
-                LOCK(cs_wallet);
-                if (!block_still_active) {
-                    // Abort scan if current block is no longer active, to prevent
-                    // marking transactions as coming from the wrong block.
+                    if (save_progress && next_interval) save_block = {block_hash, block_height};
+                    // A top-up derived new scripts: the rest of the batch was
+                    // matched without them.
+                    scripts_added = fast_rescan_filter && fast_rescan_filter->UpdateIfNeeded();
+                } else {
+                    // could not scan block, keep scanning but record this block as the most recent failure
                     result.last_failed_block = block_hash;
                     result.status = ScanResult::FAILURE;
-                    break;
-                }
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    SyncTransaction(block.vtx[posInBlock], TxStateConfirmed{block_hash, block_height, static_cast<int>(posInBlock)}, fUpdate, /*rescanning_old_block=*/true);
                 }
-                // scan succeeded, record block as most recent successfully scanned
-                result.last_scanned_block = block_hash;
-                result.last_scanned_height = block_height;
-
-                if (save_progress && next_interval) {
-                    CBlockLocator loc = m_chain->getActiveChainLocator(block_hash);
 
-                    if (!loc.IsNull()) {
-                        WalletLogPrintf("Saving scan progress %d.\n", block_height);
-                        WalletBatch batch(GetDatabase());
-                        batch.WriteBestBlock(loc);
-                    }
+                progress_current = rescan_block.progress;
+                if (scripts_added && i + 1 < blocks.size()) {
+                    next_block_hash = blocks[i + 1].hash;
+                    next_block_height = blocks[i + 1].height;
+                    scan_done = false;
+                    break;
                 }
-            } else {
-                // could not scan block, keep scanning but record this block as the most recent failure
-                result.last_failed_block = block_hash;
-                result.status = ScanResult::FAILURE;
             }
         }
-        if (max_height && block_height >= *max_height) {
-            break;
-        }
-        {
-            if (!next_block) {
-                // break successfully when rescan has reached the tip, or
-                // previous block is no longer on the chain due to a reorg
-                break;
-            }
+        if (save_block) {
+            CBlockLocator loc = m_chain->getActiveChainLocator(save_block->first);
 
-            // increment block and verification progress
-            block_hash = next_block_hash;
-            ++block_height;
-            progress_current = chain().guessVerificationProgress(block_hash);
-
-            // handle updated tip hash
-            const uint256 prev_tip_hash = tip_hash;
-            tip_hash = WITH_LOCK(cs_wallet, return GetLastBlockHash());
-            if (!max_height && prev_tip_hash != tip_hash) {
-                // in case the tip has changed, update progress max
-                progress_end = chain().guessVerificationProgress(tip_hash);
+            if (!loc.IsNull()) {
+                WalletLogPrintf("Saving scan progress %d.\n", save_block->second);
+                WalletBatch batch(GetDatabase());
+                batch.WriteBestBlock(loc);
             }
         }
+        if (scan_done) break;
+
+        // continue with the block following the batch
+        block_hash = next_block_hash;
+        block_height = next_block_height;
+
+        // handle updated tip hash
+        const uint256 prev_tip_hash = tip_hash;
+        tip_hash = WITH_LOCK(cs_wallet, return GetLastBlockHash());
+        if (!max_height && prev_tip_hash != tip_hash) {
+            // in case the tip has changed, update progress max
+            progress_end = chain().guessVerificationProgress(tip_hash);
+        }
     }
     if (!max_height) {
         WalletLogPrintf("Scanning current mempool transactions.\n");
@@ -2052,7 +2288,10 @@ bool CWallet::SubmitTxMemoryPoolAndRelay(CWalletTx& wtx, std::string& err_string
     // If transaction was previously in the mempool, it should be updated when
     // TransactionRemovedFromMempool fires.
     bool ret = chain().broadcastTransaction(wtx.tx, relay, err_string);
-    if (ret) wtx.m_state = TxStateInMempool{};
+    if (ret) {
+        wtx.m_state = TxStateInMempool{};
+        MarkBalanceDirty(wtx.GetHash());
+    }
     return ret;
 }
 
@@ -2282,7 +2521,6 @@ SigningResult CWallet::SignMessage(const std::string& message, const PKHash& pkh
     CScript script_pub_key = GetScriptForDestination(pkhash);
     for (const auto& spk_man_pair : m_spk_managers) {
         if (spk_man_pair.second->CanProvide(script_pub_key, sigdata)) {
-            LOCK(cs_wallet);  // DescriptorScriptPubKeyMan calls IsLocked which can lock cs_wallet in a deadlocking order
             return spk_man_pair.second->SignMessage(message, pkhash, str_sig);
         }
     }
@@ -2293,9 +2531,11 @@ SigningResult CWallet::SignBlockHash(const uint256 &hash, const PKHash& pkhash,
 {
     SignatureData sigdata;
     CScript script_pub_key = GetScriptForDestination(pkhash);
+    // The minter signs without the wallet RPCs in between, as they may
+    // add or encrypt the script pubkey managers
+    AssertLockHeld(cs_wallet);
     for (const auto& spk_man_pair : m_spk_managers) {
         if (spk_man_pair.second->CanProvide(script_pub_key, sigdata)) {
-            LOCK(cs_wallet);  // DescriptorScriptPubKeyMan calls IsLocked which can lock cs_wallet in a deadlocking order
             return spk_man_pair.second->SignBlockHash(hash, pkhash, vchSig);
         }
     }
@@ -2391,6 +2631,7 @@ void CWallet::CommitTransaction(CTransactionRef tx, mapValue_t mapValue, std::ve
     for (const CTxIn& txin : tx->vin) {
         CWalletTx &coin = mapWallet.at(txin.prevout.hash);
         coin.MarkDirty();
+        MarkBalanceDirty(coin.GetHash());
         NotifyTransactionChanged(coin.GetHash(), CT_UPDATED);
     }
 
@@ -2550,6 +2791,7 @@ unsigned int CWallet::GetKeyPoolSize() const
 bool CWallet::TopUpKeyPool(unsigned int kpSize)
 {
     LOCK(cs_wallet);
+    DatabaseWriteGroup write_group{GetDatabase()};
     bool res = true;
     for (auto spk_man : GetActiveScriptPubKeyMans()) {
         res &= spk_man->TopUp(kpSize);
@@ -2606,6 +2848,7 @@ void CWallet::MarkDestinationsDirty(const std::set<CTxDestination>& destinations
             CTxDestination dst;
             if (ExtractDestination(wtx.tx->vout[i].scriptPubKey, dst) && destinations.count(dst)) {
                 wtx.MarkDirty();
+                MarkBalanceDirty(entry.first);
                 break;
             }
         }
@@ -2706,6 +2949,7 @@ bool CWallet::LockCoin(const COutPoint& output, WalletBatch* batch)
 {
     AssertLockHeld(cs_wallet);
     setLockedCoins.insert(output);
+    ++m_stake_generation;
     if (batch) {
         return batch->WriteLockedUTXO(output);
     }
@@ -2716,6 +2960,7 @@ bool CWallet::UnlockCoin(const COutPoint& output, WalletBatch* batch)
 {
     AssertLockHeld(cs_wallet);
     bool was_locked = setLockedCoins.erase(output);
+    ++m_stake_generation;
     if (batch && was_locked) {
         return batch->EraseLockedUTXO(output);
     }
@@ -2731,6 +2976,7 @@ bool CWallet::UnlockAllCoins()
         success &= batch.EraseLockedUTXO(*it);
     }
     setLockedCoins.clear();
+    ++m_stake_generation;
     return success;
 }
 
@@ -3099,6 +3345,9 @@ std::shared_ptr<CWallet> CWallet::Create(WalletContext& context, const std::stri
     }
 
     walletInstance->m_spend_zero_conf_change = args.GetBoolArg("-spendzeroconfchange", DEFAULT_SPEND_ZEROCONF_CHANGE);
+    int rescan_threads{static_cast<int>(args.GetIntArg("-rescanthreads", DEFAULT_RESCAN_THREADS))};
+    if (rescan_threads <= 0) rescan_threads = GetNumCores();
+    walletInstance->m_rescan_threads = std::clamp(rescan_threads, 1, MAX_RESCAN_THREADS);
     walletInstance->m_split_coins = args.GetBoolArg("-splitcoins", DEFAULT_SPLIT_COINS);
     walletInstance->WalletLogPrintf("Wallet will%s split coins during minting\n", walletInstance->m_split_coins? "" : " not");
     walletInstance->m_combine_coins = args.GetBoolArg("-combinecoins", DEFAULT_COMBINE_COINS);
@@ -3366,7 +3615,7 @@ bool CWallet::IsLocked() const
     if (!IsCrypted()) {
         return false;
     }
-    LOCK(cs_wallet);
+    LOCK(m_master_key_mutex);
     return vMasterKey.empty();
 }
 
@@ -3376,7 +3625,7 @@ bool CWallet::Lock()
         return false;
 
     {
-        LOCK2(m_relock_mutex, cs_wallet);
+        LOCK2(m_relock_mutex, m_master_key_mutex);
         if (!vMasterKey.empty()) {
             memory_cleanse(vMasterKey.data(), vMasterKey.size() * sizeof(decltype(vMasterKey)::value_type));
             vMasterKey.clear();
@@ -3396,6 +3645,7 @@ bool CWallet::Unlock(const CKeyingMaterial& vMasterKeyIn, bool accept_no_keys)
                 return false;
             }
         }
+        LOCK(m_master_key_mutex);
         vMasterKey = vMasterKeyIn;
     }
     NotifyStatusChanged(this);
@@ -3515,8 +3765,9 @@ void CWallet::SetupLegacyScriptPubKeyMan()
     m_spk_managers[spk_manager->GetID()] = std::move(spk_manager);
 }
 
-const CKeyingMaterial& CWallet::GetEncryptionKey() const
+CKeyingMaterial CWallet::GetEncryptionKey() const
 {
+    LOCK(m_master_key_mutex);
     return vMasterKey;
 }
 
@@ -3565,271 +3816,455 @@ double SecurityToOptimalFraction(double security, bool isTestnet) {
     return optimalFraction;
 }
 
+StakeOutputTarget GetStakeOutputTarget(double difficulty, CAmount supply, const Consensus::Params& params, CAmount balance)
+{
+    StakeOutputTarget target;
+    int maxMintingUtxos = gArgs.GetIntArg("-maxmintingutxos", MAX_MINTING_UTXOS)*10;
+    int maxDayWeight = (params.nStakeMaxAge - params.nStakeMinAge) / (60*60*24);
+    target.security_level = (uint64_t(2) << 31)*difficulty / maxDayWeight / (supply/COIN) / params.nStakeTargetSpacing;
+    bool isTestnet = Params().NetworkIDString() != CBaseChainParams::MAIN;
+    target.amount = SecurityToOptimalFraction(target.security_level, isTestnet)*supply;
+
+    if (target.amount < MIN_TARGET_OUTPUT_AMOUNT)
+        target.amount = MIN_TARGET_OUTPUT_AMOUNT;
+
+    // If the available balance split by target amount would exceed max minting
+    // utxos, reset the target amount and the combine threshold to evenly split
+    // available balance
+    target.constrained = (balance / target.amount) > maxMintingUtxos;
+    if (target.constrained) {
+        target.amount = balance / maxMintingUtxos;
+        // Combine all utxos under the target amount when attempting to optimise
+        // for max minting utxos
+        target.combine_threshold = target.amount;
+    } else
+        // Otherwise do not combine utxos near the target to avoid consuming
+        // coinage and to prevent combining recently split utxos
+        target.combine_threshold = target.amount / RECOMBINE_DIVISOR;
+    return target;
+}
+
 // peercoin: create coin stake transaction
 typedef std::vector<unsigned char> valtype;
-bool CWallet::CreateCoinStake(ChainstateManager& chainman, const CWallet* pwallet, unsigned int nBits, int64_t nSearchInterval, CMutableTransaction& txNew, CTxDestination destination)
+static perf::Timer g_perf_coinstake_search{"coinstake_search", "The CreateCoinStake kernel search over the stakeable coins", "kernel_hashes"};
+
+void CWallet::AddOutputCandidates(const CTransaction& tx)
+{
+    for (unsigned int i = 0; i < tx.vout.size(); ++i) {
+        m_utxo_pool.AddPending(COutPoint(tx.GetHash(), i));
+    }
+    ++m_stake_generation;
+}
+
+void CWallet::MarkOutputCandidatesStale()
 {
-    bool bDebug = (gArgs.GetBoolArg("-debug", false) && gArgs.GetBoolArg("-printcoinstake", false));
+    m_utxo_pool_stale = true;
+    ++m_stake_generation;
+}
 
-    // if there are pre signed coinstakes, we'll use them for minting
-    if (m_coinstakes.size()) {
-        uint32_t nTime = GetTime();
-        if (bDebug)
-            LogPrintf("there are imported coinstakes, time is %d, nSearchInterval %d\n", nTime, nSearchInterval);
-        for (const auto& [timestamp, txn] : m_coinstakes) {
-            // check timestamp
-            if (nTime > timestamp) {
-                if (nTime - nSearchInterval <= timestamp) {
-                    if (bDebug)
-                        LogPrintf("timestamp within nSearchInterval, using coinstake\n");
-                    CMutableTransaction presigned(*txn);
-                    txNew = presigned;
-                    return true;
+StakeCoins CWallet::AvailableStakeCoins(ChainstateManager& chainman)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    UpdateUtxoPool(*this);
+
+    StakeCoins result;
+    // The kernel hash needs the offset of the transaction in its block
+    if (!g_txindex) return result;
+    std::vector<COutPoint> spent;
+    for (const auto& [type, by_value] : m_utxo_pool.ByValue()) {
+        // Outputs without value cannot stake
+        for (auto value_it = by_value.lower_bound({1, COutPoint()}); value_it != by_value.end(); ++value_it) {
+            const COutPoint& outpoint{value_it->second};
+            const CWalletTx* wtx{GetWalletTx(outpoint.hash)};
+            if (!wtx || IsSpent(outpoint)) {
+                spent.push_back(outpoint);
+                continue;
+            }
+            UtxoPool::Entry& entry{*Assert(m_utxo_pool.Find(outpoint))};
+            if (!(entry.mine & ISMINE_SPENDABLE)) continue;
+
+            const auto* conf{wtx->state<TxStateConfirmed>()};
+            if (!conf || IsTxImmatureCoinBase(*wtx) || IsLockedCoin(outpoint)) continue;
+            const CBlockIndex* pindex{chainman.m_blockman.LookupBlockIndex(conf->confirmed_block_hash)};
+            if (!pindex) continue;
+            if (entry.stake_block_hash != conf->confirmed_block_hash) {
+                CDiskTxPos postx;
+                SnapshotTxPos snapshot_pos;
+                if (g_txindex->FindTxPosition(outpoint.hash, postx)) {
+                    entry.stake_tx_offset = postx.nTxOffset;
+                } else if (g_txindex->FindSnapshotTx(outpoint.hash, snapshot_pos)) {
+                    // peercoin: the block of a coin loaded from a UTXO snapshot is
+                    // indexed once the background validation connects it
+                    entry.stake_tx_offset = snapshot_pos.tx_offset;
+                } else {
+                    continue;
                 }
-                else {
-                    if (bDebug)
-                        LogPrintf("timestamp too old, removing coinstake\n");
-                    m_coinstakes.erase(timestamp);
-                    break;
+                entry.stake_block_hash = conf->confirmed_block_hash;
+            }
+
+            result.balance += entry.txout.nValue;
+            result.by_script[entry.txout.scriptPubKey].push_back(result.coins.size());
+            result.coins.push_back(StakeCoin{outpoint, entry.txout, wtx->tx, pindex->GetBlockHeader(), entry.stake_tx_offset});
+        }
+    }
+    for (const COutPoint& outpoint : spent) {
+        m_utxo_pool.Erase(outpoint);
+    }
+    return result;
+}
+
+void CWallet::UpdateStakeSnapshot(ChainstateManager& chainman)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    const uint256 tip{chainman.ActiveChain().Tip()->GetBlockHash()};
+    const uint64_t generation{m_stake_generation};
+    {
+        LOCK(m_stake_snapshot_mutex);
+        if (m_stake_snapshot && m_stake_snapshot->tip == tip && m_stake_snapshot->generation == generation) return;
+    }
+    auto snapshot{std::make_shared<StakeCoins>(AvailableStakeCoins(chainman))};
+    snapshot->tip = tip;
+    snapshot->generation = generation;
+    LOCK(m_stake_snapshot_mutex);
+    m_stake_snapshot = std::move(snapshot);
+}
+
+bool CWallet::IsStakeSnapshotCurrent(const ChainstateManager& chainman, const StakeCoins& coins) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    return coins.tip == chainman.ActiveChain().Tip()->GetBlockHash() && coins.generation == m_stake_generation;
+}
+
+std::shared_ptr<const StakeCoins> CWallet::GetStakeSnapshot() const
+{
+    LOCK(m_stake_snapshot_mutex);
+    return m_stake_snapshot;
+}
+
+std::optional<CAmount> GetAllowedStakeBalance(CAmount balance)
+{
+    CAmount reserve{0};
+    if (gArgs.IsArgSet("-reservebalance")) {
+        const std::optional<CAmount> parsed{ParseMoney(gArgs.GetArg("-reservebalance", ""))};
+        if (!parsed) {
+            error("CreateCoinStake : invalid reserve balance amount");
+            return std::nullopt;
+        }
+        reserve = *parsed;
+    }
+    if (balance <= reserve || balance - reserve < MIN_TXOUT_AMOUNT)
+        return std::nullopt;
+    return balance - reserve;
+}
+
+/** Whether CreateCoinStake() supports a kernel paying to the script */
+static bool IsStakeKernelScript(const CScript& script)
+{
+    std::vector<valtype> vSolutions;
+    const TxoutType whichType{Solver(script, vSolutions)};
+    // only support pay to public key and pay to address and pay to witness keyhash
+    return whichType == TxoutType::PUBKEY || whichType == TxoutType::PUBKEYHASH || whichType == TxoutType::WITNESS_V0_KEYHASH || whichType == TxoutType::WITNESS_V1_TAPROOT;
+}
+
+//! Timestamps searched back from the current time by one kernel search
+static constexpr int64_t MAX_STAKE_SEARCH_INTERVAL{60};
+
+std::vector<size_t> SelectStakeKernelCoins(const StakeCoins& coins, CAmount allowed_balance, unsigned int time)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    std::vector<size_t> result;
+    for (size_t i = 0; i < coins.coins.size(); ++i) {
+        const StakeCoin& coin{coins.coins[i]};
+        // Do not dip into the reserve balance
+        if (coin.txout.nValue > allowed_balance)
+            continue;
+        if (coin.header.GetBlockTime() + params.nStakeMinAge > time - MAX_STAKE_SEARCH_INTERVAL)
+            continue; // only count coins meeting min age requirement
+        if (!IsStakeKernelScript(coin.txout.scriptPubKey))
+            continue;
+        result.push_back(i);
+    }
+    return result;
+}
+
+std::optional<std::pair<size_t, StakeKernel>> FindStakeKernel(ChainstateManager& chainman, unsigned int nBits, unsigned int time, int64_t search_interval, const std::vector<std::shared_ptr<const StakeCoins>>& snapshots)
+{
+    AssertLockHeld(cs_main);
+    CBlockIndex* tip{chainman.ActiveChain().Tip()};
+
+    perf::ScopedTimer search_timer{g_perf_coinstake_search};
+    // The coins of all wallets that may stake, in search order. Whether a
+    // coin may stake does not depend on the timestamp searched.
+    std::vector<std::pair<size_t, size_t>> coin_indexes;
+    std::vector<StakeKernelCandidate> candidates;
+    for (size_t w = 0; w < snapshots.size(); ++w) {
+        if (!snapshots[w]) continue;
+        const std::optional<CAmount> allowed_balance{GetAllowedStakeBalance(snapshots[w]->balance)};
+        if (!allowed_balance) continue;
+        for (const size_t i : SelectStakeKernelCoins(*snapshots[w], *allowed_balance, time)) {
+            const StakeCoin& coin{snapshots[w]->coins[i]};
+            coin_indexes.emplace_back(w, i);
+            candidates.push_back({coin.header.nTime, coin.tx_offset + CBlockHeader::NORMAL_SERIALIZE_SIZE,
+                                  coin.tx->nTime ? coin.tx->nTime : coin.header.nTime, coin.outpoint.n, coin.txout.nValue});
+        }
+    }
+
+    // Search backward in time from the given timestamp, search_interval seconds
+    // back up to MAX_STAKE_SEARCH_INTERVAL, all coins for each timestamp
+    for (int64_t n = 0; n < std::min(search_interval, MAX_STAKE_SEARCH_INTERVAL); ++n) {
+        const unsigned int time_tx = time - n;
+        // The v0.5 stake modifier is the same for the coins of all wallets,
+        // so the kernels of all coins are hashed in one batch
+        if (IsProtocolV05(time_tx)) {
+            const std::optional<KernelStakeModifier> modifier{GetKernelStakeModifierV05(tip, time_tx)};
+            if (!modifier) continue;
+            search_timer.AddItems(candidates.size());
+            if (const auto found{FindStakeKernelV05(nBits, *modifier, candidates, time_tx)}) {
+                const auto [w, i]{coin_indexes[*found]};
+                if (g_log_debug) {
+                    // Log the kernel as the search of one coin at a time does
+                    const StakeCoin& coin{snapshots[w]->coins[i]};
+                    uint256 hashProofOfStake;
+                    CheckStakeKernelHash(nBits, tip, coin.header, coin.tx_offset + CBlockHeader::NORMAL_SERIALIZE_SIZE, coin.tx, coin.outpoint, time_tx, hashProofOfStake, false, chainman.ActiveChainstate(), &*modifier);
                 }
+                return std::make_pair(w, StakeKernel{snapshots[w], i, time_tx});
+            }
+            continue;
+        }
+        search_timer.AddItems(candidates.size());
+        for (const auto& [w, i] : coin_indexes) {
+            const StakeCoin& coin{snapshots[w]->coins[i]};
+            uint256 hashProofOfStake;
+            if (CheckStakeKernelHash(nBits, tip, coin.header, coin.tx_offset + CBlockHeader::NORMAL_SERIALIZE_SIZE, coin.tx, coin.outpoint, time_tx, hashProofOfStake, false, chainman.ActiveChainstate())) {
+                return std::make_pair(w, StakeKernel{snapshots[w], i, time_tx});
             }
         }
     }
+    return std::nullopt;
+}
 
-    CBigNum bnTargetPerCoinDay;
-    bnTargetPerCoinDay.SetCompact(nBits);
+std::optional<size_t> CreateCoinStake(ChainstateManager& chainman, const std::vector<StakingWallet>& stakers, unsigned int nBits, int64_t nSearchInterval, CMutableTransaction& txNew)
+{
+    // if there are pre signed coinstakes, we'll use them for minting
+    for (size_t i = 0; i < stakers.size(); ++i) {
+        if (stakers[i].wallet->UseImportedCoinStake(nSearchInterval, txNew))
+            return i;
+    }
 
     // Transaction index is required to get to block header
-    if (!g_txindex)
-        return error("CreateCoinStake : transaction index unavailable");
+    if (!g_txindex) {
+        error("CreateCoinStake : transaction index unavailable");
+        return std::nullopt;
+    }
+
+    // Only the kernel search runs without cs_wallet
+    std::optional<std::pair<size_t, StakeKernel>> found;
+    {
+        LOCK(cs_main);
+        const uint256 tip{chainman.ActiveChain().Tip()->GetBlockHash()};
+        std::vector<std::shared_ptr<const StakeCoins>> snapshots;
+        for (const StakingWallet& staker : stakers) {
+            std::shared_ptr<const StakeCoins> snapshot{staker.wallet->GetStakeSnapshot()};
+            // Coins collected at another tip may be spent or immature by now
+            if (snapshot && snapshot->tip != tip)
+                snapshot.reset();
+            snapshots.push_back(std::move(snapshot));
+            ++staker.wallet->m_staking_stats.searches;
+            staker.wallet->m_staking_stats.last_search = txNew.nTime;
+        }
+        found = FindStakeKernel(chainman, nBits, txNew.nTime, nSearchInterval, snapshots);
+    }
+    if (!found)
+        return std::nullopt;
+    const auto& [index, kernel]{*found};
+    CWallet& wallet{*stakers[index].wallet};
+    ++wallet.m_staking_stats.kernels;
+    if (!wallet.CreateCoinStake(chainman, kernel, txNew, stakers[index].destination))
+        return std::nullopt;
+    return index;
+}
+
+bool CWallet::UseImportedCoinStake(int64_t nSearchInterval, CMutableTransaction& txNew)
+{
+    bool bDebug = g_log_debug && g_print_coinstake;
+
+    LOCK(m_coinstakes_mutex);
+    if (m_coinstakes.empty())
+        return false;
+    uint32_t nTime = GetTime();
+    if (bDebug)
+        LogPrintf("there are imported coinstakes, time is %d, nSearchInterval %d\n", nTime, nSearchInterval);
+    for (const auto& [timestamp, txn] : m_coinstakes) {
+        // check timestamp
+        if (nTime > timestamp) {
+            if (nTime - nSearchInterval <= timestamp) {
+                if (bDebug)
+                    LogPrintf("timestamp within nSearchInterval, using coinstake\n");
+                CMutableTransaction presigned(*txn);
+                txNew = presigned;
+                return true;
+            }
+            else {
+                if (bDebug)
+                    LogPrintf("timestamp too old, removing coinstake\n");
+                m_coinstakes.erase(timestamp);
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+bool CWallet::CreateCoinStake(ChainstateManager& chainman, const StakeKernel& kernel, CMutableTransaction& txNew, CTxDestination destination)
+{
+    bool bDebug = g_log_debug && g_print_coinstake;
     const Consensus::Params& params = Params().GetConsensus();
 
-    LOCK2(cs_main, pwallet->cs_wallet);
+    LOCK2(cs_wallet, cs_main);
+    const std::shared_ptr<const StakeCoins>& stake_coins{kernel.coins};
+    // The wallet may have spent or locked one of the coins since the search
+    if (!IsStakeSnapshotCurrent(chainman, *stake_coins))
+        return false;
+    const std::optional<CAmount> allowed_balance{GetAllowedStakeBalance(stake_coins->balance)};
+    if (!allowed_balance)
+        return false;
+    const CAmount nAllowedBalance{*allowed_balance};
+
     txNew.vin.clear();
     txNew.vout.clear();
     // Mark coin stake transaction
     CScript scriptEmpty;
     scriptEmpty.clear();
     txNew.vout.push_back(CTxOut(0, scriptEmpty));
-    // Choose coins to use
-    CAmount nBalance = GetBalance(*this).m_mine_trusted;
-    std::optional<CAmount> nReserveBalance = ParseMoney(gArgs.GetArg("-reservebalance", ""));
-    if (gArgs.IsArgSet("-reservebalance") && !nReserveBalance)
-        return error("CreateCoinStake : invalid reserve balance amount");
-    if (nBalance <= nReserveBalance)
-        return false;
     std::vector<CTransactionRef> vwtxPrev;
-    CCoinControl temp;
-    FastRandomContext rng_fast;
-    CoinSelectionParams coin_selection_params{rng_fast};
-    coin_selection_params.m_subtract_fee_outputs = true;
-    coin_selection_params.m_coinstake = true;
-
-    wallet::CoinsResult availableCoins = AvailableCoins(*pwallet, &temp);
-
-    CAmount nAllowedBalance = nBalance;
-    if (nReserveBalance) nAllowedBalance -= nReserveBalance.value();
-
-    if (nAllowedBalance < MIN_TXOUT_AMOUNT)
-        return false;
-
-    util::Result<SelectionResult> result = SelectCoins(*pwallet, availableCoins, /*pre_set_inputs=*/ {}, nAllowedBalance, temp, coin_selection_params);
-
-    if (!result)
-        return false;
 
     CAmount nCredit = 0;
     CScript scriptPubKeyKernel;
     CScript scriptPubKeyOut;
     bool bMinterKey = false;
 
-    for (const auto& pcoin : result->GetInputSet())
+    const StakeCoin& coin{stake_coins->coins[kernel.index]};
+    if (bDebug)
+        LogPrintf("CreateCoinStake : kernel found\n");
+    std::vector<valtype> vSolutions;
+    TxoutType whichType;
+    scriptPubKeyKernel = coin.txout.scriptPubKey;
+    whichType = Solver(scriptPubKeyKernel, vSolutions);
+    if (bDebug)
+        LogPrintf("CreateCoinStake : parsed kernel type=%s\n", GetTxnOutputType(whichType));
+    if (!IsStakeKernelScript(scriptPubKeyKernel))
     {
-        CDiskTxPos postx;
-        if (!g_txindex->FindTxPosition(pcoin->outpoint.hash, postx))
-            continue;
-
-        CBlockHeader header;
-        CTransactionRef tx;
-        auto it = g_txindex->cachedTxs.find(pcoin->outpoint.hash);
-        if (it != g_txindex->cachedTxs.end()) {
-            header = it->second.first;
-            tx = it->second.second;
-        } else {
-            try {
-                    // Read block header
-                    CAutoFile file(node::OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-                    file >> header;
-                    fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                    file >> tx;
-                    g_txindex->cachedTxs[pcoin->outpoint.hash]=std::pair(header,tx);
-                } catch (std::exception &e) {
-                    return error("%s() : deserialize or I/O error in CreateCoinStake()", __PRETTY_FUNCTION__);
-                }
-        }
-
-        static int nMaxStakeSearchInterval = 60;
-        if (header.GetBlockTime() + params.nStakeMinAge > txNew.nTime - nMaxStakeSearchInterval)
-            continue; // only count coins meeting min age requirement
-
-        bool fKernelFound = false;
-        for (unsigned int n=0; n<std::min(nSearchInterval,(int64_t)nMaxStakeSearchInterval) && !fKernelFound; n++)
-        {
-            // Search backward in time from the given txNew timestamp
-            // Search nSearchInterval seconds back up to nMaxStakeSearchInterval
-            uint256 hashProofOfStake = uint256();
-            COutPoint prevoutStake = pcoin->outpoint;
-            if (CheckStakeKernelHash(nBits, chainman.ActiveChain().Tip(), header, postx.nTxOffset + CBlockHeader::NORMAL_SERIALIZE_SIZE, tx, prevoutStake, txNew.nTime - n, hashProofOfStake, false, chainman.ActiveChainstate()))
+        if (bDebug)
+            LogPrintf("CreateCoinStake : no support for kernel type=%s\n", GetTxnOutputType(whichType));
+        return false;
+    }
+    if (whichType == TxoutType::PUBKEYHASH || whichType == TxoutType::WITNESS_V0_KEYHASH) // pay to address type or witness keyhash
+    {
+        // convert to pay to public key type
+        CKey key;
+        if (IsLegacy()) {
+            auto scriptPubKeyMan = GetLegacyScriptPubKeyMan();
+            if (!scriptPubKeyMan) {
+                if (bDebug)
+                    LogPrintf("CreateCoinStake : failed to get scriptpubkeyman for kernel type=%s\n", GetTxnOutputType(whichType));
+                return false;  // unable to find corresponding public key
+            }
+            if (!scriptPubKeyMan->GetKey(CKeyID(uint160(vSolutions[0])), key))
             {
-                // Found a kernel
                 if (bDebug)
-                    LogPrintf("CreateCoinStake : kernel found\n");
-                std::vector<valtype> vSolutions;
-                TxoutType whichType;
-                scriptPubKeyKernel = pcoin->txout.scriptPubKey;
-                whichType = Solver(scriptPubKeyKernel, vSolutions);
+                    LogPrintf("CreateCoinStake : failed to get key for kernel type=%s\n", GetTxnOutputType(whichType));
+                return false;  // unable to find corresponding public key
+            }
+            scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+        }
+        else {
+            std::unique_ptr<SigningProvider> provider = GetSolvingProvider(scriptPubKeyKernel);
+            if (!provider) {
                 if (bDebug)
-                    LogPrintf("CreateCoinStake : parsed kernel type=%s\n", GetTxnOutputType(whichType));
-                if (whichType != TxoutType::PUBKEY && whichType != TxoutType::PUBKEYHASH && whichType != TxoutType::WITNESS_V0_KEYHASH && whichType != TxoutType::WITNESS_V1_TAPROOT)
-                {
-                    if (bDebug)
-                        LogPrintf("CreateCoinStake : no support for kernel type=%s\n", GetTxnOutputType(whichType));
-                    break;  // only support pay to public key and pay to address and pay to witness keyhash
-                }
-                if (whichType == TxoutType::PUBKEYHASH || whichType == TxoutType::WITNESS_V0_KEYHASH) // pay to address type or witness keyhash
-                {
-                    // convert to pay to public key type
-                    CKey key;
-                    if (IsLegacy()) {
-                        auto scriptPubKeyMan = pwallet->GetLegacyScriptPubKeyMan();
-                        if (!scriptPubKeyMan) {
-                            if (bDebug)
-                                LogPrintf("CreateCoinStake : failed to get scriptpubkeyman for kernel type=%s\n", GetTxnOutputType(whichType));
-                            break;  // unable to find corresponding public key
-                        }
-                        if (!scriptPubKeyMan->GetKey(CKeyID(uint160(vSolutions[0])), key))
-                        {
-                            if (bDebug)
-                                LogPrintf("CreateCoinStake : failed to get key for kernel type=%s\n", GetTxnOutputType(whichType));
-                            break;  // unable to find corresponding public key
-                        }
-                        scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
-                    }
-                    else {
-                        std::unique_ptr<SigningProvider> provider = pwallet->GetSolvingProvider(scriptPubKeyKernel);
-                        if (!provider) {
-                            if (bDebug)
-                                LogPrintf("CreateCoinStake : failed to get signing provider for output %s\n", pcoin->txout.ToString());
-                            break;
-                        }
-                        CKeyID ckey = CKeyID(uint160(vSolutions[0]));
-                        CPubKey pkey;
-                        if (!provider.get()->GetPubKey(ckey, pkey)) {
-                            if (bDebug)
-                                LogPrintf("CreateCoinStake : failed to get key for output %s\n", pcoin->txout.ToString());
-                            break;
-                        }
-                        scriptPubKeyOut << ToByteVector(pkey) << OP_CHECKSIG;
-                    }
-                }
-                else if (whichType == TxoutType::PUBKEY)
-                    scriptPubKeyOut = scriptPubKeyKernel;
-                else if (whichType == TxoutType::WITNESS_V1_TAPROOT) {
-                    std::vector<valtype> vSolutionsTmp;
-                    CScript scriptPubKeyTmp = GetScriptForDestination(destination);
-                    Solver(scriptPubKeyTmp, vSolutionsTmp);
-                    std::unique_ptr<SigningProvider> provider = pwallet->GetSolvingProvider(scriptPubKeyTmp);
-                    if (!provider) {
-                        if (bDebug)
-                            LogPrintf("CreateCoinStake : failed to get signing provider for minter output\n");
-                        break;
-                    }
-                    CKeyID ckey = CKeyID(uint160(vSolutionsTmp[0]));
-                    CPubKey pkey;
-                    if (!provider.get()->GetPubKey(ckey, pkey)) {
-                        if (bDebug)
-                            LogPrintf("CreateCoinStake : failed to get key for minter output\n", pcoin->txout.ToString());
-                        break;
-                    }
-                    scriptPubKeyOut << ToByteVector(pkey) << OP_CHECKSIG;
-                    bMinterKey = true;
-                }
-
-                txNew.nTime -= n;
-                txNew.vin.push_back(CTxIn(pcoin->outpoint.hash, pcoin->outpoint.n));
-                nCredit += pcoin->txout.nValue;
-                vwtxPrev.push_back(tx);
-
-                if (bMinterKey) {
-                    // extra output for minter key
-                    txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
-                    // redefine scriptPubKeyOut to send output to input address
-                    scriptPubKeyOut = scriptPubKeyKernel;
-                }
-
+                    LogPrintf("CreateCoinStake : failed to get signing provider for output %s\n", coin.txout.ToString());
+                return false;
+            }
+            CKeyID ckey = CKeyID(uint160(vSolutions[0]));
+            CPubKey pkey;
+            if (!provider.get()->GetPubKey(ckey, pkey)) {
                 if (bDebug)
-                    LogPrintf("CreateCoinStake : added kernel type=%s\n", GetTxnOutputType(whichType));
-                fKernelFound = true;
-                break;
+                    LogPrintf("CreateCoinStake : failed to get key for output %s\n", coin.txout.ToString());
+                return false;
             }
+            scriptPubKeyOut << ToByteVector(pkey) << OP_CHECKSIG;
+        }
+    }
+    else if (whichType == TxoutType::PUBKEY)
+        scriptPubKeyOut = scriptPubKeyKernel;
+    else if (whichType == TxoutType::WITNESS_V1_TAPROOT) {
+        std::vector<valtype> vSolutionsTmp;
+        CScript scriptPubKeyTmp = GetScriptForDestination(destination);
+        Solver(scriptPubKeyTmp, vSolutionsTmp);
+        std::unique_ptr<SigningProvider> provider = GetSolvingProvider(scriptPubKeyTmp);
+        if (!provider) {
+            if (bDebug)
+                LogPrintf("CreateCoinStake : failed to get signing provider for minter output\n");
+            return false;
+        }
+        CKeyID ckey = CKeyID(uint160(vSolutionsTmp[0]));
+        CPubKey pkey;
+        if (!provider.get()->GetPubKey(ckey, pkey)) {
+            if (bDebug)
+                LogPrintf("CreateCoinStake : failed to get key for minter output\n", coin.txout.ToString());
+            return false;
         }
-        if (fKernelFound)
-            break; // if kernel is found stop searching
+        scriptPubKeyOut << ToByteVector(pkey) << OP_CHECKSIG;
+        bMinterKey = true;
     }
+
+    txNew.nTime = kernel.time;
+    txNew.vin.push_back(CTxIn(coin.outpoint.hash, coin.outpoint.n));
+    nCredit += coin.txout.nValue;
+    vwtxPrev.push_back(coin.tx);
+
+    if (bMinterKey) {
+        // extra output for minter key
+        txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
+        // redefine scriptPubKeyOut to send output to input address
+        scriptPubKeyOut = scriptPubKeyKernel;
+    }
+
+    if (bDebug)
+        LogPrintf("CreateCoinStake : added kernel type=%s\n", GetTxnOutputType(whichType));
     if (nCredit == 0 || nCredit > nAllowedBalance)
         return false;
 
     // rfc28 precalculation
-    int maxMintingUtxos = gArgs.GetIntArg("-maxmintingutxos", MAX_MINTING_UTXOS)*10;
-
     double difficulty = GetDifficulty(GetLastBlockIndex(chainman.ActiveChain().Tip(), true), chainman.ActiveChain().Tip());
-    CAmount supply = chainman.ActiveChain().Tip()->nMoneySupply;
-    int maxDayWeight = (params.nStakeMaxAge - params.nStakeMinAge) / (60*60*24);
-    double securityLevel = (uint64_t(2) << 31)*difficulty / maxDayWeight / (supply/COIN) / params.nStakeTargetSpacing;
-    bool isTestnet = Params().NetworkIDString() != CBaseChainParams::MAIN;
-    CAmount nTargetOutputAmount = SecurityToOptimalFraction(securityLevel, isTestnet)*supply;
-
-    if (nTargetOutputAmount < MIN_TARGET_OUTPUT_AMOUNT)
-        nTargetOutputAmount = MIN_TARGET_OUTPUT_AMOUNT;
-
-    // If the available balance split by target amount would exceed max minting
-    // utxos, reset the target amount and nCombineThreshold to evenly split
-    // available balance
-    bool constrainToMaxUtxos = (nAllowedBalance / nTargetOutputAmount) > maxMintingUtxos;
-    CAmount nCombineThreshold;
-    if (constrainToMaxUtxos) {
-        nTargetOutputAmount = nAllowedBalance / maxMintingUtxos;
-        // Combine all utxos under the target amount when attempting to optimise
-        // for max minting utxos
-        nCombineThreshold = nTargetOutputAmount;
-    } else
-        // Otherwise do not combine utxos near the target to avoid consuming
-        // coinage and to prevent combining recently split utxos
-        nCombineThreshold = nTargetOutputAmount / RECOMBINE_DIVISOR;
-
-    for (const auto& pcoin : result->GetInputSet())
+    const StakeOutputTarget target{GetStakeOutputTarget(difficulty, chainman.ActiveChain().Tip()->nMoneySupply, params, nAllowedBalance)};
+    const double securityLevel{target.security_level};
+    const CAmount nTargetOutputAmount{target.amount};
+    const bool constrainToMaxUtxos{target.constrained};
+    const CAmount nCombineThreshold{target.combine_threshold};
+
+    // Attempt to add more inputs
+    // Only add coins of the same key/address as kernel
+    std::vector<size_t> vCombine;
+    auto add_script_coins = [&](const CScript& script) {
+        const auto it = stake_coins->by_script.find(script);
+        if (it != stake_coins->by_script.end())
+            vCombine.insert(vCombine.end(), it->second.begin(), it->second.end());
+    };
+    add_script_coins(scriptPubKeyKernel);
+    if (txNew.vout[1].scriptPubKey != scriptPubKeyKernel)
+        add_script_coins(txNew.vout[1].scriptPubKey);
+    // Keep the outpoint order of stake_coins
+    std::sort(vCombine.begin(), vCombine.end());
+    for (const size_t i : vCombine)
     {
-        CDiskTxPos postx;
-        if (!g_txindex->FindTxPosition(pcoin->outpoint.hash, postx))
-            continue;
-
-        // Read block header
-        CAutoFile file(node::OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-        CBlockHeader header;
-        CTransactionRef tx;
-        try {
-            file >> header;
-            fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-            file >> tx;
-        } catch (std::exception &e) {
-            return error("%s() : deserialize or I/O error in CreateCoinStake()", __PRETTY_FUNCTION__);
-        }
-
-        // Attempt to add more inputs
-        // Only add coins of the same key/address as kernel
-        if (((pcoin->txout.scriptPubKey == scriptPubKeyKernel || pcoin->txout.scriptPubKey == txNew.vout[1].scriptPubKey))
-            && (pcoin->outpoint.hash != txNew.vin[0].prevout.hash)
-            && pwallet->m_combine_coins)
+        const StakeCoin& coin{stake_coins->coins[i]};
+        if ((coin.outpoint.hash != txNew.vin[0].prevout.hash)
+            && m_combine_coins)
         {
             // Stop adding more inputs if already too many inputs and we are above target or have minter key to add
             if ((txNew.vin.size() >= MAX_COINSTAKE_INPUTS) && (bMinterKey || nCredit > nTargetOutputAmount))
@@ -3838,15 +4273,15 @@ bool CWallet::CreateCoinStake(ChainstateManager& chainman, const CWallet* pwalle
             if ((txNew.vin.size() >= 8) && (nCredit < nTargetOutputAmount))
                 break;
             // Stop adding inputs if reached reserve limit
-            if (nCredit + pcoin->txout.nValue > nAllowedBalance)
+            if (nCredit + coin.txout.nValue > nAllowedBalance)
                 break;
             // Do not add additional significant input
-            if (pcoin->txout.nValue > nCombineThreshold)
+            if (coin.txout.nValue > nCombineThreshold)
                 continue;
 
-            txNew.vin.push_back(CTxIn(pcoin->outpoint.hash, pcoin->outpoint.n));
-            nCredit += pcoin->txout.nValue;
-            vwtxPrev.push_back(tx);
+            txNew.vin.push_back(CTxIn(coin.outpoint.hash, coin.outpoint.n));
+            nCredit += coin.txout.nValue;
+            vwtxPrev.push_back(coin.tx);
         }
     }
     // Calculate coin age reward
@@ -3874,7 +4309,7 @@ bool CWallet::CreateCoinStake(ChainstateManager& chainman, const CWallet* pwalle
         // Assume success
         bool outputsOk = true;
         // split and set amounts based on rfc28
-        if (pwallet->m_split_coins) {
+        if (m_split_coins) {
             CAmount current = nCredit - nMinFee;
             double ratio = current / double(nTargetOutputAmount);
             // Obtain the optimal number of outputs and clamp it to maxOutputs to ensure the fee is not exceeded
@@ -3919,7 +4354,7 @@ bool CWallet::CreateCoinStake(ChainstateManager& chainman, const CWallet* pwalle
             for (const auto& pcoin : vwtxPrev)
             {
                 SignatureData empty;
-                if (!SignSignature(*pwallet->GetLegacyScriptPubKeyMan(), *pcoin, txNew, nIn++, SIGHASH_ALL, empty))
+                if (!SignSignature(*GetLegacyScriptPubKeyMan(), *pcoin, txNew, nIn++, SIGHASH_ALL, empty))
                     return error("CreateCoinStake : failed to sign coinstake");
             }
         }
@@ -3930,11 +4365,11 @@ bool CWallet::CreateCoinStake(ChainstateManager& chainman, const CWallet* pwalle
             for (const CTxIn& txin : txNew.vin) {
                 coins[txin.prevout]; // Create empty map entry keyed by prevout.
             }
-            pwallet->chain().findCoins(coins);
+            chain().findCoins(coins);
             // Script verification errors
             std::map<int, bilingual_str> input_errors;
             int nTime = txNew.nTime;
-            pwallet->SignTransaction(txNew, coins, SIGHASH_ALL, input_errors);
+            SignTransaction(txNew, coins, SIGHASH_ALL, input_errors);
             txNew.nTime = nTime;
         }
 
@@ -3987,7 +4422,8 @@ void CWallet::SetupDescriptorScriptPubKeyMans(const CExtKey& master_key)
                 if (IsLocked()) {
                     throw std::runtime_error(std::string(__func__) + ": Wallet is locked, cannot setup new descriptors");
                 }
-                if (!spk_manager->CheckDecryptionKey(vMasterKey) && !spk_manager->Encrypt(vMasterKey, nullptr)) {
+                const CKeyingMaterial master_key{GetEncryptionKey()};
+                if (!spk_manager->CheckDecryptionKey(master_key) && !spk_manager->Encrypt(master_key, nullptr)) {
                     throw std::runtime_error(std::string(__func__) + ": Could not encrypt new descriptors");
                 }
             }
@@ -4148,6 +4584,7 @@ ScriptPubKeyMan* CWallet::AddWalletDescriptor(WalletDescriptor& desc, const Flat
         WalletLogPrintf("Cannot add WalletDescriptor to a non-descriptor wallet\n");
         return nullptr;
     }
+    MarkOutputCandidatesStale();
 
     auto spk_man = GetDescriptorScriptPubKeyMan(desc);
     if (spk_man) {
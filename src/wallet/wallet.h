@@ -29,10 +29,12 @@
 #include <wallet/crypter.h>
 #include <wallet/scriptpubkeyman.h>
 #include <wallet/transaction.h>
+#include <wallet/utxopool.h>
 #include <wallet/walletdb.h>
 #include <wallet/walletutil.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <map>
 #include <memory>
@@ -53,6 +55,9 @@ using LoadWalletFn = std::function<void(std::unique_ptr<interfaces::Wallet> wall
 class CScript;
 enum class FeeEstimateMode;
 struct bilingual_str;
+namespace Consensus {
+struct Params;
+} // namespace Consensus
 
 namespace wallet {
 struct WalletContext;
@@ -111,6 +116,12 @@ static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 6;
 static const bool DEFAULT_WALLETBROADCAST = true;
 static const bool DEFAULT_DISABLE_WALLET = false;
 static const bool DEFAULT_WALLETCROSSCHAIN = false;
+//! -rescanthreads default, 0 = one per core
+static const int DEFAULT_RESCAN_THREADS{0};
+//! Maximum number of threads reading and matching blocks during a rescan
+static const int MAX_RESCAN_THREADS{16};
+//! Number of blocks read ahead of the ordered apply phase of a rescan
+static const int RESCAN_BATCH_SIZE{64};
 //! Pre-calculated constants for input size estimation in *virtual size*
 static constexpr size_t DUMMY_NESTED_P2WPKH_INPUT_SIZE = 91;
 
@@ -118,6 +129,22 @@ class CCoinControl;
 class CWalletTx;
 class ReserveDestination;
 
+//! rfc28: the fraction of the money supply a stake output should hold at the given security level
+double SecurityToOptimalFraction(double security, bool isTestnet);
+
+//! rfc28: the amount of the outputs stakes are split into
+struct StakeOutputTarget {
+    double security_level;
+    CAmount amount;
+    //! Whether the amount was raised so that the balance fits into -maxmintingutxos outputs
+    bool constrained;
+    //! Coins up to this amount are combined with the kernel
+    CAmount combine_threshold;
+};
+
+/** The rfc28 stake output target for a balance, at the PoS difficulty and money supply of the tip */
+StakeOutputTarget GetStakeOutputTarget(double difficulty, CAmount supply, const Consensus::Params& params, CAmount balance);
+
 //! Default for -addresstype
 constexpr OutputType DEFAULT_ADDRESS_TYPE{OutputType::LEGACY};
 
@@ -126,18 +153,21 @@ static constexpr uint64_t KNOWN_WALLET_FLAGS =
     |   WALLET_FLAG_BLANK_WALLET
     |   WALLET_FLAG_KEY_ORIGIN_METADATA
     |   WALLET_FLAG_LAST_HARDENED_XPUB_CACHED
+    |   WALLET_FLAG_DISABLE_STAKING
     |   WALLET_FLAG_DISABLE_PRIVATE_KEYS
     |   WALLET_FLAG_DESCRIPTORS
     |   WALLET_FLAG_EXTERNAL_SIGNER;
 
 static constexpr uint64_t MUTABLE_WALLET_FLAGS =
-        WALLET_FLAG_AVOID_REUSE;
+        WALLET_FLAG_AVOID_REUSE
+    |   WALLET_FLAG_DISABLE_STAKING;
 
 static const std::map<std::string,WalletFlags> WALLET_FLAG_MAP{
     {"avoid_reuse", WALLET_FLAG_AVOID_REUSE},
     {"blank", WALLET_FLAG_BLANK_WALLET},
     {"key_origin_metadata", WALLET_FLAG_KEY_ORIGIN_METADATA},
     {"last_hardened_xpub_cached", WALLET_FLAG_LAST_HARDENED_XPUB_CACHED},
+    {"disable_staking", WALLET_FLAG_DISABLE_STAKING},
     {"disable_private_keys", WALLET_FLAG_DISABLE_PRIVATE_KEYS},
     {"descriptor_wallet", WALLET_FLAG_DESCRIPTORS},
     {"external_signer", WALLET_FLAG_EXTERNAL_SIGNER}
@@ -261,6 +291,48 @@ struct CRecipient
     bool fSubtractFeeFromAmount;
 };
 
+struct Balance {
+    CAmount m_mine_trusted{0};           //!< Trusted, at depth=GetBalance.min_depth or more
+    CAmount m_mine_untrusted_pending{0}; //!< Untrusted, but in mempool (pending)
+    CAmount m_mine_immature{0};          //!< Immature coinbases in the main chain
+    CAmount m_mine_stake{0};             //!< Staked, non-spendable until maturity
+    CAmount m_watchonly_trusted{0};
+    CAmount m_watchonly_untrusted_pending{0};
+    CAmount m_watchonly_immature{0};
+};
+
+/** A confirmed, mature and unlocked wallet output that can be staked. */
+struct StakeCoin
+{
+    COutPoint outpoint;
+    CTxOut txout;
+    CTransactionRef tx;
+    //! Header of the block containing tx, as needed for the kernel hash
+    CBlockHeader header;
+    //! Offset of tx in its block, after the header
+    unsigned int tx_offset;
+};
+
+struct StakeCoins
+{
+    //! Sorted by outpoint
+    std::vector<StakeCoin> coins;
+    CAmount balance{0};
+    //! Indexes into coins, grouped by output script, to find coins to combine with the kernel
+    std::map<CScript, std::vector<size_t>> by_script;
+    //! Chain tip and CWallet::m_stake_generation the coins were collected at
+    uint256 tip;
+    uint64_t generation{0};
+};
+
+/** A kernel found by FindStakeKernel(): coin index of the stake coins, hashed at time */
+struct StakeKernel
+{
+    std::shared_ptr<const StakeCoins> coins;
+    size_t index{0};
+    unsigned int time{0};
+};
+
 class WalletRescanReserver; //forward declarations for ScanForWalletTransactions/RescanFromTime
 /**
  * A CWallet maintains a set of transactions and balances, and provides the ability to create new transactions.
@@ -268,7 +340,10 @@ class WalletRescanReserver; //forward declarations for ScanForWalletTransactions
 class CWallet final : public WalletStorage, public interfaces::Chain::Notifications
 {
 private:
-    CKeyingMaterial vMasterKey GUARDED_BY(cs_wallet);
+    //! Guards the master key on its own, so IsLocked() can be called while
+    //! holding cs_main or a ScriptPubKeyMan lock without taking cs_wallet
+    mutable Mutex m_master_key_mutex;
+    CKeyingMaterial vMasterKey GUARDED_BY(m_master_key_mutex);
 
     bool Unlock(const CKeyingMaterial& vMasterKeyIn, bool accept_no_keys = false);
 
@@ -435,7 +510,55 @@ public:
     std::map<CTxDestination, CAddressBookData> m_address_book GUARDED_BY(cs_wallet);
     const CAddressBookData* FindAddressBookEntry(const CTxDestination&, bool allow_change = false) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
-    std::map<uint32_t, CTransactionRef> m_coinstakes;
+    //! Imported coinstakes by timestamp, used by the minter without cs_wallet
+    Mutex m_coinstakes_mutex;
+    std::map<uint32_t, CTransactionRef> m_coinstakes GUARDED_BY(m_coinstakes_mutex);
+
+    /** Wallet outputs that may be spent or staked. This is a superset:
+     * AvailableCoins() and AvailableStakeCoins() drop outputs that are spent, and
+     * an output is added back when a transaction spending it changes state.
+     * Mutable as AvailableCoins() analyzes the pending outputs. */
+    mutable UtxoPool m_utxo_pool GUARDED_BY(cs_wallet);
+    /** Set when outputs of known transactions may have become ours, to rebuild
+     * m_utxo_pool from mapWallet. */
+    mutable bool m_utxo_pool_stale GUARDED_BY(cs_wallet){true};
+    /** Queue the outputs of a transaction as stake and spend candidates */
+    void AddOutputCandidates(const CTransaction& tx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    /** Rebuild the stake and spend candidates, after outputs of known
+     * transactions may have become ours */
+    void MarkOutputCandidatesStale() EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /** Stake coins published by UpdateStakeSnapshot(). CreateCoinStake() searches
+     * them for a kernel without holding cs_wallet, so wallet RPCs and validation
+     * callbacks do not wait for the minter, and only takes it to sign. */
+    mutable Mutex m_stake_snapshot_mutex;
+    std::shared_ptr<const StakeCoins> m_stake_snapshot GUARDED_BY(m_stake_snapshot_mutex);
+    /** Bumped under cs_wallet whenever wallet outputs may have been added, spent
+     * or locked, which makes the published stake snapshot stale. */
+    std::atomic<uint64_t> m_stake_generation{0};
+
+    /** Balance as returned by GetBalance() with min_depth 0, kept as the sum
+     * of per-transaction contributions that are only recomputed for
+     * transactions marked dirty since the previous call. */
+    struct BalanceCache {
+        Balance total;
+        //! Non-zero contributions to total
+        std::map<uint256, Balance> txs;
+        //! Transactions whose contribution must be recomputed
+        std::set<uint256> dirty;
+        //! Immature coinbases and coinstakes in the main chain, which change with every block
+        std::set<uint256> immature;
+        //! Set to recompute all contributions
+        bool stale{true};
+    };
+    /** Indexed by the avoid_reuse argument of GetBalance(). */
+    mutable std::array<BalanceCache, 2> m_balance_cache GUARDED_BY(cs_wallet);
+    /** Recompute the balance contribution of a transaction, and of the wallet
+     * transactions spending it, on the next GetBalance() call. Called
+     * wherever the state of a wallet transaction changes. */
+    void MarkBalanceDirty(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    /** Recompute the whole balance on the next GetBalance() call. */
+    void MarkBalanceStale() EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     /** Set of Coins owned by this wallet that we won't try to spend from. A
      * Coin may be locked if it has already been used to fund a transaction
@@ -556,6 +679,7 @@ public:
     void blockConnected(const interfaces::BlockInfo& block) override;
     void blockDisconnected(const interfaces::BlockInfo& block) override;
     void updatedBlockTip() override;
+    std::string getNotificationsName() const override { return "wallet " + GetDisplayName(); }
     int64_t RescanFromTime(int64_t startTime, const WalletRescanReserver& reserver, bool update);
 
     struct ScanResult {
@@ -623,7 +747,20 @@ public:
      * @param[in] orderForm BIP 70 / BIP 21 order form details to be set on the transaction.
      */
     void CommitTransaction(CTransactionRef tx, mapValue_t mapValue, std::vector<std::pair<std::string, std::string>> orderForm);
-    bool CreateCoinStake(ChainstateManager& chainman, const CWallet* pwallet, unsigned int nBits, int64_t nSearchInterval, CMutableTransaction &txNew, CTxDestination destination);
+    /** Use an imported coinstake with a timestamp in the search interval, dropping an expired one. */
+    bool UseImportedCoinStake(int64_t nSearchInterval, CMutableTransaction& txNew) EXCLUSIVE_LOCKS_REQUIRED(!m_coinstakes_mutex);
+    /** Build and sign the coinstake of a kernel found in the published stake snapshot.
+     * Fails if the snapshot has become stale since the kernel search. */
+    bool CreateCoinStake(ChainstateManager& chainman, const StakeKernel& kernel, CMutableTransaction& txNew, CTxDestination destination) LOCKS_EXCLUDED(::cs_main);
+    /** Outputs that can be staked now, in time linear in the number of unspent wallet outputs. */
+    StakeCoins AvailableStakeCoins(ChainstateManager& chainman) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, cs_wallet);
+    /** Publish the stake coins for CreateCoinStake(), unless the snapshot is
+     * still current for the chain tip and the wallet outputs. */
+    void UpdateStakeSnapshot(ChainstateManager& chainman) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, cs_wallet, !m_stake_snapshot_mutex);
+    std::shared_ptr<const StakeCoins> GetStakeSnapshot() const EXCLUSIVE_LOCKS_REQUIRED(!m_stake_snapshot_mutex);
+    /** Whether stake coins were collected at the chain tip, with no wallet
+     * output added, spent or locked since */
+    bool IsStakeSnapshotCurrent(const ChainstateManager& chainman, const StakeCoins& coins) const EXCLUSIVE_LOCKS_REQUIRED(::cs_main, cs_wallet);
 
     /** Pass this transaction to node for mempool insertion and relay to peers if flag set to true */
     bool SubmitTxMemoryPoolAndRelay(CWalletTx& wtx, std::string& err_string, bool relay) const
@@ -641,7 +778,19 @@ public:
     bool m_spend_zero_conf_change{DEFAULT_SPEND_ZEROCONF_CHANGE};
     bool m_split_coins{DEFAULT_SPLIT_COINS};
     bool m_combine_coins{DEFAULT_COMBINE_COINS};
+    /** Minting activity of this wallet, reported by getwalletinfo */
+    struct StakingStats {
+        //! Kernel searches over the coins of this wallet, and the time of the last one
+        std::atomic<uint64_t> searches{0};
+        std::atomic<int64_t> last_search{0};
+        std::atomic<uint64_t> kernels{0};
+        //! Blocks signed by this wallet and accepted by the node
+        std::atomic<uint64_t> blocks{0};
+    };
+    StakingStats m_staking_stats;
     bool m_check_github{DEFAULT_CHECK_GITHUB};
+    /** Threads reading and matching blocks during a rescan, including the scanning thread. */
+    int m_rescan_threads{1};
 
     /** When the actual feerate is less than the consolidate feerate, we will tend to make transactions which
      * consolidate inputs. When the actual feerate is greater than the consolidate feerate, we will tend to make
@@ -886,7 +1035,7 @@ public:
     //! Make a LegacyScriptPubKeyMan and set it for all types, internal, and external.
     void SetupLegacyScriptPubKeyMan();
 
-    const CKeyingMaterial& GetEncryptionKey() const override;
+    CKeyingMaterial GetEncryptionKey() const override EXCLUSIVE_LOCKS_REQUIRED(!m_master_key_mutex);
     bool HasEncryptionKeys() const override;
 
     /** Get last block processed height */
@@ -1036,6 +1185,31 @@ struct MigrationResult {
 
 //! Do all steps to migrate a legacy wallet to a descriptor wallet
 util::Result<MigrationResult> MigrateLegacyToDescriptor(const std::string& wallet_name, const SecureString& passphrase, WalletContext& context);
+
+/** A wallet taking part in the kernel search of the minter, with its mintkey destination */
+struct StakingWallet {
+    std::shared_ptr<CWallet> wallet;
+    CTxDestination destination;
+};
+
+/** Stakeable balance above -reservebalance, nullopt if there is none */
+std::optional<CAmount> GetAllowedStakeBalance(CAmount balance);
+
+/** Indexes of the coins that may be the kernel of a coinstake at time: not
+ * above the allowed balance, old enough and paying to a supported script. */
+std::vector<size_t> SelectStakeKernelCoins(const StakeCoins& coins, CAmount allowed_balance, unsigned int time);
+
+/** Search the stake snapshots for a kernel, one timestamp at a time with the
+ * stake modifier computed once for the coins of all snapshots. Returns the
+ * index of the snapshot containing the kernel. */
+std::optional<std::pair<size_t, StakeKernel>> FindStakeKernel(ChainstateManager& chainman, unsigned int nBits, unsigned int time, int64_t search_interval, const std::vector<std::shared_ptr<const StakeCoins>>& snapshots)
+    EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+/** Create a coinstake from an imported one, or from a kernel found by a single
+ * search over the stake snapshots of all the wallets and signed by the wallet
+ * owning it. Returns the index of that wallet. */
+std::optional<size_t> CreateCoinStake(ChainstateManager& chainman, const std::vector<StakingWallet>& stakers, unsigned int nBits, int64_t nSearchInterval, CMutableTransaction& txNew)
+    LOCKS_EXCLUDED(::cs_main);
 } // namespace wallet
 
 #endif // BITCOIN_WALLET_WALLET_H
@@ -12,6 +12,7 @@
 #include <util/bip32.h>
 #include <util/fs.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <util/time.h>
 #include <util/translation.h>
 #ifdef USE_BDB
@@ -22,9 +23,11 @@
 #endif
 #include <wallet/wallet.h>
 
+#include <algorithm>
 #include <atomic>
 #include <optional>
 #include <string>
+#include <thread>
 
 namespace wallet {
 namespace DBKeys {
@@ -115,7 +118,7 @@ bool WalletBatch::WriteKey(const CPubKey& vchPubKey, const CPrivKey& vchPrivKey,
     vchKey.insert(vchKey.end(), vchPubKey.begin(), vchPubKey.end());
     vchKey.insert(vchKey.end(), vchPrivKey.begin(), vchPrivKey.end());
 
-    return WriteIC(std::make_pair(DBKeys::KEY, vchPubKey), std::make_pair(vchPrivKey, Hash(vchKey)), false);
+    return WriteKeyMaterial(std::make_pair(DBKeys::KEY, vchPubKey), std::make_pair(vchPrivKey, Hash(vchKey)), false);
 }
 
 bool WalletBatch::WriteCryptedKey(const CPubKey& vchPubKey,
@@ -130,7 +133,7 @@ bool WalletBatch::WriteCryptedKey(const CPubKey& vchPubKey,
     uint256 checksum = Hash(vchCryptedSecret);
 
     const auto key = std::make_pair(DBKeys::CRYPTED_KEY, vchPubKey);
-    if (!WriteIC(key, std::make_pair(vchCryptedSecret, checksum), false)) {
+    if (!WriteKeyMaterial(key, std::make_pair(vchCryptedSecret, checksum), false)) {
         // It may already exist, so try writing just the checksum
         std::vector<unsigned char> val;
         if (!m_batch->Read(key, val)) {
@@ -146,12 +149,12 @@ bool WalletBatch::WriteCryptedKey(const CPubKey& vchPubKey,
 
 bool WalletBatch::WriteMasterKey(unsigned int nID, const CMasterKey& kMasterKey)
 {
-    return WriteIC(std::make_pair(DBKeys::MASTER_KEY, nID), kMasterKey, true);
+    return WriteKeyMaterial(std::make_pair(DBKeys::MASTER_KEY, nID), kMasterKey, true);
 }
 
 bool WalletBatch::WriteCScript(const uint160& hash, const CScript& redeemScript)
 {
-    return WriteIC(std::make_pair(DBKeys::CSCRIPT, hash), redeemScript, false);
+    return WriteKeyMaterial(std::make_pair(DBKeys::CSCRIPT, hash), redeemScript, false);
 }
 
 bool WalletBatch::WriteWatchOnly(const CScript &dest, const CKeyMetadata& keyMeta)
@@ -227,12 +230,12 @@ bool WalletBatch::WriteDescriptorKey(const uint256& desc_id, const CPubKey& pubk
     key.insert(key.end(), pubkey.begin(), pubkey.end());
     key.insert(key.end(), privkey.begin(), privkey.end());
 
-    return WriteIC(std::make_pair(DBKeys::WALLETDESCRIPTORKEY, std::make_pair(desc_id, pubkey)), std::make_pair(privkey, Hash(key)), false);
+    return WriteKeyMaterial(std::make_pair(DBKeys::WALLETDESCRIPTORKEY, std::make_pair(desc_id, pubkey)), std::make_pair(privkey, Hash(key)), false);
 }
 
 bool WalletBatch::WriteCryptedDescriptorKey(const uint256& desc_id, const CPubKey& pubkey, const std::vector<unsigned char>& secret)
 {
-    if (!WriteIC(std::make_pair(DBKeys::WALLETDESCRIPTORCKEY, std::make_pair(desc_id, pubkey)), secret, false)) {
+    if (!WriteKeyMaterial(std::make_pair(DBKeys::WALLETDESCRIPTORCKEY, std::make_pair(desc_id, pubkey)), secret, false)) {
         return false;
     }
     EraseIC(std::make_pair(DBKeys::WALLETDESCRIPTORKEY, std::make_pair(desc_id, pubkey)));
@@ -241,7 +244,7 @@ bool WalletBatch::WriteCryptedDescriptorKey(const uint256& desc_id, const CPubKe
 
 bool WalletBatch::WriteDescriptor(const uint256& desc_id, const WalletDescriptor& descriptor)
 {
-    return WriteIC(make_pair(DBKeys::WALLETDESCRIPTOR, desc_id), descriptor);
+    return WriteKeyMaterial(make_pair(DBKeys::WALLETDESCRIPTOR, desc_id), descriptor);
 }
 
 bool WalletBatch::WriteDescriptorDerivedCache(const CExtPubKey& xpub, const uint256& desc_id, uint32_t key_exp_index, uint32_t der_index)
@@ -778,6 +781,147 @@ bool WalletBatch::IsKeyType(const std::string& strType)
             strType == DBKeys::MASTER_KEY || strType == DBKeys::CRYPTED_KEY);
 }
 
+/** Below this many transaction records per thread, LoadTxRecords does not start more threads. */
+static constexpr size_t MIN_TX_RECORDS_PER_THREAD{1000};
+static constexpr int MAX_LOAD_THREADS{8};
+
+/**
+ * Load all transaction records. They are read in key order with a prefix
+ * cursor, deserialized on several threads and then added to the wallet in
+ * one pass, which ReadKeyValue would otherwise do one record at a time.
+ */
+static DBErrors LoadTxRecords(CWallet* pwallet, DatabaseBatch& batch, CWalletScanState& wss, bool& rescan_required, bool& noncritical_errors) EXCLUSIVE_LOCKS_REQUIRED(pwallet->cs_wallet)
+{
+    struct TxRecord {
+        DataStream key;
+        CDataStream value{SER_DISK, CLIENT_VERSION};
+        uint256 hash;
+        std::unique_ptr<CWalletTx> wtx;
+        std::string error;
+    };
+    std::vector<TxRecord> records;
+
+    DataStream prefix;
+    prefix << DBKeys::TX;
+    std::unique_ptr<DatabaseCursor> cursor{batch.GetNewPrefixCursor(prefix)};
+    if (!cursor) {
+        pwallet->WalletLogPrintf("Error getting wallet database cursor\n");
+        return DBErrors::CORRUPT;
+    }
+    while (true) {
+        TxRecord& record{records.emplace_back()};
+        const DatabaseCursor::Status status{cursor->Next(record.key, record.value)};
+        if (status == DatabaseCursor::Status::DONE) {
+            records.pop_back();
+            break;
+        } else if (status == DatabaseCursor::Status::FAIL) {
+            pwallet->WalletLogPrintf("Error reading next record from wallet database\n");
+            return DBErrors::CORRUPT;
+        }
+    }
+    cursor.reset();
+
+    std::atomic<size_t> next{0};
+    auto deserialize = [&] {
+        for (size_t i = next++; i < records.size(); i = next++) {
+            TxRecord& record{records[i]};
+            try {
+                std::string type;
+                record.key >> type >> record.hash;
+                record.wtx = std::make_unique<CWalletTx>(nullptr, TxStateInactive{});
+                record.value >> *record.wtx;
+            } catch (const std::exception& e) {
+                record.wtx.reset();
+                record.error = e.what();
+            }
+        }
+    };
+    const int threads{static_cast<int>(std::min<size_t>({records.size() / MIN_TX_RECORDS_PER_THREAD, size_t(GetNumCores()), MAX_LOAD_THREADS}))};
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(&util::TraceThread, "walletload", deserialize);
+    }
+    deserialize();
+    for (std::thread& worker : workers) worker.join();
+
+    DBErrors result{DBErrors::LOAD_OK};
+    pwallet->mapWallet.reserve(pwallet->mapWallet.size() + records.size());
+    for (TxRecord& record : records) {
+        std::string strErr{record.error};
+        // LoadToWallet creates a new CWalletTx that fill_wtx fills with the
+        // deserialized transaction and metadata.
+        auto fill_wtx = [&](CWalletTx& wtx, bool new_tx) {
+            if (!new_tx) {
+                // There's some corruption here since the tx we just tried to load was already in the wallet.
+                // We don't consider this type of corruption critical, and can fix it by removing tx data and
+                // rescanning.
+                wss.tx_corrupt = true;
+                return false;
+            }
+            // The fields set by CWalletTx::Unserialize
+            CWalletTx& loaded{*record.wtx};
+            wtx.SetTx(loaded.tx);
+            wtx.mapValue = std::move(loaded.mapValue);
+            wtx.vOrderForm = std::move(loaded.vOrderForm);
+            wtx.fTimeReceivedIsTxTime = loaded.fTimeReceivedIsTxTime;
+            wtx.nTimeReceived = loaded.nTimeReceived;
+            wtx.fFromMe = loaded.fFromMe;
+            wtx.m_state = loaded.m_state;
+            wtx.nOrderPos = loaded.nOrderPos;
+            wtx.nTimeSmart = loaded.nTimeSmart;
+            if (wtx.GetHash() != record.hash)
+                return false;
+
+            // Undo serialize changes in 31600
+            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+            {
+                if (!record.value.empty())
+                {
+                    uint8_t fTmp;
+                    uint8_t fUnused;
+                    std::string unused_string;
+                    record.value >> fTmp >> fUnused >> unused_string;
+                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d %s",
+                                       wtx.fTimeReceivedIsTxTime, fTmp, record.hash.ToString());
+                    wtx.fTimeReceivedIsTxTime = fTmp;
+                }
+                else
+                {
+                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, record.hash.ToString());
+                    wtx.fTimeReceivedIsTxTime = 0;
+                }
+                wss.vWalletUpgrade.push_back(record.hash);
+            }
+
+            if (wtx.nOrderPos == -1)
+                wss.fAnyUnordered = true;
+
+            return true;
+        };
+        bool loaded{false};
+        try {
+            loaded = record.wtx && pwallet->LoadToWallet(record.hash, fill_wtx);
+        } catch (const std::exception& e) {
+            if (strErr.empty()) strErr = e.what();
+        }
+        if (!loaded) {
+            if (wss.tx_corrupt) {
+                pwallet->WalletLogPrintf("Error: Corrupt transaction found. This can be fixed by removing transactions from wallet and rescanning.\n");
+                // Set tx_corrupt back to false so that the error is only printed once (per corrupt tx)
+                wss.tx_corrupt = false;
+                result = DBErrors::CORRUPT;
+            } else {
+                // Rescan if there is a bad transaction record
+                noncritical_errors = true;
+                rescan_required = true;
+            }
+        }
+        if (!strErr.empty())
+            pwallet->WalletLogPrintf("%s\n", strErr);
+    }
+    return result;
+}
+
 DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
 {
     CWalletScanState wss;
@@ -824,6 +968,9 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
             pwallet->WalletLogPrintf("Error getting wallet database cursor\n");
             return DBErrors::CORRUPT;
         }
+        // Transaction records are loaded in bulk by LoadTxRecords below
+        DataStream tx_prefix;
+        tx_prefix << DBKeys::TX;
 
         while (true)
         {
@@ -839,6 +986,8 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
                 return DBErrors::CORRUPT;
             }
 
+            if (ssKey.size() >= tx_prefix.size() && std::equal(tx_prefix.begin(), tx_prefix.end(), ssKey.begin())) continue;
+
             // Try to be tolerant of single corrupt records:
             std::string strType, strErr;
             if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
@@ -879,6 +1028,10 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
             if (!strErr.empty())
                 pwallet->WalletLogPrintf("%s\n", strErr);
         }
+        cursor.reset();
+
+        const DBErrors tx_result{LoadTxRecords(pwallet, *m_batch, wss, rescan_required, fNoncriticalErrors)};
+        if (tx_result != DBErrors::LOAD_OK) result = tx_result;
     } catch (...) {
         result = DBErrors::CORRUPT;
     }
@@ -1101,7 +1254,7 @@ bool WalletBatch::EraseDestData(const std::string &address, const std::string &k
 
 bool WalletBatch::WriteHDChain(const CHDChain& chain)
 {
-    return WriteIC(DBKeys::HDCHAIN, chain);
+    return WriteKeyMaterial(DBKeys::HDCHAIN, chain);
 }
 
 bool WalletBatch::WriteWalletFlags(const uint64_t flags)
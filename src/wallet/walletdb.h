@@ -202,6 +202,18 @@ private:
         return true;
     }
 
+    /** WriteIC() for keys, descriptors and seeds, which are lost for good if a
+     * crash rolls them back */
+    template <typename K, typename T>
+    bool WriteKeyMaterial(const K& key, const T& value, bool fOverwrite = true)
+    {
+        if (!WriteIC(key, value, fOverwrite)) {
+            return false;
+        }
+        m_database.MakeDurable();
+        return true;
+    }
+
     template <typename K>
     bool EraseIC(const K& key)
     {
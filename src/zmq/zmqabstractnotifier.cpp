@@ -18,7 +18,7 @@ bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/)
     return true;
 }
 
-bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/)
+bool CZMQAbstractNotifier::NotifyTransaction(const CTransactionRef &/*transaction*/)
 {
     return true;
 }
@@ -33,12 +33,17 @@ bool CZMQAbstractNotifier::NotifyBlockDisconnect(const CBlockIndex * /*CBlockInd
     return true;
 }
 
-bool CZMQAbstractNotifier::NotifyTransactionAcceptance(const CTransaction &/*transaction*/, uint64_t mempool_sequence)
+bool CZMQAbstractNotifier::NotifyTransactionAcceptance(const CTransactionRef &/*transaction*/, uint64_t mempool_sequence)
 {
     return true;
 }
 
-bool CZMQAbstractNotifier::NotifyTransactionRemoval(const CTransaction &/*transaction*/, uint64_t mempool_sequence)
+bool CZMQAbstractNotifier::NotifyTransactionRemoval(const CTransactionRef &/*transaction*/, uint64_t mempool_sequence)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyMempoolSnapshot(const uint256 &/*best_block_hash*/, uint64_t /*mempool_sequence*/, const std::vector<uint256> &/*txids*/)
 {
     return true;
 }
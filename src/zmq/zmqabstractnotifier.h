@@ -5,16 +5,29 @@
 #ifndef BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
 #define BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
 
+#include <primitives/transaction.h>
+
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 class CBlockIndex;
-class CTransaction;
 class CZMQAbstractNotifier;
+class CZMQPublisher;
+class uint256;
 
 using CZMQNotifierFactory = std::unique_ptr<CZMQAbstractNotifier> (*)();
 
+/** Message counters of a notifier */
+struct CZMQNotifierStats {
+    std::atomic<uint64_t> queued{0};  //!< waiting to be sent by the publisher thread
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> dropped{0}; //!< not queued because the send queue was full
+    std::atomic<uint64_t> failed{0};  //!< could not be built or handed to zmq
+};
+
 class CZMQAbstractNotifier
 {
 public:
@@ -40,6 +53,9 @@ public:
         }
     }
 
+    const CZMQNotifierStats& GetStats() const { return stats; }
+    void SetPublisher(CZMQPublisher* p) { publisher = p; }
+
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
@@ -50,14 +66,22 @@ public:
     // Notifies of every block disconnection
     virtual bool NotifyBlockDisconnect(const CBlockIndex *pindex);
     // Notifies of every mempool acceptance
-    virtual bool NotifyTransactionAcceptance(const CTransaction &transaction, uint64_t mempool_sequence);
+    virtual bool NotifyTransactionAcceptance(const CTransactionRef &transaction, uint64_t mempool_sequence);
     // Notifies of every mempool removal, except inclusion in blocks
-    virtual bool NotifyTransactionRemoval(const CTransaction &transaction, uint64_t mempool_sequence);
+    virtual bool NotifyTransactionRemoval(const CTransactionRef &transaction, uint64_t mempool_sequence);
     // Notifies of transactions added to mempool or appearing in blocks
-    virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyTransaction(const CTransactionRef &transaction);
+    // Notifies of the contents of the mempool, as of the given mempool sequence number
+    virtual bool NotifyMempoolSnapshot(const uint256 &best_block_hash, uint64_t mempool_sequence, const std::vector<uint256> &txids);
 
 protected:
+    friend class CZMQPublisher;
+
     void* psocket{nullptr};
+    CZMQPublisher* publisher{nullptr};
+    CZMQNotifierStats stats;
+    //! Set by the publisher thread once a message could not be sent, after which the notifier is removed
+    std::atomic<bool> send_failed{false};
     std::string type;
     std::string address;
     int outbound_message_high_water_mark; // aka SNDHWM
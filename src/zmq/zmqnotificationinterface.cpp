@@ -15,6 +15,7 @@
 
 #include <zmq.h>
 
+#include <algorithm>
 #include <cassert>
 #include <map>
 #include <string>
@@ -66,6 +67,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     {
         std::unique_ptr<CZMQNotificationInterface> notificationInterface(new CZMQNotificationInterface());
         notificationInterface->notifiers = std::move(notifiers);
+        notificationInterface->queue_size = static_cast<size_t>(std::max<int64_t>(0, gArgs.GetIntArg("-zmqqueuesize", DEFAULT_ZMQ_QUEUE_SIZE)));
 
         if (notificationInterface->Initialize()) {
             return notificationInterface.release();
@@ -93,7 +95,10 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    publisher = std::make_unique<CZMQPublisher>(queue_size);
+
     for (auto& notifier : notifiers) {
+        notifier->SetPublisher(publisher.get());
         if (notifier->Initialize(pcontext)) {
             LogPrint(BCLog::ZMQ, "Notifier %s ready (address = %s)\n", notifier->GetType(), notifier->GetAddress());
         } else {
@@ -102,6 +107,9 @@ bool CZMQNotificationInterface::Initialize()
         }
     }
 
+    // The sockets are only used by the publisher thread from now on
+    publisher->Start();
+
     return true;
 }
 
@@ -111,6 +119,8 @@ void CZMQNotificationInterface::Shutdown()
     LogPrint(BCLog::ZMQ, "Shutdown notification interface\n");
     if (pcontext)
     {
+        // Send what is still queued before the sockets are closed
+        if (publisher) publisher->Stop();
         for (auto& notifier : notifiers) {
             LogPrint(BCLog::ZMQ, "Shutdown notifier %s at %s\n", notifier->GetType(), notifier->GetAddress());
             notifier->Shutdown();
@@ -124,13 +134,15 @@ void CZMQNotificationInterface::Shutdown()
 namespace {
 
 template <typename Function>
-void TryForEachAndRemoveFailed(std::list<std::unique_ptr<CZMQAbstractNotifier>>& notifiers, const Function& func)
+void TryForEachAndRemoveFailed(CZMQPublisher& publisher, std::list<std::unique_ptr<CZMQAbstractNotifier>>& notifiers, const Function& func)
 {
     for (auto i = notifiers.begin(); i != notifiers.end(); ) {
         CZMQAbstractNotifier* notifier = i->get();
         if (func(notifier)) {
             ++i;
         } else {
+            LogPrint(BCLog::ZMQ, "Removing notifier %s at %s after a failed send\n", notifier->GetType(), notifier->GetAddress());
+            publisher.Remove(notifier);
             notifier->Shutdown();
             i = notifiers.erase(i);
         }
@@ -144,41 +156,43 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, co
     if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
         return;
 
-    TryForEachAndRemoveFailed(notifiers, [pindexNew](CZMQAbstractNotifier* notifier) {
+    TryForEachAndRemoveFailed(*publisher, notifiers, [pindexNew](CZMQAbstractNotifier* notifier) {
         return notifier->NotifyBlock(pindexNew);
     });
 }
 
 void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx, uint64_t mempool_sequence)
 {
-    const CTransaction& tx = *ptx;
-
-    TryForEachAndRemoveFailed(notifiers, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
-        return notifier->NotifyTransaction(tx) && notifier->NotifyTransactionAcceptance(tx, mempool_sequence);
+    TryForEachAndRemoveFailed(*publisher, notifiers, [&ptx, mempool_sequence](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyTransaction(ptx) && notifier->NotifyTransactionAcceptance(ptx, mempool_sequence);
     });
 }
 
 void CZMQNotificationInterface::TransactionRemovedFromMempool(const CTransactionRef& ptx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
 {
     // Called for all non-block inclusion reasons
-    const CTransaction& tx = *ptx;
+    TryForEachAndRemoveFailed(*publisher, notifiers, [&ptx, mempool_sequence](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyTransactionRemoval(ptx, mempool_sequence);
+    });
+}
 
-    TryForEachAndRemoveFailed(notifiers, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
-        return notifier->NotifyTransactionRemoval(tx, mempool_sequence);
+void CZMQNotificationInterface::PublishMempoolSnapshot(const uint256& best_block_hash, uint64_t mempool_sequence, const std::vector<uint256>& txids)
+{
+    TryForEachAndRemoveFailed(*publisher, notifiers, [&](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyMempoolSnapshot(best_block_hash, mempool_sequence, txids);
     });
 }
 
 void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected)
 {
     for (const CTransactionRef& ptx : pblock->vtx) {
-        const CTransaction& tx = *ptx;
-        TryForEachAndRemoveFailed(notifiers, [&tx](CZMQAbstractNotifier* notifier) {
-            return notifier->NotifyTransaction(tx);
+        TryForEachAndRemoveFailed(*publisher, notifiers, [&ptx](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyTransaction(ptx);
         });
     }
 
     // Next we notify BlockConnect listeners for *all* blocks
-    TryForEachAndRemoveFailed(notifiers, [pindexConnected](CZMQAbstractNotifier* notifier) {
+    TryForEachAndRemoveFailed(*publisher, notifiers, [pindexConnected](CZMQAbstractNotifier* notifier) {
         return notifier->NotifyBlockConnect(pindexConnected);
     });
 }
@@ -186,14 +200,13 @@ void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBloc
 void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected)
 {
     for (const CTransactionRef& ptx : pblock->vtx) {
-        const CTransaction& tx = *ptx;
-        TryForEachAndRemoveFailed(notifiers, [&tx](CZMQAbstractNotifier* notifier) {
-            return notifier->NotifyTransaction(tx);
+        TryForEachAndRemoveFailed(*publisher, notifiers, [&ptx](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyTransaction(ptx);
         });
     }
 
     // Next we notify BlockDisconnect listeners for *all* blocks
-    TryForEachAndRemoveFailed(notifiers, [pindexDisconnected](CZMQAbstractNotifier* notifier) {
+    TryForEachAndRemoveFailed(*publisher, notifiers, [pindexDisconnected](CZMQAbstractNotifier* notifier) {
         return notifier->NotifyBlockDisconnect(pindexDisconnected);
     });
 }
@@ -8,13 +8,20 @@
 #include <primitives/transaction.h>
 #include <validationinterface.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <vector>
 
 class CBlock;
 class CBlockIndex;
 class CZMQAbstractNotifier;
+class CZMQPublisher;
+class uint256;
+
+/** Default for -zmqqueuesize, the number of messages waiting to be sent after which transaction notifications are dropped */
+static constexpr int DEFAULT_ZMQ_QUEUE_SIZE{100000};
 
 class CZMQNotificationInterface final : public CValidationInterface
 {
@@ -25,6 +32,9 @@ public:
 
     static CZMQNotificationInterface* Create();
 
+    /** Publish the txids of the mempool as of mempool_sequence to the sequence notifiers. */
+    void PublishMempoolSnapshot(const uint256& best_block_hash, uint64_t mempool_sequence, const std::vector<uint256>& txids);
+
 protected:
     bool Initialize();
     void Shutdown();
@@ -35,11 +45,14 @@ protected:
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    std::string GetSubscriberName() const override { return "zmq"; }
 
 private:
     CZMQNotificationInterface();
 
     void* pcontext{nullptr};
+    size_t queue_size{DEFAULT_ZMQ_QUEUE_SIZE};
+    std::unique_ptr<CZMQPublisher> publisher;
     std::list<std::unique_ptr<CZMQAbstractNotifier>> notifiers;
 };
 
@@ -19,13 +19,13 @@
 #include <streams.h>
 #include <sync.h>
 #include <uint256.h>
+#include <util/thread.h>
 #include <version.h>
 #include <zmq/zmqutil.h>
 
 #include <zmq.h>
 
 #include <cassert>
-#include <cstdarg>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -49,47 +49,150 @@ static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_SEQUENCE  = "sequence";
 
-// Internal function to send multipart message
-static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
+static void zmq_free_body(void* /*data*/, void* hint)
 {
-    va_list args;
-    va_start(args, size);
+    delete static_cast<std::vector<unsigned char>*>(hint);
+}
 
-    while (1)
-    {
-        zmq_msg_t msg;
+// Internal function to send one part of a multipart message
+static int zmq_send_part(void *sock, const void* data, size_t size, bool more)
+{
+    if (zmq_send(sock, data, size, more ? ZMQ_SNDMORE : 0) == -1) {
+        zmqError("Unable to send ZMQ msg");
+        return -1;
+    }
+    return 0;
+}
 
-        int rc = zmq_msg_init_size(&msg, size);
-        if (rc != 0)
-        {
+// Internal function to send a multipart message of command, body and sequence
+// number. The body is handed over to zmq without copying it.
+static int zmq_send_multipart(void *sock, const char *command, std::vector<unsigned char>&& body, const unsigned char (&msgseq)[sizeof(uint32_t)])
+{
+    if (zmq_send_part(sock, command, strlen(command), /*more=*/true) != 0) return -1;
+
+    if (body.empty()) {
+        if (zmq_send_part(sock, nullptr, 0, /*more=*/true) != 0) return -1;
+    } else {
+        auto owned_body = new std::vector<unsigned char>(std::move(body));
+        zmq_msg_t msg;
+        if (zmq_msg_init_data(&msg, owned_body->data(), owned_body->size(), zmq_free_body, owned_body) != 0) {
             zmqError("Unable to initialize ZMQ msg");
-            va_end(args);
+            delete owned_body;
             return -1;
         }
-
-        void *buf = zmq_msg_data(&msg);
-        memcpy(buf, data, size);
-
-        data = va_arg(args, const void*);
-
-        rc = zmq_msg_send(&msg, sock, data ? ZMQ_SNDMORE : 0);
-        if (rc == -1)
-        {
+        if (zmq_msg_send(&msg, sock, ZMQ_SNDMORE) == -1) {
             zmqError("Unable to send ZMQ msg");
             zmq_msg_close(&msg);
-            va_end(args);
             return -1;
         }
+    }
 
-        zmq_msg_close(&msg);
+    return zmq_send_part(sock, msgseq, sizeof(msgseq), /*more=*/false);
+}
 
-        if (!data)
-            break;
+CZMQPublisher::CZMQPublisher(size_t max_queued) : m_max_queued(max_queued) {}
 
-        size = va_arg(args, size_t);
+CZMQPublisher::~CZMQPublisher()
+{
+    Stop();
+}
+
+void CZMQPublisher::Start()
+{
+    m_thread = std::thread(&util::TraceThread, "zmqpub", [this] { ThreadPublish(); });
+}
+
+void CZMQPublisher::Stop()
+{
+    {
+        LOCK(m_mutex);
+        m_running = false;
+        m_cond.notify_all();
     }
-    va_end(args);
-    return 0;
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool CZMQPublisher::Enqueue(Message&& msg, bool droppable)
+{
+    CZMQNotifierStats& stats = msg.notifier->stats;
+    LOCK(m_mutex);
+    if (droppable && m_queue.size() >= m_max_queued) {
+        if (!m_dropping) {
+            LogPrintf("ZMQ send queue full (%u messages), dropping transaction notifications\n", m_queue.size());
+            m_dropping = true;
+        }
+        ++stats.dropped;
+        return false;
+    }
+    if (m_dropping && m_queue.size() < m_max_queued / 2) {
+        LogPrintf("ZMQ send queue has room again, no longer dropping notifications\n");
+        m_dropping = false;
+    }
+    ++stats.queued;
+    m_queue.push_back(std::move(msg));
+    m_cond.notify_all();
+    return true;
+}
+
+void CZMQPublisher::Remove(const CZMQAbstractNotifier* notifier)
+{
+    WAIT_LOCK(m_mutex, lock);
+    for (auto it = m_queue.begin(); it != m_queue.end();) {
+        if (it->notifier == notifier) {
+            --it->notifier->stats.queued;
+            it = m_queue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return !m_sending; });
+}
+
+void CZMQPublisher::ThreadPublish()
+{
+    std::deque<Message> batch;
+    while (true) {
+        {
+            WAIT_LOCK(m_mutex, lock);
+            if (m_sending) {
+                m_sending = false;
+                m_cond.notify_all();
+            }
+            while (m_running && m_queue.empty()) {
+                m_cond.wait(lock);
+            }
+            // Messages queued before shutdown are still sent
+            if (m_queue.empty()) break;
+            batch.swap(m_queue);
+            m_sending = true;
+        }
+        for (Message& msg : batch) {
+            Send(msg);
+        }
+        batch.clear();
+    }
+}
+
+void CZMQPublisher::Send(Message& msg)
+{
+    CZMQAbstractPublishNotifier& notifier = *msg.notifier;
+    --notifier.stats.queued;
+    // Once a send failed, the notifier is about to be removed
+    if (notifier.send_failed || (msg.make_body && !msg.make_body(msg.body))) {
+        ++notifier.stats.failed;
+        notifier.send_failed = true;
+        return;
+    }
+
+    /* send three parts, command & data & a LE 4byte sequence number */
+    unsigned char msgseq[sizeof(uint32_t)];
+    WriteLE32(msgseq, msg.sequence);
+    if (zmq_send_multipart(notifier.psocket, msg.command, std::move(msg.body), msgseq) != 0) {
+        ++notifier.stats.failed;
+        notifier.send_failed = true;
+        return;
+    }
+    ++notifier.stats.sent;
 }
 
 static bool IsZMQAddressIPV6(const std::string &zmq_address)
@@ -204,20 +307,23 @@ void CZMQAbstractPublishNotifier::Shutdown()
     psocket = nullptr;
 }
 
-bool CZMQAbstractPublishNotifier::SendZmqMessage(const char *command, const void* data, size_t size)
+bool CZMQAbstractPublishNotifier::SendZmqMessage(const char *command, const void* data, size_t size, bool droppable)
 {
-    assert(psocket);
+    assert(psocket && publisher);
+    if (send_failed) return false;
 
-    /* send three parts, command & data & a LE 4byte sequence number */
-    unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(msgseq, nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), nullptr);
-    if (rc == -1)
-        return false;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    /* a dropped message uses up its sequence number as well, so subscribers notice it is missing */
+    publisher->Enqueue({this, command, std::vector<unsigned char>(bytes, bytes + size), {}, nSequence++}, droppable);
+    return true;
+}
 
-    /* increment memory only sequence number after sending */
-    nSequence++;
+bool CZMQAbstractPublishNotifier::QueueZmqMessage(const char *command, std::function<bool(std::vector<unsigned char>&)> make_body, bool droppable)
+{
+    assert(psocket && publisher);
+    if (send_failed) return false;
 
+    publisher->Enqueue({this, command, {}, std::move(make_body), nSequence++}, droppable);
     return true;
 }
 
@@ -229,12 +335,12 @@ bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     for (unsigned int i = 0; i < 32; i++) {
         data[31 - i] = hash.begin()[i];
     }
-    return SendZmqMessage(MSG_HASHBLOCK, data, 32);
+    return SendZmqMessage(MSG_HASHBLOCK, data, 32, /*droppable=*/false);
 }
 
-bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransactionRef &transaction)
 {
-    uint256 hash = transaction.GetHash();
+    uint256 hash = transaction->GetHash();
     LogPrint(BCLog::ZMQ, "Publish hashtx %s to %s\n", hash.GetHex(), this->address);
     uint8_t data[32];
     for (unsigned int i = 0; i < 32; i++) {
@@ -247,30 +353,31 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint(BCLog::ZMQ, "Publish rawblock %s to %s\n", pindex->GetBlockHash().GetHex(), this->address);
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    CBlock block;
-    if (!ReadBlockFromDisk(block, pindex, consensusParams)) {
-        zmqError("Can't read block from disk");
-        return false;
-    }
-
-    ss << block;
-
-    return SendZmqMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    // Reading the block from disk is left to the publisher thread
+    return QueueZmqMessage(MSG_RAWBLOCK, [pindex](std::vector<unsigned char>& body) {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensusParams)) {
+            zmqError("Can't read block from disk");
+            return false;
+        }
+        CVectorWriter{SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), body, 0} << block;
+        return true;
+    }, /*droppable=*/false);
 }
 
-bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransactionRef &transaction)
 {
-    uint256 hash = transaction.GetHash();
-    LogPrint(BCLog::ZMQ, "Publish rawtx %s to %s\n", hash.GetHex(), this->address);
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    ss << transaction;
-    return SendZmqMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    LogPrint(BCLog::ZMQ, "Publish rawtx %s to %s\n", transaction->GetHash().GetHex(), this->address);
+    return QueueZmqMessage(MSG_RAWTX, [transaction](std::vector<unsigned char>& body) {
+        CVectorWriter{SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), body, 0} << *transaction;
+        return true;
+    }, /*droppable=*/true);
 }
 
 // Helper function to send a 'sequence' topic message with the following structure:
 //    <32-byte hash> | <1-byte label> | <8-byte LE sequence> (optional)
+// Only mempool acceptance and removal messages may be dropped when the send queue is full.
 static bool SendSequenceMsg(CZMQAbstractPublishNotifier& notifier, uint256 hash, char label, std::optional<uint64_t> sequence = {})
 {
     unsigned char data[sizeof(hash) + sizeof(label) + sizeof(uint64_t)];
@@ -279,7 +386,8 @@ static bool SendSequenceMsg(CZMQAbstractPublishNotifier& notifier, uint256 hash,
     }
     data[sizeof(hash)] = label;
     if (sequence) WriteLE64(data + sizeof(hash) + sizeof(label), *sequence);
-    return notifier.SendZmqMessage(MSG_SEQUENCE, data, sequence ? sizeof(data) : sizeof(hash) + sizeof(label));
+    const bool droppable{label == 'A' || label == 'R'};
+    return notifier.SendZmqMessage(MSG_SEQUENCE, data, sequence ? sizeof(data) : sizeof(hash) + sizeof(label), droppable);
 }
 
 bool CZMQPublishSequenceNotifier::NotifyBlockConnect(const CBlockIndex *pindex)
@@ -296,16 +404,26 @@ bool CZMQPublishSequenceNotifier::NotifyBlockDisconnect(const CBlockIndex *pinde
     return SendSequenceMsg(*this, hash, /* Block (D)isconnect */ 'D');
 }
 
-bool CZMQPublishSequenceNotifier::NotifyTransactionAcceptance(const CTransaction &transaction, uint64_t mempool_sequence)
+bool CZMQPublishSequenceNotifier::NotifyTransactionAcceptance(const CTransactionRef &transaction, uint64_t mempool_sequence)
 {
-    uint256 hash = transaction.GetHash();
+    uint256 hash = transaction->GetHash();
     LogPrint(BCLog::ZMQ, "Publish hashtx mempool acceptance %s to %s\n", hash.GetHex(), this->address);
     return SendSequenceMsg(*this, hash, /* Mempool (A)cceptance */ 'A', mempool_sequence);
 }
 
-bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransaction &transaction, uint64_t mempool_sequence)
+bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransactionRef &transaction, uint64_t mempool_sequence)
 {
-    uint256 hash = transaction.GetHash();
+    uint256 hash = transaction->GetHash();
     LogPrint(BCLog::ZMQ, "Publish hashtx mempool removal %s to %s\n", hash.GetHex(), this->address);
     return SendSequenceMsg(*this, hash, /* Mempool (R)emoval */ 'R', mempool_sequence);
 }
+
+bool CZMQPublishSequenceNotifier::NotifyMempoolSnapshot(const uint256 &best_block_hash, uint64_t mempool_sequence, const std::vector<uint256> &txids)
+{
+    LogPrint(BCLog::ZMQ, "Publish mempool snapshot of %u transactions at mempool sequence %u to %s\n", txids.size(), mempool_sequence, this->address);
+    SendSequenceMsg(*this, best_block_hash, /* (S)napshot start */ 'S', mempool_sequence);
+    for (const uint256& txid : txids) {
+        SendSequenceMsg(*this, txid, /* (M)empool transaction */ 'M', mempool_sequence);
+    }
+    return SendSequenceMsg(*this, best_block_hash, /* Snapshot (E)nd */ 'E', mempool_sequence);
+}
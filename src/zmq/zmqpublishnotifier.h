@@ -5,28 +5,94 @@
 #ifndef BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 #define BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 
+#include <sync.h>
 #include <zmq/zmqabstractnotifier.h>
 
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
 
 class CBlockIndex;
-class CTransaction;
+class CZMQAbstractPublishNotifier;
+
+/**
+ * Sends the messages of all publish notifiers from a dedicated thread, so
+ * that validation interface callbacks only have to queue them. Messages are
+ * sent in the order they were queued. The thread takes everything queued
+ * since its previous round at once and sends it without holding the lock.
+ *
+ * Once the queue holds max_queued messages, messages that may be dropped
+ * (transaction notifications) are discarded and counted. Block notifications
+ * and mempool snapshots are always queued. Dropped messages still use up a
+ * sequence number, so subscribers can detect the gap.
+ */
+class CZMQPublisher
+{
+public:
+    struct Message {
+        CZMQAbstractPublishNotifier* notifier;
+        const char* command;
+        std::vector<unsigned char> body;
+        //! If set, builds the body on the publisher thread, for messages that are expensive to produce
+        std::function<bool(std::vector<unsigned char>&)> make_body;
+        uint32_t sequence;
+    };
+
+    explicit CZMQPublisher(size_t max_queued);
+    ~CZMQPublisher();
+
+    void Start();
+    /** Send the messages still queued and stop the publisher thread. */
+    void Stop();
+
+    /** Queue a message. Returns false if it was dropped because the queue is full. */
+    bool Enqueue(Message&& msg, bool droppable);
+
+    /** Discard the messages still queued for a notifier and wait until the
+     * publisher thread no longer uses it, so it can be shut down. */
+    void Remove(const CZMQAbstractNotifier* notifier);
+
+private:
+    const size_t m_max_queued;
+    Mutex m_mutex;
+    std::condition_variable m_cond GUARDED_BY(m_mutex);
+    std::deque<Message> m_queue GUARDED_BY(m_mutex);
+    bool m_running GUARDED_BY(m_mutex){true};
+    //! Whether the publisher thread is sending a batch taken from the queue
+    bool m_sending GUARDED_BY(m_mutex){false};
+    //! Whether messages are being dropped, to log only the start and the end of a burst of drops
+    bool m_dropping GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+
+    void ThreadPublish();
+    void Send(Message& msg);
+};
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
     uint32_t nSequence {0U}; //!< upcounting per message sequence number
 
+protected:
+    /* queue zmq message with a body that is produced by make_body on the
+       publisher thread */
+    bool QueueZmqMessage(const char *command, std::function<bool(std::vector<unsigned char>&)> make_body, bool droppable);
+
 public:
 
-    /* send zmq multipart message
+    /* queue zmq multipart message for the publisher thread
        parts:
           * command
           * data
           * message sequence number
+       messages are sent asynchronously, so a failed send is only reported by
+       the next message, which returns false to have the notifier removed
     */
-    bool SendZmqMessage(const char *command, const void* data, size_t size);
+    bool SendZmqMessage(const char *command, const void* data, size_t size, bool droppable = true);
 
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
@@ -41,7 +107,7 @@ public:
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction) override;
+    bool NotifyTransaction(const CTransactionRef &transaction) override;
 };
 
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
@@ -53,7 +119,7 @@ public:
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction) override;
+    bool NotifyTransaction(const CTransactionRef &transaction) override;
 };
 
 class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
@@ -61,8 +127,9 @@ class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
 public:
     bool NotifyBlockConnect(const CBlockIndex *pindex) override;
     bool NotifyBlockDisconnect(const CBlockIndex *pindex) override;
-    bool NotifyTransactionAcceptance(const CTransaction &transaction, uint64_t mempool_sequence) override;
-    bool NotifyTransactionRemoval(const CTransaction &transaction, uint64_t mempool_sequence) override;
+    bool NotifyTransactionAcceptance(const CTransactionRef &transaction, uint64_t mempool_sequence) override;
+    bool NotifyTransactionRemoval(const CTransactionRef &transaction, uint64_t mempool_sequence) override;
+    bool NotifyMempoolSnapshot(const uint256 &best_block_hash, uint64_t mempool_sequence, const std::vector<uint256> &txids) override;
 };
 
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
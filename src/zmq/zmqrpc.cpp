@@ -4,8 +4,15 @@
 
 #include <zmq/zmqrpc.h>
 
+#include <kernel/cs_main.h>
+#include <node/context.h>
 #include <rpc/server.h>
+#include <rpc/server_util.h>
 #include <rpc/util.h>
+#include <sync.h>
+#include <txmempool.h>
+#include <validation.h>
+#include <validationinterface.h>
 #include <zmq/zmqabstractnotifier.h>
 #include <zmq/zmqnotificationinterface.h>
 
@@ -13,6 +20,9 @@
 
 #include <list>
 #include <string>
+#include <vector>
+
+using node::NodeContext;
 
 class JSONRPCRequest;
 
@@ -31,6 +41,10 @@ static RPCHelpMan getzmqnotifications()
                             {RPCResult::Type::STR, "type", "Type of notification"},
                             {RPCResult::Type::STR, "address", "Address of the publisher"},
                             {RPCResult::Type::NUM, "hwm", "Outbound message high water mark"},
+                            {RPCResult::Type::NUM, "queued", "Number of messages waiting to be sent"},
+                            {RPCResult::Type::NUM, "sent", "Number of messages sent"},
+                            {RPCResult::Type::NUM, "dropped", "Number of messages dropped because the send queue was full"},
+                            {RPCResult::Type::NUM, "failed", "Number of messages that could not be built or sent"},
                         }},
                     }
                 },
@@ -47,6 +61,11 @@ static RPCHelpMan getzmqnotifications()
             obj.pushKV("type", n->GetType());
             obj.pushKV("address", n->GetAddress());
             obj.pushKV("hwm", n->GetOutboundMessageHighWaterMark());
+            const CZMQNotifierStats& stats = n->GetStats();
+            obj.pushKV("queued", stats.queued.load());
+            obj.pushKV("sent", stats.sent.load());
+            obj.pushKV("dropped", stats.dropped.load());
+            obj.pushKV("failed", stats.failed.load());
             result.push_back(obj);
         }
     }
@@ -56,8 +75,70 @@ static RPCHelpMan getzmqnotifications()
     };
 }
 
+static RPCHelpMan publishmempoolsnapshot()
+{
+    return RPCHelpMan{"publishmempoolsnapshot",
+                "\nPublishes the txids of all mempool transactions on the ZeroMQ \"sequence\" topic.\n"
+                "The snapshot is placed in the stream of sequence notifications exactly at the point it was taken,\n"
+                "so a subscriber can build its view of the mempool from it and keep that view up to date by\n"
+                "applying all notifications that follow it.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::STR_HEX, "bestblock", "The hash of the chain tip the snapshot belongs to"},
+                        {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence number of the snapshot, the first one a later mempool change is notified with"},
+                        {RPCResult::Type::NUM, "size", "The number of transactions in the snapshot"},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("publishmempoolsnapshot", "")
+            + HelpExampleRpc("publishmempoolsnapshot", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    bool have_sequence_notifier{false};
+    if (g_zmq_notification_interface != nullptr) {
+        for (const auto* n : g_zmq_notification_interface->GetActiveNotifiers()) {
+            have_sequence_notifier |= n->GetType() == "pubsequence";
+        }
+    }
+    if (!have_sequence_notifier) {
+        throw JSONRPCError(RPC_MISC_ERROR, "No -zmqpubsequence notification is active");
+    }
+
+    const NodeContext& node = EnsureAnyNodeContext(request.context);
+    ChainstateManager& chainman = EnsureChainman(node);
+    const CTxMemPool& mempool = EnsureMemPool(node);
+
+    UniValue result(UniValue::VOBJ);
+    {
+        // Mempool and chain notifications are queued while these locks are
+        // held, so queuing the snapshot under them as well puts it right
+        // between the notifications of earlier and of later changes.
+        LOCK2(cs_main, mempool.cs);
+        const uint256 best_block_hash{chainman.ActiveChain().Tip()->GetBlockHash()};
+        const uint64_t mempool_sequence{mempool.GetSequence()};
+        std::vector<uint256> txids;
+        mempool.queryHashes(txids);
+        result.pushKV("bestblock", best_block_hash.GetHex());
+        result.pushKV("mempool_sequence", mempool_sequence);
+        result.pushKV("size", (uint64_t)txids.size());
+        CallFunctionInValidationInterfaceQueue(*g_zmq_notification_interface, [best_block_hash, mempool_sequence, txids = std::move(txids)] {
+            if (g_zmq_notification_interface != nullptr) {
+                g_zmq_notification_interface->PublishMempoolSnapshot(best_block_hash, mempool_sequence, txids);
+            }
+        });
+    }
+
+    return result;
+},
+    };
+}
+
 const CRPCCommand commands[]{
     {"zmq", &getzmqnotifications},
+    {"zmq", &publishmempoolsnapshot},
 };
 
 } // anonymous namespace
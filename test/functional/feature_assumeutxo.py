@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The Bitcoin Core developers
+# Copyright (c) 2026 The Peercoin developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test loading UTXO snapshots that carry the stake state.
+
+The snapshots are dumped from a chain that only depends on the mocked time. The
+one loaded is at the height of the regtest assumeutxo data for this chain. The
+time is past the switch to the BIPs of Bitcoin 0.16, so the proof-of-work blocks
+need no block signature:
+
+- a snapshot with a tampered stake state is refused
+- a node loads the snapshot, syncs the blocks after its base from its peer and
+  validates the blocks before it in the background
+- the stake state of the loaded blocks matches the node that validated them
+"""
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+)
+
+from pathlib import Path
+
+START_HEIGHT = 110
+SNAPSHOT_BASE_HEIGHT = 200
+FINAL_HEIGHT = 210
+# Tue 14 Nov 2023 22:13:20 UTC
+MOCKTIME = 1700000000
+
+# Size of the SnapshotMetadata fields before the stake blocks: base block hash
+# and coin count, followed by the one byte count of the stake blocks
+STAKE_BLOCKS_OFFSET = 32 + 8 + 1
+# Offset of the stake modifier in a serialized stake block: block hash, flags
+STAKE_MODIFIER_OFFSET = 32 + 4
+
+
+class AssumeutxoTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        # The snapshot is written from and loaded into the transaction index
+        self.extra_args = [["-txindex", "-minting=0"]] * self.num_nodes
+
+    def setup_network(self):
+        # The nodes are connected once the snapshot is loaded
+        self.setup_nodes()
+
+    def stake_state(self, node, height):
+        header = node.getblockheader(node.getblockhash(height))
+        return {key: header[key] for key in ["flags", "modifier", "proofhash", "mint", "moneysupply"] if key in header}
+
+    def run_test(self):
+        n0, n1 = self.nodes
+        for node in self.nodes:
+            node.setmocktime(MOCKTIME)
+
+        self.log.info(f"Dump snapshots at heights {START_HEIGHT} and {SNAPSHOT_BASE_HEIGHT}")
+        self.generate(n0, START_HEIGHT, sync_fun=self.no_op)
+        out = n0.dumptxoutset('utxos_start.dat')
+        assert_equal(out['base_height'], START_HEIGHT)
+        assert_equal(out['nchaintx'], START_HEIGHT + 1)
+        assert_equal(out['txoutset_hash'], '427af7b879c7af1bab239a97bf2b73ff08de9b93ef91f4230912866d8962fbbe')
+        assert_equal(out['stake_hash'], '1545747e71505d1b0f2a70d22f049a667167eee53df951731bb10cfd51f80f65')
+
+        self.generate(n0, SNAPSHOT_BASE_HEIGHT - START_HEIGHT, sync_fun=self.no_op)
+        dump = n0.dumptxoutset('utxos.dat')
+        assert_equal(dump['base_height'], SNAPSHOT_BASE_HEIGHT)
+        assert_equal(dump['nchaintx'], SNAPSHOT_BASE_HEIGHT + 1)
+        assert_equal(dump['txoutset_hash'], '788261ee37034eede75254fc022fbdfb54e7e96260fc384dadac8846eb45f2b2')
+        assert_equal(dump['stake_hash'], '4dddf34fcf13dd045d11d9a3a6866bf34eca03ef836e74e6d83bb727fdb8bc7a')
+        snapshot_path = Path(dump['path'])
+
+        self.generate(n0, FINAL_HEIGHT - SNAPSHOT_BASE_HEIGHT, sync_fun=self.no_op)
+
+        self.log.info("The snapshot needs the headers up to its base")
+        path_n1 = Path(n1.datadir) / self.chain / 'utxos.dat'
+        path_n1.write_bytes(snapshot_path.read_bytes())
+        assert_raises_rpc_error(-1, "The base block header of the snapshot is not in the headers chain yet", n1.loadtxoutset, str(path_n1))
+        for height in range(1, SNAPSHOT_BASE_HEIGHT + 1):
+            n1.submitheader(n0.getblockheader(n0.getblockhash(height), False))
+
+        self.log.info("A snapshot with a tampered stake state is refused")
+        snapshot = bytearray(snapshot_path.read_bytes())
+        snapshot[STAKE_BLOCKS_OFFSET + STAKE_MODIFIER_OFFSET] ^= 1
+        tampered_path = Path(n1.datadir) / self.chain / 'tampered.dat'
+        tampered_path.write_bytes(snapshot)
+        with n1.assert_debug_log(expected_msgs=["[snapshot] bad snapshot stake state hash"]):
+            assert_raises_rpc_error(-32603, "Unable to load UTXO snapshot", n1.loadtxoutset, str(tampered_path))
+        assert_equal(n1.getblockcount(), 0)
+
+        self.log.info("Load the snapshot")
+        loaded = n1.loadtxoutset(str(path_n1))
+        assert_equal(loaded['coins_loaded'], dump['coins_written'])
+        assert_equal(loaded['base_height'], SNAPSHOT_BASE_HEIGHT)
+        assert_equal(loaded['tip_hash'], dump['base_hash'])
+        assert_equal(loaded['stake_blocks'], dump['stake_blocks'])
+        assert_equal(n1.getblockcount(), SNAPSHOT_BASE_HEIGHT)
+        assert_equal(self.stake_state(n1, SNAPSHOT_BASE_HEIGHT), self.stake_state(n0, SNAPSHOT_BASE_HEIGHT))
+
+        self.log.info("Sync the blocks after the base and validate the ones before it in the background")
+        with n1.wait_for_debug_log([b"[snapshot] snapshot beginning at", b"has been fully validated"], timeout=120):
+            self.connect_nodes(1, 0)
+            self.sync_blocks(timeout=120)
+        assert_equal(n1.getbestblockhash(), n0.getbestblockhash())
+        for height in [START_HEIGHT, SNAPSHOT_BASE_HEIGHT, FINAL_HEIGHT]:
+            assert_equal(self.stake_state(n1, height), self.stake_state(n0, height))
+        assert_equal(n1.gettxoutsetinfo()['hash_serialized_2'], n0.gettxoutsetinfo()['hash_serialized_2'])
+
+        self.log.info("The validated chainstate is used after a restart")
+        self.restart_node(1, extra_args=self.extra_args[1])
+        assert_equal(n1.getbestblockhash(), n0.getbestblockhash())
+        assert_equal(n1.getblockheader(n1.getblockhash(1))['height'], 1)
+
+
+if __name__ == '__main__':
+    AssumeutxoTest().main()
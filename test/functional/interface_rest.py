@@ -318,6 +318,36 @@ class RESTTest (BitcoinTestFramework):
                 self.test_rest_request(f"/headers/{bb_hash}", ret_type=RetType.BYTES, status=400, query_params={"count": num}),
             )
 
+        self.log.info("Test the /blocks and /blockheaders range URIs")
+        tip_height = self.nodes[0].getblockcount()
+        start = tip_height - 4
+        hashes = [self.nodes[0].getblockhash(height) for height in range(start, tip_height + 1)]
+        blocks_bytes = b''.join(self.test_rest_request(f"/block/{h}", req_type=ReqType.BIN, ret_type=RetType.BYTES) for h in hashes)
+        # The range is cut off at the tip
+        assert_equal(self.test_rest_request(f"/blocks/{start}/10", req_type=ReqType.BIN, ret_type=RetType.BYTES), blocks_bytes)
+        response_hex = self.test_rest_request(f"/blocks/{start}/5", req_type=ReqType.HEX, ret_type=RetType.BYTES)
+        assert_equal(response_hex.strip(b'\n'), blocks_bytes.hex().encode())
+        self.test_rest_request(f"/blocks/{start}/5", status=404, ret_type=RetType.OBJ)
+        resp = self.test_rest_request(f"/blocks/{tip_height + 1}/1", req_type=ReqType.BIN, ret_type=RetType.OBJ, status=404)
+        assert_equal(resp.read().decode('utf-8').rstrip(), "Block height out of range")
+        for num in ['0', '1001', '-1', 'a']:
+            resp = self.test_rest_request(f"/blocks/{start}/{num}", req_type=ReqType.BIN, ret_type=RetType.OBJ, status=400)
+            assert_equal(resp.read().decode('utf-8').rstrip(), f"Count is invalid or out of acceptable range (1-1000): {num}")
+
+        # Fixed size records: header, height, flags, stake modifier, proof-of-stake hash, stake prevout, stake time, mint, money supply
+        record_size = BLOCK_HEADER_SIZE + 4 + 4 + 8 + 32 + 36 + 4 + 8 + 8
+        headers_bytes = self.test_rest_request(f"/blockheaders/{start}/5", req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        assert_equal(len(headers_bytes), 5 * record_size)
+        headers_json = self.test_rest_request(f"/blockheaders/{start}/5")
+        for i, header in enumerate(headers_json):
+            record = headers_bytes[i * record_size:(i + 1) * record_size]
+            assert_equal(record[:BLOCK_HEADER_SIZE], self.test_rest_request(f"/headers/{hashes[i]}", req_type=ReqType.BIN, ret_type=RetType.BYTES, query_params={"count": 1}))
+            assert_equal(int.from_bytes(record[BLOCK_HEADER_SIZE:BLOCK_HEADER_SIZE + 4], 'little'), start + i)
+            assert_equal(header['hash'], hashes[i])
+            rpc_block = self.nodes[0].getblock(hashes[i])
+            for key in ['flags', 'proofhash', 'entropybit', 'modifier', 'mint']:
+                assert_equal(header[key], rpc_block[key])
+
         self.log.info("Test tx inclusion in the /mempool and /block URIs")
 
         # Make 3 chained txs and mine them on node 1
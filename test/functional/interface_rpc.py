@@ -48,6 +48,13 @@ class RPCInterfaceTest(BitcoinTestFramework):
         assert_greater_than_or_equal(command['duration'], 0)
         assert_equal(info['logpath'], os.path.join(self.nodes[0].datadir, self.chain, 'debug.log'))
 
+        queues = {q['name']: q for q in info['work_queues']}
+        assert_equal(sorted(queues), ['long_running', 'rest', 'rpc_chain', 'rpc_wallet'])
+        assert_equal(queues['rpc_chain']['active'], 1)
+        assert_equal(queues['rpc_chain']['max_queued'], 16)
+        assert_equal(queues['rpc_chain']['threads'], 4)
+        assert_equal(queues['rpc_wallet']['threads'], 2)
+
     def test_batch_request(self):
         self.log.info("Testing basic JSON-RPC batch request...")
 
@@ -74,6 +81,29 @@ class RPCInterfaceTest(BitcoinTestFramework):
         assert_equal(result_by_id[3]['error'], None)
         assert result_by_id[3]['result'] is not None
 
+    def test_parallel_batch_request(self):
+        self.log.info("Testing ordering of parallel JSON-RPC batch requests...")
+
+        node = self.nodes[0]
+        self.generate(node, 10)
+        requests = []
+        for height in range(11):
+            requests.append({"method": "getblockhash", "id": len(requests), "params": [height]})
+        # Non read-only method acting as a barrier between two parallel runs.
+        requests.append({"method": "invalidmethod", "id": len(requests)})
+        for height in range(11):
+            requests.append({"method": "getblockheader", "id": len(requests), "params": [node.getblockhash(height)]})
+
+        results = node.batch(requests)
+        assert_equal([res["id"] for res in results], list(range(len(requests))))
+        for height in range(11):
+            assert_equal(results[height]["result"], node.getblockhash(height))
+            assert_equal(results[12 + height]["result"]["height"], height)
+        assert_equal(results[11]["error"]["code"], -32601)
+
+        self.restart_node(0, ['-rpcbatchthreads=0'])
+        assert_equal(node.batch(requests), results)
+
     def test_http_status_codes(self):
         self.log.info("Testing HTTP status codes for JSON-RPC requests...")
 
@@ -82,7 +112,7 @@ class RPCInterfaceTest(BitcoinTestFramework):
 
     def test_work_queue_exceeded(self):
         self.log.info("Testing work queue exceeded...")
-        self.restart_node(0, ['-rpcworkqueue=1', '-rpcthreads=1'])
+        self.restart_node(0, ['-rpcworkqueue=1', '-rpcthreads=1', '-rpclongthreads=1'])
         got_exceeded_error = []
         threads = []
         for _ in range(3):
@@ -92,11 +122,32 @@ class RPCInterfaceTest(BitcoinTestFramework):
         for t in threads:
             t.join()
 
+    def test_work_queue_isolation(self):
+        self.log.info("Testing that long-running calls do not block other RPCs...")
+        self.restart_node(0, ['-rpcworkqueue=1', '-rpcthreads=1', '-rpclongthreads=1'])
+        node = self.nodes[0]
+        height = node.getblockcount()
+        waiters = [Thread(target=lambda: node.cli("waitfornewblock", "3000").send_cli()) for _ in range(2)]
+        for t in waiters:
+            t.start()
+        self.wait_until(lambda: {q['name']: q for q in node.getrpcinfo()['work_queues']}['long_running']['queued'] == 1)
+        # Both the long-running worker and its queue are taken, other calls are still served
+        for _ in range(5):
+            assert_equal(node.getblockcount(), height)
+        for t in waiters:
+            t.join()
+        queues = {q['name']: q for q in node.getrpcinfo()['work_queues']}
+        assert_equal(queues['long_running']['processed'], 2)
+        assert_greater_than_or_equal(queues['long_running']['max_exec_us'], 3000 * 1000)
+        assert_greater_than_or_equal(queues['rpc_chain']['processed'], 6)
+
     def run_test(self):
         self.test_getrpcinfo()
         self.test_batch_request()
+        self.test_parallel_batch_request()
         self.test_http_status_codes()
         self.test_work_queue_exceeded()
+        self.test_work_queue_isolation()
 
 
 if __name__ == '__main__':
@@ -22,6 +22,7 @@ from test_framework.messages import (
 )
 from test_framework.util import (
     assert_equal,
+    assert_greater_than,
     assert_raises_rpc_error,
     p2p_port,
 )
@@ -71,7 +72,7 @@ class ZMQSubscriber:
         label = chr(body[32])
         mempool_sequence = None if len(body) != 32+1+8 else struct.unpack("<Q", body[32+1:])[0]
         if mempool_sequence is not None:
-            assert label == "A" or label == "R"
+            assert label in ("A", "R", "S", "M", "E")
         else:
             assert label == "D" or label == "C"
         return (hash, label, mempool_sequence)
@@ -120,6 +121,7 @@ class ZMQTest (BitcoinTestFramework):
             self.test_basic()
             self.test_sequence()
             self.test_mempool_sync()
+            self.test_mempool_snapshot()
             self.test_reorg()
             self.test_multiple_interfaces()
             self.test_ipv6()
@@ -234,12 +236,18 @@ class ZMQTest (BitcoinTestFramework):
 
 
         self.log.info("Test the getzmqnotifications RPC")
-        assert_equal(self.nodes[0].getzmqnotifications(), [
+        notifications = self.nodes[0].getzmqnotifications()
+        assert_equal([{key: n[key] for key in ("type", "address", "hwm")} for n in notifications], [
             {"type": "pubhashblock", "address": address, "hwm": 1000},
             {"type": "pubhashtx", "address": address, "hwm": 1000},
             {"type": "pubrawblock", "address": address, "hwm": 1000},
             {"type": "pubrawtx", "address": address, "hwm": 1000},
         ])
+        for n in notifications:
+            assert_equal(n["queued"], 0)
+            assert_greater_than(n["sent"], 0)
+            assert_equal(n["dropped"], 0)
+            assert_equal(n["failed"], 0)
 
         assert_equal(self.nodes[1].getzmqnotifications(), [])
 
@@ -333,15 +341,7 @@ class ZMQTest (BitcoinTestFramework):
         assert_equal((payment_txid, "A", seq_num), seq.receive_sequence())
         seq_num += 1
 
-        self.log.info("Testing RBF notification")
-        # Replace it to test eviction/addition notification
-        payment_tx['tx'].vout[0].nValue -= 1000
-        rbf_txid = self.nodes[1].sendrawtransaction(payment_tx['tx'].serialize().hex())
-        self.sync_all()
-        assert_equal((payment_txid, "R", seq_num), seq.receive_sequence())
-        seq_num += 1
-        assert_equal((rbf_txid, "A", seq_num), seq.receive_sequence())
-        seq_num += 1
+        # peercoin: replacement is disabled, so there is no RBF notification
 
         # Doesn't get published when mined, make a block and tx to "flush" the possibility
         # though the mempool sequence number does go up by the number of transactions
@@ -381,7 +381,7 @@ class ZMQTest (BitcoinTestFramework):
         assert self.nodes[0].getrawmempool(mempool_sequence=True)["mempool_sequence"] > seq_num
 
         assert_equal((best_hash, "D", None), seq.receive_sequence())
-        assert_equal((rbf_txid, "A", seq_num), seq.receive_sequence())
+        assert_equal((payment_txid, "A", seq_num), seq.receive_sequence())
         seq_num += 1
 
         # Other things may happen but aren't wallet-deterministic so we don't test for them currently
@@ -397,11 +397,13 @@ class ZMQTest (BitcoinTestFramework):
         for _ in range(5):
             more_tx.append(self.wallet.send_self_transfer(from_node=self.nodes[0]))
 
+        # peercoin: replacement is disabled, so the conflicting tx is only mined
         orig_tx['tx'].vout[0].nValue -= 1000
-        bump_txid = self.nodes[0].sendrawtransaction(orig_tx['tx'].serialize().hex())
-        # Mine the pre-bump tx
-        txs_to_add = [orig_tx['hex']] + [tx['hex'] for tx in more_tx]
-        block = create_block(int(self.nodes[0].getbestblockhash(), 16), create_coinbase(self.nodes[0].getblockcount()+1), txlist=txs_to_add)
+        txs_to_add = [orig_tx['tx'].serialize().hex()] + [tx['hex'] for tx in more_tx]
+        # peercoin: follow the version and the (mock) time of the chain
+        tip_header = self.nodes[0].getblockheader(self.nodes[0].getbestblockhash())
+        block_time = tip_header['time'] + 1
+        block = create_block(int(tip_header['hash'], 16), create_coinbase(tip_header['height'] + 1, timestamp=block_time), block_time, version=tip_header['version'], txlist=txs_to_add)
         add_witness_commitment(block)
         block.solve()
         assert_equal(self.nodes[0].submitblock(block.serialize().hex()), None)
@@ -421,13 +423,8 @@ class ZMQTest (BitcoinTestFramework):
         for i in range(len(more_tx)):
             assert_equal((more_tx[i]['txid'], "A", mempool_seq), seq.receive_sequence())
             mempool_seq += 1
-        # Bumped by rbf
-        assert_equal((orig_txid, "R", mempool_seq), seq.receive_sequence())
-        mempool_seq += 1
-        assert_equal((bump_txid, "A", mempool_seq), seq.receive_sequence())
-        mempool_seq += 1
         # Conflict announced first, then block
-        assert_equal((bump_txid, "R", mempool_seq), seq.receive_sequence())
+        assert_equal((orig_txid, "R", mempool_seq), seq.receive_sequence())
         mempool_seq += 1
         assert_equal((tip, "C", None), seq.receive_sequence())
         mempool_seq += len(more_tx)
@@ -478,11 +475,9 @@ class ZMQTest (BitcoinTestFramework):
             get_raw_seq = mempool_snapshot["mempool_sequence"]
 
         # Things continue to happen in the "interim" while waiting for snapshot results
-        # We have node 0 do all these to avoid p2p races with RBF announcements
+        # peercoin: replacement is disabled, so there is no RBF announcement
         for _ in range(num_txs):
             txs.append(self.wallet.send_self_transfer(from_node=self.nodes[0]))
-        txs[-1]['tx'].vout[0].nValue -= 1000
-        self.nodes[0].sendrawtransaction(txs[-1]['tx'].serialize().hex())
         self.sync_all()
         self.generatetoaddress(self.nodes[0], 1, ADDRESS_BCRT1_UNSPENDABLE)
         final_txid = self.wallet.send_self_transfer(from_node=self.nodes[0])['txid']
@@ -498,10 +493,10 @@ class ZMQTest (BitcoinTestFramework):
                     raise Exception(f"We somehow jumped mempool sequence numbers! zmq_mem_seq: {zmq_mem_seq} > get_raw_seq: {get_raw_seq}")
 
         # 4) Moving forward, we apply the delta to our local view
-        #    remaining txs(5) + 1 rbf(A+R) + 1 block connect + 1 final tx
+        #    remaining txs(5) + 1 block connect + 1 final tx
         expected_sequence = get_raw_seq
         r_gap = 0
-        for _ in range(num_txs + 2 + 1 + 1):
+        for _ in range(num_txs + 1 + 1):
             (hash_str, label, mempool_sequence) = seq.receive_sequence()
             if mempool_sequence is not None:
                 if mempool_sequence != expected_sequence:
@@ -542,6 +537,44 @@ class ZMQTest (BitcoinTestFramework):
 
         self.generatetoaddress(self.nodes[0], 1, ADDRESS_BCRT1_UNSPENDABLE)
 
+    def test_mempool_snapshot(self):
+        """
+        Use the mempool snapshot published on the sequence topic to "sync mempool"
+        """
+
+        self.log.info("Testing mempool snapshot on the sequence notifier")
+        [seq] = self.setup_zmq_test([("sequence", f"tcp://127.0.0.1:{self.zmq_port_base}")])
+        assert_raises_rpc_error(-1, "No -zmqpubsequence notification is active", self.nodes[1].publishmempoolsnapshot)
+
+        for _ in range(3):
+            self.wallet.send_self_transfer(from_node=self.nodes[0])
+        snapshot = self.nodes[0].publishmempoolsnapshot()
+        # Changes after the snapshot are published after it
+        final_txid = self.wallet.send_self_transfer(from_node=self.nodes[0])['txid']
+
+        # Skip the notifications that came before the snapshot
+        (hash_str, label, mempool_sequence) = seq.receive_sequence()
+        while label != "S":
+            (hash_str, label, mempool_sequence) = seq.receive_sequence()
+        assert_equal(hash_str, snapshot["bestblock"])
+        assert_equal(mempool_sequence, snapshot["mempool_sequence"])
+
+        mempool_view = set()
+        (hash_str, label, mempool_sequence) = seq.receive_sequence()
+        while label == "M":
+            assert_equal(mempool_sequence, snapshot["mempool_sequence"])
+            mempool_view.add(hash_str)
+            (hash_str, label, mempool_sequence) = seq.receive_sequence()
+        assert_equal((hash_str, label), (snapshot["bestblock"], "E"))
+        assert_equal(len(mempool_view), snapshot["size"])
+
+        (hash_str, label, mempool_sequence) = seq.receive_sequence()
+        assert_equal((hash_str, label, mempool_sequence), (final_txid, "A", snapshot["mempool_sequence"]))
+        mempool_view.add(hash_str)
+        assert_equal(mempool_view, set(self.nodes[0].getrawmempool()))
+
+        self.generatetoaddress(self.nodes[0], 1, ADDRESS_BCRT1_UNSPENDABLE)
+
     def test_multiple_interfaces(self):
         # Set up two subscribers with different addresses
         # (note that after the reorg test, syncing would fail due to different
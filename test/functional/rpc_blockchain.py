@@ -133,6 +133,7 @@ class BlockchainTest(BitcoinTestFramework):
             'headers',
             'initialblockdownload',
             'mediantime',
+            'moneysupply',
             'pruned',
             'size_on_disk',
             'time',
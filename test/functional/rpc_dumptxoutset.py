@@ -12,17 +12,22 @@ from test_framework.util import assert_equal, assert_raises_rpc_error
 import hashlib
 from pathlib import Path
 
+# Past the switch to the BIPs of Bitcoin 0.16, so the proof-of-work blocks need
+# no block signature
+MOCKTIME = 1700000000
+
 
 class DumptxoutsetTest(BitcoinTestFramework):
     def set_test_params(self):
         self.setup_clean_chain = True
         self.num_nodes = 1
+        # The kernel transactions of the stake state are read from the index
+        self.extra_args = [["-txindex"]]
 
     def run_test(self):
         """Test a trivial usage of the dumptxoutset RPC command."""
         node = self.nodes[0]
-        mocktime = node.getblockheader(node.getblockhash(0))['time'] + 1
-        node.setmocktime(mocktime)
+        node.setmocktime(MOCKTIME)
         self.generate(node, COINBASE_MATURITY)
 
         FILENAME = 'txoutset.dat'
@@ -37,17 +42,20 @@ class DumptxoutsetTest(BitcoinTestFramework):
         # Blockhash should be deterministic based on mocked time.
         assert_equal(
             out['base_hash'],
-            '09abf0e7b510f61ca6cf33bab104e9ee99b3528b371d27a2d4b39abb800fba7e')
+            '2458526e91fb01f509e9ad9f7947bf150e568db114cfc1be174565c3d19c639e')
 
         with open(str(expected_path), 'rb') as f:
             digest = hashlib.sha256(f.read()).hexdigest()
             # UTXO snapshot hash should be deterministic based on mocked time.
             assert_equal(
-                digest, 'b1bacb602eacf5fbc9a7c2ef6eeb0d229c04e98bdf0c2ea5929012cd0eae3830')
+                digest, 'de65f88bae64b6be8ab6c5228587a6eaebce740a0d7b454b51ebdbb6e271020d')
 
         assert_equal(
-            out['txoutset_hash'], '1f7e3befd45dc13ae198dfbb22869a9c5c4196f8e9ef9735831af1288033f890')
+            out['txoutset_hash'], '3763a5e0eb4199f997c220b25338f33e273441c6aa304993328a12f2a14b8a29')
         assert_equal(out['nchaintx'], 101)
+        # The stake state of every block since genesis is carried along.
+        assert_equal(out['stake_blocks'], 100)
+        assert_equal(out['stake_hash'], 'e9bdef09900060f2a9c44991e95857a5e177266be8e2cba3b50d892f101d0e0b')
 
         # Specifying a path to an existing or invalid file will fail.
         assert_raises_rpc_error(
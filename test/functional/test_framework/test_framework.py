@@ -48,6 +48,9 @@ TEST_EXIT_SKIPPED = 77
 
 TMPDIR_PREFIX = "bitcoin_func_test_"
 
+# peercoin: nBTC16BIPsTestSwitchTime, from when proof-of-work blocks need no block signature
+TIME_BTC16_BIPS_TEST_SWITCH = 1554811200
+
 
 class SkipTest(Exception):
     """This exception is raised to skip a test"""
@@ -803,7 +806,9 @@ class BitcoinTestFramework(metaclass=BitcoinTestMetaClass):
             cache_node.wait_for_rpc_connection()
 
             # Set a time in the past, so that blocks don't end up in the future
-            cache_node.setmocktime(cache_node.getblockheader(cache_node.getbestblockhash())['time'])
+            # peercoin: but not before the BTC16 BIPs, so that proof-of-work
+            # blocks do not need a block signature
+            cache_node.setmocktime(max(cache_node.getblockheader(cache_node.getbestblockhash())['time'], TIME_BTC16_BIPS_TEST_SWITCH))
 
             # Create a 199-block-long chain; each of the 3 first nodes
             # gets 25 mature blocks and 25 immature.
@@ -424,7 +424,7 @@ def get_datadir_path(dirname, n):
 
 
 def append_config(datadir, options):
-    with open(os.path.join(datadir, "bitcoin.conf"), 'a', encoding='utf8') as f:
+    with open(os.path.join(datadir, "peercoin.conf"), 'a', encoding='utf8') as f:
         for option in options:
             f.write(option + "\n")
 
@@ -249,6 +249,7 @@ BASE_SCRIPTS = [
     'rpc_getblockfrompeer.py',
     'rpc_invalidateblock.py',
     'feature_utxo_set_hash.py',
+    'feature_assumeutxo.py',
     'mempool_packages.py',
     'mempool_package_onemore.py',
     'mempool_package_limits.py',
@@ -263,6 +264,10 @@ BASE_SCRIPTS = [
     'rpc_generate.py',
     'wallet_balance.py --legacy-wallet',
     'wallet_balance.py --descriptors',
+    'wallet_optimizeutxoset.py --legacy-wallet',
+    'wallet_optimizeutxoset.py --descriptors',
+    'wallet_staking.py --legacy-wallet',
+    'wallet_staking.py --descriptors',
     'p2p_initial_headers_sync.py',
     'feature_nulldummy.py',
     'mempool_accept.py',
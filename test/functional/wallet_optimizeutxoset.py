@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+# Copyright (c) 2026 The Peercoin developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the optimizeutxoset RPC.
+
+The wallet only counts coinbase outputs as mature after proof-of-stake blocks,
+so it is funded by spending coinbase outputs that consensus already allows to
+be spent. Without proof-of-stake blocks the chain stays at the minimum stake
+difficulty, where the expected reward grows linearly with the value of a coin.
+No split or merge gains anything there, so the plans keep every coin.
+"""
+from decimal import Decimal
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+    assert_raises_rpc_error,
+)
+
+# Past the switch to the BIPs of Bitcoin 0.16, so the proof-of-work blocks need
+# no block signature
+MOCKTIME = 1700000000
+
+
+class WalletOptimizeUtxoSetTest(BitcoinTestFramework):
+    def add_options(self, parser):
+        self.add_wallet_options(parser)
+
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-minting=0"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def fund_wallet(self, node):
+        """Move the outputs of the first coinbase transactions to a wallet address"""
+        node.setmocktime(MOCKTIME)
+        blocks = self.generatetoaddress(node, 5, node.getnewaddress())
+        self.generate(node, 60)
+        inputs = []
+        amount = Decimal("0")
+        for block in blocks:
+            coinbase = node.getblock(block, 2)["tx"][0]
+            inputs.append({"txid": coinbase["txid"], "vout": 0})
+            amount += coinbase["vout"][0]["value"]
+        raw_tx = node.createrawtransaction(inputs, {node.getnewaddress(): amount - Decimal("1")})
+        node.sendrawtransaction(node.signrawtransactionwithwallet(raw_tx)["hex"])
+        self.generate(node, 1)
+        assert_equal(len(node.listunspent()), 1)
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.fund_wallet(node)
+        address = node.getnewaddress()
+        target = Decimal("10")
+
+        self.log.info("Plan without transmitting")
+        plan = node.optimizeutxoset(address, target)
+        assert_equal(plan["target_amount"], target)
+        assert_equal(plan["transactions"], 0)
+        assert_equal(plan["coins_kept"], 1)
+        assert_equal(plan["fees"], 0)
+        assert_greater_than(plan["yearly_reward_before"], 0)
+        assert_equal(plan["yearly_reward_after"], plan["yearly_reward_before"])
+        assert_equal(plan["txs"], [])
+        # The keys of the single transaction are only there for a transaction
+        assert "tx" not in plan
+        assert "txids" not in plan
+
+        self.log.info("Plan with the target of the stake difficulty")
+        plan = node.optimizeutxoset(address)
+        assert_greater_than(plan["target_amount"], 0)
+        assert_equal(plan["transactions"], 0)
+
+        self.log.info("Plan without coins")
+        plan = node.optimizeutxoset(address, target, False, node.getnewaddress())
+        assert_equal(plan["transactions"], 0)
+        assert_equal(plan["coins_kept"], 0)
+        assert_equal(plan["yearly_reward_before"], 0)
+
+        self.log.info("Invalid arguments")
+        assert_raises_rpc_error(-8, "Invalid max_transactions", node.optimizeutxoset, address, target, False, None, {"max_transactions": 0})
+        assert_raises_rpc_error(-8, "Invalid horizon_days", node.optimizeutxoset, address, target, False, None, {"horizon_days": 0})
+        assert_raises_rpc_error(-8, "Invalid max_tx_size", node.optimizeutxoset, address, target, False, None, {"max_tx_size": 999})
+        assert_raises_rpc_error(-5, "Invalid Peercoin address", node.optimizeutxoset, "notanaddress", target)
+
+        self.log.info("Transmit the plan")
+        plan = node.optimizeutxoset(address, target, True)
+        assert_equal(plan["transactions"], 0)
+        assert_equal(plan["txids"], [])
+        assert "txid" not in plan
+        assert "txs" not in plan
+        assert_equal(node.getrawmempool(), [])
+
+
+if __name__ == '__main__':
+    WalletOptimizeUtxoSetTest().main()
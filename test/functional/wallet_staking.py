@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+# Copyright (c) 2026 The Peercoin developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test which wallets the proof-of-stake minter searches.
+
+The minter searches once the clock has moved on since its last search, so the
+test runs without mocked time. Coins only mature with proof-of-stake blocks,
+so the wallets are searched without any stake coins:
+
+- every loaded wallet is searched, and reports it in getwalletinfo
+- the disable_staking flag leaves a wallet out until it is unset
+- a wallet without a mintkey address is retried every round
+- an unloaded wallet is dropped and searched again once reloaded
+"""
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+
+class WalletStakingTest(BitcoinTestFramework):
+    def add_options(self, parser):
+        self.add_wallet_options(parser)
+
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        # The kernel search needs the transaction index
+        self.extra_args = [["-txindex"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def searches(self, wallet):
+        return wallet.getwalletinfo()["staking"]["searches"]
+
+    def wait_for_searches(self, wallet):
+        """Wait until the minter searched the coins of the wallet twice more"""
+        start = self.searches(wallet)
+        self.wait_until(lambda: self.searches(wallet) >= start + 2)
+
+    def run_test(self):
+        node = self.nodes[0]
+        default = node.get_wallet_rpc(self.default_wallet_name)
+
+        self.log.info("The default wallet is searched")
+        self.wait_for_searches(default)
+        staking = default.getwalletinfo()["staking"]
+        assert_equal(staking["enabled"], True)
+        assert staking["last_search"] > 0
+        for key in ["coins", "balance", "kernels", "blocks"]:
+            assert key in staking
+
+        self.log.info("A second wallet is searched next to the first one")
+        node.createwallet(wallet_name="second")
+        second = node.get_wallet_rpc("second")
+        self.wait_for_searches(second)
+        self.wait_for_searches(default)
+
+        self.log.info("disable_staking leaves the wallet out")
+        second.setwalletflag("disable_staking", True)
+        assert_equal(second.getwalletinfo()["staking"]["enabled"], False)
+        # Wait for a round that started after the flag was set
+        self.wait_for_searches(default)
+        searches = self.searches(second)
+        self.wait_for_searches(default)
+        assert_equal(self.searches(second), searches)
+
+        second.setwalletflag("disable_staking", False)
+        assert_equal(second.getwalletinfo()["staking"]["enabled"], True)
+        self.wait_for_searches(second)
+
+        self.log.info("An unloaded wallet is searched again once reloaded")
+        second.unloadwallet()
+        self.wait_for_searches(default)
+        node.loadwallet("second")
+        # The counters start over with the new wallet instance
+        self.wait_for_searches(second)
+
+        self.log.info("A wallet without a mintkey address is retried every round")
+        node.createwallet(wallet_name="blank", blank=True)
+        blank = node.get_wallet_rpc("blank")
+        with node.assert_debug_log(expected_msgs=["[blank] Error in PeercoinMiner: Keypool ran out"], timeout=10):
+            self.wait_for_searches(default)
+        self.wait_for_searches(default)
+        assert_equal(self.searches(blank), 0)
+        if self.options.descriptors:
+            # Import the legacy address descriptor the mintkey is drawn from
+            descriptor = next(d for d in default.listdescriptors(True)["descriptors"] if d["desc"].startswith("pkh(") and not d["internal"])
+            res = blank.importdescriptors([{"desc": descriptor["desc"], "timestamp": "now", "active": True}])
+            assert_equal(res[0]["success"], True)
+        else:
+            blank.sethdseed()
+        self.wait_for_searches(blank)
+        assert blank.getaddressesbylabel("mintkey")
+
+
+if __name__ == '__main__':
+    WalletStakingTest().main()